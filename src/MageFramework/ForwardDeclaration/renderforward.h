@@ -7,7 +7,7 @@ enum class RENDER_TYPE { RASTERIZATION, RAYTRACE, HYBRID };
 enum class PIPELINE_TYPE { COMPUTE, RASTER, RAYTRACE, POST_PROCESS };
 enum class POST_PROCESS_TYPE { HIGH_RESOLUTION, TONEMAP, LOW_RESOLUTION };
 enum class DSL_TYPE {
-	COMPUTE, MODEL, TIME, LIGHTS,
+	COMPUTE, MODEL, BINDLESS_MATERIALS, TIME, LIGHTS,
 	POST_PROCESS, BEFOREPOST_FRAME, POST_HRFRAME1, POST_HRFRAME2, POST_LRFRAME1, POST_LRFRAME2
 };
 
@@ -23,6 +23,18 @@ struct RendererOptions
 	float minSampleShading; // value between 0.0f and 1.0f --> closer to one is smoother
 	bool enableAnisotropy; // Anisotropic filtering -- image sampling will use anisotropic filter
 	float anisotropy; //controls level of anisotropic filtering
+	bool batchTexturesIntoArrays = false; // Packs the scene's textures into texture arrays the bindless materials sample from (see TextureArrayBuilder), needs bindlessTextures
+	bool bindlessTextures = false; // Rasterization only -- one descriptor set for all materials, falls back if VK_EXT_descriptor_indexing is missing
+	bool recordEveryFrame = false; // Re-record the frame's command buffers every frame from transient pools instead of replaying prerecorded ones
+	uint32_t numRecordingThreads = 1; // Rasterization only -- more than 1 records the scene's draws into secondary command buffers in parallel, 0 picks a small count from the scene's size
+	bool timelineSemaphores = true; // One timeline semaphore per queue for frame synchronization, falls back to fences if VK_KHR_timeline_semaphore is missing
+	// Presentation -- the vulkan manager is created with these, see VulkanManager::VulkanManager
+	uint32_t framesInFlight = 3; // 1 to 4, how many frames the CPU may submit before it waits on the GPU
+	VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR; // FIFO, MAILBOX or IMMEDIATE, falls back to FIFO if the surface doesn't support it
+	bool lowLatency = false; // Waits for the previous frame to finish before the next frame's input is sampled
+	bool asyncCompute = true; // Compute gets its own queue family when the device has a compute only one, otherwise it shares the graphics queue
+	bool dedicatedTransfer = true; // Uploads go through a transfer only queue family when the device has one, otherwise through the graphics queue
+	bool lateLatchCamera = true; // Samples input right before the frame is submitted instead of before it waits for its image
 };
 
 struct Vertex
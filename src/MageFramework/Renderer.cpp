@@ -12,6 +12,7 @@ Renderer::Renderer(GLFWwindow* window,
 	m_camera(camera), m_rendererOptions(rendererOptions),
 	m_windowResized(false)
 {
+	HEAP_TRACKER_SCOPE(HEAP_TAG::RENDERER);
 	initialize(scene);
 }
 Renderer::~Renderer()
@@ -24,7 +25,7 @@ Renderer::~Renderer()
 		for (auto& modelElement : m_scene->m_modelMap)
 		{
 			auto model = modelElement.second;
-			vkFreeMemory(m_vulkanManager->getLogicalDevice(), model->m_bottomLevelAS.m_memory, nullptr);
+			VulkanMemoryTracker::free(m_vulkanManager->getLogicalDevice(), model->m_bottomLevelAS.m_memory);
 			m_rendererBackend->vkDestroyAccelerationStructureNV(
 				m_vulkanManager->getLogicalDevice(), model->m_bottomLevelAS.m_accelerationStructure, nullptr);
 		}
@@ -33,7 +34,47 @@ Renderer::~Renderer()
 
 void Renderer::initialize(JSONItem::Scene& scene)
 {
-	const uint32_t numFrames = m_vulkanManager->getSwapChainImageCount();
+	// Everything below depends on the render type, so this fallback comes first
+	if (m_rendererOptions.renderType == RENDER_TYPE::RAYTRACE && !m_vulkanManager->isRayTracingSupported())
+	{
+		m_rendererOptions.renderType = RENDER_TYPE::RASTERIZATION;
+#ifndef NDEBUG
+		std::cout << "Ray tracing unavailable, falling back to rasterization" << std::endl;
+#endif
+	}
+
+	// Bindless textures are an opt-in for the rasterization path, fall back to per primitive descriptor sets if the device can't do it
+	if (m_rendererOptions.bindlessTextures &&
+		(m_rendererOptions.renderType != RENDER_TYPE::RASTERIZATION || !m_vulkanManager->isDescriptorIndexingSupported()))
+	{
+		m_rendererOptions.bindlessTextures = false;
+#ifndef NDEBUG
+		std::cout << "Bindless textures unavailable, falling back to per primitive descriptor sets" << std::endl;
+#endif
+	}
+	// Only the bindless materials know how to sample a layer of a texture array. The batching was asked for explicitly,
+	// so turning it off is reported in every build rather than only in debug builds.
+	if (m_rendererOptions.batchTexturesIntoArrays && !m_rendererOptions.bindlessTextures)
+	{
+		m_rendererOptions.batchTexturesIntoArrays = false;
+		std::cout << "batchTexturesIntoArrays is ignored: texture arrays are only sampled by the bindless materials, which need "
+			<< "bindlessTextures, rasterization and descriptor indexing. Uploading the scene's textures individually." << std::endl;
+	}
+
+	m_vulkanManager->setUseTimelineSemaphores(m_rendererOptions.timelineSemaphores);
+	if (m_rendererOptions.timelineSemaphores && !m_vulkanManager->usesTimelineSemaphores())
+	{
+		m_rendererOptions.timelineSemaphores = false;
+#ifndef NDEBUG
+		std::cout << "Timeline semaphores unavailable, falling back to binary semaphores and fences" << std::endl;
+#endif
+	}
+
+	// Every sampler comes out of the resource cache which clamps anisotropy to this, so it has to be set before anything is loaded
+	m_vulkanManager->getResourceCache()->setMaxAnisotropy(m_rendererOptions.enableAnisotropy ? m_rendererOptions.anisotropy : 1.0f);
+
+	// Everything a frame writes is owned by its frame in flight, only the swapchain framebuffers are per swapchain image
+	const uint32_t numFrames = m_vulkanManager->getNumFramesInFlight();
 	const VkExtent2D windowsExtent = m_vulkanManager->getSwapChainVkExtent();
 	m_rendererBackend = std::make_shared<VulkanRendererBackend>(m_vulkanManager, m_rendererOptions, numFrames, windowsExtent);
 
@@ -42,7 +83,8 @@ void Renderer::initialize(JSONItem::Scene& scene)
 	VkCommandPool computeCmdPool = m_rendererBackend->getComputeCommandPool();
 	VkCommandPool graphicsCmdPool = m_rendererBackend->getGraphicsCommandPool();
 	m_scene = std::make_shared<Scene>(m_vulkanManager, scene, m_rendererOptions.renderType, numFrames, windowsExtent, 
-		graphicsQueue, graphicsCmdPool, computeQueue, computeCmdPool );
+		graphicsQueue, graphicsCmdPool, computeQueue, computeCmdPool, m_rendererOptions.batchTexturesIntoArrays, m_rendererOptions.bindlessTextures );
+	m_rendererBackend->createRecordingThreads(static_cast<uint32_t>(m_scene->m_modelMap.size()));
 
   	m_rendererBackend->createSyncObjects();
 	setupDescriptorSets();
@@ -62,8 +104,18 @@ void Renderer::initialize(JSONItem::Scene& scene)
 
 	m_rendererBackend->createAllPostProcessEffects(m_scene);
 
+#ifndef NDEBUG
+	std::shared_ptr<VulkanResourceCache> resourceCache = m_vulkanManager->getResourceCache();
+	std::cout << "Resource cache: " << resourceCache->getNumSamplerRequests() << " sampler requests -> " 
+		<< resourceCache->getNumSamplers() << " samplers, " << resourceCache->getNumImageViewRequests() << " image view requests -> "
+		<< resourceCache->getNumImageViews() << " image views" << std::endl;
+#endif
+
 	writeToAndUpdateDescriptorSets();
-	m_rendererBackend->recordAllCommandBuffers(m_camera, m_scene);
+	if (!m_rendererOptions.recordEveryFrame)
+	{
+		m_rendererBackend->recordAllCommandBuffers(m_camera, m_scene);
+	}
 
 	m_UI = std::make_shared<UIManager>(m_window, m_vulkanManager, m_rendererOptions);
 }
@@ -78,7 +130,12 @@ void Renderer::recreate()
 		glfwWaitEvents();
 	}
 
-	vkDeviceWaitIdle(m_vulkanManager->getLogicalDevice());
+	// No device wait idle, the old swapchain, images and frame resources all go through the deletion queue.
+	// The descriptor sets are rewritten in place though, and a set may not be updated while a submitted frame still uses it,
+	// so the CPU waits for the frames already submitted to the graphics queue. The present, compute and upload queues keep going.
+	m_vulkanManager->waitForPreviousFrame();
+	// The image count can change, captures of the old images are picked up now (their copies finished with those frames)
+	m_vulkanManager->getFrameCapture()->collectAll();
 
 	cleanup();
 
@@ -103,43 +160,143 @@ void Renderer::recreate()
 	m_rendererBackend->createAllPostProcessEffects(m_scene);
 
 	writeToAndUpdateDescriptorSets();
-	m_rendererBackend->recordAllCommandBuffers(m_camera, m_scene);
+	if (!m_rendererOptions.recordEveryFrame)
+	{
+		m_rendererBackend->recordAllCommandBuffers(m_camera, m_scene);
+	}
 	
 	m_UI->resize(m_window);
 }
 void Renderer::cleanup()
 {
-	m_vulkanManager->cleanup();
+	// The swapchain or offscreen images belong to the VulkanManager, they outlive the renderer and are rebuilt by VulkanManager::recreate
 	m_rendererBackend->cleanup();
 }
 
 
 void Renderer::renderLoop(float prevFrameTime)
 {
+	// The previous frame's zones are complete, the UI shows them while this one runs
+	CpuProfiler::endFrame();
+	HeapTracker::endFrame();
+	CPU_PROFILE_SCOPE("Frame");
+	HEAP_TRACKER_SCOPE(HEAP_TAG::RENDERER);
+
+	if (!m_rendererOptions.lateLatchCamera)
+	{
+		sampleInput();
+	}
 	acquireNextSwapChainImage();
 
 	updateRenderState();
-	m_UI->update(prevFrameTime);
+	{
+		CPU_PROFILE_SCOPE("UI");
+		HEAP_TRACKER_SCOPE(HEAP_TAG::UI);
+		m_UI->update(prevFrameTime);
+	}
 	
-	m_rendererBackend->submitCommandBuffers();
-	VkSemaphore waitSemaphore = m_rendererBackend->getpostProcessFinishedVkSemaphore(m_vulkanManager->getImageIndex());
- 	VkSemaphore signalSemaphore = m_vulkanManager->getRenderFinishedVkSemaphore();
-	m_UI->submitDrawCommands(waitSemaphore, signalSemaphore);
+	if (m_rendererOptions.recordEveryFrame)
+	{
+		m_rendererBackend->recordFrameCommandBuffers(m_camera, m_scene);
+	}
+
+	// Late latching -- the input is sampled once the waits for the frame and its image and the recording are behind us,
+	// the camera uniforms are the last thing written before the submit either way
+	if (m_rendererOptions.lateLatchCamera)
+	{
+		sampleInput();
+	}
+	latchCamera();
+	submitFrame();
 
 	presentCurrentImageToSwapChainImage();
 }
+void Renderer::submitFrame()
+{
+	CPU_PROFILE_SCOPE("Submit");
+	const bool useTimelineSemaphores = m_vulkanManager->usesTimelineSemaphores();
+	VkQueue graphicsQueue = m_vulkanManager->getQueue(QueueFlags::Graphics);
+
+	// Upload batches hand their graphics side to the graphics queue ahead of the frame, this is the thread that owns that queue
+	m_vulkanManager->getUploadQueue()->update();
+
+	m_frameSubmission.begin(useTimelineSemaphores);
+	m_rendererBackend->addCommandBuffersToSubmission(m_frameSubmission);
+	m_frameSubmission.addCommandBuffer(graphicsQueue, m_UI->recordDrawCommands());
+	// Copies the finished image out when the frame is captured, picked up once the image comes around again
+	const uint32_t imageIndex = m_vulkanManager->getImageIndex();
+	VkCommandBuffer captureCmdBuffer = m_vulkanManager->getFrameCapture()->recordCapture(imageIndex,
+		m_vulkanManager->canCopyFromSwapChainImages() ? m_vulkanManager->getSwapChainImage(imageIndex) : VK_NULL_HANDLE,
+		m_vulkanManager->getSwapChainImageFormat(), m_vulkanManager->getSwapChainVkExtent(), m_vulkanManager->getPresentLayout());
+	if (captureCmdBuffer != VK_NULL_HANDLE)
+	{
+		m_frameSubmission.addCommandBuffer(graphicsQueue, captureCmdBuffer);
+	}
+
+	// The UI is the last work of the frame, presentation waits on the binary semaphore and the CPU on the graphics timeline or the fence
+	if (!m_vulkanManager->isHeadless())
+	{
+		m_frameSubmission.addSignal(graphicsQueue, m_vulkanManager->getRenderFinishedVkSemaphore());
+	}
+	if (useTimelineSemaphores)
+	{
+		m_frameSubmission.addSignal(graphicsQueue, m_vulkanManager->getTimelineSemaphore(QueueFlags::Graphics),
+			m_vulkanManager->getNextTimelineValue(QueueFlags::Graphics));
+	}
+	else
+	{
+		m_frameSubmission.setFence(graphicsQueue, m_vulkanManager->getInFlightFence());
+	}
+
+	m_frameSubmission.submit();
+	// The frame's serial is handed out once it is presented
+	m_vulkanManager->getGpuProfiler()->slotSubmitted(m_vulkanManager->getFrameIndex(), m_vulkanManager->getSubmittedFrameCount() + 1);
+}
+void Renderer::prepareInputSampling()
+{
+	if (m_rendererOptions.lowLatency)
+	{
+		m_vulkanManager->waitForPreviousFrame();
+	}
+}
+void Renderer::sampleInput()
+{
+	CPU_PROFILE_SCOPE("Sample Input");
+	if (m_inputSampler)
+	{
+		m_inputSampler();
+	}
+	m_camera->applyPendingInput();
+	m_vulkanManager->markInputSampled();
+}
+void Renderer::latchCamera()
+{
+	// The frame in flight's last frame has finished by now, its camera buffer is free to overwrite
+	const uint32_t frameIndex = m_vulkanManager->getFrameIndex();
+	m_camera->updateUniformBuffer(frameIndex);
+	m_camera->copyToGPUMemory(frameIndex);
+}
+void Renderer::removeModel(const std::string& name)
+{
+	if (!m_rendererOptions.recordEveryFrame)
+	{
+		throw std::runtime_error("removing models requires the command buffers to be recorded every frame");
+	}
+	m_scene->removeModel(name);
+}
 void Renderer::updateRenderState()
 {
+	CPU_PROFILE_SCOPE("Update Render State");
 	// Update Uniforms
-	const uint32_t currentImageIndex = m_vulkanManager->getImageIndex();
+	const uint32_t frameIndex = m_vulkanManager->getFrameIndex();
 	{
-		m_camera->updateUniformBuffer(currentImageIndex);
-		m_scene->updateUniforms(currentImageIndex);
-		m_rendererBackend->update(currentImageIndex);
+		m_scene->updateUniforms(frameIndex);
+		m_rendererBackend->update(frameIndex);
 	}
 }
 void Renderer::acquireNextSwapChainImage()
 {
+	CPU_PROFILE_SCOPE("Acquire");
 	// Wait for the the frame to be finished before working on it
 	m_vulkanManager->waitForFrameInFlightFence();
 
@@ -153,10 +310,15 @@ void Renderer::acquireNextSwapChainImage()
 
 	m_vulkanManager->waitForImageInFlightFence();
 	m_vulkanManager->resetFrameInFlightFence();
+
+	// The frame in flight's last frame has finished and so have its timestamps, captures are copied out of the swapchain image
+	m_vulkanManager->getGpuProfiler()->collect(m_vulkanManager->getFrameIndex());
+	m_vulkanManager->getFrameCapture()->collect(m_vulkanManager->getImageIndex());
 }
 
 void Renderer::presentCurrentImageToSwapChainImage()
 {
+	CPU_PROFILE_SCOPE("Present");
 	// Return the image to the swapchain for presentation
 	bool result = m_vulkanManager->presentImageToSwapChain();
 	if (!result || m_windowResized)
@@ -167,6 +329,13 @@ void Renderer::presentCurrentImageToSwapChainImage()
 
 	m_vulkanManager->advanceCurrentFrameIndex();
 }
+void Renderer::readBackLastFrame(std::vector<unsigned char>& rgbaPixels)
+{
+	// The image index only moves on when the next frame acquires
+	m_vulkanManager->waitForPreviousFrame();
+	VkCommandPool graphicsCmdPool = m_rendererBackend->getGraphicsCommandPool();
+	m_vulkanManager->readBackSwapChainImage(m_vulkanManager->getImageIndex(), rgbaPixels, graphicsCmdPool);
+}
 
 
 void Renderer::setupDescriptorSets()
@@ -201,7 +370,8 @@ void Renderer::createAllPipelines()
 {
 	DescriptorSetLayouts allDSLs;
 	allDSLs.computeDSL						= { m_scene->getDescriptorSetLayout(DSL_TYPE::COMPUTE) };
-	allDSLs.rasterDSL						= { m_camera->m_DSL_camera, m_scene->getDescriptorSetLayout(DSL_TYPE::MODEL) };
+	allDSLs.rasterDSL						= { m_camera->m_DSL_camera,
+		m_scene->getDescriptorSetLayout(m_scene->usesBindlessTextures() ? DSL_TYPE::BINDLESS_MATERIALS : DSL_TYPE::MODEL) };
 	allDSLs.raytraceDSL						= { m_rendererBackend->m_DSL_rayTrace };
 
 	m_rendererBackend->createPipelines(allDSLs);	
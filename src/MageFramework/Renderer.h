@@ -1,6 +1,7 @@
 #pragma once
 
 #include <global.h>
+#include <functional>
 #include <Utilities/generalUtility.h>
 #include <Vulkan/Utilities/vPipelineUtil.h>
 #include <Vulkan/Utilities/vCommandUtil.h>
@@ -26,6 +27,22 @@ public:
 
 	void recreate();
 	void renderLoop(float frameStartTime);
+	// Call at the start of the frame. In low latency mode the previous frame has to finish first,
+	// so the input is sampled as late as possible relative to when the frame reaches the screen.
+	void prepareInputSampling();
+	// Polls the input devices when the frame samples its input, with lateLatchCamera that's after its image is acquired and its commands are recorded
+	void setInputSampler(std::function<void()> inputSampler) { m_inputSampler = inputSampler; }
+	// Only with recordEveryFrame, prerecorded command buffers keep drawing the model
+	void removeModel(const std::string& name);
+	void benchmarkDrawRecording(uint32_t numSyntheticModels) { m_rendererBackend->benchmarkDrawRecording(m_scene, m_camera, numSyntheticModels); }
+	float getLastRecordTime() const { return m_rendererBackend->getLastRecordTime(); } // ms
+	const VulkanFrameSubmission& getFrameSubmission() const { return m_frameSubmission; } // Submit stats of the last frame
+	const RendererOptions& getRendererOptions() const { return m_rendererOptions; } // With the device fallbacks applied
+	void setFixedTimeStep(float timeStep) { m_scene->setFixedTimeStep(timeStep); } // ms, see Scene::setFixedTimeStep
+	uint32_t getLastDrawCount() const { return m_rendererBackend->getDrawCount(m_vulkanManager->getPreviousFrameIndex()); } // Draws the last frame's command buffers make, without the UI
+	void setUIVisible(bool visible) { m_UI->setVisible(visible); } // Hidden the UI still runs its pass, it just draws nothing
+	// Headless only -- waits for the last frame and reads its final image back as RGBA8
+	void readBackLastFrame(std::vector<unsigned char>& rgbaPixels);
 	
 private:
 	void initialize(JSONItem::Scene& scene);
@@ -34,6 +51,9 @@ private:
 	// Render Loop Helpers
 	void acquireNextSwapChainImage();
 	void updateRenderState();
+	void sampleInput();
+	void latchCamera();
+	void submitFrame();
 	void presentCurrentImageToSwapChainImage();
 			
 	// Descriptors
@@ -54,4 +74,6 @@ private:
 	std::shared_ptr<UIManager> m_UI;
 	std::shared_ptr<Camera> m_camera;
 	std::shared_ptr<Scene> m_scene;
+	VulkanFrameSubmission m_frameSubmission;
+	std::function<void()> m_inputSampler;
 };
\ No newline at end of file
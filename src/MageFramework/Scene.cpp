@@ -1,18 +1,24 @@
 #include "Scene.h"
 
 Scene::Scene(std::shared_ptr<VulkanManager> vulkanManager, JSONItem::Scene& scene, 
-	RENDER_TYPE renderType, uint32_t numSwapChainImages, VkExtent2D windowExtents,
-	VkQueue& graphicsQueue, VkCommandPool& graphicsCommandPool,	VkQueue& computeQueue, VkCommandPool& computeCommandPool)
+	RENDER_TYPE renderType, uint32_t numFramesInFlight, VkExtent2D windowExtents,
+	VkQueue& graphicsQueue, VkCommandPool& graphicsCommandPool,	VkQueue& computeQueue, VkCommandPool& computeCommandPool,
+	bool batchTexturesIntoArrays, bool useBindlessTextures)
 	:  m_vulkanManager(vulkanManager), m_logicalDevice(vulkanManager->getLogicalDevice()), m_physicalDevice(vulkanManager->getPhysicalDevice()),
-	m_numSwapChainImages(numSwapChainImages), m_renderType(renderType),
+	m_numFramesInFlight(numFramesInFlight), m_renderType(renderType), m_batchTexturesIntoArrays(batchTexturesIntoArrays),
 	m_graphicsQueue(graphicsQueue),	m_graphicsCmdPool(graphicsCommandPool),
 	m_computeQueue(computeQueue), m_computeCmdPool(computeCommandPool)
 {
 	m_prevtime = std::chrono::high_resolution_clock::now();
 
-	m_timeUniform.resize(m_numSwapChainImages);
-	m_lightsUniform.resize(m_numSwapChainImages);
-	for (uint32_t i = 0; i < numSwapChainImages; i++)
+	if (useBindlessTextures)
+	{
+		m_bindlessMaterials = std::make_shared<BindlessMaterialTable>(m_vulkanManager);
+	}
+
+	m_timeUniform.resize(m_numFramesInFlight);
+	m_lightsUniform.resize(m_numFramesInFlight);
+	for (uint32_t i = 0; i < numFramesInFlight; i++)
 	{
 		initializeTimeUBO(i);
 		initializeLightsUBO(i);
@@ -24,15 +30,16 @@ Scene::~Scene()
 {
 	vkDeviceWaitIdle(m_logicalDevice);
 
-	if (m_modelMap.size() > 0)
+	if (m_modelMap.size() > 0 && !usesBindlessTextures())
 	{
 		vkDestroyDescriptorSetLayout(m_logicalDevice, m_DSL_model, nullptr);
 	}
+	m_bindlessMaterials = nullptr;
 	vkDestroyDescriptorSetLayout(m_logicalDevice, m_DSL_compute, nullptr);
 	vkDestroyDescriptorSetLayout(m_logicalDevice, m_DSL_time, nullptr);
 	vkDestroyDescriptorSetLayout(m_logicalDevice, m_DSL_lights, nullptr);
 
-	for (uint32_t i = 0; i < m_numSwapChainImages; i++)
+	for (uint32_t i = 0; i < m_numFramesInFlight; i++)
 	{
 		m_timeUniform[i].timeBuffer.unmap(m_logicalDevice);
 		m_timeUniform[i].timeBuffer.destroy(m_logicalDevice);
@@ -43,19 +50,50 @@ Scene::~Scene()
 
 	m_modelMap.clear();
 	m_textureMap.clear();
+	m_textureArrays.clear();
 }
 
 void Scene::createScene(JSONItem::Scene& scene)
 {
+	CPU_PROFILE_SCOPE("Create Scene");
+	HEAP_TRACKER_SCOPE(HEAP_TAG::SCENE);
+	TextureArrayBuilder textureArrayBuilder;
+	TextureArrayBuilder* l_textureArrayBuilder = m_batchTexturesIntoArrays ? &textureArrayBuilder : nullptr;
 	for (JSONItem::Model& jsonModel : scene.modelList)
 	{
 		std::shared_ptr<Model> model = std::make_shared<Model>(
-			m_vulkanManager, m_graphicsQueue, m_graphicsCmdPool, m_numSwapChainImages, jsonModel, true, m_renderType);
+			m_vulkanManager, m_graphicsQueue, m_graphicsCmdPool, m_numFramesInFlight, jsonModel, true, m_renderType, l_textureArrayBuilder);
 		m_modelMap.insert({ jsonModel.name, model });
 	}
+	// Every model is its own upload batch, they are all in flight by now and nothing reads them before this
+	m_vulkanManager->getUploadQueue()->flush();
+
+	if (m_batchTexturesIntoArrays)
+	{
+		// Pack every texture in the scene into texture arrays and let the materials know where their textures ended up
+		textureArrayBuilder.build(m_vulkanManager, m_graphicsQueue, m_graphicsCmdPool, true, m_textureArrays);
+		for (auto& model : m_modelMap)
+		{
+			model.second->assignTextureArraySlots(textureArrayBuilder);
+		}
+
+#ifndef NDEBUG
+		textureArrayBuilder.printSummary();
+#endif
+	}
+
+	if (usesBindlessTextures())
+	{
+		// Materials whose textures were packed sample them out of the arrays, those textures were never uploaded on their own
+		m_bindlessMaterials->setTextureArrays(m_textureArrays);
+		for (auto& model : m_modelMap)
+		{
+			m_bindlessMaterials->addModel(model.second);
+		}
+	}
 	
 	const VkExtent2D windowExtents = m_vulkanManager->getSwapChainVkExtent();
-	for (uint32_t i = 0; i < m_numSwapChainImages; i++)
+	for (uint32_t i = 0; i < m_numFramesInFlight; i++)
 	{
 		std::string name = "compute" + std::to_string(i);
 		std::shared_ptr<Texture2D> texture = std::make_shared<Texture2D>(m_vulkanManager, m_graphicsQueue, m_graphicsCmdPool, VK_FORMAT_R8G8B8A8_UNORM);
@@ -72,9 +110,10 @@ void Scene::recreate()
 	// Delete compute texture and recreate it
 	{
 		const VkExtent2D windowExtents = m_vulkanManager->getSwapChainVkExtent();
-		for (uint32_t i = 0; i < m_numSwapChainImages; i++)
+		for (uint32_t i = 0; i < m_numFramesInFlight; i++)
 		{
 			std::string name = "compute" + std::to_string(i);
+			m_vulkanManager->deferDestruction(m_textureMap[name]);
 			m_textureMap.erase(name);
 
 			std::shared_ptr<Texture2D> texture = std::make_shared<Texture2D>(m_vulkanManager, m_graphicsQueue, m_graphicsCmdPool, VK_FORMAT_R8G8B8A8_UNORM);
@@ -88,20 +127,43 @@ void Scene::recreate()
 	}
 }
 
-void Scene::updateUniforms(uint32_t currentImageIndex)
+void Scene::removeModel(const std::string& name)
 {
+	// Acceleration structures, bindless material slots and texture arrays are built once from every model in the scene
+	if (m_renderType != RENDER_TYPE::RASTERIZATION || usesBindlessTextures() || m_batchTexturesIntoArrays)
+	{
+		throw std::runtime_error("models can only be removed from rasterized scenes without bindless textures or texture arrays");
+	}
+	// The model descriptor set layout lives as long as there is a model
+	if (m_modelMap.size() == 1)
+	{
+		throw std::runtime_error("can't remove the last model of the scene");
+	}
+
+	std::unordered_map<std::string, std::shared_ptr<Model>>::const_iterator found = m_modelMap.find(name);
+	if (found == m_modelMap.end()) { throw std::runtime_error("failed to find the model specified"); }
+
+	// The model's descriptor sets stay allocated until the descriptor pool is recreated
+	m_vulkanManager->deferDestruction(found->second);
+	m_modelMap.erase(found);
+}
+
+void Scene::updateUniforms(uint32_t frameIndex)
+{
+	CPU_PROFILE_SCOPE("Scene Uniforms");
+	HEAP_TRACKER_SCOPE(HEAP_TAG::SCENE);
 	for (auto& model : m_modelMap)
 	{
-		model.second->updateUniformBuffer(currentImageIndex);
+		model.second->updateUniformBuffer(frameIndex);
 	}
 
-	updateTimeUBO(currentImageIndex);
-	updateLightsUBO(currentImageIndex);
+	updateTimeUBO(frameIndex);
+	updateLightsUBO(frameIndex);
 }
 
-void Scene::initializeTimeUBO(uint32_t currentImageIndex)
+void Scene::initializeTimeUBO(uint32_t frameIndex)
 {
-	TimeUniformBlock& l_timeUniformBlock = m_timeUniform[currentImageIndex].uniformBlock;
+	TimeUniformBlock& l_timeUniformBlock = m_timeUniform[frameIndex].uniformBlock;
 	l_timeUniformBlock.time.x = 0.0f;
 	l_timeUniformBlock.time.y += 0.0f;
 
@@ -130,15 +192,16 @@ void Scene::initializeTimeUBO(uint32_t currentImageIndex)
 
 	// We keep the buffer mapped to make it easier to copy data in update
 	// TODO: Unsure of memory/performance implications of keeping buffers mapped
-	BufferUtil::createMageBuffer(m_logicalDevice, m_physicalDevice, m_timeUniform[currentImageIndex].timeBuffer,
+	BufferUtil::createMageBuffer(m_logicalDevice, m_physicalDevice, m_timeUniform[frameIndex].timeBuffer,
 		sizeof(TimeUniformBlock), nullptr, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
-	m_timeUniform[currentImageIndex].timeBuffer.map(m_logicalDevice);
-	m_timeUniform[currentImageIndex].timeBuffer.copyDataToMappedBuffer(&l_timeUniformBlock);
+	m_timeUniform[frameIndex].timeBuffer.map(m_logicalDevice);
+	m_timeUniform[frameIndex].timeBuffer.copyDataToMappedBuffer(&l_timeUniformBlock);
 }
-void Scene::updateTimeUBO(uint32_t currentImageIndex)
+void Scene::updateTimeUBO(uint32_t frameIndex)
 {
-	TimeUniformBlock& l_timeUniformBlock = m_timeUniform[currentImageIndex].uniformBlock;
-	const float deltaTime = static_cast<float>(TimerUtil::getTimeElapsedSinceStart(m_prevtime));
+	TimeUniformBlock& l_timeUniformBlock = m_timeUniform[frameIndex].uniformBlock;
+	const float deltaTime = (m_fixedTimeStep > 0.0f) ? m_fixedTimeStep * static_cast<float>(++m_numFixedTimeSteps) :
+		static_cast<float>(TimerUtil::getTimeElapsedSinceStart(m_prevtime));
 
 	l_timeUniformBlock.time.x = deltaTime;
 	l_timeUniformBlock.time.y += l_timeUniformBlock.time.x;
@@ -146,48 +209,51 @@ void Scene::updateTimeUBO(uint32_t currentImageIndex)
 	l_timeUniformBlock.frameCount += 1;
 	l_timeUniformBlock.frameCount = l_timeUniformBlock.frameCount % 16;
 
-	m_timeUniform[currentImageIndex].timeBuffer.copyDataToMappedBuffer(&l_timeUniformBlock);
+	m_timeUniform[frameIndex].timeBuffer.copyDataToMappedBuffer(&l_timeUniformBlock);
 }
 
-void Scene::initializeLightsUBO(uint32_t currentImageIndex)
+void Scene::initializeLightsUBO(uint32_t frameIndex)
 {
-	LightsUniformBlock l_lightsUniformBlock = m_lightsUniform[currentImageIndex].uniformBlock;
-	float currentTime = m_timeUniform[currentImageIndex].uniformBlock.time.y * 0.0000001f;
+	LightsUniformBlock l_lightsUniformBlock = m_lightsUniform[frameIndex].uniformBlock;
+	float currentTime = m_timeUniform[frameIndex].uniformBlock.time.y * 0.0000001f;
 	l_lightsUniformBlock.lightPos =
 		glm::vec4(cos(glm::radians(currentTime * 360.0f)) * 40.0f,
 			-20.0f + sin(glm::radians(currentTime * 360.0f)) * 20.0f,
 			25.0f + sin(glm::radians(currentTime * 360.0f)) * 5.0f,
 			0.0f);
 
-	BufferUtil::createMageBuffer(m_logicalDevice, m_physicalDevice, m_lightsUniform[currentImageIndex].lightBuffer,
+	BufferUtil::createMageBuffer(m_logicalDevice, m_physicalDevice, m_lightsUniform[frameIndex].lightBuffer,
 		sizeof(LightsUniformBlock), nullptr, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
-	m_lightsUniform[currentImageIndex].lightBuffer.map(m_logicalDevice);
-	m_lightsUniform[currentImageIndex].lightBuffer.copyDataToMappedBuffer(&l_lightsUniformBlock);
+	m_lightsUniform[frameIndex].lightBuffer.map(m_logicalDevice);
+	m_lightsUniform[frameIndex].lightBuffer.copyDataToMappedBuffer(&l_lightsUniformBlock);
 }
-void Scene::updateLightsUBO(uint32_t currentImageIndex)
+void Scene::updateLightsUBO(uint32_t frameIndex)
 {
-	LightsUniformBlock l_lightsUniformBlock = m_lightsUniform[currentImageIndex].uniformBlock;
-	float currentTime = m_timeUniform[currentImageIndex].uniformBlock.time.y * 0.0000001f;
+	LightsUniformBlock l_lightsUniformBlock = m_lightsUniform[frameIndex].uniformBlock;
+	float currentTime = m_timeUniform[frameIndex].uniformBlock.time.y * 0.0000001f;
 	l_lightsUniformBlock.lightPos =
 		glm::vec4(cos(glm::radians(currentTime * 360.0f)) * 40.0f,
 			-20.0f + sin(glm::radians(currentTime * 360.0f)) * 20.0f,
 			25.0f + sin(glm::radians(currentTime * 360.0f)) * 5.0f,
 			0.0f);
 
-	m_lightsUniform[currentImageIndex].lightBuffer.copyDataToMappedBuffer(&l_lightsUniformBlock);
+	m_lightsUniform[frameIndex].lightBuffer.copyDataToMappedBuffer(&l_lightsUniformBlock);
 }
 
 void Scene::expandDescriptorPool(std::vector<VkDescriptorPoolSize>& poolSizes)
 {
-	// Models
-	for (auto& model : m_modelMap)
+	// Models -- the bindless material table allocates out of its own update after bind pool
+	if (!usesBindlessTextures())
 	{
-		model.second->addToDescriptorPoolSize(poolSizes);
+		for (auto& model : m_modelMap)
+		{
+			model.second->addToDescriptorPoolSize(poolSizes);
+		}
 	}
 
-	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_numSwapChainImages });  // Compute
-	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, m_numSwapChainImages }); // Time
-	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, m_numSwapChainImages }); // Lights
+	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_numFramesInFlight });  // Compute
+	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, m_numFramesInFlight }); // Time
+	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, m_numFramesInFlight }); // Lights
 }
 void Scene::createDescriptors(VkDescriptorPool descriptorPool)
 {
@@ -199,7 +265,12 @@ void Scene::createDescriptors(VkDescriptorPool descriptorPool)
 
 		// MODEL
 		// One Descriptor Set Layout for all the models we create
-		if (m_modelMap.size() > 0)
+		if (usesBindlessTextures())
+		{
+			// One Descriptor Set for all the materials in the scene
+			m_bindlessMaterials->createDescriptors();
+		}
+		else if (m_modelMap.size() > 0)
 		{
 			m_modelMap.begin()->second->createDescriptorSetLayout(m_DSL_model);
 		}		
@@ -220,19 +291,22 @@ void Scene::createDescriptors(VkDescriptorPool descriptorPool)
 	// Descriptor Sets
 	{
 		// Model
-		for (auto& model : m_modelMap)
+		if (!usesBindlessTextures())
 		{
-			for (uint32_t i = 0; i < static_cast<uint32_t>(m_numSwapChainImages); i++)
+			for (auto& model : m_modelMap)
 			{
-				model.second->createDescriptorSets(descriptorPool, m_DSL_model, i);
+				for (uint32_t i = 0; i < static_cast<uint32_t>(m_numFramesInFlight); i++)
+				{
+					model.second->createDescriptorSets(descriptorPool, m_DSL_model, i);
+				}
 			}
 		}
 
-		m_DS_time.resize(m_numSwapChainImages);
-		m_DS_lights.resize(m_numSwapChainImages);
-		m_DS_compute.resize(m_numSwapChainImages);
+		m_DS_time.resize(m_numFramesInFlight);
+		m_DS_lights.resize(m_numFramesInFlight);
+		m_DS_compute.resize(m_numFramesInFlight);
 
-		for (uint32_t i = 0; i < m_numSwapChainImages; i++)
+		for (uint32_t i = 0; i < m_numFramesInFlight; i++)
 		{
 			// Compute
 			DescriptorUtil::createDescriptorSets(m_logicalDevice, descriptorPool, 1, &m_DSL_compute, &m_DS_compute[i]);
@@ -245,10 +319,18 @@ void Scene::createDescriptors(VkDescriptorPool descriptorPool)
 }
 void Scene::writeToAndUpdateDescriptorSets()
 {
-	for (uint32_t i = 0; i < m_numSwapChainImages; i++)
+	if (usesBindlessTextures())
+	{
+		m_bindlessMaterials->writeToAndUpdateDescriptorSet();
+	}
+
+	for (uint32_t i = 0; i < m_numFramesInFlight; i++)
 	{
 		// Models
-		for (auto& model : m_modelMap) { model.second->writeToAndUpdateDescriptorSets(i); }
+		if (!usesBindlessTextures())
+		{
+			for (auto& model : m_modelMap) { model.second->writeToAndUpdateDescriptorSets(i); }
+		}
 
 		// Compute
 		{
@@ -281,6 +363,10 @@ VkDescriptorSet Scene::getDescriptorSet(DSL_TYPE type, int index, std::string ke
 	case DSL_TYPE::COMPUTE:
 		return m_DS_compute[index];
 		break;
+	case DSL_TYPE::BINDLESS_MATERIALS:
+		// Shared by all frames, nothing in it changes once the scene is loaded
+		return m_bindlessMaterials->getDescriptorSet();
+		break;
 	case DSL_TYPE::TIME:
 		return m_DS_time[index];
 		break;
@@ -300,6 +386,9 @@ VkDescriptorSetLayout Scene::getDescriptorSetLayout(DSL_TYPE key)
 	case DSL_TYPE::MODEL:
 		return m_DSL_model;
 		break;
+	case DSL_TYPE::BINDLESS_MATERIALS:
+		return m_bindlessMaterials->getDescriptorSetLayout();
+		break;
 	case DSL_TYPE::COMPUTE:
 		return m_DSL_compute;
 		break;
@@ -7,6 +7,7 @@
 #include <Vulkan/vulkanManager.h>
 
 #include "SceneElements/model.h"
+#include "SceneElements/bindlessMaterials.h"
 #include "Utilities/loadingUtility.h"
 
 struct TimeUniformBlock
@@ -42,23 +43,30 @@ class Scene
 public:
 	Scene() = delete;
 	Scene(std::shared_ptr<VulkanManager> vulkanManager, JSONItem::Scene& scene,
-		RENDER_TYPE renderType, uint32_t numSwapChainImages, VkExtent2D windowExtents,
-		VkQueue& graphicsQueue, VkCommandPool& graphicsCommandPool, VkQueue& computeQueue, VkCommandPool& computeCommandPool);
+		RENDER_TYPE renderType, uint32_t numFramesInFlight, VkExtent2D windowExtents,
+		VkQueue& graphicsQueue, VkCommandPool& graphicsCommandPool, VkQueue& computeQueue, VkCommandPool& computeCommandPool,
+		bool batchTexturesIntoArrays = false, bool useBindlessTextures = false);
 	~Scene();
 
 	void cleanup() {} //specifically clean up resources that are recreated on frame resizing
 	void createScene(JSONItem::Scene& scene);
 	void recreate();
+	// Drops the model without waiting on the device, it is destroyed once the frames that may still draw it have finished.
+	// Nothing recorded from now on may draw it, see Renderer::removeModel.
+	void removeModel(const std::string& name);
 	void updateSceneInfrequent() {}
-	void updateUniforms(uint32_t currentImageIndex);
+	void updateUniforms(uint32_t frameIndex);
 
 	// Time
-	void initializeTimeUBO(uint32_t currentImageIndex);
-	void updateTimeUBO(uint32_t currentImageIndex);
+	void initializeTimeUBO(uint32_t frameIndex);
+	void updateTimeUBO(uint32_t frameIndex);
+	// Advances the scene's time by a fixed step (ms) every frame instead of following the clock, 0 goes back to the clock.
+	// Benchmarks use it so the lights and anything else animated end up the same from run to run.
+	void setFixedTimeStep(float timeStep) { m_fixedTimeStep = timeStep; m_numFixedTimeSteps = 0; }
 
 	// Lights
-	void initializeLightsUBO(uint32_t currentImageIndex);
-	void updateLightsUBO(uint32_t currentImageIndex);
+	void initializeLightsUBO(uint32_t frameIndex);
+	void updateLightsUBO(uint32_t frameIndex);
 
 	// Descriptor Sets
 	void expandDescriptorPool(std::vector<VkDescriptorPoolSize>& poolSizes);
@@ -68,6 +76,7 @@ public:
 	// Getters
 	VkDescriptorSet getDescriptorSet(DSL_TYPE type, int index, std::string key = "");
 	VkDescriptorSetLayout getDescriptorSetLayout(DSL_TYPE key);
+	bool usesBindlessTextures() const { return m_bindlessMaterials != nullptr; }
 
 	std::shared_ptr<Model> Scene::getModel(std::string key)
 	{
@@ -90,6 +99,9 @@ public:
 public:
 	std::unordered_map<std::string, std::shared_ptr<Model>> m_modelMap;
 	std::unordered_map<std::string, std::shared_ptr<Texture2D>> m_textureMap;
+
+	// The scene's textures packed by size class, vkMaterial::textureArraySlots index into this and the bindless materials sample them
+	std::vector<std::shared_ptr<Texture2DArray>> m_textureArrays;
 	
 	std::vector<TimeUniform> m_timeUniform; // Time	
 	std::vector<LightsUniform> m_lightsUniform; // Lights
@@ -102,10 +114,16 @@ private:
 	VkQueue	m_computeQueue;
 	VkCommandPool m_graphicsCmdPool;
 	VkCommandPool m_computeCmdPool;
-	uint32_t m_numSwapChainImages;
+	uint32_t m_numFramesInFlight;
 	RENDER_TYPE m_renderType;
+	bool m_batchTexturesIntoArrays;
+
+	// Replaces the per primitive model descriptor sets when bindless textures are in use
+	std::shared_ptr<BindlessMaterialTable> m_bindlessMaterials;
 
 	std::chrono::high_resolution_clock::time_point m_prevtime;
+	float m_fixedTimeStep = 0.0f;
+	uint64_t m_numFixedTimeSteps = 0;
 	
 	// Descriptor Set Stuff
 	VkDescriptorSetLayout m_DSL_model;
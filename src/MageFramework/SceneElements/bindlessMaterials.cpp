@@ -0,0 +1,224 @@
+#include "bindlessMaterials.h"
+
+// Upper bound on the size of the texture array, the device limit for update after bind sampled images is often in the millions
+static constexpr uint32_t MAX_BINDLESS_TEXTURES = 4096;
+// Has to match MAX_TEXTURE_ARRAYS in geometryBindless.frag. The arrays are grouped by format and size class so there are only ever a few.
+static constexpr uint32_t MAX_BINDLESS_TEXTURE_ARRAYS = 64;
+
+BindlessMaterialTable::BindlessMaterialTable(std::shared_ptr<VulkanManager> vulkanManager)
+	: m_vulkanManager(vulkanManager), m_logicalDevice(vulkanManager->getLogicalDevice()), m_physicalDevice(vulkanManager->getPhysicalDevice()), m_resourceCache(vulkanManager->getResourceCache()),
+	m_descriptorPool(VK_NULL_HANDLE), m_DSL_bindless(VK_NULL_HANDLE), m_DS_bindless(VK_NULL_HANDLE)
+{
+	// The texture arrays come out of the same sampled image budget
+	const uint32_t maxSampledImages = vulkanManager->getMaxBindlessSampledImages();
+	m_maxTextures = std::min(maxSampledImages > MAX_BINDLESS_TEXTURE_ARRAYS ? maxSampledImages - MAX_BINDLESS_TEXTURE_ARRAYS : 1u, MAX_BINDLESS_TEXTURES);
+	m_samplers.fill(VK_NULL_HANDLE);
+}
+BindlessMaterialTable::~BindlessMaterialTable()
+{
+	// Frames in flight may still read the table, it goes once they have finished. 
+	// The lambda holds on to the textures the descriptor set points at until then.
+	VkDevice logicalDevice = m_logicalDevice;
+	m_vulkanManager->deferDestruction([logicalDevice, materialBuffer = m_materialBuffer, descriptorPool = m_descriptorPool, 
+		DSL_bindless = m_DSL_bindless, textures = m_textures, textureArrays = m_textureArrays]() mutable
+	{
+		if (materialBuffer.buffer != VK_NULL_HANDLE)
+		{
+			materialBuffer.destroy(logicalDevice);
+		}
+
+		// Destroying the pool frees the descriptor set as well
+		vkDestroyDescriptorPool(logicalDevice, descriptorPool, nullptr);
+		vkDestroyDescriptorSetLayout(logicalDevice, DSL_bindless, nullptr);
+	});
+}
+
+int BindlessMaterialTable::addTexture(const std::shared_ptr<Texture2D>& texture)
+{
+	if (!texture)
+	{
+		return -1;
+	}
+
+	// Textures shared between materials only take up one slot in the array
+	std::unordered_map<const Texture2D*, int>::const_iterator found = m_textureIndices.find(texture.get());
+	if (found != m_textureIndices.end())
+	{
+		return found->second;
+	}
+
+	if (m_textures.size() >= m_maxTextures)
+	{
+		throw std::runtime_error("the scene uses more textures than the bindless texture array can hold");
+	}
+
+	const int index = static_cast<int>(m_textures.size());
+	m_textures.push_back(texture);
+	m_textureIndices.insert({ texture.get(), index });
+	return index;
+}
+
+void BindlessMaterialTable::addMaterialTexture(const vkMaterial* material, size_t textureSlot, const std::shared_ptr<Texture2D>& texture, int& index, int& layer)
+{
+	const TextureArraySlot& arraySlot = material->textureArraySlots[textureSlot];
+	if (arraySlot.isValid())
+	{
+		index = arraySlot.arrayIndex;
+		layer = arraySlot.layer;
+		return;
+	}
+
+	index = addTexture(texture);
+	layer = -1;
+}
+
+void BindlessMaterialTable::setTextureArrays(const std::vector<std::shared_ptr<Texture2DArray>>& textureArrays)
+{
+	if (textureArrays.size() > MAX_BINDLESS_TEXTURE_ARRAYS)
+	{
+		throw std::runtime_error("the scene's textures were packed into more texture arrays than the bindless descriptor set can hold");
+	}
+	m_textureArrays = textureArrays;
+}
+
+void BindlessMaterialTable::addModel(std::shared_ptr<Model> model)
+{
+	for (vkMaterial* material : model->m_materials)
+	{
+		material->bindlessIndex = static_cast<uint32_t>(m_materialBlocks.size());
+		material->uniformBlock.activeTextureFlags = material->activeTextures.to_ulong();
+
+		BindlessMaterialBlock block = {};
+		block.activeTextureFlags = static_cast<uint32_t>(material->uniformBlock.activeTextureFlags);
+		block.alphaMode = material->uniformBlock.alphaMode;
+		block.alphaCutoff = material->uniformBlock.alphaCutoff;
+		block.metallicFactor = material->uniformBlock.metallicFactor;
+		block.roughnessFactor = material->uniformBlock.roughnessFactor;
+		block.samplerIndex = LINEAR_REPEAT;
+		block.baseColorFactor = material->uniformBlock.baseColorFactor;
+
+		// Same ordering as vkMaterial::activeTextures; the base color texture is always bound in the per primitive path as well
+		block.textureIndices = glm::ivec4(-1);
+		block.textureLayers = glm::ivec4(-1);
+		block.occlusionTextureIndex = -1;
+		block.occlusionTextureLayer = -1;
+		addMaterialTexture(material, 0, material->baseColorTexture, block.textureIndices.x, block.textureLayers.x);
+		if (material->activeTextures[1]) { addMaterialTexture(material, 1, material->normalTexture, block.textureIndices.y, block.textureLayers.y); }
+		if (material->activeTextures[2]) { addMaterialTexture(material, 2, material->metallicRoughnessTexture, block.textureIndices.z, block.textureLayers.z); }
+		if (material->activeTextures[3]) { addMaterialTexture(material, 3, material->emissiveTexture, block.textureIndices.w, block.textureLayers.w); }
+		if (material->activeTextures[4]) { addMaterialTexture(material, 4, material->occlusionTexture, block.occlusionTextureIndex, block.occlusionTextureLayer); }
+
+		m_materialBlocks.push_back(block);
+	}
+}
+
+void BindlessMaterialTable::createDescriptors()
+{
+	// Material Storage Buffer
+	{
+		const size_t numMaterials = std::max(m_materialBlocks.size(), static_cast<size_t>(1));
+		std::vector<BindlessMaterialBlock> materialData(numMaterials, BindlessMaterialBlock());
+		std::copy(m_materialBlocks.begin(), m_materialBlocks.end(), materialData.begin());
+
+		BufferUtil::createMageBuffer(m_logicalDevice, m_physicalDevice, m_materialBuffer,
+			static_cast<VkDeviceSize>(numMaterials * sizeof(BindlessMaterialBlock)), materialData.data(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	}
+
+	// Sampler Table -- same sampler states the textures themselves use, so these come straight out of the cache
+	{
+		m_samplers[LINEAR_REPEAT] = m_resourceCache->getSampler(ImageUtil::createSamplerCreateInfo(VK_FILTER_LINEAR, VK_FILTER_LINEAR,
+			VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_SAMPLER_MIPMAP_MODE_LINEAR, 0, 0, VK_LOD_CLAMP_NONE, 16, VK_COMPARE_OP_NEVER));
+		m_samplers[LINEAR_CLAMP] = m_resourceCache->getSampler(ImageUtil::createSamplerCreateInfo(VK_FILTER_LINEAR, VK_FILTER_LINEAR,
+			VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_SAMPLER_MIPMAP_MODE_LINEAR, 0, 0, VK_LOD_CLAMP_NONE, 16, VK_COMPARE_OP_NEVER));
+	}
+
+	// Descriptor Pool
+	{
+		std::vector<VkDescriptorPoolSize> poolSizes = {
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1 },
+			{ VK_DESCRIPTOR_TYPE_SAMPLER, NUM_SAMPLERS },
+			{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, MAX_BINDLESS_TEXTURE_ARRAYS + m_maxTextures }
+		};
+		DescriptorUtil::createDescriptorPool(m_logicalDevice, 1, static_cast<uint32_t>(poolSizes.size()), poolSizes.data(),
+			m_descriptorPool, VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT);
+	}
+
+	// Descriptor Set Layout
+	{
+		std::array<VkDescriptorSetLayoutBinding, 4> bindings = {};
+		bindings[MATERIALS]		 = { MATERIALS,		 VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,							VK_SHADER_STAGE_FRAGMENT_BIT, nullptr };
+		bindings[SAMPLERS]		 = { SAMPLERS,		 VK_DESCRIPTOR_TYPE_SAMPLER,		NUM_SAMPLERS,				VK_SHADER_STAGE_FRAGMENT_BIT, nullptr };
+		bindings[TEXTURE_ARRAYS] = { TEXTURE_ARRAYS, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,	MAX_BINDLESS_TEXTURE_ARRAYS,	VK_SHADER_STAGE_FRAGMENT_BIT, nullptr };
+		bindings[TEXTURES]		 = { TEXTURES,		 VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,	m_maxTextures,				VK_SHADER_STAGE_FRAGMENT_BIT, nullptr };
+
+		// The individual textures are the last binding so the size of that array can be picked when the set is allocated.
+		// Partially bound means the unused tail of either array never has to be written.
+		std::array<VkDescriptorBindingFlagsEXT, 4> bindingFlags = {};
+		bindingFlags[TEXTURE_ARRAYS] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT;
+		bindingFlags[TEXTURES] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT |
+			VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT_EXT;
+
+		VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo = {};
+		bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+		bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+		bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+		DescriptorUtil::createDescriptorSetLayout(m_logicalDevice, m_DSL_bindless, static_cast<uint32_t>(bindings.size()), bindings.data(),
+			&bindingFlagsInfo, VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT);
+	}
+
+	// Descriptor Set
+	{
+		const uint32_t textureCount = std::max(getNumTextures(), 1u);
+		VkDescriptorSetVariableDescriptorCountAllocateInfoEXT variableCountInfo = {};
+		variableCountInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO_EXT;
+		variableCountInfo.descriptorSetCount = 1;
+		variableCountInfo.pDescriptorCounts = &textureCount;
+
+		DescriptorUtil::createDescriptorSets(m_logicalDevice, m_descriptorPool, 1, &m_DSL_bindless, &m_DS_bindless, &variableCountInfo);
+	}
+}
+
+void BindlessMaterialTable::writeToAndUpdateDescriptorSet()
+{
+	std::vector<VkWriteDescriptorSet> writeBindlessSet;
+
+	m_materialBuffer.setDescriptorInfo();
+	writeBindlessSet.push_back(DescriptorUtil::writeDescriptorSet(m_DS_bindless, MATERIALS, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &m_materialBuffer.descriptorInfo));
+
+	std::array<VkDescriptorImageInfo, NUM_SAMPLERS> samplerInfos = {};
+	for (uint32_t i = 0; i < NUM_SAMPLERS; i++)
+	{
+		samplerInfos[i].sampler = m_samplers[i];
+	}
+	writeBindlessSet.push_back(DescriptorUtil::writeDescriptorSet(m_DS_bindless, SAMPLERS, NUM_SAMPLERS, VK_DESCRIPTOR_TYPE_SAMPLER, samplerInfos.data()));
+
+	// Sampling happens through the sampler table so only the views go into the texture array
+	std::vector<VkDescriptorImageInfo> textureInfos(m_textures.size());
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		textureInfos[i].sampler = VK_NULL_HANDLE;
+		textureInfos[i].imageView = m_textures[i]->m_imageView;
+		textureInfos[i].imageLayout = m_textures[i]->m_imageLayout;
+	}
+	if (!textureInfos.empty())
+	{
+		writeBindlessSet.push_back(DescriptorUtil::writeDescriptorSet(m_DS_bindless, TEXTURES,
+			static_cast<uint32_t>(textureInfos.size()), VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, textureInfos.data()));
+	}
+
+	std::vector<VkDescriptorImageInfo> textureArrayInfos(m_textureArrays.size());
+	for (size_t i = 0; i < m_textureArrays.size(); i++)
+	{
+		textureArrayInfos[i].sampler = VK_NULL_HANDLE;
+		textureArrayInfos[i].imageView = m_textureArrays[i]->m_imageView;
+		textureArrayInfos[i].imageLayout = m_textureArrays[i]->m_imageLayout;
+	}
+	if (!textureArrayInfos.empty())
+	{
+		writeBindlessSet.push_back(DescriptorUtil::writeDescriptorSet(m_DS_bindless, TEXTURE_ARRAYS,
+			static_cast<uint32_t>(textureArrayInfos.size()), VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, textureArrayInfos.data()));
+	}
+
+	vkUpdateDescriptorSets(m_logicalDevice, static_cast<uint32_t>(writeBindlessSet.size()), writeBindlessSet.data(), 0, nullptr);
+}
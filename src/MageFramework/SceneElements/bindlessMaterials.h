@@ -0,0 +1,62 @@
+#pragma once
+#include <global.h>
+#include <unordered_map>
+#include <Vulkan/vulkanManager.h>
+#include <Vulkan/Utilities/vBufferUtil.h>
+#include <Vulkan/Utilities/vDescriptorUtil.h>
+#include <SceneElements/model.h>
+
+// Bindless material textures via VK_EXT_descriptor_indexing.
+// Every texture used by the scene's materials lives in one large partially bound, update after bind sampled image array.
+// Materials reference their textures by index through a material storage buffer, and pick a sampler out of a small sampler table.
+// This lets the rasterization pass bind a single descriptor set for the whole pass instead of one per primitive.
+// Textures the scene packed into texture arrays (see TextureArrayBuilder) are referenced by (array, layer) instead.
+class BindlessMaterialTable
+{
+public:
+	enum BINDING { MATERIALS = 0, SAMPLERS = 1, TEXTURE_ARRAYS = 2, TEXTURES = 3 };
+	enum SAMPLER_TYPE { LINEAR_REPEAT = 0, LINEAR_CLAMP = 1, NUM_SAMPLERS };
+
+	BindlessMaterialTable() = delete;
+	BindlessMaterialTable(std::shared_ptr<VulkanManager> vulkanManager);
+	~BindlessMaterialTable();
+
+	// Has to be called before the models are added, materials look their texture array slots up in these
+	void setTextureArrays(const std::vector<std::shared_ptr<Texture2DArray>>& textureArrays);
+	// Assigns table indices to the model's materials and the textures they use
+	void addModel(std::shared_ptr<Model> model);
+
+	// Creates the material buffer, samplers, descriptor pool, layout and the one descriptor set
+	void createDescriptors();
+	void writeToAndUpdateDescriptorSet();
+
+	VkDescriptorSetLayout getDescriptorSetLayout() const { return m_DSL_bindless; }
+	VkDescriptorSet getDescriptorSet() const { return m_DS_bindless; }
+	uint32_t getNumTextures() const { return static_cast<uint32_t>(m_textures.size()); }
+	uint32_t getNumMaterials() const { return static_cast<uint32_t>(m_materialBlocks.size()); }
+
+private:
+	int addTexture(const std::shared_ptr<Texture2D>& texture);
+	// Fills in where the shader finds one of the material's textures, indexed the same way as vkMaterial::activeTextures
+	void addMaterialTexture(const vkMaterial* material, size_t textureSlot, const std::shared_ptr<Texture2D>& texture, int& index, int& layer);
+
+private:
+	std::shared_ptr<VulkanManager> m_vulkanManager;
+	VkDevice m_logicalDevice;
+	VkPhysicalDevice m_physicalDevice;
+	std::shared_ptr<VulkanResourceCache> m_resourceCache;
+	uint32_t m_maxTextures;
+
+	std::vector<std::shared_ptr<Texture2D>> m_textures;
+	std::unordered_map<const Texture2D*, int> m_textureIndices;
+	std::vector<std::shared_ptr<Texture2DArray>> m_textureArrays;
+	std::vector<BindlessMaterialBlock> m_materialBlocks;
+
+	mageVKBuffer m_materialBuffer;
+	std::array<VkSampler, NUM_SAMPLERS> m_samplers; // Owned by the resource cache
+
+	// Update after bind sets have to come out of a pool created with the matching flag, so the table has its own pool
+	VkDescriptorPool m_descriptorPool;
+	VkDescriptorSetLayout m_DSL_bindless;
+	VkDescriptorSet m_DS_bindless;
+};
@@ -1,17 +1,18 @@
 #include "model.h"
 
-Model::Model(std::shared_ptr<VulkanManager> vulkanManager, VkQueue& graphicsQueue, VkCommandPool& commandPool, unsigned int numSwapChainImages,
-	const JSONItem::Model& jsonModel, bool isMipMapped, RENDER_TYPE renderType)
-	: m_logicalDevice(vulkanManager->getLogicalDevice()), m_physicalDevice(vulkanManager->getPhysicalDevice()), m_numSwapChainImages(numSwapChainImages), 
+Model::Model(std::shared_ptr<VulkanManager> vulkanManager, VkQueue& graphicsQueue, VkCommandPool& commandPool, unsigned int numFramesInFlight,
+	const JSONItem::Model& jsonModel, bool isMipMapped, RENDER_TYPE renderType, TextureArrayBuilder* textureArrayBuilder)
+	: m_logicalDevice(vulkanManager->getLogicalDevice()), m_physicalDevice(vulkanManager->getPhysicalDevice()), 
+	m_resourceCache(vulkanManager->getResourceCache()), m_uploadQueue(vulkanManager->getUploadQueue()), m_numFramesInFlight(numFramesInFlight), 
 	m_areTexturesMipMapped(isMipMapped), m_materialCount(0), m_primitiveCount(0), m_renderType(renderType)
 {
-	m_updateUniforms.resize(m_numSwapChainImages, true);
-	LoadModel(jsonModel, graphicsQueue, commandPool);
+	m_updateUniforms.resize(m_numFramesInFlight, true);
+	LoadModel(jsonModel, graphicsQueue, commandPool, textureArrayBuilder);
+	m_uploadTicket = m_uploadQueue->submit();
 }; 
 Model::~Model()
 {
-	vkDeviceWaitIdle(m_logicalDevice);
-
+	// Doesn't wait on the device, see Scene::removeModel
 	m_indices.indexBuffer.destroy(m_logicalDevice);
 	m_vertices.vertexBuffer.destroy(m_logicalDevice);
 
@@ -25,19 +26,19 @@ Model::~Model()
 	}
 }
 
-void Model::updateUniformBuffer(uint32_t currentImageIndex)
+void Model::updateUniformBuffer(uint32_t frameIndex)
 {
-	if (m_updateUniforms[currentImageIndex])
+	if (m_updateUniforms[frameIndex])
 	{
 		for (vkNode* node : m_linearNodes)
 		{
 			if (node->mesh)
 			{
-				node->update(currentImageIndex);
+				node->update(frameIndex);
 			}
 		}
 
-		m_updateUniforms[currentImageIndex] = false;
+		m_updateUniforms[frameIndex] = false;
 	}
 }
 
@@ -45,9 +46,9 @@ void Model::updateUniformBuffer(uint32_t currentImageIndex)
 void Model::addToDescriptorPoolSize(std::vector<VkDescriptorPoolSize>& poolSizes)
 {
 	// Model Uniforms + Material Uniforms
-	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 * m_primitiveCount * m_numSwapChainImages });
+	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 * m_primitiveCount * m_numFramesInFlight });
 	// (baseColor + metallicRoughness + normal + occlusion + emissive + specularGlossiness + diffuse) Texture Sampler
-	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 7 * m_primitiveCount * m_numSwapChainImages });
+	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 7 * m_primitiveCount * m_numFramesInFlight });
 }
 void Model::createDescriptorSetLayout(VkDescriptorSetLayout& DSL_model)
 {
@@ -79,7 +80,7 @@ void Model::createDescriptorSets(VkDescriptorPool descriptorPool, VkDescriptorSe
 		{
 			for (auto primitive : node->mesh->primitives)
 			{
-				primitive->descriptorSets.resize(m_numSwapChainImages);
+				primitive->descriptorSets.resize(m_numFramesInFlight);
 				DescriptorUtil::createDescriptorSets(m_logicalDevice, descriptorPool, 1, &DSL_model, &primitive->descriptorSets[index]);
 			}
 		}
@@ -119,20 +120,36 @@ void Model::writeToAndUpdateDescriptorSets(uint32_t index)
 	}
 }
 
+void Model::assignTextureArraySlots(const TextureArrayBuilder& textureArrayBuilder)
+{
+	for (vkMaterial* material : m_materials)
+	{
+		const std::shared_ptr<Texture2D> textures[] = {
+			material->baseColorTexture, material->normalTexture, material->metallicRoughnessTexture,
+			material->emissiveTexture, material->occlusionTexture };
 
-void Model::recordDrawCmds(	unsigned int frameIndex, const VkDescriptorSet& DS_camera, 
-	const VkPipeline& rasterP, const VkPipelineLayout& rasterPL, VkCommandBuffer& graphicsCmdBuffer )
+		for (size_t i = 0; i < material->textureArraySlots.size(); i++)
+		{
+			material->textureArraySlots[i] = (material->activeTextures[i] && textures[i]) ?
+				textureArrayBuilder.getSlot(textures[i].get()) : TextureArraySlot();
+		}
+	}
+}
+
+uint32_t Model::recordDrawCmds(	unsigned int frameIndex, const VkDescriptorSet& DS_camera, 
+	const VkPipeline& rasterP, const VkPipelineLayout& rasterPL, VulkanCommandRecorder& graphicsRecorder )
 {
 	VkBuffer vertexBuffers[] = { m_vertices.vertexBuffer.buffer };
 	VkBuffer indexBuffer = m_indices.indexBuffer.buffer;
 	VkDeviceSize offsets[] = { 0 };
 
-	vkCmdBindPipeline(graphicsCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, rasterP);
-	vkCmdBindVertexBuffers(graphicsCmdBuffer, 0, 1, vertexBuffers, offsets);
-	vkCmdBindIndexBuffer(graphicsCmdBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+	graphicsRecorder.bindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, rasterP);
+	graphicsRecorder.bindVertexBuffers(0, 1, vertexBuffers, offsets);
+	graphicsRecorder.bindIndexBuffer(indexBuffer, 0, VK_INDEX_TYPE_UINT32);
 
-	vkCmdBindDescriptorSets(graphicsCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, rasterPL, 0, 1, &DS_camera, 0, nullptr);
+	graphicsRecorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, rasterPL, 0, 1, &DS_camera);
 
+	uint32_t numDraws = 0;
 	for (vkNode* node : m_linearNodes)
 	{
 		if (node->mesh)
@@ -140,30 +157,61 @@ void Model::recordDrawCmds(	unsigned int frameIndex, const VkDescriptorSet& DS_c
 			for (vkPrimitive* primitive : node->mesh->primitives)
 			{
 				VkDescriptorSet DS_primitive = primitive->descriptorSets[frameIndex];
-				vkCmdBindDescriptorSets(graphicsCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, rasterPL, 1, 1, &DS_primitive, 0, nullptr);
-				vkCmdDrawIndexed(graphicsCmdBuffer, primitive->indexCount, 1, primitive->firstIndex, 0, 0);
+				graphicsRecorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, rasterPL, 1, 1, &DS_primitive);
+				graphicsRecorder.drawIndexed(primitive->indexCount, 1, primitive->firstIndex, 0, 0);
+				numDraws++;
 			}
 		}
 	}
+	return numDraws;
 }
+uint32_t Model::recordDrawCmds_Bindless(const VkPipelineLayout& rasterPL, VulkanCommandRecorder& graphicsRecorder)
+{
+	VkBuffer vertexBuffers[] = { m_vertices.vertexBuffer.buffer };
+	VkBuffer indexBuffer = m_indices.indexBuffer.buffer;
+	VkDeviceSize offsets[] = { 0 };
+
+	graphicsRecorder.bindVertexBuffers(0, 1, vertexBuffers, offsets);
+	graphicsRecorder.bindIndexBuffer(indexBuffer, 0, VK_INDEX_TYPE_UINT32);
 
+	BindlessDrawPushConstants drawConstants;
+	uint32_t numDraws = 0;
+	for (vkNode* node : m_linearNodes)
+	{
+		if (node->mesh)
+		{
+			// Node transforms don't change after loading so they can be baked into the command buffer
+			drawConstants.modelMatrix = node->getMatrix();
+			for (vkPrimitive* primitive : node->mesh->primitives)
+			{
+				drawConstants.materialIndex = primitive->material->bindlessIndex;
+				graphicsRecorder.pushConstants(rasterPL, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+					0, sizeof(BindlessDrawPushConstants), &drawConstants);
+				graphicsRecorder.drawIndexed(primitive->indexCount, 1, primitive->firstIndex, 0, 0);
+				numDraws++;
+			}
+		}
+	}
+	return numDraws;
+}
 
-bool Model::LoadModel(const JSONItem::Model& jsonModel, VkQueue& graphicsQueue, VkCommandPool& commandPool)
+bool Model::LoadModel(const JSONItem::Model& jsonModel, VkQueue& graphicsQueue, VkCommandPool& commandPool, TextureArrayBuilder* textureArrayBuilder)
 {
 	m_transform = jsonModel.transform;
 	if (jsonModel.filetype == FILE_TYPE::OBJ)
 	{
 		loadingUtil::loadObj(m_vertices.vertexArray, m_indices.indexArray, m_textures, jsonModel.meshPath, jsonModel.texturePaths,
-			m_areTexturesMipMapped, m_logicalDevice, m_physicalDevice, graphicsQueue, commandPool);
+			m_areTexturesMipMapped, m_logicalDevice, m_physicalDevice, m_resourceCache, graphicsQueue, commandPool, textureArrayBuilder, m_uploadQueue);
 		loadingUtil::convertObjToNodeStructure(m_vertices, m_indices, m_textures, m_materials, m_nodes, m_linearNodes,
-			jsonModel.name, m_transform, m_primitiveCount, m_materialCount, m_numSwapChainImages,
+			jsonModel.name, m_transform, m_primitiveCount, m_materialCount, m_numFramesInFlight,
 			m_logicalDevice, m_physicalDevice, graphicsQueue, commandPool);
 	}
 	else if (jsonModel.filetype == FILE_TYPE::GLTF)
 	{
 		loadingUtil::loadGLTF(m_vertices.vertexArray, m_indices.indexArray, m_textures, m_materials,
 			m_nodes, m_linearNodes, jsonModel.meshPath, m_transform,
-			m_primitiveCount, m_materialCount, m_numSwapChainImages, m_logicalDevice, m_physicalDevice, graphicsQueue, commandPool);
+			m_primitiveCount, m_materialCount, m_numFramesInFlight, m_logicalDevice, m_physicalDevice, m_resourceCache, graphicsQueue, commandPool,
+			textureArrayBuilder, m_uploadQueue);
 	}
 	else
 	{
@@ -181,11 +229,10 @@ bool Model::LoadModel(const JSONItem::Model& jsonModel, VkQueue& graphicsQueue,
 		allowedUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
 	}
 
-	BufferUtil::createMageVertexBuffer(m_logicalDevice, m_physicalDevice, graphicsQueue, commandPool,
-		m_vertices.vertexBuffer, m_vertices.vertexBuffer.bufferSize, m_vertices.vertexArray.data(), allowedUsage);
-
-	BufferUtil::createMageIndexBuffer(m_logicalDevice, m_physicalDevice, graphicsQueue, commandPool,
-		m_indices.indexBuffer, m_indices.indexBuffer.bufferSize, m_indices.indexArray.data(), allowedUsage);
+	createDeviceLocalBuffer(m_vertices.vertexBuffer, m_vertices.vertexBuffer.bufferSize, m_vertices.vertexArray.data(),
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | allowedUsage);
+	createDeviceLocalBuffer(m_indices.indexBuffer, m_indices.indexBuffer.bufferSize, m_indices.indexArray.data(),
+		VK_BUFFER_USAGE_INDEX_BUFFER_BIT | allowedUsage);
 
 	if (m_renderType == RENDER_TYPE::RAYTRACE)
 	{
@@ -194,4 +241,16 @@ bool Model::LoadModel(const JSONItem::Model& jsonModel, VkQueue& graphicsQueue,
 	}
 
 	return true;
-}
\ No newline at end of file
+}
+void Model::createDeviceLocalBuffer(mageVKBuffer& buffer, VkDeviceSize bufferSize, void* sourceData, VkBufferUsageFlags usage)
+{
+	// Same buffers as BufferUtil::createMageVertexBuffer and createMageIndexBuffer, the staging buffer is handed to the upload queue
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+	BufferUtil::createStagingBuffer(m_logicalDevice, m_physicalDevice, sourceData, stagingBuffer, stagingBufferMemory, bufferSize);
+
+	BufferUtil::createMageBuffer(m_logicalDevice, m_physicalDevice, buffer, bufferSize, nullptr,
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_SHARING_MODE_EXCLUSIVE, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	m_uploadQueue->uploadBuffer(stagingBuffer, stagingBufferMemory, buffer.buffer, bufferSize);
+}
@@ -14,11 +14,12 @@ class Model
 {
 public:
 	Model() = delete;
-	Model(std::shared_ptr<VulkanManager> vulkanManager, VkQueue& graphicsQueue, VkCommandPool& commandPool, unsigned int numSwapChainImages, 
-		const JSONItem::Model& jsonModel, bool isMipMapped = false, RENDER_TYPE renderType = RENDER_TYPE::RASTERIZATION);
+	Model(std::shared_ptr<VulkanManager> vulkanManager, VkQueue& graphicsQueue, VkCommandPool& commandPool, unsigned int numFramesInFlight, 
+		const JSONItem::Model& jsonModel, bool isMipMapped = false, RENDER_TYPE renderType = RENDER_TYPE::RASTERIZATION,
+		TextureArrayBuilder* textureArrayBuilder = nullptr);
 	~Model();
 
-	void updateUniformBuffer(uint32_t currentImageIndex);
+	void updateUniformBuffer(uint32_t frameIndex);
 	glm::mat3x4 getMatrix_3x4()
 	{
 		return glm::mat3x4(glm::row(m_transform, 0), glm::row(m_transform, 1), glm::row(m_transform, 2));
@@ -30,11 +31,24 @@ public:
 	void createDescriptorSets(VkDescriptorPool descriptorPool, VkDescriptorSetLayout& DSL_model, uint32_t index);
 	void writeToAndUpdateDescriptorSets(uint32_t index);
 
-	void recordDrawCmds(unsigned int frameIndex, const VkDescriptorSet& DS_camera,
-		const VkPipeline& rasterP, const VkPipelineLayout& rasterPL, VkCommandBuffer& graphicsCmdBuffer);
+	// Texture Arrays
+	void assignTextureArraySlots(const TextureArrayBuilder& textureArrayBuilder);
+
+	// Both return the number of draws they recorded
+	uint32_t recordDrawCmds(unsigned int frameIndex, const VkDescriptorSet& DS_camera,
+		const VkPipeline& rasterP, const VkPipelineLayout& rasterPL, VulkanCommandRecorder& graphicsRecorder);
+	// Expects the bindless pipeline and its descriptor sets to already be bound, per draw data goes through push constants
+	uint32_t recordDrawCmds_Bindless(const VkPipelineLayout& rasterPL, VulkanCommandRecorder& graphicsRecorder);
+
+	// Buffers and textures are uploaded through the VulkanManager's upload queue as one batch,
+	// the model can't be drawn or used to build acceleration structures before that batch has completed
+	bool isUploaded() const { return m_uploadQueue->isComplete(m_uploadTicket); }
+	uint64_t getUploadTicket() const { return m_uploadTicket; }
 
 private:
-	bool LoadModel(const JSONItem::Model& jsonModel, VkQueue& graphicsQueue, VkCommandPool& commandPool);
+	bool LoadModel(const JSONItem::Model& jsonModel, VkQueue& graphicsQueue, VkCommandPool& commandPool, TextureArrayBuilder* textureArrayBuilder);
+	// Device local buffer filled through the upload queue
+	void createDeviceLocalBuffer(mageVKBuffer& buffer, VkDeviceSize bufferSize, void* sourceData, VkBufferUsageFlags usage);
 
 public:
 	Vertices m_vertices;
@@ -52,7 +66,10 @@ public:
 private:
 	VkDevice m_logicalDevice;
 	VkPhysicalDevice m_physicalDevice;
-	uint32_t m_numSwapChainImages;
+	std::shared_ptr<VulkanResourceCache> m_resourceCache;
+	std::shared_ptr<VulkanUploadQueue> m_uploadQueue;
+	uint64_t m_uploadTicket = 0;
+	uint32_t m_numFramesInFlight;
 	
 	std::vector<bool> m_updateUniforms;
 	uint32_t m_materialCount;
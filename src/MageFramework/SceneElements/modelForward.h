@@ -4,6 +4,7 @@
 #include <Vulkan/Utilities/vBufferUtil.h>
 #include <Vulkan/Utilities/vDescriptorUtil.h>
 #include <SceneElements/texture.h>
+#include <SceneElements/textureArrayBuilder.h>
 
 enum AlphaMode { ALPHAMODE_OPAQUE, ALPHAMODE_MASK, ALPHAMODE_BLEND };
 
@@ -47,6 +48,35 @@ struct MaterialUniformBlock
 	{};
 };
 
+// Mirrors the Material struct in geometryBindless.frag (std430), the shader applies baseColorFactor, alphaMode and alphaCutoff
+// the same way geometryPlain.frag does with the MaterialUniformBlock
+struct BindlessMaterialBlock
+{
+	uint32_t activeTextureFlags;
+	int alphaMode;
+	float alphaCutoff;
+	float metallicFactor;
+	float roughnessFactor;
+	uint32_t samplerIndex;
+	uint32_t pad0;
+	uint32_t pad1;
+	glm::vec4 baseColorFactor;
+	glm::ivec4 textureIndices; // baseColor, normal, metallicRoughness, emissive -- -1 if the material doesn't have that texture, the shader reads white then
+	int occlusionTextureIndex;
+	int pad2[3];
+	// Layer of each texture above if it was packed into a texture array, the index then picks the array instead of the texture. -1 otherwise.
+	glm::ivec4 textureLayers;
+	int occlusionTextureLayer;
+	int pad3[3];
+};
+
+// Per draw data for the bindless pipeline, has to stay within the 128 bytes the spec guarantees
+struct BindlessDrawPushConstants
+{
+	glm::mat4 modelMatrix;
+	uint32_t materialIndex;
+};
+
 //-------------------------------------------------------------
 //----------------------- glTF classes ------------------------
 //-------------------------------------------------------------
@@ -74,6 +104,13 @@ struct vkMaterial
 	//std::shared_ptr<Texture2D> specularGlossinessTexture;
 	//std::shared_ptr<Texture2D> diffuseTexture;
 
+	// Where each of the textures above lives if the scene's textures were also packed into texture arrays
+	// Indexed the same way as activeTextures
+	std::array<TextureArraySlot, 5> textureArraySlots;
+
+	// Index of this material in the BindlessMaterialTable's material buffer, only used by the bindless path
+	uint32_t bindlessIndex = 0;
+
 	mageVKBuffer materialUB; // material Uniform Buffer
 	MaterialUniformBlock uniformBlock;
 	
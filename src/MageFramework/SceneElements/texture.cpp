@@ -29,6 +29,14 @@ void Texture2D::creationHelperPart1(ImageLoaderOutput& imgOut, VkQueue& queue, V
 	ImageUtil::createImage(m_logicalDevice, m_physicalDevice, m_image, m_imageMemory, VK_IMAGE_TYPE_2D, m_format, extent, usage,
 		VK_SAMPLE_COUNT_1_BIT, tiling, m_mipLevels, m_layerCount, VK_IMAGE_LAYOUT_UNDEFINED, VK_SHARING_MODE_EXCLUSIVE);
 
+	m_imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	if (m_uploadQueue)
+	{
+		// Records the same transitions, copy and mip generation as below, the upload queue destroys the staging buffer
+		m_uploadQueue->uploadImage(imgOut.stagingBuffer, imgOut.stagingBufferMemory, m_image, m_format, m_width, m_height, m_mipLevels, isMipMapped);
+		return;
+	}
+
 	// vkCmdCopyBufferToImage will be used to copy the stagingBuffer into the m_textureImage, 
 	// but this command requires the image to be in the right layout. So we perform an image Transition
 	ImageUtil::transitionImageLayout_SingleTimeCommand(m_logicalDevice, queue, cmdPool, m_image, m_format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, m_mipLevels);
@@ -36,10 +44,9 @@ void Texture2D::creationHelperPart1(ImageLoaderOutput& imgOut, VkQueue& queue, V
 
 	// Destroy Staging Buffer
 	vkDestroyBuffer(m_logicalDevice, imgOut.stagingBuffer, nullptr);
-	vkFreeMemory(m_logicalDevice, imgOut.stagingBufferMemory, nullptr);
+	VulkanMemoryTracker::free(m_logicalDevice, imgOut.stagingBufferMemory);
 
 	// Transition Image to final Layout
-	m_imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 	if (isMipMapped)
 	{
 		// Generate mipmaps --> also handles transitions of image to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL at each mipLevel
@@ -58,15 +65,15 @@ void Texture2D::creationHelperPart1(ImageLoaderOutput& imgOut, VkQueue& queue, V
 
 void Texture2DArray::create2DTextureArray(
 	std::vector<std::string> texturePaths, VkQueue& queue, VkCommandPool& cmdPool,
-	bool isMipMapped, VkImageTiling tiling, VkImageUsageFlags usage)
+	bool isMipMapped, FixTextureFlag fix, VkImageTiling tiling, VkImageUsageFlags usage)
 {
-#ifdef DEBUG_MAGE_FRAMEWORK
-	assert(texturePaths.size() >= m_layerCount);
-	std::cout << "\n Texture paths doesn't contain enough textures to fill the 2D texture array" << std::endl;
-#endif
+	if (texturePaths.size() < m_layerCount)
+	{
+		throw std::runtime_error("Texture paths doesn't contain enough textures to fill the 2D texture array");
+	}
 
 	ImageArrayLoaderOutput imgArrayOut;
-	loadingUtil::loadArrayOfImageUsingSTB(texturePaths, imgArrayOut, m_logicalDevice, m_physicalDevice);
+	loadingUtil::loadArrayOfImageUsingSTB(texturePaths, imgArrayOut, m_logicalDevice, m_physicalDevice, fix);
 	create2DTextureArray(imgArrayOut, queue, cmdPool, isMipMapped, VK_SAMPLER_ADDRESS_MODE_REPEAT, tiling, usage);
 }
 
@@ -86,46 +93,32 @@ void Texture2DArray::creationHelperPart1(ImageArrayLoaderOutput& imgArrayOut, Vk
 	m_height = imgArrayOut.imgHeights[0];
 	m_mipLevels = isMipMapped ? (static_cast<uint32_t>(std::floor(std::log2(std::max(m_width, m_height)))) + 1) : 1;
 
-	// Setup buffer copy regions for each layer including all of its miplevels
-	uint32_t bufferOffset = 0;
-	const uint32_t imageSize_single = m_width * m_height * 4;
+	// Setup buffer copy regions for each layer
+	// The staging buffer only holds mip level 0 of every layer, the rest of the mip chain is generated on the GPU
+	VkDeviceSize bufferOffset = 0;
+	const VkDeviceSize imageSize_single = static_cast<VkDeviceSize>(m_width) * m_height * 4;
 	std::vector<VkBufferImageCopy> bufferCopyRegions;
 	for (uint32_t layer = 0; layer < m_layerCount; layer++)
 	{
-#ifdef DEBUG_MAGE_FRAMEWORK
-		if (isMipMapped)
-		{
-			uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(imgArrayOut.imgWidths[layer], imgArrayOut.imgHeights[layer])))) + 1;
-			assert(mipLevels == m_mipLevels);
-			std::cout << "\n Mipmap Levels of loaded texture don't match ones described in constructor" << std::endl;
-		}
-		if (imgArrayOut.imgWidths[layer] != m_width && imgArrayOut.imgHeights[layer] != m_height)
+		// Layers are expected to have been made the same size already (see ImageUtil::fixImagesForTextureArray)
+		if (imgArrayOut.imgWidths[layer] != m_width || imgArrayOut.imgHeights[layer] != m_height)
 		{
 			throw std::runtime_error("\n Textures in a texture array need to be of the same size");
 		}
-#endif
 
-		for (uint32_t level = 0; level < m_mipLevels; level++)
-		{
-			VkBufferImageCopy bufferCopyRegion = {};
-			bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			bufferCopyRegion.imageSubresource.mipLevel = level;
-			bufferCopyRegion.imageSubresource.baseArrayLayer = layer;
-			bufferCopyRegion.imageSubresource.layerCount = 1;
-			bufferCopyRegion.imageExtent.width = m_width;
-			bufferCopyRegion.imageExtent.height = m_height;
-			bufferCopyRegion.imageExtent.depth = m_depth;
-			bufferCopyRegion.bufferOffset = bufferOffset;
-
-			bufferCopyRegions.push_back(bufferCopyRegion);
-		}
-		bufferOffset += static_cast<uint32_t>(imageSize_single);
-	}
+		VkBufferImageCopy bufferCopyRegion = {};
+		bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		bufferCopyRegion.imageSubresource.mipLevel = 0;
+		bufferCopyRegion.imageSubresource.baseArrayLayer = layer;
+		bufferCopyRegion.imageSubresource.layerCount = 1;
+		bufferCopyRegion.imageExtent.width = m_width;
+		bufferCopyRegion.imageExtent.height = m_height;
+		bufferCopyRegion.imageExtent.depth = m_depth;
+		bufferCopyRegion.bufferOffset = bufferOffset;
 
-	// Make all the textures the same size by adding padding to the smallest ones
-	// Assuming all textures are stored from left to right and top to bottom
-	// If you do something like this do it during in the load function
-	// ImageUtil::fixImagesForTextureArray(m_layerCount, FixTextureFlag::SCALE_UP, m_width, m_height, imgWidths, imgHeights);
+		bufferCopyRegions.push_back(bufferCopyRegion);
+		bufferOffset += imageSize_single;
+	}
 
 	VkExtent3D extent = { m_width, m_height, m_depth };
 	ImageUtil::createImage(m_logicalDevice, m_physicalDevice, m_image, m_imageMemory, VK_IMAGE_TYPE_2D, m_format, extent, usage,
@@ -134,25 +127,26 @@ void Texture2DArray::creationHelperPart1(ImageArrayLoaderOutput& imgArrayOut, Vk
 	// vkCmdCopyBufferToImage will be used to copy the stagingBuffer into the m_textureImage, 
 	// but this command requires the image to be in the right layout. So we perform an image Transition
 
-	ImageUtil::transitionImageLayout_SingleTimeCommand(m_logicalDevice, queue, cmdPool, m_image, m_format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, m_mipLevels);
+	ImageUtil::transitionImageLayout_SingleTimeCommand(m_logicalDevice, queue, cmdPool, m_image, m_format,
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, m_mipLevels, m_layerCount);
 	ImageUtil::copyBufferToImage_SingleTimeCommand(m_logicalDevice, queue, cmdPool, imgArrayOut.stagingBuffer, m_image,
 		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(bufferCopyRegions.size()), bufferCopyRegions.data());
 
 	// Destroy Staging Buffer
 	vkDestroyBuffer(m_logicalDevice, imgArrayOut.stagingBuffer, nullptr);
-	vkFreeMemory(m_logicalDevice, imgArrayOut.stagingBufferMemory, nullptr);
+	VulkanMemoryTracker::free(m_logicalDevice, imgArrayOut.stagingBufferMemory);
 
 	// Transition Images to final Layout
 	m_imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 	if (isMipMapped)
 	{
 		// Generate mipmaps --> also handles transitions of image to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL at each mipLevel
-		ImageUtil::generateMipMaps(m_logicalDevice, m_physicalDevice, queue, cmdPool, m_image, m_format, m_width, m_height, m_depth, m_mipLevels);
+		ImageUtil::generateMipMaps(m_logicalDevice, m_physicalDevice, queue, cmdPool, m_image, m_format, m_width, m_height, m_depth, m_mipLevels, m_layerCount);
 	}
 	else
 	{
 		ImageUtil::transitionImageLayout_SingleTimeCommand(m_logicalDevice, queue, cmdPool, m_image, m_format,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, m_imageLayout, m_mipLevels);
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, m_imageLayout, m_mipLevels, m_layerCount);
 	}
 }
 
@@ -164,12 +158,101 @@ void Texture3D::create3DTexture(
 	std::string texturePath, VkQueue& queue, VkCommandPool& cmdPool,
 	bool isMipMapped, VkImageTiling tiling, VkImageUsageFlags usage)
 {
+	const uint32_t numChannels = FormatUtil::getNum8BitChannels(m_format);
+	if (numChannels == 0) { throw std::runtime_error("3D textures loaded from images need a format with 8 bit channels"); }
 
+	VolumeLoaderOutput volumeOut;
+	loadingUtil::loadVolumeAtlasUsingSTB(texturePath, numChannels, isMipMapped, volumeOut, m_logicalDevice, m_physicalDevice);
+	create3DTexture(volumeOut, queue, cmdPool, VK_SAMPLER_ADDRESS_MODE_REPEAT, tiling, usage);
 }
 
 void Texture3D::create3DTextureFromMany2DTextures(
 	VkQueue& queue, VkCommandPool& cmdPool,	int num2DImages, int numChannels,
-	const std::string folder_path, const std::string textureBaseName, const std::string fileExtension)
+	const std::string folder_path, const std::string textureBaseName, const std::string fileExtension,
+	bool isMipMapped, VkImageTiling tiling, VkImageUsageFlags usage)
+{
+	if (FormatUtil::getNum8BitChannels(m_format) != static_cast<uint32_t>(numChannels))
+	{
+		throw std::runtime_error("the number of channels in the slices doesn't match the format of the 3D texture");
+	}
+
+	std::vector<std::string> slicePaths(num2DImages);
+	for (int i = 0; i < num2DImages; i++)
+	{
+		slicePaths[i] = folder_path + textureBaseName + "(" + std::to_string(i + 1) + ")" + fileExtension;
+	}
+
+	VolumeLoaderOutput volumeOut;
+	loadingUtil::loadVolumeSlicesUsingSTB(slicePaths, static_cast<uint32_t>(numChannels), isMipMapped, volumeOut, m_logicalDevice, m_physicalDevice);
+	create3DTexture(volumeOut, queue, cmdPool, VK_SAMPLER_ADDRESS_MODE_REPEAT, tiling, usage);
+}
+
+void Texture3D::create3DTextureFromNoise(
+	const CloudNoiseUtil::CloudNoiseParams& params, VkQueue& queue, VkCommandPool& cmdPool,
+	bool isMipMapped, const std::string cacheFolder, VkImageTiling tiling, VkImageUsageFlags usage)
 {
+	if (FormatUtil::getNum8BitChannels(m_format) != CloudNoiseUtil::NUM_CHANNELS)
+	{
+		throw std::runtime_error("the noise volumes are RGBA8, the 3D texture needs a matching format");
+	}
+
+	VolumeLoaderOutput volumeOut;
+	loadingUtil::loadCloudNoiseVolume(params, isMipMapped, cacheFolder, volumeOut, m_logicalDevice, m_physicalDevice);
+	create3DTexture(volumeOut, queue, cmdPool, VK_SAMPLER_ADDRESS_MODE_REPEAT, tiling, usage);
+}
+
+void Texture3D::create3DTexture(
+	VolumeLoaderOutput& volumeOut, VkQueue& queue, VkCommandPool& cmdPool,
+	VkSamplerAddressMode samplerAddressMode, VkImageTiling tiling, VkImageUsageFlags usage)
+{
+#ifndef NDEBUG
+	TIME_POINT uploadStart = std::chrono::high_resolution_clock::now();
+#endif
+
+	m_width = volumeOut.width;
+	m_height = volumeOut.height;
+	m_depth = volumeOut.depth;
+	m_mipLevels = volumeOut.mipLevels;
+
+	// The mip chain was generated on the CPU, so every level is a plain copy out of the staging buffer
+	std::vector<VkBufferImageCopy> bufferCopyRegions(m_mipLevels);
+	for (uint32_t level = 0; level < m_mipLevels; level++)
+	{
+		VkBufferImageCopy& bufferCopyRegion = bufferCopyRegions[level];
+		bufferCopyRegion = {};
+		bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		bufferCopyRegion.imageSubresource.mipLevel = level;
+		bufferCopyRegion.imageSubresource.baseArrayLayer = 0;
+		bufferCopyRegion.imageSubresource.layerCount = 1;
+		bufferCopyRegion.imageExtent.width = std::max(1u, m_width >> level);
+		bufferCopyRegion.imageExtent.height = std::max(1u, m_height >> level);
+		bufferCopyRegion.imageExtent.depth = std::max(1u, m_depth >> level);
+		bufferCopyRegion.bufferOffset = volumeOut.mipOffsets[level];
+	}
+
+	VkExtent3D extent = { m_width, m_height, m_depth };
+	ImageUtil::createImage(m_logicalDevice, m_physicalDevice, m_image, m_imageMemory, VK_IMAGE_TYPE_3D, m_format, extent, 
+		usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_SAMPLE_COUNT_1_BIT, tiling, m_mipLevels, m_layerCount, VK_IMAGE_LAYOUT_UNDEFINED, VK_SHARING_MODE_EXCLUSIVE);
 
-}
\ No newline at end of file
+	ImageUtil::transitionImageLayout_SingleTimeCommand(m_logicalDevice, queue, cmdPool, m_image, m_format,
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, m_mipLevels);
+	ImageUtil::copyBufferToImage_SingleTimeCommand(m_logicalDevice, queue, cmdPool, volumeOut.stagingBuffer, m_image,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(bufferCopyRegions.size()), bufferCopyRegions.data());
+
+	// Destroy Staging Buffer
+	vkDestroyBuffer(m_logicalDevice, volumeOut.stagingBuffer, nullptr);
+	VulkanMemoryTracker::free(m_logicalDevice, volumeOut.stagingBufferMemory);
+
+	m_imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	ImageUtil::transitionImageLayout_SingleTimeCommand(m_logicalDevice, queue, cmdPool, m_image, m_format,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, m_imageLayout, m_mipLevels);
+
+	createViewSamplerAndUpdateDescriptor(m_mipLevels > 1, samplerAddressMode, queue, cmdPool);
+
+#ifndef NDEBUG
+	const float uploadTime = TimerUtil::getTimeElapsedSinceStart(uploadStart);
+	const float uploadedMB = static_cast<float>(ImageProcessingUtil::volumeSizeInBytes(m_width, m_height, m_depth, volumeOut.numChannels)) / (1024.0f * 1024.0f);
+	std::cout << "3D texture " << m_width << "x" << m_height << "x" << m_depth << " (" << m_mipLevels << " mips): uploaded in " 
+		<< uploadTime << " ms (" << uploadedMB / (uploadTime / 1000.0f) << " MB/s for mip 0)" << std::endl;
+#endif
+}
@@ -4,27 +4,25 @@
 #include <Vulkan/Utilities/vBufferUtil.h>
 #include <Vulkan/Utilities/vImageUtil.h>
 #include <Utilities/loadingUtilityForward.h>
+#include <Utilities/cloudNoiseUtility.h>
 
 class Texture
 {
 public:
 	Texture() = delete;
-	Texture(VkDevice lDevice, VkPhysicalDevice pDevice, VkFormat format, uint32_t layerCount, uint32_t mipLevels)
-		: m_logicalDevice(lDevice), m_physicalDevice(pDevice), 
+	Texture(VkDevice lDevice, VkPhysicalDevice pDevice, std::shared_ptr<VulkanResourceCache> resourceCache, 
+		VkFormat format, uint32_t layerCount, uint32_t mipLevels)
+		: m_logicalDevice(lDevice), m_physicalDevice(pDevice), m_resourceCache(resourceCache),
 		m_format(format), m_layerCount(layerCount), m_mipLevels(mipLevels),
 		m_image(VK_NULL_HANDLE), m_imageMemory(VK_NULL_HANDLE), m_imageView(VK_NULL_HANDLE), m_sampler(VK_NULL_HANDLE)
 	{}
+	// Doesn't wait on the device, a texture dropped while frames that sample it are in flight has to go through VulkanManager::deferDestruction
 	~Texture()
 	{
-		vkDeviceWaitIdle(m_logicalDevice);
-
-		vkDestroyImageView(m_logicalDevice, m_imageView, nullptr);
+		// The sampler is shared through the resource cache and outlives the texture
+		m_resourceCache->releaseImageView(m_imageView);
 		vkDestroyImage(m_logicalDevice, m_image, nullptr);
-		if (m_sampler)
-		{
-			vkDestroySampler(m_logicalDevice, m_sampler, nullptr);
-		}
-		vkFreeMemory(m_logicalDevice, m_imageMemory, nullptr);
+		VulkanMemoryTracker::free(m_logicalDevice, m_imageMemory);
 	}
 
 	void setDescriptorInfo()
@@ -36,12 +34,14 @@ public:
 
 	void createViewSamplerAndUpdateDescriptor(bool isMipMapped, VkSamplerAddressMode samplerAddressMode, VkQueue& queue, VkCommandPool& cmdPool)
 	{
-		// Create 2D image View
-		ImageUtil::createImageView(m_logicalDevice, m_image, &m_imageView, VK_IMAGE_VIEW_TYPE_2D, m_format, VK_IMAGE_ASPECT_COLOR_BIT, m_mipLevels, nullptr);
+		// Create image View
+		m_imageView = m_resourceCache->getImageView(
+			ImageUtil::createImageViewCreateInfo(m_image, m_viewType, m_format, VK_IMAGE_ASPECT_COLOR_BIT, m_mipLevels, m_layerCount));
 
-		// Create Texture Sampler
-		ImageUtil::createImageSampler(m_logicalDevice, m_sampler, VK_FILTER_LINEAR, VK_FILTER_LINEAR, samplerAddressMode,
-			VK_SAMPLER_MIPMAP_MODE_LINEAR, 0, 0, static_cast<float>(m_mipLevels), 16, VK_COMPARE_OP_NEVER);
+		// Texture Sampler -- maxLod doesn't clamp anything below the real mip count, so VK_LOD_CLAMP_NONE lets every texture
+		// with the same address mode share one sampler. The anisotropy level is clamped by the cache to the renderer's setting.
+		m_sampler = m_resourceCache->getSampler(ImageUtil::createSamplerCreateInfo(VK_FILTER_LINEAR, VK_FILTER_LINEAR, samplerAddressMode,
+			VK_SAMPLER_MIPMAP_MODE_LINEAR, 0, 0, VK_LOD_CLAMP_NONE, 16, VK_COMPARE_OP_NEVER));
 
 		// Update descriptor image info member that can be used for setting up descriptor sets
 		setDescriptorInfo();
@@ -76,32 +76,34 @@ public:
 	uint32_t m_layerCount;
 	VkFormat m_format;
 	VkImageLayout m_imageLayout;
+	VkImageViewType m_viewType = VK_IMAGE_VIEW_TYPE_2D;
 
 	VkImage m_image = VK_NULL_HANDLE;
 	VkDeviceMemory m_imageMemory = VK_NULL_HANDLE;
 	VkImageView m_imageView = VK_NULL_HANDLE;
-	VkSampler m_sampler = VK_NULL_HANDLE;
+	VkSampler m_sampler = VK_NULL_HANDLE; // Not owned, see VulkanResourceCache
 
 	VkDescriptorImageInfo m_descriptorInfo;
 
 protected:
 	VkDevice m_logicalDevice;
 	VkPhysicalDevice m_physicalDevice;
+	std::shared_ptr<VulkanResourceCache> m_resourceCache;
 };
 
 class Texture2D : public Texture
 {
 public:
 	Texture2D() = delete;
-	Texture2D(VkDevice lDevice, VkPhysicalDevice pDevice, VkQueue& queue, VkCommandPool& cmdPool,
+	Texture2D(VkDevice lDevice, VkPhysicalDevice pDevice, std::shared_ptr<VulkanResourceCache> resourceCache, VkQueue& queue, VkCommandPool& cmdPool,
 		VkFormat format = VK_FORMAT_R8G8B8A8_UNORM, uint32_t mipLevels = 1)
-		: Texture(lDevice, pDevice, format, 1, mipLevels)
+		: Texture(lDevice, pDevice, resourceCache, format, 1, mipLevels)
 	{
 		m_depth = 1;
 	}
 	Texture2D(std::shared_ptr<VulkanManager> vulkanManager, VkQueue& queue, VkCommandPool& cmdPool,
 		VkFormat format = VK_FORMAT_R8G8B8A8_UNORM, uint32_t mipLevels = 1)
-		: Texture2D(vulkanManager->getLogicalDevice(), vulkanManager->getPhysicalDevice(), queue, cmdPool, format, mipLevels) 
+		: Texture2D(vulkanManager->getLogicalDevice(), vulkanManager->getPhysicalDevice(), vulkanManager->getResourceCache(), queue, cmdPool, format, mipLevels) 
 	{}
 
 	void create2DTexture(
@@ -120,6 +122,13 @@ public:
 
 	void creationHelperPart1(ImageLoaderOutput& imgOut, VkQueue& queue, VkCommandPool& cmdPool,
 		bool isMipMapped, VkImageTiling tiling, VkImageUsageFlags usage);
+
+	// Uploads go through the upload queue instead of single time commands on the queue passed in,
+	// the texture can't be sampled until the batch it was recorded into has completed
+	void setUploadQueue(std::shared_ptr<VulkanUploadQueue> uploadQueue) { m_uploadQueue = uploadQueue; }
+
+private:
+	std::shared_ptr<VulkanUploadQueue> m_uploadQueue;
 };
 
 class Texture2DArray : public Texture
@@ -129,17 +138,19 @@ public:
 	Texture2DArray() = delete;
 	Texture2DArray(std::shared_ptr<VulkanManager> vulkanManager, VkQueue& queue, VkCommandPool& cmdPool, 
 		uint32_t layerCount, VkFormat format = VK_FORMAT_R8G8B8A8_UNORM, uint32_t mipLevels = 1)
-		: Texture(vulkanManager->getLogicalDevice(), vulkanManager->getPhysicalDevice(), format, layerCount, mipLevels)
+		: Texture(vulkanManager->getLogicalDevice(), vulkanManager->getPhysicalDevice(), vulkanManager->getResourceCache(), format, layerCount, mipLevels)
 	{
 		m_depth = 1;
+		m_viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
 	}
 	
 	// Use individual textures to create a 2D Texture Array
-	// If addPadding it true then we additinally add black pixels to the smallest texture to make it the same size as the biggest texture in the 
+	// Textures that aren't the same size as the others are fixed up on the CPU according to the FixTextureFlag
 	void create2DTextureArray(
 		std::vector<std::string> texturePaths,
 		VkQueue& queue, VkCommandPool& cmdPool,
 		bool isMipMapped = false, 
+		FixTextureFlag fix = FixTextureFlag::SCALE_UP,
 		VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL,
 		VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT);
 
@@ -161,9 +172,12 @@ public:
 	Texture3D() = delete;
 	Texture3D(std::shared_ptr<VulkanManager> vulkanManager, VkQueue& queue, VkCommandPool& cmdPool, 
 		VkFormat format = VK_FORMAT_R8G8B8A8_UNORM, uint32_t mipLevels = 1)
-		: Texture(vulkanManager->getLogicalDevice(), vulkanManager->getPhysicalDevice(), format, 1, mipLevels)
-	{};
+		: Texture(vulkanManager->getLogicalDevice(), vulkanManager->getPhysicalDevice(), vulkanManager->getResourceCache(), format, 1, mipLevels)
+	{
+		m_viewType = VK_IMAGE_VIEW_TYPE_3D;
+	};
 
+	// The file holds the volume's square slices stacked vertically, i.e. its height is width * depth
 	void create3DTexture(
 		std::string texturePath,
 		VkQueue& queue, VkCommandPool& cmdPool,
@@ -171,8 +185,31 @@ public:
 		VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL,
 		VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT);
 
+	// Slice i is read from folder_path + textureBaseName + "(i)" + fileExtension with i starting at 1, e.g. "LowFrequency(1).tga"
+	// numChannels is the number of 8 bit channels per texel and has to match the texture's format
 	void create3DTextureFromMany2DTextures(
 		VkQueue& queue, VkCommandPool& cmdPool,
 		int num2DImages, int numChannels,
-		const std::string folder_path, const std::string textureBaseName, const std::string fileExtension);
+		const std::string folder_path, const std::string textureBaseName, const std::string fileExtension,
+		bool isMipMapped = false,
+		VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL,
+		VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT);
+
+	// Bakes the volume on the CPU instead of loading slices, the noise tiles so the sampler repeats.
+	// The cache folder is optional, see CloudNoiseUtil::getCacheFilePath.
+	void create3DTextureFromNoise(
+		const CloudNoiseUtil::CloudNoiseParams& params,
+		VkQueue& queue, VkCommandPool& cmdPool,
+		bool isMipMapped = false,
+		const std::string cacheFolder = "",
+		VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL,
+		VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT);
+
+	// Uploads every mip level in the staging buffer with one copy
+	void create3DTexture(
+		VolumeLoaderOutput& volumeOut,
+		VkQueue& queue, VkCommandPool& cmdPool,
+		VkSamplerAddressMode samplerAddressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL,
+		VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT);
 };
\ No newline at end of file
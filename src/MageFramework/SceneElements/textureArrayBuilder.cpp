@@ -0,0 +1,276 @@
+#include "textureArrayBuilder.h"
+#include <Utilities/imageProcessingUtility.h>
+
+bool TextureArrayBuilder::addImage(const Texture* texture, VkFormat format, uint32_t width, uint32_t height, const unsigned char* pixels)
+{
+	// The CPU side resampling only understands tightly packed 8 bit RGBA style texels
+	const bool isSupportedFormat =
+		format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R8G8B8A8_SRGB ||
+		format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+	if (!isSupportedFormat || !pixels || width == 0 || height == 0)
+	{
+		return false;
+	}
+
+	PendingImage image;
+	image.texture = texture;
+	image.format = format;
+	image.width = width;
+	image.height = height;
+	image.pixels.assign(pixels, pixels + ImageProcessingUtil::imageSizeInBytes(width, height));
+	m_pendingImages.push_back(std::move(image));
+	return true;
+}
+
+uint32_t TextureArrayBuilder::sizeClass(uint32_t extent, uint32_t maxExtent) const
+{
+	const uint32_t powerOfTwo = ImageProcessingUtil::nearestPowerOfTwo(extent);
+	return std::min(std::max(powerOfTwo, m_minExtent), maxExtent);
+}
+
+void TextureArrayBuilder::pack(uint32_t maxExtent, uint32_t maxLayers, int32_t firstArrayIndex, const std::function<void(PackedArray&)>& onArrayPacked)
+{
+	// Group the images; std::map keeps the array indices deterministic from run to run
+	std::map<GroupKey, std::vector<uint32_t>> groups;
+	for (uint32_t i = 0; i < static_cast<uint32_t>(m_pendingImages.size()); i++)
+	{
+		const PendingImage& image = m_pendingImages[i];
+		GroupKey key = { image.format, sizeClass(image.width, maxExtent), sizeClass(image.height, maxExtent) };
+		groups[key].push_back(i);
+	}
+
+	int32_t arrayIndex = firstArrayIndex;
+	std::vector<unsigned char> resampledPixels;
+	for (auto& group : groups)
+	{
+		const GroupKey& key = group.first;
+		const std::vector<uint32_t>& members = group.second;
+		const size_t layerSize = ImageProcessingUtil::imageSizeInBytes(key.width, key.height);
+
+		// A group can hold more images than a single array is allowed to have layers
+		for (size_t first = 0; first < members.size(); first += maxLayers)
+		{
+			PackedArray packedArray;
+			packedArray.format = key.format;
+			packedArray.width = key.width;
+			packedArray.height = key.height;
+			packedArray.layerCount = static_cast<uint32_t>(std::min(members.size() - first, static_cast<size_t>(maxLayers)));
+			uint32_t resampledCount = 0;
+
+			// Pack every layer back to back, resampling the ones that aren't already the size of the array.
+			// A layer always covers the whole array extent so the texture coordinates of the draws don't change.
+			packedArray.pixels.resize(layerSize * packedArray.layerCount);
+			for (uint32_t layer = 0; layer < packedArray.layerCount; layer++)
+			{
+				PendingImage& image = m_pendingImages[members[first + layer]];
+				const unsigned char* layerPixels = image.pixels.data();
+				if (image.width != key.width || image.height != key.height)
+				{
+					ImageProcessingUtil::resizeImage(image.pixels.data(), image.width, image.height, resampledPixels, key.width, key.height);
+					layerPixels = resampledPixels.data();
+					resampledCount++;
+				}
+				memcpy(packedArray.pixels.data() + layer * layerSize, layerPixels, layerSize);
+				m_slots[image.texture] = { arrayIndex, static_cast<int32_t>(layer) };
+
+				// Free the CPU copy as soon as it has been packed
+				std::vector<unsigned char>().swap(image.pixels);
+			}
+
+			m_summary.push_back({ key, packedArray.layerCount, resampledCount });
+			onArrayPacked(packedArray);
+			arrayIndex++;
+		}
+	}
+
+	m_pendingImages.clear();
+}
+
+void TextureArrayBuilder::build(std::shared_ptr<VulkanManager> vulkanManager, VkQueue& queue, VkCommandPool& cmdPool, bool isMipMapped,
+	std::vector<std::shared_ptr<Texture2DArray>>& textureArrays)
+{
+	if (m_pendingImages.empty())
+	{
+		return;
+	}
+
+	VkDevice logicalDevice = vulkanManager->getLogicalDevice();
+	VkPhysicalDevice physicalDevice = vulkanManager->getPhysicalDevice();
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+	const uint32_t maxLayers = deviceProperties.limits.maxImageArrayLayers;
+	const uint32_t maxExtent = ImageProcessingUtil::nearestPowerOfTwo(std::min(m_maxExtent, deviceProperties.limits.maxImageDimension2D));
+
+	pack(maxExtent, maxLayers, static_cast<int32_t>(textureArrays.size()), [&](PackedArray& packedArray)
+	{
+		ImageArrayLoaderOutput imgArrayOut;
+		imgArrayOut.imgUsageTypes.assign(packedArray.layerCount, ImageArrayLoaderOutput::IMAGE_USAGE::COLOR);
+		imgArrayOut.imgWidths.assign(packedArray.layerCount, packedArray.width);
+		imgArrayOut.imgHeights.assign(packedArray.layerCount, packedArray.height);
+
+		BufferUtil::createStagingBuffer(logicalDevice, physicalDevice, packedArray.pixels.data(),
+			imgArrayOut.stagingBuffer, imgArrayOut.stagingBufferMemory, static_cast<VkDeviceSize>(packedArray.pixels.size()));
+
+		std::shared_ptr<Texture2DArray> textureArray =
+			std::make_shared<Texture2DArray>(vulkanManager, queue, cmdPool, packedArray.layerCount, packedArray.format);
+		textureArray->create2DTextureArray(imgArrayOut, queue, cmdPool, isMipMapped);
+		textureArrays.push_back(textureArray);
+	});
+}
+
+void TextureArrayBuilder::printSummary() const
+{
+	uint32_t totalLayers = 0;
+	std::cout << "\nTexture arrays built: " << m_summary.size() << std::endl;
+	for (size_t i = 0; i < m_summary.size(); i++)
+	{
+		const ArraySummary& summary = m_summary[i];
+		std::cout << "  array " << i << " : " << summary.key.width << "x" << summary.key.height
+			<< ", format " << summary.key.format
+			<< ", " << summary.layerCount << " layers"
+			<< ", " << summary.resampledCount << " resampled" << std::endl;
+		totalLayers += summary.layerCount;
+	}
+	std::cout << "  " << totalLayers << " textures packed into " << m_summary.size() << " arrays" << std::endl;
+}
+
+bool TextureArrayBuilder::verifyPacking()
+{
+	const uint32_t bytesPerPixel = ImageProcessingUtil::BYTES_PER_PIXEL;
+	auto makeImage = [bytesPerPixel](uint32_t width, uint32_t height, const std::function<void(uint32_t, uint32_t, unsigned char*)>& texel)
+	{
+		std::vector<unsigned char> pixels(ImageProcessingUtil::imageSizeInBytes(width, height));
+		for (uint32_t y = 0; y < height; y++)
+		{
+			for (uint32_t x = 0; x < width; x++)
+			{
+				texel(x, y, &pixels[(static_cast<size_t>(y) * width + x) * bytesPerPixel]);
+			}
+		}
+		return pixels;
+	};
+	auto solid = [](unsigned char r, unsigned char g, unsigned char b)
+	{
+		return [r, g, b](uint32_t, uint32_t, unsigned char* texel) { texel[0] = r; texel[1] = g; texel[2] = b; texel[3] = 255; };
+	};
+
+	// The builder only uses the textures as lookup keys, it never dereferences them
+	enum { RED, GREEN, BLUE, STRIPES, GRADIENT, SINGLE_CHANNEL, NUM_IMAGES };
+	const char keyStorage[NUM_IMAGES] = {};
+	auto key = [&keyStorage](int image) { return reinterpret_cast<const Texture*>(&keyStorage[image]); };
+
+	// Red, green and blue share a size class but only two layers fit in an array. The stripes only have to shrink along
+	// their width (1024x64 -> 256x64) and the gradient is resampled from 48x80 to 64x64 in an array of its own format.
+	const uint32_t gradientWidth = 48, gradientHeight = 80;
+	const std::vector<unsigned char> red = makeImage(64, 64, solid(255, 0, 0));
+	const std::vector<unsigned char> green = makeImage(64, 64, solid(0, 255, 0));
+	const std::vector<unsigned char> blue = makeImage(64, 64, solid(0, 0, 255));
+	const std::vector<unsigned char> stripes = makeImage(1024, 64, [](uint32_t x, uint32_t, unsigned char* texel)
+	{
+		// Every 4 columns average to 127.5, a filter that skips columns sees only the black pair in the middle
+		const unsigned char value = (x % 4 == 0 || x % 4 == 3) ? 255 : 0;
+		texel[0] = value; texel[1] = value; texel[2] = value; texel[3] = 255;
+	});
+	const std::vector<unsigned char> gradient = makeImage(gradientWidth, gradientHeight, [&](uint32_t x, uint32_t y, unsigned char* texel)
+	{
+		texel[0] = static_cast<unsigned char>(x * 255 / (gradientWidth - 1));
+		texel[1] = static_cast<unsigned char>(y * 255 / (gradientHeight - 1));
+		texel[2] = 0; texel[3] = 255;
+	});
+
+	TextureArrayBuilder builder;
+	bool passed = true;
+	auto check = [&passed](bool condition, const std::string& description)
+	{
+		if (!condition)
+		{
+			std::cout << "  FAILED: " << description << std::endl;
+			passed = false;
+		}
+	};
+
+	check(builder.addImage(key(RED), VK_FORMAT_R8G8B8A8_UNORM, 64, 64, red.data()), "red was added");
+	check(builder.addImage(key(GREEN), VK_FORMAT_R8G8B8A8_UNORM, 64, 64, green.data()), "green was added");
+	check(builder.addImage(key(BLUE), VK_FORMAT_R8G8B8A8_UNORM, 64, 64, blue.data()), "blue was added");
+	check(builder.addImage(key(STRIPES), VK_FORMAT_R8G8B8A8_UNORM, 1024, 64, stripes.data()), "stripes were added");
+	check(builder.addImage(key(GRADIENT), VK_FORMAT_R8G8B8A8_SRGB, gradientWidth, gradientHeight, gradient.data()), "gradient was added");
+	check(!builder.addImage(key(SINGLE_CHANNEL), VK_FORMAT_R8_UNORM, 64, 64, red.data()), "single channel image was refused");
+
+	const int32_t firstArrayIndex = 3;
+	std::vector<PackedArray> packedArrays;
+	builder.pack(256, 2, firstArrayIndex, [&packedArrays](PackedArray& packedArray) { packedArrays.push_back(std::move(packedArray)); });
+	check(packedArrays.size() == 4, "4 arrays were packed");
+	check(builder.getNumPendingImages() == 0, "no image is left pending");
+	if (!passed)
+	{
+		return false;
+	}
+
+	// Every layer is looked up through the slot the draws would get
+	auto layerOf = [&](int image, uint32_t width, uint32_t height) -> const unsigned char*
+	{
+		const TextureArraySlot slot = builder.getSlot(key(image));
+		if (!slot.isValid() || slot.arrayIndex < firstArrayIndex || slot.arrayIndex >= firstArrayIndex + static_cast<int32_t>(packedArrays.size()))
+		{
+			return nullptr;
+		}
+		const PackedArray& packedArray = packedArrays[slot.arrayIndex - firstArrayIndex];
+		if (packedArray.width != width || packedArray.height != height || slot.layer >= static_cast<int32_t>(packedArray.layerCount))
+		{
+			return nullptr;
+		}
+		return packedArray.pixels.data() + slot.layer * ImageProcessingUtil::imageSizeInBytes(width, height);
+	};
+
+	const TextureArraySlot redSlot = builder.getSlot(key(RED));
+	const TextureArraySlot greenSlot = builder.getSlot(key(GREEN));
+	const TextureArraySlot blueSlot = builder.getSlot(key(BLUE));
+	check(redSlot.arrayIndex == greenSlot.arrayIndex && redSlot.layer != greenSlot.layer, "red and green share an array");
+	check(blueSlot.isValid() && blueSlot.arrayIndex != redSlot.arrayIndex, "blue spilled into a second array");
+	check(!builder.getSlot(key(SINGLE_CHANNEL)).isValid(), "the refused image has no slot");
+
+	const std::vector<unsigned char>* solids[] = { &red, &green, &blue };
+	for (int image = RED; image <= BLUE; image++)
+	{
+		const unsigned char* layer = layerOf(image, 64, 64);
+		check(layer && memcmp(layer, solids[image]->data(), solids[image]->size()) == 0, "solid layer " + std::to_string(image) + " holds its own image");
+	}
+
+	const unsigned char* stripesLayer = layerOf(STRIPES, 256, 64);
+	check(stripesLayer != nullptr, "stripes were packed into a 256x64 array");
+	for (size_t i = 0; stripesLayer && i < ImageProcessingUtil::imageSizeInBytes(256, 64); i += bytesPerPixel)
+	{
+		if (std::abs(static_cast<int>(stripesLayer[i]) - 128) > 1)
+		{
+			check(false, "stripes were box filtered along their width, found " + std::to_string(stripesLayer[i]));
+			break;
+		}
+	}
+
+	// A layer covers the whole array so the draw's texture coordinates sample the same spot of the original image
+	const unsigned char* gradientLayer = layerOf(GRADIENT, 64, 64);
+	check(gradientLayer != nullptr, "gradient was packed into a 64x64 array");
+	for (uint32_t y = 0; gradientLayer && y < 64; y++)
+	{
+		for (uint32_t x = 0; x < 64; x++)
+		{
+			const float u = (x + 0.5f) / 64.0f;
+			const float v = (y + 0.5f) / 64.0f;
+			const float srcX = std::min(std::max(u * gradientWidth - 0.5f, 0.0f), static_cast<float>(gradientWidth - 1));
+			const float srcY = std::min(std::max(v * gradientHeight - 0.5f, 0.0f), static_cast<float>(gradientHeight - 1));
+			const float expectedR = srcX * 255.0f / (gradientWidth - 1);
+			const float expectedG = srcY * 255.0f / (gradientHeight - 1);
+			const unsigned char* texel = gradientLayer + (static_cast<size_t>(y) * 64 + x) * bytesPerPixel;
+			if (std::abs(texel[0] - expectedR) > 3.0f || std::abs(texel[1] - expectedG) > 3.0f)
+			{
+				check(false, "gradient at uv (" + std::to_string(u) + ", " + std::to_string(v) + ") matches the original image");
+				y = 64;
+				break;
+			}
+		}
+	}
+
+	std::cout << "Texture array packing " << (passed ? "passed" : "failed") << std::endl;
+	return passed;
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <global.h>
+#include <map>
+#include <functional>
+#include <unordered_map>
+#include <Vulkan/vulkanManager.h>
+#include <SceneElements/texture.h>
+
+// Location of a texture inside the texture arrays built by the TextureArrayBuilder
+struct TextureArraySlot
+{
+	int32_t arrayIndex = -1;
+	int32_t layer = -1;
+
+	bool isValid() const { return arrayIndex >= 0 && layer >= 0; }
+};
+
+// Collects the textures of a scene and packs them into as few Texture2DArrays as possible so that draws can select
+// their textures with an (array, layer) index instead of needing their own descriptor set.
+// Textures are grouped by format and size class, where the size class is the nearest power of two of each dimension.
+// Textures that don't exactly match their size class (the outliers) are resampled on the CPU before being packed.
+class TextureArrayBuilder
+{
+public:
+	TextureArrayBuilder(uint32_t maxExtent = 4096, uint32_t minExtent = 4)
+		: m_maxExtent(maxExtent), m_minExtent(minExtent)
+	{}
+
+	// The pixels are copied, so the caller is free to release them right after this call.
+	// Returns false if the texture can't be placed in an array (only 8 bit, 4 channel formats are supported).
+	bool addImage(const Texture* texture, VkFormat format, uint32_t width, uint32_t height, const unsigned char* pixels);
+
+	// Every layer of a packed array back to back, each one already resampled to the array's extent
+	struct PackedArray
+	{
+		VkFormat format;
+		uint32_t width, height;
+		uint32_t layerCount;
+		std::vector<unsigned char> pixels;
+	};
+
+	// Groups and packs the images added so far on the CPU and assigns their slots, starting at firstArrayIndex.
+	// Each array is handed to onArrayPacked as soon as it is packed (so only one of them is alive at a time) and the
+	// CPU copies of the images are released as they are packed.
+	void pack(uint32_t maxExtent, uint32_t maxLayers, int32_t firstArrayIndex, const std::function<void(PackedArray&)>& onArrayPacked);
+
+	// Creates the texture arrays for all the images added so far and releases the CPU copies of their pixels
+	void build(std::shared_ptr<VulkanManager> vulkanManager, VkQueue& queue, VkCommandPool& cmdPool, bool isMipMapped,
+		std::vector<std::shared_ptr<Texture2DArray>>& textureArrays);
+
+	TextureArraySlot getSlot(const Texture* texture) const
+	{
+		std::unordered_map<const Texture*, TextureArraySlot>::const_iterator found = m_slots.find(texture);
+		if (found == m_slots.end()) { return TextureArraySlot(); }
+		return found->second;
+	}
+
+	uint32_t getNumPendingImages() const { return static_cast<uint32_t>(m_pendingImages.size()); }
+	void printSummary() const;
+
+	// Packs a handful of synthetic images and checks their slots, that every layer holds its own image and that sampling
+	// a layer at a texture coordinate gives what the original image has there. Needs no device.
+	static bool verifyPacking();
+
+private:
+	struct PendingImage
+	{
+		const Texture* texture;
+		VkFormat format;
+		uint32_t width, height;
+		std::vector<unsigned char> pixels;
+	};
+
+	struct GroupKey
+	{
+		VkFormat format;
+		uint32_t width, height;
+
+		bool operator<(const GroupKey& other) const
+		{
+			if (format != other.format) { return format < other.format; }
+			if (width != other.width) { return width < other.width; }
+			return height < other.height;
+		}
+	};
+
+	struct ArraySummary
+	{
+		GroupKey key;
+		uint32_t layerCount;
+		uint32_t resampledCount;
+	};
+
+	uint32_t sizeClass(uint32_t extent, uint32_t maxExtent) const;
+
+private:
+	uint32_t m_maxExtent;
+	uint32_t m_minExtent;
+
+	std::vector<PendingImage> m_pendingImages;
+	std::unordered_map<const Texture*, TextureArraySlot> m_slots;
+	std::vector<ArraySummary> m_summary;
+};
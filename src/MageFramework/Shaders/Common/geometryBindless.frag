@@ -0,0 +1,84 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : enable
+
+// Bindless variant of geometryPlain.frag
+// All the scene's textures live in one array, the material picked by the push constant says which ones to sample
+// Textures that were packed into texture arrays are picked by (array, layer) instead
+
+#define MAX_TEXTURE_ARRAYS 64 // Has to match MAX_BINDLESS_TEXTURE_ARRAYS in bindlessMaterials.cpp
+
+// Has to match AlphaMode in modelForward.h
+#define ALPHAMODE_OPAQUE 0
+#define ALPHAMODE_MASK 1
+
+struct Material
+{
+	uint activeTextureFlags;
+	int alphaMode;
+	float alphaCutoff;
+	float metallicFactor;
+	float roughnessFactor;
+	uint samplerIndex;
+	vec4 baseColorFactor;
+	ivec4 textureIndices; // baseColor, normal, metallicRoughness, emissive
+	int occlusionTextureIndex;
+	ivec4 textureLayers; // -1 if the texture isn't in a texture array
+	int occlusionTextureLayer;
+};
+
+layout(set = 1, binding = 0) readonly buffer Materials
+{
+	Material materials[];
+};
+layout(set = 1, binding = 1) uniform sampler samplers[2];
+layout(set = 1, binding = 2) uniform texture2DArray textureArrays[MAX_TEXTURE_ARRAYS];
+layout(set = 1, binding = 3) uniform texture2D textures[];
+
+layout(push_constant) uniform DrawConstants
+{
+	mat4 modelMatrix;
+	uint materialIndex;
+};
+
+layout(location = 0) in vec2 f_uv;
+layout(location = 1) in vec3 f_nor;
+
+layout(location = 0) out vec4 outColor;
+
+vec4 sampleMaterialTexture(int textureIndex, int textureLayer, uint samplerIndex)
+{
+	// The indices are the same for the whole draw, i.e. dynamically uniform, so no nonuniformEXT is needed
+	// A material without the texture has index -1, it reads as white instead of indexing past the start of the array
+	if( textureIndex < 0 )
+	{
+		return vec4(1.0f);
+	}
+	if( textureLayer >= 0 )
+	{
+		return texture(sampler2DArray(textureArrays[textureIndex], samplers[samplerIndex]), vec3(f_uv, float(textureLayer)));
+	}
+	return texture(sampler2D(textures[textureIndex], samplers[samplerIndex]), f_uv);
+}
+
+void main() 
+{
+	Material material = materials[materialIndex];
+
+	vec4 baseColor = sampleMaterialTexture(material.textureIndices.x, material.textureLayers.x, material.samplerIndex) * material.baseColorFactor;
+	if( material.alphaMode == ALPHAMODE_MASK && baseColor.a < material.alphaCutoff )
+	{
+		discard;
+	}
+	vec3 normal = vec3(0.0f);
+	if( bitfieldExtract(material.activeTextureFlags, 1, 1) == 1 )
+	{
+		normal = sampleMaterialTexture(material.textureIndices.y, material.textureLayers.y, material.samplerIndex).rgb;
+	}
+	else
+	{
+		normal = f_nor;
+	}
+	 
+	outColor = vec4(baseColor.rgb, (material.alphaMode == ALPHAMODE_OPAQUE) ? 1.0 : baseColor.a);
+}
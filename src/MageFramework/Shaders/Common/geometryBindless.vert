@@ -0,0 +1,36 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Bindless variant of geometryPlain.vert
+// The model matrix comes in through push constants instead of a per primitive uniform buffer
+
+layout (set = 0, binding = 0) uniform CameraUBO
+{
+	mat4 view;
+	mat4 proj;
+	mat4 viewInverse;
+	mat4 projInverse;
+	vec4 eye;
+	vec2 tanFovBy2;
+};
+
+layout(push_constant) uniform DrawConstants
+{
+	mat4 modelMatrix;
+	uint materialIndex;
+};
+
+layout(location = 0) in vec4 inPos;
+layout(location = 1) in vec4 inNor;
+layout(location = 2) in vec4 inUV;
+
+layout(location = 0) out vec2 f_uv;
+layout(location = 1) out vec3 f_nor;
+
+void main() 
+{
+    gl_Position = proj * view * modelMatrix * vec4(inPos.xyz, 1.0);
+
+	f_uv = inUV.xy;
+	f_nor = inNor.xyz;
+}
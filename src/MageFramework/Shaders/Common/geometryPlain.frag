@@ -1,6 +1,10 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+// Has to match AlphaMode in modelForward.h
+#define ALPHAMODE_OPAQUE 0
+#define ALPHAMODE_MASK 1
+
 layout(set = 1, binding = 1) uniform MaterialUBO
 {
 	int activeTextureFlags;
@@ -23,7 +27,11 @@ layout(location = 0) out vec4 outColor;
 
 void main() 
 {
-	vec3 baseColor = texture(baseTexSampler, f_uv).rgb;
+	vec4 baseColor = texture(baseTexSampler, f_uv) * baseColorFactor;
+	if( alphaMode == ALPHAMODE_MASK && baseColor.a < alphaCutoff )
+	{
+		discard;
+	}
 	vec3 normal = vec3(0.0f);
 	if( bitfieldExtract(activeTextureFlags, 1, 1) == 1 )
 	{
@@ -34,6 +42,6 @@ void main()
 		normal = f_nor;
 	}
 	 
-	outColor = vec4(baseColor, 1.0); // baseColorFactor;//
+	outColor = vec4(baseColor.rgb, (alphaMode == ALPHAMODE_OPAQUE) ? 1.0 : baseColor.a);
 	//outColor = vec4((baseColor + normal)*0.5f, 1.0);
 }
\ No newline at end of file
@@ -16,6 +16,7 @@ layout (std140, push_constant) uniform ShaderConsts
 {
 	float toneMap_WhitePoint; // The white point is the value that is mapped to 1.0 in the regular RGB space.
 	float toneMap_Exposure;
+	float toneMap_EncodeGamma; // 0 when the image written to is sRGB and the hardware encodes for us
 } shaderConsts;
 
 layout (location = 0) in vec2 in_uv;
@@ -49,7 +50,7 @@ vec3 tonemap(vec3 x, const float whiteBalance)
    vec3 whitemap = 1.0 / Uncharted2Tonemap(white);
 
    color *= whitemap;
-   return pow(color, vec3(INVGAMMA));
+   return (shaderConsts.toneMap_EncodeGamma > 0.5) ? pow(color, vec3(INVGAMMA)) : color;
 }
 
 // Replacement for dithering noise function
@@ -0,0 +1,147 @@
+#include <playgroundApplication.h>
+#include <fstream>
+
+void GraphicsPlaygroundApplication::runCameraPathRecording(const std::string& sceneFile, const std::string& pathFile)
+{
+	initialize(sceneFile);
+	cameraPathFile = pathFile;
+	startCameraPathRecording();
+	mainLoop();
+	cleanup();
+}
+
+bool GraphicsPlaygroundApplication::runCameraPathBenchmark(const std::string& pathFile, const std::string& sceneFile, const std::string& csvPath)
+{
+	const CameraPath cameraPath = CameraPath::load(pathFile);
+
+	// Headless so neither the compositor nor the present mode gets a say in the frame times
+	initialize(sceneFile, defaultRendererOptions(), true);
+	const RendererOptions& rendererOptions = renderer->getRendererOptions();
+	std::shared_ptr<VulkanGpuProfiler> gpuProfiler = vulkanManager->getGpuProfiler();
+
+	// Every frame advances the path and the scene by the same step however long it took, so two runs render the same frames
+	const float timeStep = 1000.0f / 60.0f; // ms
+	const uint32_t numFrames = static_cast<uint32_t>(cameraPath.getDuration() * 1000.0f / timeStep) + 1;
+	renderer->setFixedTimeStep(timeStep);
+
+	float pathTime = 0.0f; // s
+	renderer->setInputSampler([&cameraPath, &pathTime]()
+	{
+		glm::vec3 eyePos, lookAtPoint;
+		cameraPath.sample(pathTime, eyePos, lookAtPoint);
+		camera->setPose(eyePos, lookAtPoint);
+	});
+
+	std::cout << "Camera path " << pathFile << ": " << cameraPath.getNumKeyframes() << " keyframes, " << numFrames << " frames through "
+		<< sceneFile << ((rendererOptions.renderType == RENDER_TYPE::RAYTRACE) ? " (ray traced)" : " (rasterized)")
+		<< " on " << vulkanManager->getPhysicalDeviceProperties().deviceName << std::endl;
+
+	struct FrameRecord
+	{
+		float cpuTime; // ms
+		float recordTime; // ms
+		uint32_t numDraws;
+		VkDeviceSize deviceMemory;
+		std::vector<float> passTimes; // ms, empty until the frame's timestamps are collected
+	};
+	std::vector<FrameRecord> frames;
+	frames.reserve(numFrames);
+	uint64_t firstFrame = 0; // Submission count of the first measured frame
+
+	// A frame's timestamps are collected when its frame in flight comes around again
+	auto collectPassTimes = [&]()
+	{
+		const uint64_t collectedFrame = gpuProfiler->getLastCollectedFrame();
+		if (collectedFrame >= firstFrame && collectedFrame - firstFrame < frames.size() && frames[collectedFrame - firstFrame].passTimes.empty())
+		{
+			for (const VulkanGpuProfiler::PassStats& stats : gpuProfiler->getPassStats())
+			{
+				frames[collectedFrame - firstFrame].passTimes.push_back(stats.lastMs);
+			}
+		}
+	};
+
+	// The warm up frames sit at the start of the path. After the last frame its pose is held until every frame in flight
+	// has come around once more, which collects the timestamps of the last frames.
+	runFrames(numFrames + vulkanManager->getNumFramesInFlight() + 1, [&](uint32_t frame, float frameTime)
+	{
+		if (frame == 0)
+		{
+			firstFrame = vulkanManager->getSubmittedFrameCount();
+		}
+		if (frame < numFrames)
+		{
+			frames.push_back({ frameTime, renderer->getLastRecordTime(), renderer->getLastDrawCount(), vulkanManager->getDeviceLocalMemoryUsage(), {} });
+		}
+		collectPassTimes();
+		pathTime = std::min(frame + 1, numFrames - 1) * timeStep / 1000.0f;
+	});
+
+	// One row per frame, the pass columns are empty if the device can't time a pass
+	const std::vector<VulkanGpuProfiler::PassStats>& passStats = gpuProfiler->getPassStats();
+	std::ofstream csv(csvPath);
+	if (csv.is_open())
+	{
+		csv << "frame,path_time_s,cpu_ms,record_ms,draws,device_memory_mb";
+		for (const VulkanGpuProfiler::PassStats& stats : passStats)
+		{
+			csv << ",gpu_" << stats.name << "_ms";
+		}
+		csv << "\n";
+		for (uint32_t frame = 0; frame < frames.size(); frame++)
+		{
+			const FrameRecord& record = frames[frame];
+			csv << frame << "," << frame * timeStep / 1000.0f << "," << record.cpuTime << "," << record.recordTime << "," << record.numDraws << ","
+				<< record.deviceMemory / (1024.0 * 1024.0);
+			for (size_t pass = 0; pass < passStats.size(); pass++)
+			{
+				csv << ",";
+				if (pass < record.passTimes.size() && passStats[pass].timed)
+				{
+					csv << record.passTimes[pass];
+				}
+			}
+			csv << "\n";
+		}
+	}
+	const bool wroteCSV = csv.is_open() && csv.good();
+
+	std::vector<float> cpuTimes;
+	float averageDraws = 0.0f;
+	for (const FrameRecord& record : frames)
+	{
+		cpuTimes.push_back(record.cpuTime);
+		averageDraws += static_cast<float>(record.numDraws) / frames.size();
+	}
+	std::cout << numFrames << " frames at a fixed " << timeStep << " ms step, " << averageDraws << " draws per frame";
+	if (vulkanManager->isMemoryBudgetSupported())
+	{
+		std::cout << ", " << frames.back().deviceMemory / (1024 * 1024) << " MB device memory in use";
+	}
+	std::cout << std::endl;
+	printFrameTimeStats("CPU frame time", computeFrameTimeStats(cpuTimes));
+	for (size_t pass = 0; pass < passStats.size(); pass++)
+	{
+		if (!passStats[pass].timed)
+		{
+			continue;
+		}
+		std::vector<float> passTimes;
+		for (const FrameRecord& record : frames)
+		{
+			if (pass < record.passTimes.size())
+			{
+				passTimes.push_back(record.passTimes[pass]);
+			}
+		}
+		if (!passTimes.empty())
+		{
+			const std::string label = "GPU " + passStats[pass].name;
+			printFrameTimeStats(label.c_str(), computeFrameTimeStats(passTimes));
+		}
+	}
+	std::cout << (wroteCSV ? "Wrote " : "Failed to write ") << csvPath << std::endl;
+
+	cleanup();
+	return wroteCSV;
+}
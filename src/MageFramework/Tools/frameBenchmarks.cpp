@@ -0,0 +1,491 @@
+#include <playgroundApplication.h>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <deque>
+
+void GraphicsPlaygroundApplication::runDrawRecordingBenchmark(uint32_t numSyntheticModels)
+{
+	RendererOptions rendererOptions = defaultRendererOptions();
+	rendererOptions.renderType = RENDER_TYPE::RASTERIZATION;
+	initialize("gltfTest_gltf_and_obj.json", rendererOptions);
+	renderer->benchmarkDrawRecording(numSyntheticModels);
+	cleanup();
+}
+
+bool GraphicsPlaygroundApplication::runRecordBudgetTest(uint32_t numFrames, float budgetMs)
+{
+	RendererOptions rendererOptions = defaultRendererOptions();
+	rendererOptions.renderType = RENDER_TYPE::RASTERIZATION;
+	rendererOptions.recordEveryFrame = true;
+	initialize("gltfTestSponza.json", rendererOptions);
+
+	// The first frames pay for pipeline and driver warm up, they aren't what the budget is about
+	float totalRecordTime = 0.0f;
+	float maxRecordTime = 0.0f;
+	runFrames(numFrames, [&](uint32_t frame, float frameTime)
+	{
+		totalRecordTime += renderer->getLastRecordTime();
+		maxRecordTime = std::max(maxRecordTime, renderer->getLastRecordTime());
+	});
+	cleanup();
+
+	const float averageRecordTime = totalRecordTime / numFrames;
+	std::cout << "Per frame command recording over " << numFrames << " frames: average " << averageRecordTime << " ms, max "
+		<< maxRecordTime << " ms, budget " << budgetMs << " ms" << std::endl;
+	return averageRecordTime <= budgetMs;
+}
+
+void GraphicsPlaygroundApplication::runFrameWaitReport(uint32_t numFrames, bool useTimelineSemaphores)
+{
+	RendererOptions rendererOptions = defaultRendererOptions();
+	rendererOptions.renderType = RENDER_TYPE::RASTERIZATION;
+	rendererOptions.timelineSemaphores = useTimelineSemaphores;
+	initialize("gltfTestSponza.json", rendererOptions);
+
+	float totalWaitTime = 0.0f;
+	float maxWaitTime = 0.0f;
+	float totalSubmitTime = 0.0f;
+	uint32_t totalSubmitCalls = 0;
+	uint32_t totalSubmitInfos = 0;
+	runFrames(numFrames, [&](uint32_t frame, float frameTime)
+	{
+		totalWaitTime += vulkanManager->getLastFrameWaitTime();
+		maxWaitTime = std::max(maxWaitTime, vulkanManager->getLastFrameWaitTime());
+
+		const VulkanFrameSubmission& frameSubmission = renderer->getFrameSubmission();
+		totalSubmitTime += frameSubmission.getSubmitTime();
+		totalSubmitCalls += frameSubmission.getNumSubmitCalls();
+		totalSubmitInfos += frameSubmission.getNumSubmitInfos();
+	});
+	const bool usedTimelineSemaphores = vulkanManager->usesTimelineSemaphores();
+	cleanup();
+
+	std::cout << "CPU wait per frame with " << (usedTimelineSemaphores ? "timeline semaphores" : "fences") << " over " << numFrames
+		<< " frames: average " << totalWaitTime / numFrames << " ms, max " << maxWaitTime << " ms" << std::endl;
+	std::cout << "Per frame submission: " << float(totalSubmitCalls) / numFrames << " vkQueueSubmit calls, "
+		<< float(totalSubmitInfos) / numFrames << " VkSubmitInfos, " << totalSubmitTime / numFrames << " ms inside vkQueueSubmit" << std::endl;
+}
+
+void GraphicsPlaygroundApplication::runLatencySweep(uint32_t numFrames)
+{
+	struct LatencySetting
+	{
+		VkPresentModeKHR presentMode;
+		const char* presentModeName;
+		uint32_t framesInFlight;
+		bool lowLatency;
+	};
+
+	// Every present mode with 1 to 4 frames in flight, then the low latency preset: one frame in flight that also waits before input
+	std::vector<LatencySetting> settings;
+	const std::pair<VkPresentModeKHR, const char*> presentModes[] = {
+		{ VK_PRESENT_MODE_FIFO_KHR, "FIFO" }, { VK_PRESENT_MODE_MAILBOX_KHR, "MAILBOX" }, { VK_PRESENT_MODE_IMMEDIATE_KHR, "IMMEDIATE" } };
+	for (const auto& presentMode : presentModes)
+	{
+		for (uint32_t framesInFlight = 1; framesInFlight <= MAX_FRAMES_IN_FLIGHT; framesInFlight++)
+		{
+			settings.push_back({ presentMode.first, presentMode.second, framesInFlight, false });
+		}
+		settings.push_back({ presentMode.first, presentMode.second, 1, true });
+	}
+
+	std::cout << "Latency sweep, " << numFrames << " frames per setting" << std::endl;
+	for (const LatencySetting& setting : settings)
+	{
+		RendererOptions rendererOptions = defaultRendererOptions();
+		rendererOptions.renderType = RENDER_TYPE::RASTERIZATION;
+		rendererOptions.presentMode = setting.presentMode;
+		rendererOptions.framesInFlight = setting.framesInFlight;
+		rendererOptions.lowLatency = setting.lowLatency;
+		initialize("gltfTestSponza.json", rendererOptions);
+
+		float totalLatency = 0.0f;
+		float maxLatency = 0.0f;
+		const FrameRun run = runFrames(numFrames, [&](uint32_t frame, float frameTime)
+		{
+			totalLatency += vulkanManager->getLastInputToCompletionLatency();
+			maxLatency = std::max(maxLatency, vulkanManager->getLastInputToCompletionLatency());
+		});
+		const bool presentModeSupported = (vulkanManager->getPresentMode() == setting.presentMode);
+		cleanup();
+
+		std::cout << "  " << setting.presentModeName << (presentModeSupported ? "" : " (unsupported, ran FIFO)")
+			<< ", " << setting.framesInFlight << " in flight" << (setting.lowLatency ? ", low latency" : "")
+			<< ": " << run.numFrames / (run.runTime / 1000.0f) << " FPS, input to GPU completion average " << totalLatency / numFrames
+			<< " ms, max " << maxLatency << " ms" << std::endl;
+	}
+}
+
+void GraphicsPlaygroundApplication::runStreamingReport(uint32_t numFrames)
+{
+	// Streams Sponza's model in a second time while Sponza renders. The scene can't take new models yet, 
+	// so the streamed model is only loaded and uploaded, what this measures is how much the frames around the load hitch.
+	JSONContents streamedContent = loadingUtil::loadJSON("gltfTestSponza.json");
+	if (streamedContent.scene.modelList.empty())
+	{
+		throw std::runtime_error("the streamed scene has no models");
+	}
+	const JSONItem::Model streamedModel = streamedContent.scene.modelList[0];
+
+	std::cout << "Streaming " << streamedModel.name << " in while rendering, " << numFrames << " frames per run" << std::endl;
+	for (const bool loadOnWorkerThread : { false, true })
+	{
+		RendererOptions rendererOptions = defaultRendererOptions();
+		rendererOptions.renderType = RENDER_TYPE::RASTERIZATION;
+		initialize("gltfTestSponza.json", rendererOptions);
+
+		// Every upload goes through the upload queue, the queue and pool the model constructor asks for are never used
+		VkQueue unusedQueue = VK_NULL_HANDLE;
+		VkCommandPool unusedCmdPool = VK_NULL_HANDLE;
+		auto loadModel = [&]()
+		{
+			return std::make_shared<Model>(vulkanManager, unusedQueue, unusedCmdPool, vulkanManager->getNumFramesInFlight(),
+				streamedModel, true, RENDER_TYPE::RASTERIZATION);
+		};
+
+		const uint32_t numBaselineFrames = numFrames / 4;
+		std::shared_ptr<Model> model;
+		std::thread loader;
+		std::atomic<bool> modelLoaded(false);
+		bool uploadDone = false;
+		float baselineFrameTime = 0.0f;
+		float maxLoadFrameTime = 0.0f;
+		uint32_t numLoadFrames = 0;
+		uint32_t numSpikes = 0;
+		float loadTime = 0.0f;
+		TIME_POINT loadStartTime;
+		// The load is part of the frame it starts in
+		auto startLoad = [&](uint32_t frame)
+		{
+			if (frame != numBaselineFrames)
+			{
+				return;
+			}
+			loadStartTime = std::chrono::high_resolution_clock::now();
+			if (loadOnWorkerThread)
+			{
+				loader = std::thread([&]() { model = loadModel(); modelLoaded = true; });
+			}
+			else
+			{
+				// What loading used to cost: the render thread decodes and uploads and waits for it all
+				model = loadModel();
+				vulkanManager->getUploadQueue()->flush();
+				modelLoaded = true;
+			}
+		};
+		runFrames(numFrames, [&](uint32_t frame, float frameTime)
+		{
+			if (frame < numBaselineFrames)
+			{
+				baselineFrameTime += frameTime / numBaselineFrames;
+			}
+			else if (!uploadDone)
+			{
+				// A frame that takes twice as long as the frames before the load counts as a hitch
+				numLoadFrames++;
+				maxLoadFrameTime = std::max(maxLoadFrameTime, frameTime);
+				numSpikes += (frameTime > 2.0f * baselineFrameTime) ? 1 : 0;
+				if (modelLoaded && model->isUploaded())
+				{
+					uploadDone = true;
+					loadTime = TimerUtil::getTimeElapsedSinceStart(loadStartTime);
+				}
+			}
+		}, 10, startLoad);
+		if (loader.joinable())
+		{
+			loader.join();
+		}
+		const bool usedDedicatedTransfer = vulkanManager->usesDedicatedTransferQueue();
+		if (model)
+		{
+			vulkanManager->deferDestruction(model);
+			model.reset();
+		}
+		cleanup();
+
+		std::cout << "  " << (loadOnWorkerThread ? "Streamed from a worker thread" : "Loaded on the render thread")
+			<< (usedDedicatedTransfer ? ", dedicated transfer queue" : ", uploads on the graphics queue") << ": ";
+		if (!uploadDone)
+		{
+			std::cout << "the upload didn't finish within the run" << std::endl;
+			continue;
+		}
+		std::cout << "loaded in " << loadTime << " ms over " << numLoadFrames << " frames, frame time before the load " << baselineFrameTime
+			<< " ms, max while loading " << maxLoadFrameTime << " ms, " << numSpikes << " frames over twice the baseline" << std::endl;
+	}
+}
+
+bool GraphicsPlaygroundApplication::runResourceChurnTest(uint32_t numFrames)
+{
+	// Every frame creates a texture and a device local buffer through the upload queue, i.e. what loading a model or swapping a texture does.
+	// Once its upload is done each set is read by a copy submitted on the graphics queue right before a frame and dropped straight after,
+	// so it is released while that frame is still in flight. Dropping must never wait on the GPU and everything has to be destroyed in the end.
+	// Frames are timed as a whole, one that takes more than twice the frame time measured before the churn starts is counted as a stall,
+	// and every drop is timed on its own, one that takes longer than maxReleaseTime fails the test as well.
+	RendererOptions rendererOptions = defaultRendererOptions();
+	rendererOptions.renderType = RENDER_TYPE::RASTERIZATION;
+	initialize("gltfTestSponza.json", rendererOptions);
+
+	VkDevice logicalDevice = vulkanManager->getLogicalDevice();
+	VkPhysicalDevice physicalDevice = vulkanManager->getPhysicalDevice();
+	VkQueue graphicsQueue = vulkanManager->getQueue(QueueFlags::Graphics);
+	std::shared_ptr<VulkanUploadQueue> uploadQueue = vulkanManager->getUploadQueue();
+	std::shared_ptr<VulkanDeletionQueue> deletionQueue = vulkanManager->getDeletionQueue();
+	VkQueue unusedQueue = VK_NULL_HANDLE;
+	VkCommandPool unusedCmdPool = VK_NULL_HANDLE;
+
+	const uint32_t textureSize = 64;
+	const VkDeviceSize textureBytes = textureSize * textureSize * 4;
+	const VkDeviceSize bufferSize = 64 * 1024;
+	const std::vector<uint8_t> texels(static_cast<size_t>(textureBytes), 255);
+	const std::vector<uint8_t> bufferData(static_cast<size_t>(bufferSize), 0);
+	const uint32_t numBaselineFrames = 20;
+	const float maxReleaseTime = 0.5f; // ms
+
+	// The copies that use the churned resources are recorded into their own pool and land in a buffer that lives through the whole test
+	VkCommandPool cmdPool;
+	VulkanCommandUtil::createCommandPool(logicalDevice, cmdPool, vulkanManager->getQueueIndex(QueueFlags::Graphics), VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+	mageVKBuffer readBackBuffer = {};
+	BufferUtil::createMageBuffer(logicalDevice, physicalDevice, readBackBuffer, bufferSize + textureBytes, nullptr,
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_SHARING_MODE_EXCLUSIVE, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	struct ChurnedResources
+	{
+		std::shared_ptr<Texture2D> texture;
+		mageVKBuffer buffer;
+		uint64_t uploadTicket;
+	};
+	auto createResources = [&]()
+	{
+		ChurnedResources resources = {};
+		ImageLoaderOutput imgOut = {};
+		imgOut.imgWidth = textureSize;
+		imgOut.imgHeight = textureSize;
+		BufferUtil::createStagingBuffer(logicalDevice, physicalDevice, texels.data(), imgOut.stagingBuffer, imgOut.stagingBufferMemory, textureBytes);
+		resources.texture = std::make_shared<Texture2D>(vulkanManager, unusedQueue, unusedCmdPool);
+		resources.texture->setUploadQueue(uploadQueue);
+		resources.texture->create2DTexture(imgOut, unusedQueue, unusedCmdPool, true);
+
+		VkBuffer stagingBuffer;
+		VkDeviceMemory stagingBufferMemory;
+		BufferUtil::createStagingBuffer(logicalDevice, physicalDevice, bufferData.data(), stagingBuffer, stagingBufferMemory, bufferSize);
+		BufferUtil::createMageBuffer(logicalDevice, physicalDevice, resources.buffer, bufferSize, nullptr,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			VK_SHARING_MODE_EXCLUSIVE, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		uploadQueue->uploadBuffer(stagingBuffer, stagingBufferMemory, resources.buffer.buffer, bufferSize);
+		resources.uploadTicket = uploadQueue->submit();
+		return resources;
+	};
+	auto retireResources = [&](ChurnedResources& resources)
+	{
+		vulkanManager->deferDestruction(resources.texture);
+		resources.texture.reset();
+		vulkanManager->deferDestruction([logicalDevice, buffer = resources.buffer]() mutable { buffer.destroy(logicalDevice); });
+	};
+	// Reads the buffer and mip level 0 of the texture on the graphics queue, ahead of the frame about to be submitted
+	auto useResources = [&](ChurnedResources& resources)
+	{
+		VkCommandBuffer cmdBuffer;
+		VulkanCommandUtil::allocateCommandBuffers(logicalDevice, cmdPool, 1, &cmdBuffer);
+		VulkanCommandUtil::beginCommandBuffer(cmdBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+		VulkanCommandUtil::copyCommandBuffer(logicalDevice, cmdBuffer, resources.buffer.buffer, readBackBuffer.buffer, 0, 0, bufferSize);
+
+		Texture2D& texture = *resources.texture;
+		VkImageSubresourceRange subresourceRange = ImageUtil::createImageSubResourceRange(VK_IMAGE_ASPECT_COLOR_BIT, 0, texture.m_mipLevels, 0, 1);
+		VkImageMemoryBarrier imageBarrier = ImageUtil::createImageMemoryBarrier(texture.m_image,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, subresourceRange);
+		VulkanCommandUtil::pipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+		VkBufferImageCopy region = {};
+		region.bufferOffset = bufferSize;
+		region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		region.imageExtent = { textureSize, textureSize, 1 };
+		vkCmdCopyImageToBuffer(cmdBuffer, texture.m_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readBackBuffer.buffer, 1, &region);
+
+		imageBarrier = ImageUtil::createImageMemoryBarrier(texture.m_image,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT, subresourceRange);
+		VulkanCommandUtil::pipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+			0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+		VulkanCommandUtil::endCommandBuffer(cmdBuffer);
+		// No fence of its own, the frame submitted after it on the same queue finishing means the copies have finished too
+		VulkanCommandUtil::submitToQueueSynced(graphicsQueue, 1, &cmdBuffer, 0, nullptr, nullptr, 0, nullptr, VK_NULL_HANDLE);
+		vulkanManager->deferDestruction([logicalDevice, cmdPool, cmdBuffer]() { vkFreeCommandBuffers(logicalDevice, cmdPool, 1, &cmdBuffer); });
+	};
+
+	const uint32_t numBaselineImageViews = vulkanManager->getResourceCache()->getNumImageViews();
+	const uint64_t numBaselineRetired = deletionQueue->getNumRetired();
+
+	std::deque<ChurnedResources> uploading;
+	uint32_t numChurned = 0;
+	uint32_t numChurnFrames = 0;
+	uint32_t numStalls = 0;
+	uint32_t maxPending = 0;
+	uint32_t numSlowReleases = 0;
+	float maxReleaseTimeSeen = 0.0f;
+	float baselineFrameTime = 0.0f;
+	float maxFrameTime = 0.0f;
+	float totalFrameTime = 0.0f;
+	// Sets whose uploads have finished are used by the frame about to start and dropped while it is in flight
+	auto churnResources = [&](uint32_t frame)
+	{
+		if (frame < numBaselineFrames)
+		{
+			return;
+		}
+		while (!uploading.empty() && uploadQueue->isComplete(uploading.front().uploadTicket))
+		{
+			useResources(uploading.front());
+			TIME_POINT releaseStart = std::chrono::high_resolution_clock::now();
+			retireResources(uploading.front());
+			const float releaseTime = TimerUtil::getTimeElapsedSinceStart(releaseStart);
+			maxReleaseTimeSeen = std::max(maxReleaseTimeSeen, releaseTime);
+			numSlowReleases += (releaseTime > maxReleaseTime) ? 1 : 0;
+			uploading.pop_front();
+			numChurned++;
+		}
+		uploading.push_back(createResources());
+	};
+	runFrames(numBaselineFrames + numFrames, [&](uint32_t frame, float frameTime)
+	{
+		if (frame < numBaselineFrames)
+		{
+			baselineFrameTime += frameTime / numBaselineFrames;
+			return;
+		}
+		numChurnFrames++;
+		totalFrameTime += frameTime;
+		maxFrameTime = std::max(maxFrameTime, frameTime);
+		numStalls += (frameTime > 2.0f * baselineFrameTime) ? 1 : 0;
+		maxPending = std::max(maxPending, deletionQueue->getNumPending());
+	}, 10, churnResources);
+
+	// Sets still uploading are dropped like the others, then everything still pending is destroyed
+	for (ChurnedResources& resources : uploading)
+	{
+		retireResources(resources);
+	}
+	uploading.clear();
+	vkDeviceWaitIdle(logicalDevice);
+	uploadQueue->flush();
+	deletionQueue->flush();
+	vkDestroyCommandPool(logicalDevice, cmdPool, nullptr);
+	readBackBuffer.destroy(logicalDevice);
+
+	const uint64_t numRetired = deletionQueue->getNumRetired() - numBaselineRetired;
+	const uint64_t numLeaked = deletionQueue->getNumRetired() - deletionQueue->getNumDestroyed();
+	const uint32_t numLeakedImageViews = vulkanManager->getResourceCache()->getNumImageViews() - numBaselineImageViews;
+	// Three objects per set and frame, each waits for the frames in flight and at most a couple of upload batches
+	const uint32_t pendingBound = 3 * (vulkanManager->getNumFramesInFlight() + 2) + 3;
+	cleanup();
+
+	const bool passed = (numStalls == 0) && (numSlowReleases == 0) && (numLeaked == 0) && (numLeakedImageViews == 0) && (maxPending <= pendingBound);
+	std::cout << "Resource churn over " << numChurnFrames << " frames: " << numChurned << " sets used and dropped in flight, " 
+		<< numRetired << " objects retired, frame time before the churn " << baselineFrameTime << " ms, average "
+		<< (numChurnFrames > 0 ? totalFrameTime / numChurnFrames : 0.0f) << " ms, max " << maxFrameTime << " ms, "
+		<< numStalls << " frames over twice the baseline, slowest drop " << maxReleaseTimeSeen << " ms (" << numSlowReleases << " over "
+		<< maxReleaseTime << " ms), at most " << maxPending << " pending (bound " << pendingBound << "), "
+		<< numLeaked << " objects and " << numLeakedImageViews << " image views leaked -- " << (passed ? "passed" : "FAILED") << std::endl;
+	return passed;
+}
+
+void GraphicsPlaygroundApplication::runInputReplay(uint32_t numFrames)
+{
+	// A thread replays a steady stream of small camera rotations, like input arriving from the OS wherever the frame happens to be.
+	// Every input is followed to the frame that carries it and to when the CPU sees that frame finish, which stands in for the photons.
+	// Frames are counted from the frame that was being prepared when the input arrived: 0 means it made it into that very frame.
+	// Frame completion is polled once per frame, so the motion to photon times are as coarse as a frame.
+	std::cout << "Replaying synthetic camera input, " << numFrames << " frames per run" << std::endl;
+	for (const bool lateLatch : { false, true })
+	{
+		RendererOptions rendererOptions = defaultRendererOptions();
+		rendererOptions.renderType = RENDER_TYPE::RASTERIZATION;
+		rendererOptions.lateLatchCamera = lateLatch;
+		initialize("gltfTestSponza.json", rendererOptions);
+		// Pipelines and caches warm up before any input is replayed
+		runFrames(0);
+
+		struct ReplayedInput
+		{
+			uint64_t serial;
+			TIME_POINT arrivalTime;
+			uint64_t arrivalFrame;
+			uint64_t carryingFrame;
+		};
+		std::mutex replayMutex;
+		std::deque<ReplayedInput> pendingInputs; // Oldest first
+		std::atomic<uint64_t> frameBeingPrepared(vulkanManager->getSubmittedFrameCount() + 1);
+		std::atomic<bool> replaying(true);
+		std::thread replayer([&]()
+		{
+			CameraInput input;
+			input.rotateUp = 0.01f;
+			while (replaying)
+			{
+				{
+					std::lock_guard<std::mutex> lock(replayMutex);
+					const TIME_POINT arrivalTime = std::chrono::high_resolution_clock::now();
+					const uint64_t serial = camera->addInput(input);
+					pendingInputs.push_back({ serial, arrivalTime, frameBeingPrepared, 0 });
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		});
+
+		uint64_t numMeasured = 0;
+		uint64_t totalInputToFrame = 0;
+		uint64_t totalPhotonFrames = 0;
+		uint64_t maxPhotonFrames = 0;
+		float totalPhotonTime = 0.0f;
+		float maxPhotonTime = 0.0f;
+		runFrames(numFrames, [&](uint32_t frame, float frameTime)
+		{
+			vulkanManager->pollCompletedFrames();
+			const uint64_t submittedFrame = vulkanManager->getSubmittedFrameCount();
+			const uint64_t completedFrame = vulkanManager->getCompletedFrameCount();
+			const uint64_t latchedSerial = camera->getLatchedInputSerial();
+			const TIME_POINT now = std::chrono::high_resolution_clock::now();
+
+			std::lock_guard<std::mutex> lock(replayMutex);
+			frameBeingPrepared = submittedFrame + 1;
+			for (ReplayedInput& input : pendingInputs)
+			{
+				if (input.carryingFrame == 0 && input.serial <= latchedSerial)
+				{
+					input.carryingFrame = submittedFrame;
+				}
+			}
+			while (!pendingInputs.empty() && pendingInputs.front().carryingFrame != 0 && pendingInputs.front().carryingFrame <= completedFrame)
+			{
+				const ReplayedInput& input = pendingInputs.front();
+				const uint64_t photonFrames = submittedFrame - input.arrivalFrame;
+				const float photonTime = std::chrono::duration<float, std::milli>(now - input.arrivalTime).count();
+				numMeasured++;
+				totalInputToFrame += input.carryingFrame - input.arrivalFrame;
+				totalPhotonFrames += photonFrames;
+				maxPhotonFrames = std::max(maxPhotonFrames, photonFrames);
+				totalPhotonTime += photonTime;
+				maxPhotonTime = std::max(maxPhotonTime, photonTime);
+				pendingInputs.pop_front();
+			}
+		}, 0);
+		replaying = false;
+		replayer.join();
+		cleanup();
+
+		std::cout << "  " << (lateLatch ? "Late latched camera" : "Camera latched before acquire") << ": ";
+		if (numMeasured == 0)
+		{
+			std::cout << "no input reached the screen" << std::endl;
+			continue;
+		}
+		std::cout << numMeasured << " inputs, input to frame average " << static_cast<float>(totalInputToFrame) / numMeasured
+			<< " frames, motion to photon average " << static_cast<float>(totalPhotonFrames) / numMeasured << " frames / "
+			<< totalPhotonTime / numMeasured << " ms, max " << maxPhotonFrames << " frames / " << maxPhotonTime << " ms" << std::endl;
+	}
+}
@@ -0,0 +1,121 @@
+#include <playgroundApplication.h>
+#include <iomanip>
+
+void GraphicsPlaygroundApplication::runHeadless(const RendererConfig& config)
+{
+	const uint32_t numFrames = config.numFrames;
+	initialize(config.sceneFile, config.options, true, config.resolution);
+	const RendererOptions& rendererOptions = renderer->getRendererOptions();
+	std::cout << "Headless: " << config.sceneFile << " at " << vulkanManager->getSwapChainVkExtent().width << "x" << vulkanManager->getSwapChainVkExtent().height
+		<< " on " << vulkanManager->getPhysicalDeviceProperties().deviceName
+		<< ((rendererOptions.renderType == RENDER_TYPE::RAYTRACE) ? " (ray traced)" : " (rasterized)") << std::endl;
+
+	// Pipelines and caches warm up over the first frames
+	const FrameRun run = runFrames(numFrames);
+
+	std::cout << run.numFrames << " frames in " << run.runTime << " ms, " << 1000.0f * run.numFrames / run.runTime << " fps" << std::endl;
+	printFrameTimeStats("frame time", run.frameTimeStats);
+	for (const VulkanGpuProfiler::PassStats& stats : vulkanManager->getGpuProfiler()->getPassStats())
+	{
+		if (stats.numSamples > 0)
+		{
+			std::cout << "  GPU " << stats.name << ": " << stats.averageMs << " ms" << std::endl;
+		}
+	}
+	// Everything the run allocated on the device, by category and heap
+	std::cout << "Device memory:" << std::endl;
+	VulkanMemoryTracker::printAllocationTable(std::cout, vulkanManager->getMemoryHeapStats());
+
+	cleanup();
+}
+
+void GraphicsPlaygroundApplication::runSweep(const RendererConfig& config)
+{
+	const std::vector<RendererSweepRun> runs = RendererConfigUtil::expandSweep(config);
+	std::cout << "Sweep: " << config.sceneFile << ", " << runs.size() << " runs of " << config.numFrames << " frames" << std::endl;
+
+	struct SweepResult
+	{
+		std::string label;
+		float loadTime;
+		FrameTimeStats frameTimeStats;
+		float fps;
+		float gpuTime; // Sum of the timed passes
+	};
+	std::vector<SweepResult> results;
+
+	// Parsed glTFs and their decoded images are kept for the whole sweep, and the device and its queues carry over between runs
+	// that don't change them, so from the second run on loading is mostly uploading
+	loadingUtil::setKeepParsedGLTFs(true);
+	VkExtent2D deviceExtent = { 0, 0 };
+	RendererOptions deviceOptions;
+	for (const RendererSweepRun& run : runs)
+	{
+		std::cout << "  " << run.label << std::endl;
+		TIME_POINT loadStartTime = std::chrono::high_resolution_clock::now();
+		JSONContents jsonContent = loadScene(config.sceneFile, run.resolution);
+		const VkExtent2D extent = { static_cast<uint32_t>(jsonContent.mainCamera.width), static_cast<uint32_t>(jsonContent.mainCamera.height) };
+		const bool reuseDevice = vulkanManager && extent.width == deviceExtent.width && extent.height == deviceExtent.height &&
+			run.options.framesInFlight == deviceOptions.framesInFlight && run.options.asyncCompute == deviceOptions.asyncCompute &&
+			run.options.dedicatedTransfer == deviceOptions.dedicatedTransfer && run.options.timelineSemaphores == deviceOptions.timelineSemaphores;
+		if (reuseDevice)
+		{
+			vkDeviceWaitIdle(vulkanManager->getLogicalDevice());
+			renderer.reset();
+			camera.reset();
+		}
+		else
+		{
+			if (vulkanManager)
+			{
+				cleanup();
+			}
+			createVulkanManager(jsonContent.mainCamera, run.options, true);
+			deviceExtent = extent;
+			deviceOptions = run.options;
+		}
+		createRenderer(jsonContent, run.options);
+		const float loadTime = TimerUtil::getTimeElapsedSinceStart(loadStartTime);
+
+		// Pipelines and caches warm up over the first frames
+		const FrameRun frameRun = runFrames(config.numFrames);
+
+		float gpuTime = 0.0f;
+		for (const VulkanGpuProfiler::PassStats& stats : vulkanManager->getGpuProfiler()->getPassStats())
+		{
+			if (stats.numSamples > 0)
+			{
+				gpuTime += stats.averageMs;
+			}
+		}
+
+		// The renderer falls back on devices without ray tracing, the row should say what actually ran
+		std::string label = run.label;
+		if (run.options.renderType != renderer->getRendererOptions().renderType)
+		{
+			label += " (raster fallback)";
+		}
+		results.push_back({ label, loadTime, frameRun.frameTimeStats, 1000.0f * frameRun.numFrames / frameRun.runTime, gpuTime });
+	}
+	cleanup();
+	loadingUtil::setKeepParsedGLTFs(false);
+
+	// Frame times in ms, the last column compares the average frame time against the first run
+	size_t labelWidth = 3;
+	for (const SweepResult& result : results)
+	{
+		labelWidth = std::max(labelWidth, result.label.size());
+	}
+	std::cout << std::endl << std::left << std::setw(static_cast<int>(labelWidth)) << "Run" << std::right << std::fixed << std::setprecision(2)
+		<< std::setw(10) << "Load ms" << std::setw(9) << "Avg" << std::setw(9) << "p50" << std::setw(9) << "p95"
+		<< std::setw(9) << "p99" << std::setw(9) << "Max" << std::setw(9) << "FPS" << std::setw(9) << "GPU ms" << std::setw(10) << "vs first" << std::endl;
+	for (const SweepResult& result : results)
+	{
+		const float relative = 100.0f * (result.frameTimeStats.average / results.front().frameTimeStats.average - 1.0f);
+		std::cout << std::left << std::setw(static_cast<int>(labelWidth)) << result.label << std::right
+			<< std::setw(10) << result.loadTime << std::setw(9) << result.frameTimeStats.average << std::setw(9) << result.frameTimeStats.median
+			<< std::setw(9) << result.frameTimeStats.p95 << std::setw(9) << result.frameTimeStats.p99 << std::setw(9) << result.frameTimeStats.max
+			<< std::setw(9) << result.fps << std::setw(9) << result.gpuTime << std::setw(9) << std::showpos << relative << std::noshowpos << "%" << std::endl;
+	}
+	std::cout << std::defaultfloat;
+}
@@ -0,0 +1,208 @@
+#include <playgroundApplication.h>
+#include <fstream>
+#include <iomanip>
+#include <filesystem>
+
+bool GraphicsPlaygroundApplication::runGpuProfile(uint32_t numFrames, const std::string& csvPath)
+{
+	RendererOptions rendererOptions = defaultRendererOptions();
+	rendererOptions.renderType = RENDER_TYPE::RASTERIZATION;
+	initialize("gltfTestSponza.json", rendererOptions);
+
+	std::shared_ptr<VulkanGpuProfiler> gpuProfiler = vulkanManager->getGpuProfiler();
+	if (!gpuProfiler->isEnabled())
+	{
+		cleanup();
+		std::cout << "The graphics queue can't write timestamps, nothing to profile" << std::endl;
+		return true;
+	}
+
+	// Pipelines and caches warm up over the first frames
+	float totalComputeOverlap = 0.0f;
+	runFrames(numFrames, [&](uint32_t frame, float frameTime) { totalComputeOverlap += gpuProfiler->getLastComputeOverlap(); });
+
+	std::cout << "GPU pass timings over " << numFrames << " frames (average, min, max):" << std::endl;
+	for (const VulkanGpuProfiler::PassStats& stats : gpuProfiler->getPassStats())
+	{
+		std::cout << "  " << stats.name << ": ";
+		if (!stats.timed)
+		{
+			std::cout << "no timestamps on this queue" << std::endl;
+			continue;
+		}
+		std::cout << stats.averageMs << " ms, " << stats.minMs << " ms, " << stats.maxMs << " ms (" << stats.numSamples << " samples)" << std::endl;
+	}
+	if (vulkanManager->usesAsyncCompute())
+	{
+		std::cout << "  Compute overlapping graphics: " << totalComputeOverlap / numFrames << " ms average" << std::endl;
+	}
+
+	const bool exported = gpuProfiler->exportCSV(csvPath);
+	cleanup();
+	std::cout << (exported ? "Written to " : "Failed to write ") << csvPath << std::endl;
+	return exported;
+}
+
+bool GraphicsPlaygroundApplication::runCpuTrace(uint32_t numFrames, const std::string& tracePath)
+{
+	// Capturing from the start gets the scene loading into the trace as well
+	CpuProfiler::beginCapture();
+
+	RendererOptions rendererOptions = defaultRendererOptions();
+	rendererOptions.renderType = RENDER_TYPE::RASTERIZATION;
+	initialize("gltfTestSponza.json", rendererOptions);
+
+	runFrames(numFrames, nullptr, 0);
+
+	const bool written = CpuProfiler::endCapture(tracePath);
+	CpuProfiler::setEnabled(false);
+	cleanup();
+
+	std::cout << (written ? "Written to " : "Failed to write ") << tracePath << " (" << CpuProfiler::getNumDroppedZones()
+		<< " zones dropped), open it in chrome://tracing or ui.perfetto.dev" << std::endl;
+	return written;
+}
+
+bool GraphicsPlaygroundApplication::runCaptureBenchmark(uint32_t numFrames, const std::string& outputDirectory)
+{
+	RendererOptions rendererOptions = defaultRendererOptions();
+	rendererOptions.renderType = RENDER_TYPE::RASTERIZATION;
+	initialize("gltfTestSponza.json", rendererOptions, true, { 1280, 720 });
+	std::shared_ptr<VulkanFrameCapture> frameCapture = vulkanManager->getFrameCapture();
+	std::cout << "Frame capture: Sponza at 1280x720 on " << vulkanManager->getPhysicalDeviceProperties().deviceName << ", "
+		<< numFrames << " frames per run" << std::endl;
+
+	// Pipelines and caches warm up over the first frames
+	runFrames(0);
+
+	struct CaptureRun
+	{
+		const char* label;
+		bool capture;
+		CAPTURE_FORMAT format;
+	};
+	const CaptureRun captureRuns[] = {
+		{ "no capture", false, CAPTURE_FORMAT::PNG },
+		{ "PNG every frame", true, CAPTURE_FORMAT::PNG },
+		{ "raw every frame", true, CAPTURE_FORMAT::RAW } };
+
+	bool allWritten = true;
+	float uncapturedFrameTime = 0.0f;
+	for (const CaptureRun& captureRun : captureRuns)
+	{
+		frameCapture->resetStats();
+		if (captureRun.capture)
+		{
+			const char* subdirectory = (captureRun.format == CAPTURE_FORMAT::PNG) ? "/png/frame" : "/raw/frame";
+			frameCapture->startSequence(outputDirectory + subdirectory, captureRun.format);
+		}
+
+		// The encoders still working on the last frames are not part of the run
+		const FrameRun run = runFrames(numFrames, nullptr, 0);
+		frameCapture->stopSequence();
+		const FrameTimeStats& frameTimeStats = run.frameTimeStats;
+		if (!captureRun.capture)
+		{
+			uncapturedFrameTime = frameTimeStats.average;
+		}
+
+		// Overhead and stalls as seen by the frame loop, before the last frames are picked up
+		const VulkanFrameCapture::Stats loopStats = frameCapture->getStats();
+		vkDeviceWaitIdle(vulkanManager->getLogicalDevice());
+		frameCapture->collectAll();
+		frameCapture->waitForEncoders();
+		const VulkanFrameCapture::Stats stats = frameCapture->getStats();
+
+		std::cout << "  " << std::left << std::setw(16) << captureRun.label << std::right << std::fixed << std::setprecision(2)
+			<< std::setw(8) << 1000.0f * run.numFrames / run.runTime << " fps, " << frameTimeStats.average << " ms/frame";
+		if (captureRun.capture)
+		{
+			std::cout << " (" << std::showpos << frameTimeStats.average - uncapturedFrameTime << std::noshowpos << " ms), capture "
+				<< loopStats.averageOverheadMs << " ms/frame of which " << loopStats.totalStallMs / numFrames << " ms waiting on encoders, encode "
+				<< stats.averageEncodeMs << " ms, " << stats.numWritten << "/" << stats.numCaptured << " written";
+			allWritten = allWritten && (stats.numCaptured == numFrames) && (stats.numWritten == stats.numCaptured);
+		}
+		std::cout << std::defaultfloat << std::endl;
+	}
+
+	cleanup();
+	std::filesystem::remove_all(outputDirectory);
+	std::cout << (allWritten ? "Every captured frame was written" : "Some frames were not captured or written") << std::endl;
+	return allWritten;
+}
+
+bool GraphicsPlaygroundApplication::runHeapReport(uint32_t numFrames)
+{
+	if (!HeapTracker::isCompiledIn())
+	{
+		std::cerr << "The heap report needs a build configured with -DMAGE_HEAP_TRACKER=ON" << std::endl;
+		return false;
+	}
+
+	// From the start, so the loading peak is part of the report
+	HeapTracker::setEnabled(true);
+	RendererOptions rendererOptions = defaultRendererOptions();
+	rendererOptions.renderType = RENDER_TYPE::RASTERIZATION;
+	initialize("gltfTestSponza.json", rendererOptions, true);
+	std::cout << "Heap report: Sponza headless, " << numFrames << " frames after " << HeapTracker::STEADY_STATE_FRAMES << " to settle" << std::endl;
+
+	runFrames(numFrames, nullptr, HeapTracker::STEADY_STATE_FRAMES);
+	// The last frame only ends with the next one
+	HeapTracker::endFrame();
+	HeapTracker::printReport(std::cout);
+
+	// Whatever is still live once everything is torn down either leaked or belongs to a cache that lives until exit
+	cleanup();
+	const std::array<HeapTracker::TagStats, static_cast<size_t>(HEAP_TAG::COUNT)> stats = HeapTracker::getStats();
+	std::cout << "Live after cleanup:";
+	for (size_t i = 0; i < stats.size(); i++)
+	{
+		std::cout << " " << HeapTracker::getTagName(static_cast<HEAP_TAG>(i)) << " " << stats[i].numLive << " (" << stats[i].liveBytes << " bytes)";
+	}
+	std::cout << std::endl;
+	HeapTracker::setEnabled(false);
+	return true;
+}
+
+bool GraphicsPlaygroundApplication::runPassStatistics(uint32_t numFrames, const std::string& csvPath)
+{
+	RendererOptions rendererOptions = defaultRendererOptions();
+	rendererOptions.renderType = RENDER_TYPE::RASTERIZATION;
+	initialize("gltfTestSponza.json", rendererOptions, true);
+
+	std::shared_ptr<VulkanGpuProfiler> gpuProfiler = vulkanManager->getGpuProfiler();
+	if (!gpuProfiler->startFrameLog(csvPath))
+	{
+		cleanup();
+		std::cerr << "Failed to write " << csvPath << std::endl;
+		return false;
+	}
+
+	// Frames are logged as they are collected, a frame in flight after they were submitted
+	runFrames(numFrames + vulkanManager->getNumFramesInFlight(), nullptr, 0);
+	gpuProfiler->stopFrameLog();
+
+	const VkExtent2D extent = vulkanManager->getSwapChainVkExtent();
+	const double numPixels = static_cast<double>(extent.width) * extent.height;
+	std::cout << "Commands and pipeline statistics of frame " << gpuProfiler->getLastCollectedFrame() << " per pass"
+		<< (gpuProfiler->isPipelineStatisticsEnabled() ? "" : " (no pipeline statistics on this device)") << ":" << std::endl;
+	for (const VulkanGpuProfiler::PassStats& stats : gpuProfiler->getPassStats())
+	{
+		const CommandCounters& counters = stats.lastCounters;
+		std::cout << "  " << stats.name << ": " << counters.draws << " draws, " << counters.dispatches << " dispatches, "
+			<< counters.pipelineBinds << " pipeline binds, " << counters.descriptorSetBinds << " descriptor set binds, "
+			<< counters.redundantBinds << " redundant, " << counters.pushConstants << " push constants, " << counters.barriers << " barriers";
+		if (stats.queried)
+		{
+			const PipelineStatistics& statistics = stats.lastStatistics;
+			std::cout << ", " << statistics.inputAssemblyPrimitives << " primitives, " << statistics.vertexShaderInvocations << " vertices, "
+				<< statistics.fragmentShaderInvocations << " fragments (" << statistics.fragmentShaderInvocations / numPixels << " per pixel), "
+				<< statistics.computeShaderInvocations << " compute invocations";
+		}
+		std::cout << std::endl;
+	}
+
+	cleanup();
+	std::cout << "Written to " << csvPath << std::endl;
+	return true;
+}
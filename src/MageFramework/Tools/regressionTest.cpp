@@ -0,0 +1,181 @@
+#include <playgroundApplication.h>
+#include <Utilities/imageCompareUtility.h>
+#include <json.hpp>
+#include <stb_image.h>
+#include <stb_image_write.h>
+#include <fstream>
+#include <filesystem>
+
+RegressionResult GraphicsPlaygroundApplication::runRegressionTest(const std::string& suitePath, bool updateBaseline)
+{
+	std::ifstream suiteFile(suitePath);
+	if (!suiteFile.is_open())
+	{
+		throw std::runtime_error("failed to open regression suite " + suitePath);
+	}
+	nlohmann::json suite;
+	suiteFile >> suite;
+
+	// Golden images and the timing baseline live next to the suite
+	const std::filesystem::path suiteDirectory = std::filesystem::path(suitePath).parent_path();
+	const std::filesystem::path goldenDirectory = suiteDirectory / "golden";
+	const std::string baselinePath = (suiteDirectory / "baseline.json").string();
+
+	RendererOptions rendererOptions = defaultRendererOptions();
+	for (auto& option : suite["options"].items())
+	{
+		RendererConfigUtil::setOption(rendererOptions, option.key(), option.value());
+	}
+	const VkExtent2D resolution = { suite["resolution"][0].get<uint32_t>(), suite["resolution"][1].get<uint32_t>() };
+	const uint32_t numWarmUpFrames = suite.value("warmUpFrames", 30u);
+	const uint32_t numTimedFrames = std::max(1u, suite.value("timedFrames", 120u));
+	const double minPSNR = suite["imageTolerances"]["psnr"].get<double>();
+	const double minSSIM = suite["imageTolerances"]["ssim"].get<double>();
+	const nlohmann::json& timingThresholds = suite["timingThresholds"];
+
+	nlohmann::json baseline;
+	std::ifstream baselineFile(baselinePath);
+	if (baselineFile.is_open())
+	{
+		baselineFile >> baseline;
+	}
+	nlohmann::json newBaseline = { { "cases", nlohmann::json::object() } };
+
+	std::cout << "Regression suite " << suitePath << (updateBaseline ? ", updating the golden images and the baseline" : "") << std::endl;
+	bool passed = true;
+	bool skipped = false;
+	loadingUtil::setKeepParsedGLTFs(true);
+	for (const nlohmann::json& testCase : suite["cases"])
+	{
+		const std::string name = testCase["name"].get<std::string>();
+		initialize(testCase["scene"].get<std::string>(), rendererOptions, true, resolution);
+		const std::string deviceName = vulkanManager->getPhysicalDeviceProperties().deviceName;
+		newBaseline["device"] = deviceName;
+
+		// Same pose, frame count and time step every run, so the captured frame only changes when the rendering does
+		renderer->setUIVisible(false);
+		renderer->setFixedTimeStep(1000.0f / 60.0f);
+		if (testCase.contains("eye"))
+		{
+			auto toVec3 = [](const nlohmann::json& v) { return glm::vec3(v["x"].get<float>(), v["y"].get<float>(), v["z"].get<float>()); };
+			camera->setPose(toVec3(testCase["eye"]), toVec3(testCase["lookAtPoint"]));
+		}
+
+		runFrames(0, nullptr, numWarmUpFrames);
+		std::vector<unsigned char> pixels;
+		renderer->readBackLastFrame(pixels);
+
+		const FrameRun run = runFrames(numTimedFrames, nullptr, 0);
+
+		float gpuTime = 0.0f;
+		for (const VulkanGpuProfiler::PassStats& stats : vulkanManager->getGpuProfiler()->getPassStats())
+		{
+			if (stats.numSamples > 0)
+			{
+				gpuTime += stats.averageMs;
+			}
+		}
+		cleanup();
+
+		const FrameTimeStats& frameTimeStats = run.frameTimeStats;
+		const nlohmann::json timings = { { "cpuMedianMs", frameTimeStats.median }, { "cpuP95Ms", frameTimeStats.p95 }, { "gpuMs", gpuTime } };
+		newBaseline["cases"][name] = timings;
+
+		const std::string goldenPath = (goldenDirectory / (name + ".png")).string();
+		if (updateBaseline)
+		{
+			std::filesystem::create_directories(goldenDirectory);
+			if (!stbi_write_png(goldenPath.c_str(), resolution.width, resolution.height, 4, pixels.data(), resolution.width * 4))
+			{
+				throw std::runtime_error("failed to write golden image " + goldenPath);
+			}
+			std::cout << "  " << name << ": wrote " << goldenPath << ", CPU median " << frameTimeStats.median << " ms, p95 "
+				<< frameTimeStats.p95 << " ms, GPU " << gpuTime << " ms" << std::endl;
+			continue;
+		}
+
+		// Image quality
+		std::cout << "  " << name << ":";
+		bool casePassed = true;
+		bool caseSkipped = false;
+		int goldenWidth = 0, goldenHeight = 0, numChannels = 0;
+		unsigned char* golden = stbi_load(goldenPath.c_str(), &goldenWidth, &goldenHeight, &numChannels, STBI_rgb_alpha);
+		if (!golden)
+		{
+			std::cout << " image skipped (no golden image at " << goldenPath << ")";
+			caseSkipped = true;
+		}
+		else if (static_cast<uint32_t>(goldenWidth) != resolution.width || static_cast<uint32_t>(goldenHeight) != resolution.height)
+		{
+			std::cout << " golden image is " << goldenWidth << "x" << goldenHeight;
+			casePassed = false;
+		}
+		else
+		{
+			const double psnr = ImageCompareUtil::computePSNR(pixels.data(), golden, resolution.width, resolution.height);
+			const double ssim = ImageCompareUtil::computeSSIM(pixels.data(), golden, resolution.width, resolution.height);
+			const bool imagePassed = (psnr >= minPSNR && ssim >= minSSIM);
+			std::cout << " PSNR " << psnr << " dB, SSIM " << ssim << (imagePassed ? "" : " (below tolerance)");
+			casePassed = imagePassed;
+		}
+		stbi_image_free(golden);
+		if (!casePassed || caseSkipped)
+		{
+			const std::string actualPath = "regression_" + name + ".png";
+			stbi_write_png(actualPath.c_str(), resolution.width, resolution.height, 4, pixels.data(), resolution.width * 4);
+			std::cout << ", wrote " << actualPath;
+		}
+
+		// Timings, each metric may get slower than the baseline by its threshold (0.1 is 10%)
+		if (!baseline.contains("cases") || !baseline["cases"].contains(name))
+		{
+			std::cout << ", timings skipped (no baseline timings)";
+			caseSkipped = true;
+		}
+		else if (baseline.value("device", "") != deviceName)
+		{
+			std::cout << ", timings skipped (baseline is from " << baseline.value("device", "") << ")";
+			caseSkipped = true;
+		}
+		else
+		{
+			const nlohmann::json& baselineTimings = baseline["cases"][name];
+			for (auto& threshold : timingThresholds.items())
+			{
+				const float measured = timings.at(threshold.key()).get<float>();
+				const float expected = baselineTimings.value(threshold.key(), 0.0f);
+				if (expected <= 0.0f)
+				{
+					continue; // E.g. no GPU timestamps
+				}
+				const bool timingPassed = (measured <= expected * (1.0f + threshold.value().get<float>()));
+				std::cout << ", " << threshold.key() << " " << measured << " (baseline " << expected << ")" << (timingPassed ? "" : " too slow");
+				casePassed = casePassed && timingPassed;
+			}
+		}
+		std::cout << (!casePassed ? " -- FAIL" : (caseSkipped ? " -- skipped" : " -- pass")) << std::endl;
+		passed = passed && casePassed;
+		skipped = skipped || caseSkipped;
+	}
+	loadingUtil::setKeepParsedGLTFs(false);
+
+	if (updateBaseline)
+	{
+		std::ofstream file(baselinePath);
+		file << newBaseline.dump(1, '\t') << "\n";
+		if (!file.good())
+		{
+			throw std::runtime_error("failed to write " + baselinePath);
+		}
+		std::cout << "Wrote " << baselinePath << std::endl;
+		return RegressionResult::PASSED;
+	}
+	if (!passed)
+	{
+		std::cout << "Regressions found" << std::endl;
+		return RegressionResult::FAILED;
+	}
+	std::cout << (skipped ? "No regressions, but some checks were skipped for lack of golden images or baseline timings "
+		"(\"--regression update\" writes them)" : "All cases passed") << std::endl;
+	return skipped ? RegressionResult::SKIPPED : RegressionResult::PASSED;
+}
@@ -0,0 +1,103 @@
+#include <playgroundApplication.h>
+#include <filesystem>
+#include <Utilities/cloudNoiseUtility.h>
+#include <stb_image.h>
+
+bool GraphicsPlaygroundApplication::runNoiseVolumeUpload(std::string cacheFolder)
+{
+	// The cache file names are appended to the folder as they are
+	if (!cacheFolder.empty() && cacheFolder.back() != '/')
+	{
+		cacheFolder += '/';
+	}
+
+	initialize("gltfTest_gltf_and_obj.json", defaultRendererOptions(), true);
+	VkDevice logicalDevice = vulkanManager->getLogicalDevice();
+	VkQueue graphicsQueue = vulkanManager->getQueue(QueueFlags::Graphics);
+	VkCommandPool cmdPool;
+	VulkanCommandUtil::createCommandPool(logicalDevice, cmdPool, vulkanManager->getQueueIndex(QueueFlags::Graphics), VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+
+	// Every volume is uploaded twice: the first time is baked (the cache file is removed beforehand) and written to the cache,
+	// the second time has to come out of the cache
+	bool cacheWorks = true;
+	const CloudNoiseUtil::CloudNoiseParams noiseVolumes[] = { CloudNoiseUtil::lowFrequencyDefaults(), CloudNoiseUtil::highFrequencyDefaults() };
+	std::cout << "Noise volume upload, cache in " << cacheFolder << std::endl;
+	for (const CloudNoiseUtil::CloudNoiseParams& params : noiseVolumes)
+	{
+		const std::string cacheFile = CloudNoiseUtil::getCacheFilePath(params, cacheFolder);
+		std::error_code error;
+		std::filesystem::remove(cacheFile, error);
+
+		float uploadTimes[2];
+		for (float& uploadTime : uploadTimes)
+		{
+			TIME_POINT uploadStart = std::chrono::high_resolution_clock::now();
+			std::shared_ptr<Texture3D> volume = std::make_shared<Texture3D>(vulkanManager, graphicsQueue, cmdPool, VK_FORMAT_R8G8B8A8_UNORM);
+			volume->create3DTextureFromNoise(params, graphicsQueue, cmdPool, true, cacheFolder);
+			uploadTime = TimerUtil::getTimeElapsedSinceStart(uploadStart);
+			vulkanManager->deferDestruction(volume);
+		}
+
+		const bool cached = std::filesystem::exists(cacheFile, error);
+		cacheWorks = cacheWorks && cached;
+		std::cout << "  " << CloudNoiseUtil::getCacheFilePath(params, "") << ": baked and uploaded in " << uploadTimes[0] << " ms, from the cache in "
+			<< uploadTimes[1] << " ms" << (cached ? "" : " (the cache file was never written)") << std::endl;
+	}
+
+	vkDeviceWaitIdle(logicalDevice);
+	vkDestroyCommandPool(logicalDevice, cmdPool, nullptr);
+	cleanup();
+	return cacheWorks;
+}
+
+void GraphicsPlaygroundApplication::runVolumeLoadReport()
+{
+	initialize("gltfTest_gltf_and_obj.json", defaultRendererOptions(), true);
+	VkDevice logicalDevice = vulkanManager->getLogicalDevice();
+	VkQueue graphicsQueue = vulkanManager->getQueue(QueueFlags::Graphics);
+	VkCommandPool cmdPool;
+	VulkanCommandUtil::createCommandPool(logicalDevice, cmdPool, vulkanManager->getQueueIndex(QueueFlags::Graphics), VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+
+	struct SlicedVolume
+	{
+		const char* folder;
+		const char* baseName;
+		int numSlices;
+	};
+	const SlicedVolume cloudVolumes[] = {
+		{ "CloudTextures/LowFrequency/", "LowFrequency", 128 },
+		{ "CloudTextures/HighFrequency/", "HighFrequency", 32 } };
+	const int numChannels = 4;
+
+	std::cout << "Volume load report, decode + upload on the loader's threads against a serial stb decode of the same slices" << std::endl;
+	for (const SlicedVolume& cloudVolume : cloudVolumes)
+	{
+		TIME_POINT loadStart = std::chrono::high_resolution_clock::now();
+		std::shared_ptr<Texture3D> volume = std::make_shared<Texture3D>(vulkanManager, graphicsQueue, cmdPool, VK_FORMAT_R8G8B8A8_UNORM);
+		volume->create3DTextureFromMany2DTextures(graphicsQueue, cmdPool, cloudVolume.numSlices, numChannels,
+			cloudVolume.folder, cloudVolume.baseName, ".tga");
+		const float loadTime = TimerUtil::getTimeElapsedSinceStart(loadStart);
+		vulkanManager->deferDestruction(volume);
+
+		TIME_POINT serialStart = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < cloudVolume.numSlices; i++)
+		{
+			const std::string slicePath = std::string("../../src/Assets/Textures/") + cloudVolume.folder + cloudVolume.baseName + 
+				"(" + std::to_string(i + 1) + ").tga";
+			int imgW, imgH, imgChannels;
+			unsigned char* pixels = stbi_load(slicePath.c_str(), &imgW, &imgH, &imgChannels, numChannels);
+			if (!pixels) { throw std::runtime_error("failed to load image!"); }
+			stbi_image_free(pixels);
+		}
+		const float serialTime = TimerUtil::getTimeElapsedSinceStart(serialStart);
+
+		const float decodedMB = static_cast<float>(volume->m_width) * volume->m_height * volume->m_depth * numChannels / (1024.0f * 1024.0f);
+		std::cout << "  " << cloudVolume.baseName << " (" << volume->m_width << "x" << volume->m_height << "x" << volume->m_depth << ", " 
+			<< decodedMB << " MB): decode + upload " << loadTime << " ms (" << decodedMB / (loadTime / 1000.0f) << " MB/s), serial stb decode " 
+			<< serialTime << " ms (" << decodedMB / (serialTime / 1000.0f) << " MB/s), " << serialTime / loadTime << "x" << std::endl;
+	}
+
+	vkDeviceWaitIdle(logicalDevice);
+	vkDestroyCommandPool(logicalDevice, cmdPool, nullptr);
+	cleanup();
+}
@@ -28,8 +28,12 @@ UIManager::UIManager(GLFWwindow* window, std::shared_ptr<VulkanManager> vulkanMa
 	: m_vulkanManager(vulkanManager),
 	m_logicalDevice(vulkanManager->getLogicalDevice()),
 	m_queue(m_vulkanManager->getQueue(QueueFlags::Graphics)),
-	m_rendererOptions(rendererOptions)
+	m_rendererOptions(rendererOptions),
+	m_gpuProfiler(m_vulkanManager->getGpuProfiler())
 {
+	HEAP_TRACKER_SCOPE(HEAP_TAG::UI);
+	m_profilerPass = m_gpuProfiler->registerPass("UI", QueueFlags::Graphics);
+
 	setupVulkanObjectsForImgui();
 
 	IMGUI_CHECKVERSION();
@@ -37,13 +41,18 @@ UIManager::UIManager(GLFWwindow* window, std::shared_ptr<VulkanManager> vulkanMa
 	ImGuiIO& io = ImGui::GetIO();
 	ImGui::StyleColorsDark(); // Setup Dear ImGui style
 
-	ImGui_ImplGlfw_InitForVulkan(window, true);
+	m_hasWindow = (window != nullptr);
+	if (m_hasWindow)
+	{
+		ImGui_ImplGlfw_InitForVulkan(window, true);
+	}
 	setupPlatformAndRendererBindings(window);
 	uploadFonts();
 
 	const VkExtent2D extents = m_vulkanManager->getSwapChainVkExtent();
 	m_windowWidth = extents.width;
 	m_windowHeight = extents.height;
+	io.DisplaySize = ImVec2(static_cast<float>(m_windowWidth), static_cast<float>(m_windowHeight));
 	m_stateChanged = true;
 
 	// Set options
@@ -51,10 +60,15 @@ UIManager::UIManager(GLFWwindow* window, std::shared_ptr<VulkanManager> vulkanMa
 		m_options.framerateInFPS = false;
 		m_options.transparentWindows = true;
 		m_options.showStatisticsWindow = true;
+		m_options.showGpuTimingsWindow = m_gpuProfiler->isEnabled();
+		m_options.showCpuFrameWindow = true;
+		m_options.showMemoryWindow = true;
 		// Re-enable when the option to actually toggle this stuff exists in the renderer
 		m_options.showOptionsWindow = false;
 
 		m_options.boundaryPadding = 5;
+		m_options.cpuFrameWindowHeight = 170;
+		m_options.memoryWarningFraction = 0.9f;
 	}
 
 #if IMGUI_REFERENCE_DEMO
@@ -65,32 +79,40 @@ UIManager::UIManager(GLFWwindow* window, std::shared_ptr<VulkanManager> vulkanMa
 }
 UIManager::~UIManager()
 {
-	vkDeviceWaitIdle(m_logicalDevice);
-
 	clean();
-	
-	for (auto fence : m_inFlightFences)
-	{
-		vkDestroyFence(m_logicalDevice, fence, nullptr);
-	}
 
-	vkDestroyDescriptorPool(m_vulkanManager->getLogicalDevice(), m_UIDescriptorPool, nullptr);
-	vkDestroyCommandPool(m_logicalDevice, m_UICommandPool, nullptr);
+	VkDevice logicalDevice = m_logicalDevice;
+	m_vulkanManager->deferDestruction([logicalDevice, UIDescriptorPool = m_UIDescriptorPool, UICommandPool = m_UICommandPool]()
+	{
+		vkDestroyDescriptorPool(logicalDevice, UIDescriptorPool, nullptr);
+		vkDestroyCommandPool(logicalDevice, UICommandPool, nullptr);
+	});
 
+	// The ImGui backend keeps its font image, pipeline and buffers in its own global state, 
+	// they can't be handed to the deletion queue so the last frame that drew the UI has to finish first
+	m_vulkanManager->waitForPreviousFrame();
 	ImGui_ImplVulkan_Shutdown();
-	ImGui_ImplGlfw_Shutdown();
+	if (m_hasWindow)
+	{
+		ImGui_ImplGlfw_Shutdown();
+	}
 	ImGui::DestroyContext();
 }
 void UIManager::clean()
 {
-	// Resources to destroy on swapchain recreation
-	for (auto framebuffer : m_UIFrameBuffers) 
+	// Resources to destroy on swapchain recreation, once the frames in flight that draw the UI have finished
+	VkDevice logicalDevice = m_logicalDevice;
+	m_vulkanManager->deferDestruction([logicalDevice, UIFrameBuffers = m_UIFrameBuffers, UIRenderPass = m_UIRenderPass,
+		UICommandPool = m_UICommandPool, UICommandBuffers = m_UICommandBuffers]()
 	{
-		vkDestroyFramebuffer(m_logicalDevice, framebuffer, nullptr);
-	}
-	vkDestroyRenderPass(m_logicalDevice, m_UIRenderPass, nullptr);
-	
-	vkFreeCommandBuffers(m_logicalDevice, m_UICommandPool, static_cast<uint32_t>(m_UICommandBuffers.size()), m_UICommandBuffers.data());
+		for (auto framebuffer : UIFrameBuffers)
+		{
+			vkDestroyFramebuffer(logicalDevice, framebuffer, nullptr);
+		}
+		vkDestroyRenderPass(logicalDevice, UIRenderPass, nullptr);
+
+		vkFreeCommandBuffers(logicalDevice, UICommandPool, static_cast<uint32_t>(UICommandBuffers.size()), UICommandBuffers.data());
+	});
 }
 void UIManager::resize(GLFWwindow* window)
 {
@@ -103,7 +125,7 @@ void UIManager::resize(GLFWwindow* window)
 	clean();
 
 	// Recreate CommandBuffers
-	const int numCmdBuffers = m_vulkanManager->getSwapChainImageCount();
+	const int numCmdBuffers = m_vulkanManager->getNumFramesInFlight();
 	m_UICommandBuffers.resize(numCmdBuffers);
 	VulkanCommandUtil::allocateCommandBuffers(m_logicalDevice, m_UICommandPool, m_UICommandBuffers);
 
@@ -117,7 +139,17 @@ void UIManager::update(float frameTime)
 {
 	// New Frame
 	ImGui_ImplVulkan_NewFrame(); // empty
-	ImGui_ImplGlfw_NewFrame(); // handles inputs, screen resiziing, etc
+	if (m_hasWindow)
+	{
+		ImGui_ImplGlfw_NewFrame(); // handles inputs, screen resiziing, etc
+	}
+	else
+	{
+		// What the GLFW backend would fill in, ImGui needs a positive time step
+		ImGuiIO& io = ImGui::GetIO();
+		io.DisplaySize = ImVec2(static_cast<float>(m_windowWidth), static_cast<float>(m_windowHeight));
+		io.DeltaTime = std::max(frameTime, 0.001f) / 1000.0f;
+	}
 	ImGui::NewFrame();
 
 	// Update UI
@@ -126,30 +158,31 @@ void UIManager::update(float frameTime)
 	// Record new state into command buffers
 	ImGui::Render();
 }
-void UIManager::submitDrawCommands(VkSemaphore& waitSemaphore, VkSemaphore& signalSemaphore)
+VkCommandBuffer UIManager::recordDrawCommands()
 {
+	HEAP_TRACKER_SCOPE(HEAP_TAG::UI);
 	VkRect2D renderArea = {};
 	renderArea.extent = m_vulkanManager->getSwapChainVkExtent();
 	VkClearValue clearColor = { 0.0f, 0.0f, 0.0f, 1.0f };
+	const unsigned int frameIndex = m_vulkanManager->getFrameIndex();
 	const unsigned int imageIndex = m_vulkanManager->getImageIndex();
+	VkCommandBuffer cmdBuffer = m_UICommandBuffers[frameIndex];
 
-	VkFence& inFlightFence = m_inFlightFences[imageIndex];
-	// The VK_TRUE we pass in vkWaitForFences indicates that we want to wait for all fences.
-	vkWaitForFences(m_logicalDevice, 1, &inFlightFence, VK_TRUE, std::numeric_limits<uint64_t>::max());
-	vkResetFences(m_logicalDevice, 1, &inFlightFence);
-
-	vkResetCommandBuffer(m_UICommandBuffers[imageIndex], VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT);
-	VulkanCommandUtil::beginCommandBuffer(m_UICommandBuffers[imageIndex]);
-	VulkanCommandUtil::beginRenderPass(m_UICommandBuffers[imageIndex], m_UIRenderPass, m_UIFrameBuffers[imageIndex], renderArea, 1, &clearColor);
+	// The UI is submitted with the rest of the frame, the wait on the frame in flight's fence means its last use of this command buffer is done.
+	// Only the framebuffer belongs to the acquired swapchain image.
+	vkResetCommandBuffer(cmdBuffer, VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT);
+	VulkanCommandUtil::beginCommandBuffer(cmdBuffer);
+	m_gpuProfiler->beginPass(cmdBuffer, frameIndex, m_profilerPass);
+	VulkanCommandUtil::beginRenderPass(cmdBuffer, m_UIRenderPass, m_UIFrameBuffers[imageIndex], renderArea, 1, &clearColor);
 
 	// Record Imgui Draw Data and draw funcs into command buffer
-	ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), m_UICommandBuffers[imageIndex]);
+	ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmdBuffer);
 
-	vkCmdEndRenderPass(m_UICommandBuffers[imageIndex]);
-	VulkanCommandUtil::endCommandBuffer(m_UICommandBuffers[imageIndex]);
+	vkCmdEndRenderPass(cmdBuffer);
+	m_gpuProfiler->endPass(cmdBuffer, frameIndex, m_profilerPass);
+	VulkanCommandUtil::endCommandBuffer(cmdBuffer);
 
-	VkPipelineStageFlags waitStages_UI[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-	VulkanCommandUtil::submitToQueueSynced(m_queue, 1, &m_UICommandBuffers[imageIndex], 1, &waitSemaphore, waitStages_UI, 1, &signalSemaphore, inFlightFence);
+	return cmdBuffer;
 }
 
 
@@ -161,9 +194,17 @@ void UIManager::updateState(float frameTime)
 	createImguiDefaultDemo();
 #endif
 	
+	if (!m_visible)
+	{
+		return;
+	}
+
 	// The ordering here is important, window positioning depends on previous window position and size
 	if(m_options.showStatisticsWindow) statisticsWindow(frameTime);
 	if(m_options.showOptionsWindow) optionsWindow();
+	if(m_options.showGpuTimingsWindow) gpuTimingsWindow();
+	if(m_options.showCpuFrameWindow) cpuFrameWindow();
+	if(m_options.showMemoryWindow) memoryWindow();
 
 	m_stateChanged = false;
 }
@@ -171,8 +212,8 @@ void UIManager::statisticsWindow(float frameTime)
 {
 	if (m_stateChanged)
 	{
-		m_options.statisticsWindowSize.x = 200; // width
-		m_options.statisticsWindowSize.y = 50; // height
+		m_options.statisticsWindowSize.x = 260; // width
+		m_options.statisticsWindowSize.y = 176; // height
 		const float& width = m_options.statisticsWindowSize.x;
 		const float& height = m_options.statisticsWindowSize.y;
 		const float xPos = m_options.boundaryPadding;
@@ -204,9 +245,284 @@ void UIManager::statisticsWindow(float frameTime)
 		ImGui::Text("Framerate: %.3f ms/frame", frameTime);
 		//ImGui::Text("Framerate: %.3f ms/frame", 1000.0f / ImGui::GetIO().Framerate);
 	}
+
+	// Time the CPU spent blocked on the GPU before it could start the frame
+	ImGui::Text("CPU wait: %.3f ms/frame (%s)", m_vulkanManager->getLastFrameWaitTime(),
+		m_vulkanManager->usesTimelineSemaphores() ? "timeline" : "fences");
+	// Input sampled to the CPU seeing the frame finish on the GPU
+	ImGui::Text("Input to GPU completion: %.2f ms (%u in flight)", m_vulkanManager->getLastInputToCompletionLatency(), m_vulkanManager->getNumFramesInFlight());
+	// Render thread time a captured frame costs, the encoding happens on background threads
+	const VulkanFrameCapture::Stats captureStats = m_vulkanManager->getFrameCapture()->getStats();
+	if (m_vulkanManager->getFrameCapture()->isCapturingSequence() || captureStats.numPending > 0)
+	{
+		ImGui::Text("Capture: %.3f ms/frame (%u pending)", captureStats.averageOverheadMs, captureStats.numPending);
+	}
+	else
+	{
+		ImGui::Text("Capture: F12 screenshot, F11 sequence");
+	}
+
+	// What the last collected frame recorded and made the GPU do, the GPU Passes window breaks it down by pass
+	const CommandCounters counters = m_gpuProfiler->getLastFrameCounters();
+	ImGui::Text("Draws: %u, dispatches: %u", counters.draws, counters.dispatches);
+	ImGui::Text("Binds: %u pipeline, %u set, %u redundant", counters.pipelineBinds, counters.descriptorSetBinds, counters.redundantBinds);
+	ImGui::Text("Push constants: %u, barriers: %u", counters.pushConstants, counters.barriers);
+	if (m_gpuProfiler->isPipelineStatisticsEnabled())
+	{
+		// Every pass's fragments, a fullscreen pass adds about 1
+		const PipelineStatistics statistics = m_gpuProfiler->getLastFrameStatistics();
+		const float numPixels = static_cast<float>(std::max(1u, m_windowWidth * m_windowHeight));
+		ImGui::Text("Fragments: %.2f per pixel", statistics.fragmentShaderInvocations / numPixels);
+	}
+	else
+	{
+		ImGui::Text("Fragments: no pipeline statistics");
+	}
 	
 	ImGui::End();
 }
+void UIManager::gpuTimingsWindow()
+{
+	if (m_stateChanged)
+	{
+		// Right under the statistics window, sized to its contents
+		const float xPos = m_options.boundaryPadding;
+		const float yPos = 2.0f * m_options.boundaryPadding + m_options.statisticsWindowSize.y;
+		ImGui::SetNextWindowPos(ImVec2(xPos, yPos), ImGuiCond_Always);
+	}
+
+	ImGuiWindowFlags window_flags = ImGuiWindowFlags_NoMove | ImGuiWindowFlags_AlwaysAutoResize;
+	if (m_options.transparentWindows) window_flags |= ImGuiWindowFlags_NoBackground;
+
+	if (!ImGui::Begin("GPU Passes", &m_options.showGpuTimingsWindow, window_flags))
+	{
+		ImGui::End();
+		return;
+	}
+
+	// Average, min and max since the last reset
+	for (const VulkanGpuProfiler::PassStats& stats : m_gpuProfiler->getPassStats())
+	{
+		if (!stats.timed)
+		{
+			ImGui::Text("%-16s no timestamps on this queue", stats.name.c_str());
+		}
+		else if (stats.numSamples > 0)
+		{
+			ImGui::Text("%-16s %.3f ms (%.3f - %.3f)", stats.name.c_str(), stats.averageMs, stats.minMs, stats.maxMs);
+		}
+	}
+	if (m_vulkanManager->usesAsyncCompute())
+	{
+		ImGui::Text("Compute overlap: %.3f ms", m_gpuProfiler->getLastComputeOverlap());
+	}
+
+	// The last collected frame's counters and pipeline statistics
+	if (ImGui::CollapsingHeader("Commands and statistics"))
+	{
+		const bool hasStatistics = m_gpuProfiler->isPipelineStatisticsEnabled();
+		for (const VulkanGpuProfiler::PassStats& stats : m_gpuProfiler->getPassStats())
+		{
+			const CommandCounters& counters = stats.lastCounters;
+			ImGui::Text("%-16s %u draws, %u dispatches, %u binds (%u redundant), %u push constants, %u barriers", stats.name.c_str(),
+				counters.draws, counters.dispatches, counters.pipelineBinds + counters.descriptorSetBinds, counters.redundantBinds,
+				counters.pushConstants, counters.barriers);
+			if (hasStatistics && stats.queried)
+			{
+				const PipelineStatistics& statistics = stats.lastStatistics;
+				ImGui::Text("%-16s %llu primitives, %llu vertices, %llu fragments, %llu compute", "",
+					static_cast<unsigned long long>(statistics.inputAssemblyPrimitives), static_cast<unsigned long long>(statistics.vertexShaderInvocations),
+					static_cast<unsigned long long>(statistics.fragmentShaderInvocations), static_cast<unsigned long long>(statistics.computeShaderInvocations));
+			}
+		}
+	}
+
+	if (ImGui::Button("Reset"))
+	{
+		m_gpuProfiler->resetStats();
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Export CSV"))
+	{
+		m_gpuProfiler->exportCSV("gpu_pass_timings.csv");
+	}
+	ImGui::SameLine();
+	if (ImGui::Button(m_gpuProfiler->isLoggingFrames() ? "Stop Frame Log" : "Log Frames"))
+	{
+		if (m_gpuProfiler->isLoggingFrames())
+		{
+			m_gpuProfiler->stopFrameLog();
+		}
+		else
+		{
+			m_gpuProfiler->startFrameLog("gpu_pass_statistics.csv");
+		}
+	}
+
+	ImGui::End();
+}
+void UIManager::memoryWindow()
+{
+	if (m_stateChanged)
+	{
+		// Top right corner, sized to its contents
+		const float xPos = m_windowWidth - m_options.boundaryPadding;
+		const float yPos = m_options.boundaryPadding;
+		ImGui::SetNextWindowPos(ImVec2(xPos, yPos), ImGuiCond_Always, ImVec2(1.0f, 0.0f));
+	}
+
+	ImGuiWindowFlags window_flags = ImGuiWindowFlags_NoMove | ImGuiWindowFlags_AlwaysAutoResize;
+	if (m_options.transparentWindows) window_flags |= ImGuiWindowFlags_NoBackground;
+
+	if (!ImGui::Begin("Device Memory", &m_options.showMemoryWindow, window_flags))
+	{
+		ImGui::End();
+		return;
+	}
+
+	const float toMB = 1.0f / (1024.0f * 1024.0f);
+	const ImVec4 warningColor(1.0f, 0.3f, 0.2f, 1.0f);
+	const bool hasBudget = m_vulkanManager->isMemoryBudgetSupported();
+	for (const VulkanMemoryTracker::HeapStats& heap : m_vulkanManager->getMemoryHeapStats())
+	{
+		if (heap.numAllocations == 0 && !heap.deviceLocal)
+		{
+			continue;
+		}
+		// Usage counts other processes too, without the extension only our own allocations are known
+		const VkDeviceSize used = hasBudget ? heap.usage : heap.allocated;
+		const VkDeviceSize limit = hasBudget ? heap.budget : heap.size;
+		const bool nearLimit = (limit > 0) && (used >= static_cast<VkDeviceSize>(m_options.memoryWarningFraction * limit));
+		const char* heapType = heap.deviceLocal ? "device" : "host";
+		if (nearLimit)
+		{
+			ImGui::TextColored(warningColor, "%-6s %.0f / %.0f MB %s, near the limit", heapType, used * toMB, limit * toMB, hasBudget ? "budget" : "heap");
+		}
+		else
+		{
+			ImGui::Text("%-6s %.0f / %.0f MB %s", heapType, used * toMB, limit * toMB, hasBudget ? "budget" : "heap");
+		}
+	}
+
+	ImGui::Separator();
+	const auto categories = VulkanMemoryTracker::getCategoryStats();
+	for (size_t i = 0; i < categories.size(); i++)
+	{
+		if (categories[i].numAllocations > 0)
+		{
+			ImGui::Text("%-16s %8.1f MB (%u)", VulkanMemoryTracker::getCategoryName(static_cast<MEMORY_CATEGORY>(i)),
+				categories[i].allocated * toMB, categories[i].numAllocations);
+		}
+	}
+
+	ImGui::End();
+}
+void UIManager::cpuFrameWindow()
+{
+	if (m_stateChanged)
+	{
+		// Along the bottom of the screen
+		const float width = m_windowWidth - 2.0f * m_options.boundaryPadding;
+		const float height = m_options.cpuFrameWindowHeight;
+		const float xPos = m_options.boundaryPadding;
+		const float yPos = m_windowHeight - height - m_options.boundaryPadding;
+
+		ImGui::SetNextWindowPos(ImVec2(xPos, yPos), ImGuiCond_Always);
+		ImGui::SetNextWindowSize(ImVec2(width, height), ImGuiCond_Always);
+		ImGui::SetNextWindowCollapsed(true, ImGuiCond_Once);
+	}
+
+	ImGuiWindowFlags window_flags = ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize;
+	if (m_options.transparentWindows) window_flags |= ImGuiWindowFlags_NoBackground;
+
+	if (!ImGui::Begin("CPU Frame", &m_options.showCpuFrameWindow, window_flags))
+	{
+		ImGui::End();
+		return;
+	}
+
+	bool profilerEnabled = CpuProfiler::isEnabled();
+	if (ImGui::Checkbox("Enabled", &profilerEnabled))
+	{
+		CpuProfiler::setEnabled(profilerEnabled);
+	}
+	ImGui::SameLine();
+	if (!CpuProfiler::isCapturing())
+	{
+		if (ImGui::Button("Capture Trace"))
+		{
+			CpuProfiler::beginCapture();
+		}
+	}
+	else if (ImGui::Button("Stop and Write cpu_trace.json"))
+	{
+		CpuProfiler::endCapture("cpu_trace.json");
+	}
+
+	const uint64_t frameBegin = CpuProfiler::getLastFrameBegin();
+	const uint64_t frameEnd = CpuProfiler::getLastFrameEnd();
+	const double frameMs = CpuProfiler::ticksToMilliseconds(frameEnd - frameBegin);
+	ImGui::SameLine();
+	ImGui::Text("%.3f ms, %llu zones dropped", frameMs, static_cast<unsigned long long>(CpuProfiler::getNumDroppedZones()));
+
+	// Flame graph of the last frame: one band per thread that finished a zone in it, one row per nesting depth.
+	// Zones that started before the frame are clipped to its start.
+	const std::vector<CpuProfiler::Zone>& zones = CpuProfiler::getLastFrameZones();
+	if (frameMs <= 0.0 || zones.empty())
+	{
+		ImGui::End();
+		return;
+	}
+
+	const float rowHeight = ImGui::GetTextLineHeight() + 2.0f;
+	const ImVec2 origin = ImGui::GetCursorScreenPos();
+	const float width = ImGui::GetContentRegionAvail().x;
+	const float pixelsPerMs = static_cast<float>(width / frameMs);
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+
+	float bandTop = origin.y;
+	uint32_t bandThread = zones.front().threadIndex;
+	uint32_t bandDepth = 0;
+	for (const CpuProfiler::Zone& zone : zones)
+	{
+		// Zones come grouped by thread
+		if (zone.threadIndex != bandThread)
+		{
+			bandTop += (bandDepth + 1) * rowHeight + 4.0f;
+			bandThread = zone.threadIndex;
+			bandDepth = 0;
+		}
+		bandDepth = std::max(bandDepth, zone.depth);
+
+		const uint64_t begin = std::max(zone.begin, frameBegin);
+		const float x0 = origin.x + static_cast<float>(CpuProfiler::ticksToMilliseconds(begin - frameBegin)) * pixelsPerMs;
+		const float x1 = origin.x + static_cast<float>(CpuProfiler::ticksToMilliseconds(zone.end - frameBegin)) * pixelsPerMs;
+		const ImVec2 min(x0, bandTop + zone.depth * rowHeight);
+		const ImVec2 max(std::max(x1, x0 + 1.0f), min.y + rowHeight - 1.0f);
+
+		// Color by name so a zone keeps its color from frame to frame
+		ImU32 hash = 2166136261u;
+		for (const char* c = zone.name; *c; c++)
+		{
+			hash = (hash ^ static_cast<unsigned char>(*c)) * 16777619u;
+		}
+		const ImU32 color = IM_COL32(96 + (hash & 0x7F), 96 + ((hash >> 8) & 0x7F), 96 + ((hash >> 16) & 0x7F), 255);
+		drawList->AddRectFilled(min, max, color);
+		if (max.x - min.x > 20.0f)
+		{
+			drawList->PushClipRect(min, max, true);
+			drawList->AddText(ImVec2(min.x + 2.0f, min.y), IM_COL32(0, 0, 0, 255), zone.name);
+			drawList->PopClipRect();
+		}
+		if (ImGui::IsMouseHoveringRect(min, max))
+		{
+			ImGui::SetTooltip("%s: %.3f ms", zone.name, CpuProfiler::ticksToMilliseconds(zone.end - zone.begin));
+		}
+	}
+	ImGui::Dummy(ImVec2(width, bandTop + (bandDepth + 1) * rowHeight - origin.y));
+
+	ImGui::End();
+}
 void UIManager::optionsWindow()
 {
 	if (m_stateChanged)
@@ -295,33 +611,16 @@ void UIManager::uploadFonts()
 // Vulkan Setup
 void UIManager::setupVulkanObjectsForImgui()
 {
-	createSyncObjects();
 	createCommandPoolAndCommandBuffers();
 	createDescriptorPool();
 	createRenderPass();
 	createFrameBuffers();
 }
 
-void UIManager::createSyncObjects()
-{
-	// Look at VulkanManager::createSyncObjects() for explanation of sync objects in vulkan
-	unsigned int maxFramesInFlight = m_vulkanManager->getSwapChainImageCount();
-	m_inFlightFences.resize(maxFramesInFlight);
-
-	VkFenceCreateInfo fenceInfo = {};
-	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-	for (size_t i = 0; i < maxFramesInFlight; i++)
-	{
-		VK_CHECK_RESULT(vkCreateFence(m_logicalDevice, &fenceInfo, nullptr, &m_inFlightFences[i]));
-	}
-}
-
 void UIManager::createCommandPoolAndCommandBuffers()
 {
-	// Do not need multiple command pools, just multiple command buffers
-	const int numCmdBuffers = m_vulkanManager->getSwapChainImageCount();
+	// Do not need multiple command pools, just one command buffer per frame in flight
+	const int numCmdBuffers = m_vulkanManager->getNumFramesInFlight();
 	m_UICommandBuffers.resize(numCmdBuffers);
 
 	// VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT allows any command buffer allocated from a pool to be
@@ -363,7 +662,7 @@ void UIManager::createRenderPass()
 		RenderPassUtil::attachmentDescription(m_vulkanManager->getSwapChainImageFormat(), VK_SAMPLE_COUNT_1_BIT,
 			VK_ATTACHMENT_LOAD_OP_LOAD, VK_ATTACHMENT_STORE_OP_STORE,			  //color data
 			VK_ATTACHMENT_LOAD_OP_DONT_CARE, VK_ATTACHMENT_STORE_OP_DONT_CARE,    //stencil data
-			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);  //initial and final layout
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, m_vulkanManager->getPresentLayout());  //initial and final layout
 
 	// Create Color Attachment References
 	VkAttachmentReference colorAttachmentReference = RenderPassUtil::attachmentReference(0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
@@ -378,10 +677,12 @@ void UIManager::createRenderPass()
 			0, nullptr); //preserve attachments
 
 	// Subpass Description -- details how to transition into the renderpass/subpass
+	// The UI is submitted right after post processing on the same queue without a semaphore in between, 
+	// so this dependency is what makes the last post process pass's writes to the swapchain image visible to the UI
 	VkSubpassDependency subpassDependency =
 		RenderPassUtil::subpassDependency(VK_SUBPASS_EXTERNAL, 0,
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0 /* Or use VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT */,
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
 
 	VkDevice logicalDevice = m_vulkanManager->getLogicalDevice();
 	RenderPassUtil::createRenderPass(logicalDevice,
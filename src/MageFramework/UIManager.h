@@ -34,17 +34,23 @@ struct UIOptions
 	// Display Windows
 	bool showStatisticsWindow;
 	bool showOptionsWindow;
+	bool showGpuTimingsWindow;
+	bool showCpuFrameWindow;
+	bool showMemoryWindow;
 
 	// Positioning
 	float boundaryPadding;
 	glm::vec2 statisticsWindowSize;
 	glm::vec2 optionsWindowSize;
+	float cpuFrameWindowHeight;
+	float memoryWarningFraction; // Of the budget, or of the heap without VK_EXT_memory_budget
 };
 
 class UIManager
 {
 public:
 	UIManager() = delete;
+	// Without a window (headless) the UI still renders, it just doesn't get any input
 	UIManager(GLFWwindow* window, std::shared_ptr<VulkanManager> vulkanManager, RendererOptions rendererOptions);
 	~UIManager();
 	
@@ -52,7 +58,10 @@ public:
 	void resize(GLFWwindow* window);
 	
 	void update(float frameTime);
-	void submitDrawCommands(VkSemaphore& waitSemaphore, VkSemaphore& signalSemaphore);
+	// Hidden the UI draws no windows, e.g. for images that get compared against golden images
+	void setVisible(bool visible) { m_visible = visible; }
+	// Records the UI for the acquired swapchain image, the renderer submits it after the frame's post processing
+	VkCommandBuffer recordDrawCommands();
 
 private:
 	std::shared_ptr<VulkanManager> m_vulkanManager;
@@ -61,7 +70,9 @@ private:
 	UIOptions m_options;
 	RendererOptions m_rendererOptions;
 	unsigned int m_windowWidth, m_windowHeight;
+	bool m_hasWindow;
 	bool m_stateChanged;
+	bool m_visible = true;
 
 	//-------------------------------------------
 	// UI Specific vulkan objects for rendering
@@ -75,12 +86,14 @@ private:
 	// to avoid this we just double the number of command buffers we use.
 	VkCommandPool m_UICommandPool;
 	std::vector<VkCommandBuffer> m_UICommandBuffers;
-	std::vector<VkFence> m_inFlightFences;
 
 	VkDescriptorPool m_UIDescriptorPool;
 	VkRenderPass m_UIRenderPass;
 	std::vector<VkFramebuffer> m_UIFrameBuffers;
 
+	std::shared_ptr<VulkanGpuProfiler> m_gpuProfiler;
+	uint32_t m_profilerPass;
+
 #ifdef IMGUI_REFERENCE_DEMO
 	bool show_demo_window;
 	bool show_another_window;
@@ -93,13 +106,15 @@ private:
 	void updateState(float frameTime);
 	void optionsWindow();
 	void statisticsWindow(float frameTime);
+	void gpuTimingsWindow();
+	void cpuFrameWindow();
+	void memoryWindow();
 
 
 	// Helpers
 	void uploadFonts();
 
 	void setupVulkanObjectsForImgui();
-	void createSyncObjects();
 	void createCommandPoolAndCommandBuffers();
 	void createDescriptorPool();
 	void createRenderPass();
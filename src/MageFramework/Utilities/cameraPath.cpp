@@ -0,0 +1,107 @@
+#include "cameraPath.h"
+#include <algorithm>
+#include <fstream>
+#include <json.hpp>
+
+using json = nlohmann::json;
+
+void CameraPath::addKeyframe(float time, const glm::vec3& eyePos, const glm::vec3& lookAtPoint)
+{
+	if (!m_keyframes.empty() && time <= m_keyframes.back().time)
+	{
+		m_keyframes.back() = { m_keyframes.back().time, eyePos, lookAtPoint };
+		return;
+	}
+	m_keyframes.push_back({ time, eyePos, lookAtPoint });
+}
+
+void CameraPath::sample(float time, glm::vec3& eyePos, glm::vec3& lookAtPoint) const
+{
+	if (m_keyframes.empty())
+	{
+		throw std::runtime_error("sampling an empty camera path");
+	}
+
+	time += m_keyframes.front().time;
+	if (time <= m_keyframes.front().time || m_keyframes.size() == 1)
+	{
+		eyePos = m_keyframes.front().eyePos;
+		lookAtPoint = m_keyframes.front().lookAtPoint;
+		return;
+	}
+	if (time >= m_keyframes.back().time)
+	{
+		eyePos = m_keyframes.back().eyePos;
+		lookAtPoint = m_keyframes.back().lookAtPoint;
+		return;
+	}
+
+	// The segment [k1, k2] contains the time, k0 and k3 are its neighbours (clamped at the ends of the path)
+	const size_t i2 = static_cast<size_t>(std::upper_bound(m_keyframes.begin(), m_keyframes.end(), time,
+		[](float t, const Keyframe& keyframe) { return t < keyframe.time; }) - m_keyframes.begin());
+	const size_t i1 = i2 - 1;
+	const Keyframe& k0 = m_keyframes[(i1 > 0) ? i1 - 1 : i1];
+	const Keyframe& k1 = m_keyframes[i1];
+	const Keyframe& k2 = m_keyframes[i2];
+	const Keyframe& k3 = m_keyframes[std::min(i2 + 1, m_keyframes.size() - 1)];
+
+	// Cubic Hermite basis, the Catmull-Rom tangents are the slopes between the neighbours in units per second
+	const float h = k2.time - k1.time;
+	const float s = (time - k1.time) / h;
+	const float s2 = s * s;
+	const float s3 = s2 * s;
+	const float h00 = 2.0f * s3 - 3.0f * s2 + 1.0f;
+	const float h10 = s3 - 2.0f * s2 + s;
+	const float h01 = -2.0f * s3 + 3.0f * s2;
+	const float h11 = s3 - s2;
+
+	auto interpolate = [&](const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3) -> glm::vec3
+	{
+		const glm::vec3 m1 = (p2 - p0) / (k2.time - k0.time);
+		const glm::vec3 m2 = (p3 - p1) / (k3.time - k1.time);
+		return h00 * p1 + h10 * h * m1 + h01 * p2 + h11 * h * m2;
+	};
+	eyePos = interpolate(k0.eyePos, k1.eyePos, k2.eyePos, k3.eyePos);
+	lookAtPoint = interpolate(k0.lookAtPoint, k1.lookAtPoint, k2.lookAtPoint, k3.lookAtPoint);
+}
+
+bool CameraPath::save(const std::string& path) const
+{
+	std::ofstream file(path);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	auto toJSON = [](const glm::vec3& v) { return json{ { "x", v.x }, { "y", v.y }, { "z", v.z } }; };
+	json keyframes = json::array();
+	for (const Keyframe& keyframe : m_keyframes)
+	{
+		keyframes.push_back({ { "time", keyframe.time }, { "eye", toJSON(keyframe.eyePos) }, { "lookAtPoint", toJSON(keyframe.lookAtPoint) } });
+	}
+	file << json{ { "keyframes", keyframes } }.dump(1, '\t') << "\n";
+	return file.good();
+}
+
+CameraPath CameraPath::load(const std::string& path)
+{
+	std::ifstream file(path);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("failed to open camera path " + path);
+	}
+	json j;
+	file >> j;
+
+	auto fromJSON = [](const json& v) { return glm::vec3(v["x"].get<float>(), v["y"].get<float>(), v["z"].get<float>()); };
+	CameraPath cameraPath;
+	for (const json& keyframe : j["keyframes"])
+	{
+		cameraPath.addKeyframe(keyframe["time"].get<float>(), fromJSON(keyframe["eye"]), fromJSON(keyframe["lookAtPoint"]));
+	}
+	if (cameraPath.empty())
+	{
+		throw std::runtime_error("camera path " + path + " has no keyframes");
+	}
+	return cameraPath;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <global.h>
+#include <string>
+
+// A camera path is a list of keyframes, each an eye position and a look at point at a time in seconds.
+// In between keyframes both points follow Catmull-Rom splines, with the tangents scaled to the keyframe spacing
+// so recorded paths with uneven gaps between keyframes don't overshoot. Before the first and after the last keyframe the path holds still.
+//
+// Stored as JSON: { "keyframes": [ { "time": 0.0, "eye": { "x", "y", "z" }, "lookAtPoint": { "x", "y", "z" } }, ... ] }
+class CameraPath
+{
+public:
+	struct Keyframe
+	{
+		float time; // seconds
+		glm::vec3 eyePos;
+		glm::vec3 lookAtPoint;
+	};
+
+	// Keyframes have to come in order, one that isn't later than the last keyframe replaces it
+	void addKeyframe(float time, const glm::vec3& eyePos, const glm::vec3& lookAtPoint);
+	void clear() { m_keyframes.clear(); }
+
+	bool empty() const { return m_keyframes.empty(); }
+	size_t getNumKeyframes() const { return m_keyframes.size(); }
+	float getDuration() const { return m_keyframes.empty() ? 0.0f : m_keyframes.back().time - m_keyframes.front().time; }
+
+	// Time is relative to the first keyframe
+	void sample(float time, glm::vec3& eyePos, glm::vec3& lookAtPoint) const;
+
+	bool save(const std::string& path) const;
+	// Throws if the file can't be read or has no keyframes
+	static CameraPath load(const std::string& path);
+
+private:
+	std::vector<Keyframe> m_keyframes;
+};
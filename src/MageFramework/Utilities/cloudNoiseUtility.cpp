@@ -0,0 +1,472 @@
+#include "cloudNoiseUtility.h"
+#include <vector>
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <climits>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+
+#include <Utilities/threadPool.h>
+#include <Utilities/timerUtility.h>
+
+// SSE2 is part of the x86-64 baseline so it is always safe to use there; everything else falls back to the scalar path
+#if defined(_M_X64) || defined(__SSE2__)
+#define MAGE_CLOUD_NOISE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	//--------------------
+	// Hashing
+	//--------------------
+	// Integer hash (lowbias32), plain integer math so every thread and platform gets the same feature points and gradients
+	inline uint32_t hash(uint32_t x)
+	{
+		x ^= x >> 16;
+		x *= 0x7feb352d;
+		x ^= x >> 15;
+		x *= 0x846ca68b;
+		x ^= x >> 16;
+		return x;
+	}
+	inline uint32_t hashCell(int x, int y, int z, uint32_t seed)
+	{
+		return hash(static_cast<uint32_t>(x) + hash(static_cast<uint32_t>(y) + hash(static_cast<uint32_t>(z) + hash(seed))));
+	}
+	inline float toUnitFloat(uint32_t h)
+	{
+		return static_cast<float>(h >> 8) * (1.0f / 16777216.0f);
+	}
+	// Lattice coordinates are wrapped by the cell count, that is what makes the noise tile
+	inline int wrap(int value, int period)
+	{
+		const int r = value % period;
+		return (r < 0) ? r + period : r;
+	}
+	inline uint32_t octaveSeed(uint32_t seed, uint32_t channel, uint32_t octave)
+	{
+		return hash(seed ^ hash(channel * 16 + octave + 1));
+	}
+
+	//--------------------
+	// Perlin
+	//--------------------
+	inline float fade(float t)
+	{
+		return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+	}
+	inline float lerp(float a, float b, float t)
+	{
+		return a + t * (b - a);
+	}
+	// Ken Perlin's 12 gradient directions, 4 of them repeated to fill 16 slots
+	inline float gradient(uint32_t h, float x, float y, float z)
+	{
+		switch (h & 15)
+		{
+		case 0:  return  x + y;
+		case 1:  return -x + y;
+		case 2:  return  x - y;
+		case 3:  return -x - y;
+		case 4:  return  x + z;
+		case 5:  return -x + z;
+		case 6:  return  x - z;
+		case 7:  return -x - z;
+		case 8:  return  y + z;
+		case 9:  return -y + z;
+		case 10: return  y - z;
+		case 11: return -y - z;
+		case 12: return  x + y;
+		case 13: return -y + z;
+		case 14: return -x + y;
+		default: return -y - z;
+		}
+	}
+
+	// Roughly [-1, 1], tiles every 'period' lattice cells
+	float tileablePerlin(float px, float py, float pz, int period, uint32_t seed)
+	{
+		const float qx = px * period, qy = py * period, qz = pz * period;
+		const int ix = static_cast<int>(std::floor(qx)), iy = static_cast<int>(std::floor(qy)), iz = static_cast<int>(std::floor(qz));
+		const float fx = qx - ix, fy = qy - iy, fz = qz - iz;
+		const float u = fade(fx), v = fade(fy), w = fade(fz);
+
+		const int x0 = wrap(ix, period), x1 = wrap(ix + 1, period);
+		const int y0 = wrap(iy, period), y1 = wrap(iy + 1, period);
+		const int z0 = wrap(iz, period), z1 = wrap(iz + 1, period);
+
+		const float n000 = gradient(hashCell(x0, y0, z0, seed), fx, fy, fz);
+		const float n100 = gradient(hashCell(x1, y0, z0, seed), fx - 1.0f, fy, fz);
+		const float n010 = gradient(hashCell(x0, y1, z0, seed), fx, fy - 1.0f, fz);
+		const float n110 = gradient(hashCell(x1, y1, z0, seed), fx - 1.0f, fy - 1.0f, fz);
+		const float n001 = gradient(hashCell(x0, y0, z1, seed), fx, fy, fz - 1.0f);
+		const float n101 = gradient(hashCell(x1, y0, z1, seed), fx - 1.0f, fy, fz - 1.0f);
+		const float n011 = gradient(hashCell(x0, y1, z1, seed), fx, fy - 1.0f, fz - 1.0f);
+		const float n111 = gradient(hashCell(x1, y1, z1, seed), fx - 1.0f, fy - 1.0f, fz - 1.0f);
+
+		return lerp(lerp(lerp(n000, n100, u), lerp(n010, n110, u), v),
+					lerp(lerp(n001, n101, u), lerp(n011, n111, u), v), w);
+	}
+
+	// [0, 1], each octave doubles the lattice cell count so the sum still tiles
+	float tileablePerlinFBM(float px, float py, float pz, int baseCellCount, uint32_t octaves, uint32_t seed)
+	{
+		float sum = 0.0f;
+		float amplitude = 1.0f;
+		float totalAmplitude = 0.0f;
+		for (uint32_t octave = 0; octave < octaves; octave++)
+		{
+			sum += amplitude * tileablePerlin(px, py, pz, baseCellCount << octave, octaveSeed(seed, 0, octave));
+			totalAmplitude += amplitude;
+			amplitude *= 0.5f;
+		}
+		return std::min(std::max(sum / totalAmplitude * 0.5f + 0.5f, 0.0f), 1.0f);
+	}
+
+	//--------------------
+	// Worley
+	//--------------------
+	// Evaluates inverted cellular noise along one row of voxels.
+	// The 27 feature points around the current cell are kept in SoA form and only refetched when the row crosses into a new cell,
+	// which leaves the distance test as 7 iterations of 4 wide SIMD math per voxel.
+	class WorleyRowEvaluator
+	{
+	public:
+		WorleyRowEvaluator(int cellCount, uint32_t seed, int cellY, int cellZ)
+			: m_cellCount(cellCount), m_seed(seed), m_cellX(INT_MIN), m_cellY(cellY), m_cellZ(cellZ)
+		{
+			// The 28th slot pads the last SIMD batch with a point that can never be the closest
+			m_xs[27] = m_ys[27] = m_zs[27] = 1e6f;
+		}
+
+		// q is the voxel position in cell units, returns 1 - distance to the closest feature point clamped to [0, 1]
+		float evaluate(float qx, float qy, float qz, int cellX)
+		{
+			if (cellX != m_cellX)
+			{
+				gatherNeighbourhood(cellX);
+			}
+
+#ifdef MAGE_CLOUD_NOISE_SSE2
+			const __m128 px = _mm_set1_ps(qx);
+			const __m128 py = _mm_set1_ps(qy);
+			const __m128 pz = _mm_set1_ps(qz);
+			__m128 closest = _mm_set1_ps(FLT_MAX);
+			for (int i = 0; i < 28; i += 4)
+			{
+				const __m128 dx = _mm_sub_ps(_mm_load_ps(m_xs + i), px);
+				const __m128 dy = _mm_sub_ps(_mm_load_ps(m_ys + i), py);
+				const __m128 dz = _mm_sub_ps(_mm_load_ps(m_zs + i), pz);
+				const __m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+				closest = _mm_min_ps(closest, distanceSquared);
+			}
+			closest = _mm_min_ps(closest, _mm_shuffle_ps(closest, closest, _MM_SHUFFLE(1, 0, 3, 2)));
+			closest = _mm_min_ps(closest, _mm_shuffle_ps(closest, closest, _MM_SHUFFLE(2, 3, 0, 1)));
+			const float closestDistanceSquared = _mm_cvtss_f32(closest);
+#else
+			float closestDistanceSquared = FLT_MAX;
+			for (int i = 0; i < 28; i++)
+			{
+				const float dx = m_xs[i] - qx;
+				const float dy = m_ys[i] - qy;
+				const float dz = m_zs[i] - qz;
+				closestDistanceSquared = std::min(closestDistanceSquared, (dx * dx + dy * dy) + dz * dz);
+			}
+#endif
+			return 1.0f - std::min(std::sqrt(closestDistanceSquared), 1.0f);
+		}
+
+	private:
+		void gatherNeighbourhood(int cellX)
+		{
+			// Rows are walked in +x, so stepping into the next cell keeps two of the three columns and only hashes the new one
+			const bool shiftByOne = (cellX == m_cellX + 1);
+			m_cellX = cellX;
+			int i = 0;
+			for (int z = m_cellZ - 1; z <= m_cellZ + 1; z++)
+			{
+				for (int y = m_cellY - 1; y <= m_cellY + 1; y++, i += 3)
+				{
+					if (shiftByOne)
+					{
+						m_xs[i] = m_xs[i + 1]; m_ys[i] = m_ys[i + 1]; m_zs[i] = m_zs[i + 1];
+						m_xs[i + 1] = m_xs[i + 2]; m_ys[i + 1] = m_ys[i + 2]; m_zs[i + 1] = m_zs[i + 2];
+						setFeaturePoint(i + 2, cellX + 1, y, z);
+					}
+					else
+					{
+						setFeaturePoint(i, cellX - 1, y, z);
+						setFeaturePoint(i + 1, cellX, y, z);
+						setFeaturePoint(i + 2, cellX + 1, y, z);
+					}
+				}
+			}
+		}
+
+		void setFeaturePoint(int i, int x, int y, int z)
+		{
+			// The point comes from the wrapped cell but is placed relative to the unwrapped one, so distances work across the seam
+			const uint32_t h = hashCell(wrap(x, m_cellCount), wrap(y, m_cellCount), wrap(z, m_cellCount), m_seed);
+			m_xs[i] = x + toUnitFloat(h);
+			m_ys[i] = y + toUnitFloat(hash(h));
+			m_zs[i] = z + toUnitFloat(hash(hash(h)));
+		}
+
+	private:
+		int m_cellCount;
+		uint32_t m_seed;
+		int m_cellX, m_cellY, m_cellZ;
+		alignas(16) float m_xs[28];
+		alignas(16) float m_ys[28];
+		alignas(16) float m_zs[28];
+	};
+
+	// Worley FBM: 3 octaves, each doubling the cell count
+	class WorleyFBMRowEvaluator
+	{
+	public:
+		WorleyFBMRowEvaluator(int baseCellCount, uint32_t seed, uint32_t channel, float py, float pz)
+		{
+			for (uint32_t octave = 0; octave < 3; octave++)
+			{
+				const int cellCount = baseCellCount << octave;
+				m_cellCounts[octave] = cellCount;
+				m_qy[octave] = py * cellCount;
+				m_qz[octave] = pz * cellCount;
+				m_octaves.emplace_back(cellCount, octaveSeed(seed, channel, octave),
+					static_cast<int>(std::floor(m_qy[octave])), static_cast<int>(std::floor(m_qz[octave])));
+			}
+		}
+
+		float evaluate(float px)
+		{
+			float value = 0.0f;
+			for (uint32_t octave = 0; octave < 3; octave++)
+			{
+				const float qx = px * m_cellCounts[octave];
+				value += WEIGHTS[octave] * m_octaves[octave].evaluate(qx, m_qy[octave], m_qz[octave], static_cast<int>(std::floor(qx)));
+			}
+			return value;
+		}
+
+	private:
+		static constexpr float WEIGHTS[3] = { 0.625f, 0.25f, 0.125f };
+		std::vector<WorleyRowEvaluator> m_octaves;
+		int m_cellCounts[3];
+		float m_qy[3];
+		float m_qz[3];
+	};
+	constexpr float WorleyFBMRowEvaluator::WEIGHTS[3];
+
+	inline unsigned char quantize(float value)
+	{
+		return static_cast<unsigned char>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+	}
+
+	//--------------------
+	// Cache
+	//--------------------
+	const uint32_t CACHE_VERSION = 1;
+	struct CacheHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t type;
+		uint32_t resolution;
+		uint32_t seed;
+		uint32_t baseCellCount;
+		uint32_t perlinOctaves;
+		uint64_t byteCount;
+	};
+	CacheHeader createCacheHeader(const CloudNoiseUtil::CloudNoiseParams& params)
+	{
+		CacheHeader header;
+		std::memset(&header, 0, sizeof(header));
+		std::memcpy(header.magic, "MAGENOIS", 8);
+		header.version = CACHE_VERSION;
+		header.type = static_cast<uint32_t>(params.type);
+		header.resolution = params.resolution;
+		header.seed = params.seed;
+		header.baseCellCount = params.baseCellCount;
+		header.perlinOctaves = params.perlinOctaves;
+		header.byteCount = CloudNoiseUtil::volumeSizeInBytes(params);
+		return header;
+	}
+}
+
+size_t CloudNoiseUtil::volumeSizeInBytes(const CloudNoiseParams& params)
+{
+	return static_cast<size_t>(params.resolution) * params.resolution * params.resolution * NUM_CHANNELS;
+}
+
+void CloudNoiseUtil::bakeSlices(const CloudNoiseParams& params, unsigned char* dst, uint32_t sliceBegin, uint32_t sliceEnd)
+{
+	const uint32_t resolution = params.resolution;
+	const int baseCellCount = static_cast<int>(params.baseCellCount);
+	const float invResolution = 1.0f / static_cast<float>(resolution);
+	const size_t rowPitch = static_cast<size_t>(resolution) * NUM_CHANNELS;
+	const size_t slicePitch = rowPitch * resolution;
+
+	for (uint32_t z = sliceBegin; z < sliceEnd; z++)
+	{
+		const float pz = (z + 0.5f) * invResolution;
+		for (uint32_t y = 0; y < resolution; y++)
+		{
+			const float py = (y + 0.5f) * invResolution;
+			unsigned char* row = dst + z * slicePitch + y * rowPitch;
+
+			if (params.type == CLOUD_NOISE_TYPE::LOW_FREQUENCY)
+			{
+				WorleyFBMRowEvaluator worley0(baseCellCount,     params.seed, 1, py, pz);
+				WorleyFBMRowEvaluator worley1(baseCellCount * 2, params.seed, 2, py, pz);
+				WorleyFBMRowEvaluator worley2(baseCellCount * 4, params.seed, 3, py, pz);
+				for (uint32_t x = 0; x < resolution; x++)
+				{
+					const float px = (x + 0.5f) * invResolution;
+					const float worleyFBM0 = worley0.evaluate(px);
+
+					// Perlin-Worley: the perlin FBM remapped into [worley, 1] -- billowy perlin with the worley cells carved in
+					const float perlin = tileablePerlinFBM(px, py, pz, baseCellCount, params.perlinOctaves, params.seed);
+					const float perlinWorley = worleyFBM0 + perlin * (1.0f - worleyFBM0);
+
+					unsigned char* voxel = row + x * NUM_CHANNELS;
+					voxel[0] = quantize(perlinWorley);
+					voxel[1] = quantize(worleyFBM0);
+					voxel[2] = quantize(worley1.evaluate(px));
+					voxel[3] = quantize(worley2.evaluate(px));
+				}
+			}
+			else
+			{
+				WorleyFBMRowEvaluator worley0(baseCellCount,     params.seed, 1, py, pz);
+				WorleyFBMRowEvaluator worley1(baseCellCount * 2, params.seed, 2, py, pz);
+				WorleyFBMRowEvaluator worley2(baseCellCount * 4, params.seed, 3, py, pz);
+				for (uint32_t x = 0; x < resolution; x++)
+				{
+					const float px = (x + 0.5f) * invResolution;
+
+					unsigned char* voxel = row + x * NUM_CHANNELS;
+					voxel[0] = quantize(worley0.evaluate(px));
+					voxel[1] = quantize(worley1.evaluate(px));
+					voxel[2] = quantize(worley2.evaluate(px));
+					voxel[3] = 0;
+				}
+			}
+		}
+	}
+}
+
+void CloudNoiseUtil::bakeVolume(const CloudNoiseParams& params, ThreadPool& threadPool, unsigned char* dst)
+{
+	threadPool.parallelFor(params.resolution, [&](uint32_t slice)
+	{
+		bakeSlices(params, dst, slice, slice + 1);
+	});
+}
+
+std::string CloudNoiseUtil::getCacheFilePath(const CloudNoiseParams& params, const std::string& cacheFolder)
+{
+	const char* typeName = (params.type == CLOUD_NOISE_TYPE::LOW_FREQUENCY) ? "LowFrequency" : "HighFrequency";
+	return cacheFolder + typeName + "_r" + std::to_string(params.resolution) + "_s" + std::to_string(params.seed) +
+		"_c" + std::to_string(params.baseCellCount) + "_o" + std::to_string(params.perlinOctaves) + ".noise";
+}
+
+bool CloudNoiseUtil::readFromCache(const CloudNoiseParams& params, const std::string& cacheFolder, unsigned char* dst)
+{
+	if (cacheFolder.empty())
+	{
+		return false;
+	}
+
+	std::ifstream file(getCacheFilePath(params, cacheFolder), std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	// Anything that doesn't match exactly (older version, different parameters, truncated file) is treated as a miss
+	const CacheHeader expectedHeader = createCacheHeader(params);
+	CacheHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(&header, &expectedHeader, sizeof(header)) != 0)
+	{
+		return false;
+	}
+	return static_cast<bool>(file.read(reinterpret_cast<char*>(dst), static_cast<std::streamsize>(header.byteCount)));
+}
+
+void CloudNoiseUtil::writeToCache(const CloudNoiseParams& params, const std::string& cacheFolder, const unsigned char* src)
+{
+	if (cacheFolder.empty())
+	{
+		return;
+	}
+
+	// A failed write only costs a rebake next time, so it isn't an error
+	std::error_code error;
+	std::filesystem::create_directories(cacheFolder, error);
+	std::ofstream file(getCacheFilePath(params, cacheFolder), std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+#ifndef NDEBUG
+		std::cout << "Could not write the noise cache to " << getCacheFilePath(params, cacheFolder) << std::endl;
+#endif
+		return;
+	}
+
+	const CacheHeader header = createCacheHeader(params);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(src), static_cast<std::streamsize>(header.byteCount));
+}
+
+bool CloudNoiseUtil::benchmarkAndVerifyDeterminism(const CloudNoiseParams& params, uint32_t maxThreads)
+{
+	if (maxThreads == 0)
+	{
+		maxThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	std::vector<uint32_t> threadCounts;
+	for (uint32_t count = 1; count < maxThreads; count *= 2)
+	{
+		threadCounts.push_back(count);
+	}
+	threadCounts.push_back(maxThreads);
+
+	const size_t volumeSize = volumeSizeInBytes(params);
+	const double numVoxels = static_cast<double>(params.resolution) * params.resolution * params.resolution;
+	std::vector<unsigned char> reference;
+	std::vector<unsigned char> volume(volumeSize);
+	bool deterministic = true;
+
+	std::cout << "Noise bake " << ((params.type == CLOUD_NOISE_TYPE::LOW_FREQUENCY) ? "LowFrequency " : "HighFrequency ")
+		<< params.resolution << "^3" << std::endl;
+	for (uint32_t threadCount : threadCounts)
+	{
+		ThreadPool threadPool(threadCount);
+		std::memset(volume.data(), 0, volumeSize);
+
+		TIME_POINT bakeStart = std::chrono::high_resolution_clock::now();
+		bakeVolume(params, threadPool, volume.data());
+		const float bakeTime = TimerUtil::getTimeElapsedSinceStart(bakeStart);
+
+		bool matches = true;
+		if (reference.empty())
+		{
+			reference = volume;
+		}
+		else
+		{
+			matches = (std::memcmp(reference.data(), volume.data(), volumeSize) == 0);
+			deterministic = deterministic && matches;
+		}
+
+		std::cout << "  " << threadCount << " threads: " << bakeTime << " ms, " << numVoxels / (bakeTime / 1000.0) / 1e6
+			<< " Mvoxels/s" << (matches ? "" : " -- MISMATCH with the single threaded bake") << std::endl;
+	}
+
+	return deterministic;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+class ThreadPool;
+
+// CPU baker for the tileable noise volumes the clouds are built from, replaces decoding the LowFrequency / HighFrequency TGA slices.
+// The channel layout matches those slices (RGBA8):
+//	LOW_FREQUENCY  -- R: Perlin-Worley, G B A: Worley FBM at 1x, 2x and 4x the base cell count
+//	HIGH_FREQUENCY -- R G B: Worley FBM at 1x, 2x and 4x the base cell count, A: 0
+// Every voxel is a pure function of its coordinates and the parameters, so the bytes don't depend on how the work is split across threads.
+namespace CloudNoiseUtil
+{
+	enum class CLOUD_NOISE_TYPE { LOW_FREQUENCY, HIGH_FREQUENCY };
+
+	struct CloudNoiseParams
+	{
+		CLOUD_NOISE_TYPE type;
+		uint32_t resolution;	// The volume is resolution^3 voxels
+		uint32_t seed;
+		uint32_t baseCellCount;	// Worley cells and Perlin lattice cells along each axis at the lowest frequency, this is what makes it tile
+		uint32_t perlinOctaves;	// Only used by LOW_FREQUENCY
+	};
+
+	// Same sizes as the textures that ship in Assets/Textures/CloudTextures
+	inline CloudNoiseParams lowFrequencyDefaults() { return { CLOUD_NOISE_TYPE::LOW_FREQUENCY, 128, 0, 4, 5 }; }
+	inline CloudNoiseParams highFrequencyDefaults() { return { CLOUD_NOISE_TYPE::HIGH_FREQUENCY, 32, 0, 2, 0 }; }
+
+	const uint32_t NUM_CHANNELS = 4;
+	size_t volumeSizeInBytes(const CloudNoiseParams& params);
+
+	// Bakes the whole volume into dst (volumeSizeInBytes(params) bytes), one job per slice
+	void bakeVolume(const CloudNoiseParams& params, ThreadPool& threadPool, unsigned char* dst);
+	// Bakes the slices [sliceBegin, sliceEnd) into their place in dst
+	void bakeSlices(const CloudNoiseParams& params, unsigned char* dst, uint32_t sliceBegin, uint32_t sliceEnd);
+
+	// On disk cache keyed by the generator parameters, an empty folder disables it
+	std::string getCacheFilePath(const CloudNoiseParams& params, const std::string& cacheFolder);
+	bool readFromCache(const CloudNoiseParams& params, const std::string& cacheFolder, unsigned char* dst);
+	void writeToCache(const CloudNoiseParams& params, const std::string& cacheFolder, const unsigned char* src);
+
+	// Bakes the volume with 1, 2, 4, ... up to maxThreads threads (0 means every hardware thread) and prints the voxels/s of each.
+	// Returns false if any of the thread counts produced different bytes than the single threaded bake.
+	bool benchmarkAndVerifyDeterminism(const CloudNoiseParams& params, uint32_t maxThreads = 0);
+}
@@ -0,0 +1,339 @@
+#include "cpuProfiler.h"
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+
+#ifdef MAGE_CPU_PROFILER_RDTSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+// Zones per thread that can be written between two endFrame calls before the oldest ones are overwritten
+static const uint32_t ZONES_PER_THREAD = 8192;
+// Upper bound on a capture, ~32 MB of zones
+static const size_t MAX_CAPTURED_ZONES = 1 << 20;
+
+namespace
+{
+	// Single producer ring buffer: only the owning thread writes zones and the depth, only the render thread reads zones.
+	// The writer publishes a zone by bumping m_written (release), the reader copies what was published and afterwards throws away
+	// anything the writer may have lapped while it was copying.
+	struct ThreadBuffer
+	{
+		uint32_t index;
+		std::string name;
+		uint32_t depth = 0;
+		std::array<CpuProfiler::Zone, ZONES_PER_THREAD> zones;
+		std::atomic<uint64_t> written{ 0 };
+		uint64_t read = 0;
+	};
+
+	std::mutex s_threadsMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> s_threads; // Buffers outlive their threads, the index keeps them apart in traces
+	thread_local ThreadBuffer* t_buffer = nullptr;
+
+	// Render thread only
+	std::vector<CpuProfiler::Zone> s_lastFrameZones;
+	uint64_t s_lastFrameBegin = 0;
+	uint64_t s_lastFrameEnd = 0;
+	uint64_t s_numDroppedZones = 0;
+	bool s_capturing = false;
+	uint64_t s_captureBegin = 0;
+	std::vector<CpuProfiler::Zone> s_capturedZones;
+
+#ifdef MAGE_CPU_PROFILER_RDTSC
+	const uint64_t s_tscEpoch = __rdtsc();
+	const std::chrono::steady_clock::time_point s_clockEpoch = std::chrono::steady_clock::now();
+	double s_ticksPerMillisecond = 0.0;
+
+	// The longer the process has been running the more accurate this gets, so it is redone every frame
+	void calibrate()
+	{
+		const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - s_clockEpoch).count();
+		if (elapsedMs > 1.0)
+		{
+			s_ticksPerMillisecond = static_cast<double>(__rdtsc() - s_tscEpoch) / elapsedMs;
+		}
+	}
+#else
+	void calibrate() {}
+#endif
+
+	ThreadBuffer& getThreadBuffer()
+	{
+		if (!t_buffer)
+		{
+			std::lock_guard<std::mutex> lock(s_threadsMutex);
+			s_threads.push_back(std::make_unique<ThreadBuffer>());
+			t_buffer = s_threads.back().get();
+			t_buffer->index = static_cast<uint32_t>(s_threads.size() - 1);
+			t_buffer->name = "Thread " + std::to_string(t_buffer->index);
+		}
+		return *t_buffer;
+	}
+
+	void drain(ThreadBuffer& buffer, std::vector<CpuProfiler::Zone>& out)
+	{
+		const uint64_t written = buffer.written.load(std::memory_order_acquire);
+		const uint64_t first = std::max(buffer.read, (written > ZONES_PER_THREAD) ? written - ZONES_PER_THREAD : 0);
+		s_numDroppedZones += first - buffer.read;
+
+		const size_t outBegin = out.size();
+		for (uint64_t i = first; i < written; i++)
+		{
+			out.push_back(buffer.zones[i % ZONES_PER_THREAD]);
+		}
+
+		// Zones the writer overwrote while they were being copied are torn, drop them
+		const uint64_t writtenAfterCopy = buffer.written.load(std::memory_order_acquire);
+		const uint64_t firstIntact = (writtenAfterCopy > ZONES_PER_THREAD) ? writtenAfterCopy - ZONES_PER_THREAD : 0;
+		if (firstIntact > first)
+		{
+			const uint64_t numTorn = std::min(firstIntact, written) - first;
+			out.erase(out.begin() + outBegin, out.begin() + outBegin + static_cast<size_t>(numTorn));
+			s_numDroppedZones += numTorn;
+		}
+		buffer.read = written;
+	}
+
+	void writeEscaped(std::ofstream& file, const std::string& text)
+	{
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+			{
+				file << '\\';
+			}
+			file << c;
+		}
+	}
+}
+
+std::atomic<bool> CpuProfiler::g_enabled{ false };
+
+void CpuProfiler::setEnabled(bool enabled)
+{
+	g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+uint64_t CpuProfiler::now()
+{
+#ifdef MAGE_CPU_PROFILER_RDTSC
+	return __rdtsc();
+#else
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+double CpuProfiler::ticksToMilliseconds(uint64_t ticks)
+{
+#ifdef MAGE_CPU_PROFILER_RDTSC
+	if (s_ticksPerMillisecond == 0.0)
+	{
+		calibrate();
+	}
+	return (s_ticksPerMillisecond > 0.0) ? static_cast<double>(ticks) / s_ticksPerMillisecond : 0.0;
+#else
+	return static_cast<double>(ticks) / 1e6;
+#endif
+}
+
+void CpuProfiler::setThreadName(const std::string& name)
+{
+	ThreadBuffer& buffer = getThreadBuffer();
+	std::lock_guard<std::mutex> lock(s_threadsMutex);
+	buffer.name = name;
+}
+
+std::vector<CpuProfiler::ThreadInfo> CpuProfiler::getThreads()
+{
+	std::lock_guard<std::mutex> lock(s_threadsMutex);
+	std::vector<ThreadInfo> threads;
+	threads.reserve(s_threads.size());
+	for (const std::unique_ptr<ThreadBuffer>& buffer : s_threads)
+	{
+		threads.push_back({ buffer->index, buffer->name });
+	}
+	return threads;
+}
+
+uint32_t CpuProfiler::pushZone()
+{
+	return getThreadBuffer().depth++;
+}
+
+void CpuProfiler::popZone(const char* name, uint64_t begin, uint32_t depth)
+{
+	const uint64_t end = now();
+	ThreadBuffer& buffer = getThreadBuffer();
+	buffer.depth--;
+
+	const uint64_t index = buffer.written.load(std::memory_order_relaxed);
+	buffer.zones[index % ZONES_PER_THREAD] = { name, begin, end, depth, buffer.index };
+	buffer.written.store(index + 1, std::memory_order_release);
+}
+
+void CpuProfiler::endFrame()
+{
+	const uint64_t frameEnd = now();
+	calibrate();
+
+	std::vector<ThreadBuffer*> buffers;
+	{
+		std::lock_guard<std::mutex> lock(s_threadsMutex);
+		for (const std::unique_ptr<ThreadBuffer>& buffer : s_threads)
+		{
+			buffers.push_back(buffer.get());
+		}
+	}
+
+	s_lastFrameZones.clear();
+	for (ThreadBuffer* buffer : buffers)
+	{
+		drain(*buffer, s_lastFrameZones);
+	}
+	s_lastFrameBegin = (s_lastFrameEnd != 0) ? s_lastFrameEnd : frameEnd;
+	s_lastFrameEnd = frameEnd;
+
+	if (s_capturing)
+	{
+		const size_t numKept = std::min(s_lastFrameZones.size(), MAX_CAPTURED_ZONES - s_capturedZones.size());
+		s_capturedZones.insert(s_capturedZones.end(), s_lastFrameZones.begin(), s_lastFrameZones.begin() + numKept);
+		s_numDroppedZones += s_lastFrameZones.size() - numKept;
+	}
+}
+
+const std::vector<CpuProfiler::Zone>& CpuProfiler::getLastFrameZones()
+{
+	return s_lastFrameZones;
+}
+uint64_t CpuProfiler::getLastFrameBegin()
+{
+	return s_lastFrameBegin;
+}
+uint64_t CpuProfiler::getLastFrameEnd()
+{
+	return s_lastFrameEnd;
+}
+uint64_t CpuProfiler::getNumDroppedZones()
+{
+	return s_numDroppedZones;
+}
+
+void CpuProfiler::beginCapture()
+{
+	s_capturedZones.clear();
+	s_capturing = true;
+	s_captureBegin = now();
+	setEnabled(true);
+}
+bool CpuProfiler::isCapturing()
+{
+	return s_capturing;
+}
+bool CpuProfiler::endCapture(const std::string& path)
+{
+	// Whatever finished since the last frame belongs to the capture as well
+	endFrame();
+	s_capturing = false;
+
+	std::ofstream file(path);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	// Complete events ("ph":"X") with microsecond timestamps relative to the start of the capture
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	for (const ThreadInfo& thread : getThreads())
+	{
+		file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << thread.index << ",\"args\":{\"name\":\"";
+		writeEscaped(file, thread.name);
+		file << "\"}}";
+		first = false;
+	}
+	for (const Zone& zone : s_capturedZones)
+	{
+		const uint64_t begin = std::max(zone.begin, s_captureBegin);
+		file << (first ? "" : ",") << "\n{\"name\":\"";
+		writeEscaped(file, zone.name);
+		file << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << zone.threadIndex
+			<< ",\"ts\":" << ticksToMilliseconds(begin - s_captureBegin) * 1000.0
+			<< ",\"dur\":" << ticksToMilliseconds(zone.end - begin) * 1000.0 << "}";
+		first = false;
+	}
+	file << "\n]}\n";
+
+	s_capturedZones.clear();
+	s_capturedZones.shrink_to_fit();
+	return file.good();
+}
+
+bool CpuProfiler::benchmarkOverhead(uint32_t numIterations, double maxDisabledOverheadNs)
+{
+	const bool wasEnabled = isEnabled();
+	const uint64_t numDroppedZones = s_numDroppedZones;
+	volatile uint64_t sink = 0;
+
+	// Best of a few runs, nanoseconds per iteration
+	auto timeLoop = [&](bool withZone) -> double
+	{
+		double best = 0.0;
+		for (uint32_t run = 0; run < 5; run++)
+		{
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			if (withZone)
+			{
+				for (uint32_t i = 0; i < numIterations; i++)
+				{
+					CPU_PROFILE_SCOPE("Benchmark");
+					sink = sink + i;
+				}
+			}
+			else
+			{
+				for (uint32_t i = 0; i < numIterations; i++)
+				{
+					sink = sink + i;
+				}
+			}
+			const double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / numIterations;
+			best = (run == 0) ? elapsed : std::min(best, elapsed);
+		}
+		return best;
+	};
+
+	const double baseline = timeLoop(false);
+	setEnabled(false);
+	const double disabled = timeLoop(true);
+	setEnabled(true);
+	const double enabled = timeLoop(true);
+	setEnabled(wasEnabled);
+
+	// The enabled runs lapped the ring buffer many times over, none of that is real
+	std::vector<Zone> discarded;
+	drain(getThreadBuffer(), discarded);
+	s_numDroppedZones = numDroppedZones;
+
+	const double disabledOverhead = std::max(0.0, disabled - baseline);
+	const double enabledOverhead = std::max(0.0, enabled - baseline);
+	std::cout << "CPU profiler zone overhead over " << numIterations << " iterations (baseline " << baseline << " ns):" << std::endl;
+	std::cout << "  switched off: " << disabledOverhead << " ns per zone" << std::endl;
+	std::cout << "  switched on:  " << enabledOverhead << " ns per zone" << std::endl;
+
+	const bool withinBudget = (disabledOverhead <= maxDisabledOverheadNs);
+	if (!withinBudget)
+	{
+		std::cout << "  a switched off zone costs more than " << maxDisabledOverheadNs << " ns" << std::endl;
+	}
+	return withinBudget;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Hierarchical CPU scope profiler.
+// CPU_PROFILE_SCOPE("name") times the rest of the enclosing scope on whatever thread it runs on. Zones are appended to a fixed size
+// ring buffer owned by their thread, without locks, and the render thread drains every buffer once per frame in CpuProfiler::endFrame.
+// The drained zones feed the flame view of the last frame and, while a capture is running, a Chrome trace (chrome://tracing, Perfetto).
+//
+// While the profiler is switched off a zone costs one relaxed atomic load and a branch. Defining MAGE_CPU_PROFILER_DISABLED compiles
+// the zones out entirely. Timestamps come from steady_clock, or from the time stamp counter with MAGE_CPU_PROFILER_RDTSC on x86
+// (assumes an invariant TSC, which every x86 CPU of the last decade has).
+//
+// Zone names are stored as pointers, they have to be string literals or otherwise outlive the profiler.
+namespace CpuProfiler
+{
+	struct Zone
+	{
+		const char* name;
+		uint64_t begin; // Ticks, see ticksToMilliseconds
+		uint64_t end;
+		uint32_t depth; // Number of zones open around it on its thread
+		uint32_t threadIndex;
+	};
+
+	struct ThreadInfo
+	{
+		uint32_t index;
+		std::string name;
+	};
+
+	extern std::atomic<bool> g_enabled;
+	inline bool isEnabled() { return g_enabled.load(std::memory_order_relaxed); }
+	void setEnabled(bool enabled);
+
+	uint64_t now();
+	double ticksToMilliseconds(uint64_t ticks);
+
+	// Shows up as the thread's name in traces and in the flame view, the first zone of an unnamed thread calls it "Thread <index>"
+	void setThreadName(const std::string& name);
+	std::vector<ThreadInfo> getThreads();
+
+	// Drains every thread's buffer, call once per frame from the render thread
+	void endFrame();
+	// Zones that ended during the last frame, grouped by thread and in the order they ended
+	const std::vector<Zone>& getLastFrameZones();
+	uint64_t getLastFrameBegin();
+	uint64_t getLastFrameEnd();
+	// Zones a thread wrote faster than endFrame drained them, or that came in while the capture was full
+	uint64_t getNumDroppedZones();
+
+	// Keeps every drained zone from now on, enables the profiler
+	void beginCapture();
+	bool isCapturing();
+	// Stops keeping zones and writes the ones kept since beginCapture in the Chrome trace event format
+	bool endCapture(const std::string& path);
+
+	// Times a tight loop with and without a zone, with the profiler switched off and on, and prints the cost per zone.
+	// Returns false if a switched off zone costs more than maxDisabledOverheadNs.
+	bool benchmarkOverhead(uint32_t numIterations, double maxDisabledOverheadNs);
+
+	// Internal, used by CpuProfileScope
+	uint32_t pushZone();
+	void popZone(const char* name, uint64_t begin, uint32_t depth);
+}
+
+class CpuProfileScope
+{
+public:
+	explicit CpuProfileScope(const char* name)
+		: m_name(nullptr)
+	{
+		if (CpuProfiler::isEnabled())
+		{
+			m_name = name;
+			m_depth = CpuProfiler::pushZone();
+			m_begin = CpuProfiler::now();
+		}
+	}
+	~CpuProfileScope()
+	{
+		// A zone that was opened is closed even if the profiler was switched off in between, so the depths stay balanced
+		if (m_name)
+		{
+			CpuProfiler::popZone(m_name, m_begin, m_depth);
+		}
+	}
+
+	CpuProfileScope(const CpuProfileScope&) = delete;
+	CpuProfileScope& operator=(const CpuProfileScope&) = delete;
+
+private:
+	const char* m_name;
+	uint64_t m_begin;
+	uint32_t m_depth;
+};
+
+#define CPU_PROFILE_CONCAT_INNER(a, b) a##b
+#define CPU_PROFILE_CONCAT(a, b) CPU_PROFILE_CONCAT_INNER(a, b)
+#ifndef MAGE_CPU_PROFILER_DISABLED
+#define CPU_PROFILE_SCOPE(name) CpuProfileScope CPU_PROFILE_CONCAT(l_cpuProfileScope, __LINE__)(name)
+#else
+#define CPU_PROFILE_SCOPE(name)
+#endif
@@ -54,4 +54,129 @@ namespace FormatUtil
 	{
 		return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
 	}
+
+	inline bool isSRGBFormat(VkFormat format)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_R8_SRGB:
+		case VK_FORMAT_R8G8_SRGB:
+		case VK_FORMAT_R8G8B8_SRGB:
+		case VK_FORMAT_B8G8R8_SRGB:
+		case VK_FORMAT_R8G8B8A8_SRGB:
+		case VK_FORMAT_B8G8R8A8_SRGB:
+		case VK_FORMAT_A8B8G8R8_SRGB_PACK32:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// Channel count of formats made of 8 bit channels, 0 for anything else
+	inline uint32_t getNum8BitChannels(VkFormat format)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_R8_UNORM:
+		case VK_FORMAT_R8_SRGB:
+			return 1;
+		case VK_FORMAT_R8G8_UNORM:
+		case VK_FORMAT_R8G8_SRGB:
+			return 2;
+		case VK_FORMAT_R8G8B8A8_UNORM:
+		case VK_FORMAT_R8G8B8A8_SRGB:
+		case VK_FORMAT_B8G8R8A8_UNORM:
+		case VK_FORMAT_B8G8R8A8_SRGB:
+			return 4;
+		default:
+			return 0;
+		}
+	}
+
+	// Texels per block along x and y for the block compressed formats, 1x1 for everything else
+	inline VkExtent2D getBlockExtent(VkFormat format)
+	{
+		if (format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_EAC_R11G11_SNORM_BLOCK)
+		{
+			return { 4, 4 };
+		}
+		if (format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK)
+		{
+			// Every ASTC block size comes as a UNORM and an SRGB format, in this order
+			static const VkExtent2D astcExtents[] = {
+				{ 4, 4 }, { 5, 4 }, { 5, 5 }, { 6, 5 }, { 6, 6 }, { 8, 5 }, { 8, 6 },
+				{ 8, 8 }, { 10, 5 }, { 10, 6 }, { 10, 8 }, { 10, 10 }, { 12, 10 }, { 12, 12 } };
+			return astcExtents[(format - VK_FORMAT_ASTC_4x4_UNORM_BLOCK) / 2];
+		}
+		return { 1, 1 };
+	}
+
+	// Bytes per texel, or per block for the block compressed formats (see getBlockExtent).
+	// Covers the core formats up to ASTC, 0 for anything else, e.g. multi planar formats.
+	inline uint32_t getTexelBlockSize(VkFormat format)
+	{
+		// Each range is one channel layout in all its numeric formats (UNORM, SNORM, ..., SRGB), which share the size
+		if (format == VK_FORMAT_R4G4_UNORM_PACK8) { return 1; }
+		if (format >= VK_FORMAT_R4G4B4A4_UNORM_PACK16 && format <= VK_FORMAT_A1R5G5B5_UNORM_PACK16) { return 2; }
+		if (format >= VK_FORMAT_R8_UNORM && format <= VK_FORMAT_R8_SRGB) { return 1; }
+		if (format >= VK_FORMAT_R8G8_UNORM && format <= VK_FORMAT_R8G8_SRGB) { return 2; }
+		if (format >= VK_FORMAT_R8G8B8_UNORM && format <= VK_FORMAT_B8G8R8_SRGB) { return 3; }
+		if (format >= VK_FORMAT_R8G8B8A8_UNORM && format <= VK_FORMAT_A2B10G10R10_SINT_PACK32) { return 4; }
+		if (format >= VK_FORMAT_R16_UNORM && format <= VK_FORMAT_R16_SFLOAT) { return 2; }
+		if (format >= VK_FORMAT_R16G16_UNORM && format <= VK_FORMAT_R16G16_SFLOAT) { return 4; }
+		if (format >= VK_FORMAT_R16G16B16_UNORM && format <= VK_FORMAT_R16G16B16_SFLOAT) { return 6; }
+		if (format >= VK_FORMAT_R16G16B16A16_UNORM && format <= VK_FORMAT_R16G16B16A16_SFLOAT) { return 8; }
+		if (format >= VK_FORMAT_R32_UINT && format <= VK_FORMAT_R32_SFLOAT) { return 4; }
+		if (format >= VK_FORMAT_R32G32_UINT && format <= VK_FORMAT_R32G32_SFLOAT) { return 8; }
+		if (format >= VK_FORMAT_R32G32B32_UINT && format <= VK_FORMAT_R32G32B32_SFLOAT) { return 12; }
+		if (format >= VK_FORMAT_R32G32B32A32_UINT && format <= VK_FORMAT_R32G32B32A32_SFLOAT) { return 16; }
+		if (format >= VK_FORMAT_R64_UINT && format <= VK_FORMAT_R64_SFLOAT) { return 8; }
+		if (format >= VK_FORMAT_R64G64_UINT && format <= VK_FORMAT_R64G64_SFLOAT) { return 16; }
+		if (format >= VK_FORMAT_R64G64B64_UINT && format <= VK_FORMAT_R64G64B64_SFLOAT) { return 24; }
+		if (format >= VK_FORMAT_R64G64B64A64_UINT && format <= VK_FORMAT_R64G64B64A64_SFLOAT) { return 32; }
+
+		switch (format)
+		{
+		case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+		case VK_FORMAT_E5B9G9R9_UFLOAT_PACK32:
+		case VK_FORMAT_X8_D24_UNORM_PACK32:
+		case VK_FORMAT_D32_SFLOAT:
+		case VK_FORMAT_D24_UNORM_S8_UINT:
+			return 4;
+		case VK_FORMAT_D16_UNORM:
+			return 2;
+		case VK_FORMAT_S8_UINT:
+			return 1;
+		case VK_FORMAT_D16_UNORM_S8_UINT:
+			return 3;
+		case VK_FORMAT_D32_SFLOAT_S8_UINT:
+			return 8;
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		case VK_FORMAT_BC4_UNORM_BLOCK:
+		case VK_FORMAT_BC4_SNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+		case VK_FORMAT_EAC_R11_UNORM_BLOCK:
+		case VK_FORMAT_EAC_R11_SNORM_BLOCK:
+			return 8;
+		default:
+			// The remaining BC, ETC2 / EAC formats and every ASTC format use 128 bit blocks
+			const bool is128BitBlock = (format >= VK_FORMAT_BC2_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK);
+			return is128BitBlock ? 16 : 0;
+		}
+	}
+
+	// Size of one tightly packed mip level, partial blocks at the right and bottom edges take up a whole block
+	inline VkDeviceSize getImageSizeInBytes(VkFormat format, uint32_t width, uint32_t height, uint32_t depth = 1)
+	{
+		const VkExtent2D blockExtent = getBlockExtent(format);
+		const VkDeviceSize blocksX = (width + blockExtent.width - 1) / blockExtent.width;
+		const VkDeviceSize blocksY = (height + blockExtent.height - 1) / blockExtent.height;
+		return blocksX * blocksY * depth * getTexelBlockSize(format);
+	}
 }
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include "heapTracker.h"
+#include <atomic>
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+
+namespace
+{
+	const size_t NUM_TAGS = static_cast<size_t>(HEAP_TAG::COUNT);
+	const char* const s_tagNames[] = { "untagged", "loading", "scene", "renderer", "UI" };
+	static_assert(sizeof(s_tagNames) / sizeof(s_tagNames[0]) == NUM_TAGS, "every heap tag needs a name");
+
+	// Everything here is constant initialized, operator new can run before main
+	struct AtomicTagStats
+	{
+		std::atomic<uint64_t> liveBytes{ 0 };
+		std::atomic<uint64_t> peakBytes{ 0 };
+		std::atomic<uint64_t> numLive{ 0 };
+		std::atomic<uint64_t> numAllocations{ 0 };
+		std::atomic<uint64_t> steadyFrameAllocations{ 0 };
+	};
+
+	std::atomic<bool> s_enabled{ false };
+	AtomicTagStats s_tags[NUM_TAGS];
+	std::atomic<uint64_t> s_frame{ 0 }; // Frames since enabling or resetting
+	std::atomic<uint64_t> s_frameAllocations{ 0 };
+	std::atomic<uint64_t> s_lastFrameAllocations{ 0 };
+	std::atomic<uint64_t> s_numFlagged{ 0 };
+	HeapTracker::FlaggedAllocation s_flagged[HeapTracker::MAX_FLAGGED_ALLOCATIONS];
+
+	thread_local HEAP_TAG t_tag = HEAP_TAG::UNTAGGED;
+	thread_local bool t_renderThread = false;
+
+#ifdef MAGE_HEAP_TRACKER
+	bool isSteadyFrame()
+	{
+		return s_frame.load(std::memory_order_relaxed) >= HeapTracker::STEADY_STATE_FRAMES;
+	}
+
+	// Keeps the pointers handed out aligned like malloc's
+	struct alignas(16) AllocationHeader
+	{
+		uint64_t size;
+		uint32_t tag;
+		uint32_t counted; // Allocated while the tracker was enabled
+	};
+	static_assert(sizeof(AllocationHeader) == 16, "the header has to keep the default new alignment");
+
+	void* trackedAllocate(size_t size)
+	{
+		AllocationHeader* header = static_cast<AllocationHeader*>(std::malloc(sizeof(AllocationHeader) + size));
+		if (!header)
+		{
+			return nullptr;
+		}
+		const HEAP_TAG tag = t_tag;
+		header->size = size;
+		header->tag = static_cast<uint32_t>(tag);
+		header->counted = 0;
+
+		if (s_enabled.load(std::memory_order_relaxed))
+		{
+			header->counted = 1;
+			AtomicTagStats& stats = s_tags[static_cast<size_t>(tag)];
+			const uint64_t liveBytes = stats.liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+			uint64_t peakBytes = stats.peakBytes.load(std::memory_order_relaxed);
+			while (liveBytes > peakBytes && !stats.peakBytes.compare_exchange_weak(peakBytes, liveBytes, std::memory_order_relaxed)) {}
+			stats.numLive.fetch_add(1, std::memory_order_relaxed);
+			stats.numAllocations.fetch_add(1, std::memory_order_relaxed);
+			s_frameAllocations.fetch_add(1, std::memory_order_relaxed);
+
+			if (isSteadyFrame())
+			{
+				stats.steadyFrameAllocations.fetch_add(1, std::memory_order_relaxed);
+				if (t_renderThread)
+				{
+					const uint64_t index = s_numFlagged.fetch_add(1, std::memory_order_relaxed);
+					if (index < HeapTracker::MAX_FLAGGED_ALLOCATIONS)
+					{
+						s_flagged[index] = { tag, size, s_frame.load(std::memory_order_relaxed) };
+					}
+				}
+			}
+		}
+		return header + 1;
+	}
+
+	void trackedFree(void* pointer)
+	{
+		if (!pointer)
+		{
+			return;
+		}
+		AllocationHeader* header = static_cast<AllocationHeader*>(pointer) - 1;
+		if (header->counted)
+		{
+			AtomicTagStats& stats = s_tags[header->tag];
+			stats.liveBytes.fetch_sub(header->size, std::memory_order_relaxed);
+			stats.numLive.fetch_sub(1, std::memory_order_relaxed);
+		}
+		std::free(header);
+	}
+#endif
+}
+
+#ifdef MAGE_HEAP_TRACKER
+// The over-aligned overloads aren't replaced, they allocate and free through their own functions
+void* operator new(std::size_t size)
+{
+	void* pointer = trackedAllocate(size);
+	if (!pointer)
+	{
+		throw std::bad_alloc();
+	}
+	return pointer;
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return trackedAllocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return trackedAllocate(size); }
+void operator delete(void* pointer) noexcept { trackedFree(pointer); }
+void operator delete[](void* pointer) noexcept { trackedFree(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { trackedFree(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { trackedFree(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { trackedFree(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { trackedFree(pointer); }
+#endif
+
+void HeapTracker::setEnabled(bool enabled)
+{
+	s_enabled.store(enabled && isCompiledIn(), std::memory_order_relaxed);
+}
+bool HeapTracker::isEnabled()
+{
+	return s_enabled.load(std::memory_order_relaxed);
+}
+
+void HeapTracker::resetStats()
+{
+	for (AtomicTagStats& stats : s_tags)
+	{
+		stats.peakBytes.store(stats.liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		stats.numAllocations.store(0, std::memory_order_relaxed);
+		stats.steadyFrameAllocations.store(0, std::memory_order_relaxed);
+	}
+	s_frame.store(0, std::memory_order_relaxed);
+	s_frameAllocations.store(0, std::memory_order_relaxed);
+	s_lastFrameAllocations.store(0, std::memory_order_relaxed);
+	s_numFlagged.store(0, std::memory_order_relaxed);
+}
+
+void HeapTracker::endFrame()
+{
+	t_renderThread = true;
+	s_lastFrameAllocations.store(s_frameAllocations.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+	if (isEnabled())
+	{
+		s_frame.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+uint64_t HeapTracker::getNumSteadyFrames()
+{
+	const uint64_t frame = s_frame.load(std::memory_order_relaxed);
+	return (frame > STEADY_STATE_FRAMES) ? frame - STEADY_STATE_FRAMES : 0;
+}
+uint64_t HeapTracker::getLastFrameAllocations()
+{
+	return s_lastFrameAllocations.load(std::memory_order_relaxed);
+}
+
+std::array<HeapTracker::TagStats, static_cast<size_t>(HEAP_TAG::COUNT)> HeapTracker::getStats()
+{
+	std::array<TagStats, NUM_TAGS> stats;
+	for (size_t i = 0; i < NUM_TAGS; i++)
+	{
+		stats[i].liveBytes = s_tags[i].liveBytes.load(std::memory_order_relaxed);
+		stats[i].peakBytes = s_tags[i].peakBytes.load(std::memory_order_relaxed);
+		stats[i].numLive = s_tags[i].numLive.load(std::memory_order_relaxed);
+		stats[i].numAllocations = s_tags[i].numAllocations.load(std::memory_order_relaxed);
+		stats[i].steadyFrameAllocations = s_tags[i].steadyFrameAllocations.load(std::memory_order_relaxed);
+	}
+	return stats;
+}
+
+uint64_t HeapTracker::getNumFlaggedAllocations()
+{
+	return s_numFlagged.load(std::memory_order_relaxed);
+}
+std::array<HeapTracker::FlaggedAllocation, HeapTracker::MAX_FLAGGED_ALLOCATIONS> HeapTracker::getFlaggedAllocations(uint32_t& count)
+{
+	count = static_cast<uint32_t>(std::min<uint64_t>(getNumFlaggedAllocations(), MAX_FLAGGED_ALLOCATIONS));
+	std::array<FlaggedAllocation, MAX_FLAGGED_ALLOCATIONS> flagged;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		flagged[i] = s_flagged[i];
+	}
+	return flagged;
+}
+
+const char* HeapTracker::getTagName(HEAP_TAG tag)
+{
+	return s_tagNames[static_cast<size_t>(tag)];
+}
+
+void HeapTracker::printReport(std::ostream& out)
+{
+	const std::ios_base::fmtflags flags = out.flags();
+	const std::streamsize precision = out.precision();
+	const double toMB = 1.0 / (1024.0 * 1024.0);
+	const uint64_t numSteadyFrames = getNumSteadyFrames();
+
+	out << std::fixed << std::setprecision(2);
+	out << std::left << std::setw(12) << "subsystem" << std::right << std::setw(12) << "live MB" << std::setw(12) << "peak MB"
+		<< std::setw(10) << "live" << std::setw(14) << "allocations" << std::setw(12) << "per frame" << "\n";
+	const std::array<TagStats, NUM_TAGS> stats = getStats();
+	for (size_t i = 0; i < NUM_TAGS; i++)
+	{
+		out << std::left << std::setw(12) << s_tagNames[i] << std::right << std::setw(12) << stats[i].liveBytes * toMB
+			<< std::setw(12) << stats[i].peakBytes * toMB << std::setw(10) << stats[i].numLive << std::setw(14) << stats[i].numAllocations
+			<< std::setw(12) << ((numSteadyFrames > 0) ? static_cast<double>(stats[i].steadyFrameAllocations) / numSteadyFrames : 0.0) << "\n";
+	}
+
+	// Per frame is over the steady state frames and counts every thread, the flagged ones are the render thread's
+	uint32_t numKept = 0;
+	const std::array<FlaggedAllocation, MAX_FLAGGED_ALLOCATIONS> flagged = getFlaggedAllocations(numKept);
+	out << numSteadyFrames << " steady frames, " << getNumFlaggedAllocations() << " allocations on the render thread";
+	out << (numKept > 0 ? ", the first ones:" : "") << "\n";
+	for (uint32_t i = 0; i < numKept; i++)
+	{
+		out << "  frame " << flagged[i].frame << ": " << flagged[i].size << " bytes (" << s_tagNames[static_cast<size_t>(flagged[i].tag)] << ")\n";
+	}
+
+	out.flags(flags);
+	out.precision(precision);
+}
+
+HEAP_TAG HeapTracker::exchangeThreadTag(HEAP_TAG tag)
+{
+	const HEAP_TAG previousTag = t_tag;
+	t_tag = tag;
+	return previousTag;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+enum class HEAP_TAG { UNTAGGED, LOADING, SCENE, RENDERER, UI, COUNT };
+
+// Opt-in accounting of CPU heap allocations per subsystem.
+// Building with MAGE_HEAP_TRACKER replaces the global operator new and delete. Every allocation then carries a 16 byte header with
+// its size and the tag of the innermost HEAP_TRACKER_SCOPE on the allocating thread, and its free is charged to the same tag,
+// whichever thread frees it. Counting only happens while the tracker is enabled, allocations made before are ignored when freed.
+// Without MAGE_HEAP_TRACKER nothing is replaced, the scopes compile to nothing and every stat stays 0.
+//
+// The render thread calls endFrame once per frame. Once the frame loop has settled (STEADY_STATE_FRAMES after enabling or resetting),
+// every allocation the render thread makes is flagged, a steady frame loop shouldn't touch the heap at all.
+namespace HeapTracker
+{
+	static const uint32_t STEADY_STATE_FRAMES = 30;
+	static const uint32_t MAX_FLAGGED_ALLOCATIONS = 32;
+
+	struct TagStats
+	{
+		uint64_t liveBytes = 0;
+		uint64_t peakBytes = 0;
+		uint64_t numLive = 0;
+		uint64_t numAllocations = 0; // Since enabling or resetting
+		uint64_t steadyFrameAllocations = 0; // Made by any thread during steady state frames
+	};
+
+	struct FlaggedAllocation
+	{
+		HEAP_TAG tag;
+		uint64_t size;
+		uint64_t frame;
+	};
+
+	constexpr bool isCompiledIn()
+	{
+#ifdef MAGE_HEAP_TRACKER
+		return true;
+#else
+		return false;
+#endif
+	}
+	void setEnabled(bool enabled);
+	bool isEnabled();
+	// Keeps the live bytes, they still get freed
+	void resetStats();
+
+	// The calling thread becomes the render thread
+	void endFrame();
+	uint64_t getNumSteadyFrames();
+	uint64_t getLastFrameAllocations(); // By any thread
+
+	std::array<TagStats, static_cast<size_t>(HEAP_TAG::COUNT)> getStats();
+	// Render thread allocations in steady state frames, the first MAX_FLAGGED_ALLOCATIONS are kept
+	uint64_t getNumFlaggedAllocations();
+	std::array<FlaggedAllocation, MAX_FLAGGED_ALLOCATIONS> getFlaggedAllocations(uint32_t& count);
+	const char* getTagName(HEAP_TAG tag);
+
+	// Live and peak MB, allocations and allocations per steady frame by tag, then the flagged allocations
+	void printReport(std::ostream& out);
+
+	// Internal, used by HeapTrackerScope
+	HEAP_TAG exchangeThreadTag(HEAP_TAG tag);
+}
+
+class HeapTrackerScope
+{
+public:
+	explicit HeapTrackerScope(HEAP_TAG tag) : m_previousTag(HeapTracker::exchangeThreadTag(tag)) {}
+	~HeapTrackerScope() { HeapTracker::exchangeThreadTag(m_previousTag); }
+
+	HeapTrackerScope(const HeapTrackerScope&) = delete;
+	HeapTrackerScope& operator=(const HeapTrackerScope&) = delete;
+
+private:
+	HEAP_TAG m_previousTag;
+};
+
+#define HEAP_TRACKER_CONCAT_INNER(a, b) a##b
+#define HEAP_TRACKER_CONCAT(a, b) HEAP_TRACKER_CONCAT_INNER(a, b)
+#ifdef MAGE_HEAP_TRACKER
+#define HEAP_TRACKER_SCOPE(tag) HeapTrackerScope HEAP_TRACKER_CONCAT(l_heapTrackerScope, __LINE__)(tag)
+#else
+#define HEAP_TRACKER_SCOPE(tag)
+#endif
@@ -0,0 +1,179 @@
+#include "imageCompareUtility.h"
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+// SSE2 is part of the x86-64 baseline so it is always safe to use there; everything else falls back to the scalar paths
+#if defined(_M_X64) || defined(__SSE2__)
+#define MAGE_IMAGE_COMPARE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	const uint32_t SSIM_WINDOW_SIZE = 8;
+	const uint32_t SSIM_WINDOW_STRIDE = 4;
+	// (0.01 * 255)^2 and (0.03 * 255)^2, keep the ratios stable for flat windows
+	const double SSIM_C1 = 6.5025;
+	const double SSIM_C2 = 58.5225;
+
+	struct WindowSums
+	{
+		double a = 0.0, b = 0.0, aa = 0.0, bb = 0.0, ab = 0.0;
+	};
+
+	void computeLuma(const unsigned char* image, uint32_t width, uint32_t height, std::vector<float>& luma)
+	{
+		luma.resize(static_cast<size_t>(width) * height);
+		for (size_t i = 0; i < luma.size(); i++)
+		{
+			const unsigned char* pixel = image + 4 * i;
+			luma[i] = 0.299f * pixel[0] + 0.587f * pixel[1] + 0.114f * pixel[2];
+		}
+	}
+
+	WindowSums sumWindow(const float* lumaA, const float* lumaB, uint32_t rowPitch, uint32_t windowWidth, uint32_t windowHeight)
+	{
+		WindowSums sums;
+		for (uint32_t y = 0; y < windowHeight; y++)
+		{
+			for (uint32_t x = 0; x < windowWidth; x++)
+			{
+				const double a = lumaA[y * rowPitch + x];
+				const double b = lumaB[y * rowPitch + x];
+				sums.a += a;
+				sums.b += b;
+				sums.aa += a * a;
+				sums.bb += b * b;
+				sums.ab += a * b;
+			}
+		}
+		return sums;
+	}
+
+#ifdef MAGE_IMAGE_COMPARE_SSE2
+	float horizontalSum(__m128 v)
+	{
+		v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+		v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_cvtss_f32(v);
+	}
+
+	// Full 8x8 windows, two 4 wide rows of floats at a time
+	WindowSums sumWindow8x8(const float* lumaA, const float* lumaB, uint32_t rowPitch)
+	{
+		__m128 sumA = _mm_setzero_ps(), sumB = _mm_setzero_ps();
+		__m128 sumAA = _mm_setzero_ps(), sumBB = _mm_setzero_ps(), sumAB = _mm_setzero_ps();
+		for (uint32_t y = 0; y < SSIM_WINDOW_SIZE; y++)
+		{
+			for (uint32_t x = 0; x < SSIM_WINDOW_SIZE; x += 4)
+			{
+				const __m128 a = _mm_loadu_ps(lumaA + y * rowPitch + x);
+				const __m128 b = _mm_loadu_ps(lumaB + y * rowPitch + x);
+				sumA = _mm_add_ps(sumA, a);
+				sumB = _mm_add_ps(sumB, b);
+				sumAA = _mm_add_ps(sumAA, _mm_mul_ps(a, a));
+				sumBB = _mm_add_ps(sumBB, _mm_mul_ps(b, b));
+				sumAB = _mm_add_ps(sumAB, _mm_mul_ps(a, b));
+			}
+		}
+
+		WindowSums sums;
+		sums.a = horizontalSum(sumA);
+		sums.b = horizontalSum(sumB);
+		sums.aa = horizontalSum(sumAA);
+		sums.bb = horizontalSum(sumBB);
+		sums.ab = horizontalSum(sumAB);
+		return sums;
+	}
+#else
+	WindowSums sumWindow8x8(const float* lumaA, const float* lumaB, uint32_t rowPitch)
+	{
+		return sumWindow(lumaA, lumaB, rowPitch, SSIM_WINDOW_SIZE, SSIM_WINDOW_SIZE);
+	}
+#endif
+
+	double windowSSIM(const WindowSums& sums, double numPixels)
+	{
+		const double meanA = sums.a / numPixels;
+		const double meanB = sums.b / numPixels;
+		const double varianceA = std::max(0.0, sums.aa / numPixels - meanA * meanA);
+		const double varianceB = std::max(0.0, sums.bb / numPixels - meanB * meanB);
+		const double covariance = sums.ab / numPixels - meanA * meanB;
+		return ((2.0 * meanA * meanB + SSIM_C1) * (2.0 * covariance + SSIM_C2)) /
+			((meanA * meanA + meanB * meanB + SSIM_C1) * (varianceA + varianceB + SSIM_C2));
+	}
+}
+
+double ImageCompareUtil::computePSNR(const unsigned char* imageA, const unsigned char* imageB, uint32_t width, uint32_t height)
+{
+	uint64_t sumSquaredError = 0;
+	for (uint32_t y = 0; y < height; y++)
+	{
+		const unsigned char* rowA = imageA + static_cast<size_t>(y) * width * 4;
+		const unsigned char* rowB = imageB + static_cast<size_t>(y) * width * 4;
+		uint32_t x = 0;
+
+#ifdef MAGE_IMAGE_COMPARE_SSE2
+		// 4 pixels at a time: widen to 16 bits, subtract and let madd square and pair up the differences.
+		// A lane gains at most 4 * 255^2 per step, so the 32 bit row sums hold rows of up to ~8000 steps.
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i rgbMask = _mm_set1_epi32(0x00FFFFFF);
+		__m128i rowSum = _mm_setzero_si128();
+		for (; x + 4 <= width; x += 4)
+		{
+			const __m128i a = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rowA + 4 * x)), rgbMask);
+			const __m128i b = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rowB + 4 * x)), rgbMask);
+			const __m128i differenceLow = _mm_sub_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+			const __m128i differenceHigh = _mm_sub_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+			rowSum = _mm_add_epi32(rowSum, _mm_madd_epi16(differenceLow, differenceLow));
+			rowSum = _mm_add_epi32(rowSum, _mm_madd_epi16(differenceHigh, differenceHigh));
+		}
+		uint32_t lanes[4];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), rowSum);
+		sumSquaredError += static_cast<uint64_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+#endif
+
+		for (; x < width; x++)
+		{
+			for (uint32_t channel = 0; channel < 3; channel++)
+			{
+				const int difference = static_cast<int>(rowA[4 * x + channel]) - static_cast<int>(rowB[4 * x + channel]);
+				sumSquaredError += static_cast<uint64_t>(difference * difference);
+			}
+		}
+	}
+
+	if (sumSquaredError == 0)
+	{
+		return std::numeric_limits<double>::infinity();
+	}
+	const double meanSquaredError = static_cast<double>(sumSquaredError) / (static_cast<double>(width) * height * 3.0);
+	return 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
+
+double ImageCompareUtil::computeSSIM(const unsigned char* imageA, const unsigned char* imageB, uint32_t width, uint32_t height)
+{
+	std::vector<float> lumaA, lumaB;
+	computeLuma(imageA, width, height, lumaA);
+	computeLuma(imageB, width, height, lumaB);
+
+	if (width < SSIM_WINDOW_SIZE || height < SSIM_WINDOW_SIZE)
+	{
+		return windowSSIM(sumWindow(lumaA.data(), lumaB.data(), width, width, height), static_cast<double>(width) * height);
+	}
+
+	double totalSSIM = 0.0;
+	uint32_t numWindows = 0;
+	for (uint32_t y = 0; y + SSIM_WINDOW_SIZE <= height; y += SSIM_WINDOW_STRIDE)
+	{
+		for (uint32_t x = 0; x + SSIM_WINDOW_SIZE <= width; x += SSIM_WINDOW_STRIDE)
+		{
+			const size_t offset = static_cast<size_t>(y) * width + x;
+			totalSSIM += windowSSIM(sumWindow8x8(lumaA.data() + offset, lumaB.data() + offset, width), SSIM_WINDOW_SIZE * SSIM_WINDOW_SIZE);
+			numWindows++;
+		}
+	}
+	return totalSSIM / numWindows;
+}
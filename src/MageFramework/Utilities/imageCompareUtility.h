@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+
+// Compares two images of the same size, both RGBA8 and tightly packed. The alpha channel is ignored.
+namespace ImageCompareUtil
+{
+	// Peak signal to noise ratio over the RGB channels in dB, infinite if the images are identical
+	double computePSNR(const unsigned char* imageA, const unsigned char* imageB, uint32_t width, uint32_t height);
+
+	// Mean structural similarity of the luma over 8x8 windows placed every 4 pixels, 1 if the images are identical.
+	// Images smaller than a window are compared as a single window.
+	double computeSSIM(const unsigned char* imageA, const unsigned char* imageB, uint32_t width, uint32_t height);
+}
@@ -0,0 +1,330 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+// SSE2 is part of the x86-64 baseline so it is always safe to use there; everything else falls back to the scalar paths
+#if defined(_M_X64) || defined(__SSE2__)
+#define MAGE_IMAGE_PROCESSING_SSE2
+#include <emmintrin.h>
+#endif
+
+// CPU side image manipulation for tightly packed 8 bit RGBA images (the layout STBI_rgb_alpha and the gltf loader produce).
+// These are used to get textures into a common size before they are packed into the layers of a texture array.
+namespace ImageProcessingUtil
+{
+	const uint32_t BYTES_PER_PIXEL = 4;
+
+	inline size_t imageSizeInBytes(uint32_t width, uint32_t height)
+	{
+		return static_cast<size_t>(width) * static_cast<size_t>(height) * BYTES_PER_PIXEL;
+	}
+
+	// Rounds to the closest power of two in log space, i.e. 600 -> 512 and 800 -> 1024
+	inline uint32_t nearestPowerOfTwo(uint32_t value)
+	{
+		if (value <= 1) { return 1; }
+		const int exponent = static_cast<int>(std::lround(std::log2(static_cast<double>(value))));
+		return 1u << exponent;
+	}
+
+#ifdef MAGE_IMAGE_PROCESSING_SSE2
+	inline __m128 loadPixel(const unsigned char* pixel)
+	{
+		int32_t packed;
+		memcpy(&packed, pixel, BYTES_PER_PIXEL);
+		const __m128i zero = _mm_setzero_si128();
+		__m128i widened = _mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero);
+		widened = _mm_unpacklo_epi16(widened, zero);
+		return _mm_cvtepi32_ps(widened);
+	}
+
+	inline void storePixel(unsigned char* pixel, __m128 value)
+	{
+		// cvtps rounds to nearest and the saturating packs clamp to [0, 255]
+		__m128i narrowed = _mm_cvtps_epi32(value);
+		narrowed = _mm_packs_epi32(narrowed, narrowed);
+		narrowed = _mm_packus_epi16(narrowed, narrowed);
+		const int32_t packed = _mm_cvtsi128_si32(narrowed);
+		memcpy(pixel, &packed, BYTES_PER_PIXEL);
+	}
+#endif
+
+	// Averages 2x2 blocks of the source image. Odd dimensions clamp the last row / column.
+	// The output is max(1, width/2) x max(1, height/2)
+	inline void halveImage(const unsigned char* src, uint32_t srcWidth, uint32_t srcHeight, std::vector<unsigned char>& dst)
+	{
+		const uint32_t dstWidth = std::max(1u, srcWidth / 2);
+		const uint32_t dstHeight = std::max(1u, srcHeight / 2);
+		dst.resize(imageSizeInBytes(dstWidth, dstHeight));
+
+		const size_t srcRowPitch = static_cast<size_t>(srcWidth) * BYTES_PER_PIXEL;
+		for (uint32_t y = 0; y < dstHeight; y++)
+		{
+			const uint32_t y0 = std::min(2 * y, srcHeight - 1);
+			const uint32_t y1 = std::min(2 * y + 1, srcHeight - 1);
+			const unsigned char* row0 = src + y0 * srcRowPitch;
+			const unsigned char* row1 = src + y1 * srcRowPitch;
+			unsigned char* dstRow = dst.data() + static_cast<size_t>(y) * dstWidth * BYTES_PER_PIXEL;
+
+			uint32_t x = 0;
+#ifdef MAGE_IMAGE_PROCESSING_SSE2
+			// Two destination pixels per iteration: 4 source pixels (16 bytes) from each of the two source rows
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i rounding = _mm_set1_epi16(2);
+			if (srcWidth >= 2)
+			{
+				for (; x + 2 <= dstWidth && (2 * x + 4) <= srcWidth; x += 2)
+				{
+					const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 2 * x * BYTES_PER_PIXEL));
+					const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 2 * x * BYTES_PER_PIXEL));
+
+					// Vertical sums of pixel pairs, 16 bits per channel
+					const __m128i sumLo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+					const __m128i sumHi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+					// Horizontal sums: the low 4 lanes of each hold one destination pixel
+					const __m128i pixel0 = _mm_add_epi16(sumLo, _mm_srli_si128(sumLo, 8));
+					const __m128i pixel1 = _mm_add_epi16(sumHi, _mm_srli_si128(sumHi, 8));
+
+					__m128i result = _mm_unpacklo_epi64(pixel0, pixel1);
+					result = _mm_srli_epi16(_mm_add_epi16(result, rounding), 2);
+					result = _mm_packus_epi16(result, result);
+					_mm_storel_epi64(reinterpret_cast<__m128i*>(dstRow + x * BYTES_PER_PIXEL), result);
+				}
+			}
+#endif
+			for (; x < dstWidth; x++)
+			{
+				const uint32_t x0 = std::min(2 * x, srcWidth - 1);
+				const uint32_t x1 = std::min(2 * x + 1, srcWidth - 1);
+				for (uint32_t c = 0; c < BYTES_PER_PIXEL; c++)
+				{
+					const uint32_t sum = row0[x0 * BYTES_PER_PIXEL + c] + row0[x1 * BYTES_PER_PIXEL + c]
+						+ row1[x0 * BYTES_PER_PIXEL + c] + row1[x1 * BYTES_PER_PIXEL + c];
+					dstRow[x * BYTES_PER_PIXEL + c] = static_cast<unsigned char>((sum + 2) / 4);
+				}
+			}
+		}
+	}
+
+	// Averages pairs of pixels along a single axis, for images that only need to shrink in one direction.
+	// The output is max(1, width/2) x height when halving the width, width x max(1, height/2) otherwise
+	inline void halveImageAxis(const unsigned char* src, uint32_t srcWidth, uint32_t srcHeight, std::vector<unsigned char>& dst, bool halveWidth)
+	{
+		const uint32_t dstWidth = halveWidth ? std::max(1u, srcWidth / 2) : srcWidth;
+		const uint32_t dstHeight = halveWidth ? srcHeight : std::max(1u, srcHeight / 2);
+		dst.resize(imageSizeInBytes(dstWidth, dstHeight));
+
+		const size_t srcRowPitch = static_cast<size_t>(srcWidth) * BYTES_PER_PIXEL;
+		for (uint32_t y = 0; y < dstHeight; y++)
+		{
+			const uint32_t y0 = halveWidth ? y : std::min(2 * y, srcHeight - 1);
+			const uint32_t y1 = halveWidth ? y : std::min(2 * y + 1, srcHeight - 1);
+			const unsigned char* row0 = src + y0 * srcRowPitch;
+			const unsigned char* row1 = src + y1 * srcRowPitch;
+			unsigned char* dstRow = dst.data() + static_cast<size_t>(y) * dstWidth * BYTES_PER_PIXEL;
+
+			for (uint32_t x = 0; x < dstWidth; x++)
+			{
+				const uint32_t x0 = halveWidth ? std::min(2 * x, srcWidth - 1) : x;
+				const uint32_t x1 = halveWidth ? std::min(2 * x + 1, srcWidth - 1) : x;
+				for (uint32_t c = 0; c < BYTES_PER_PIXEL; c++)
+				{
+					const uint32_t sum = halveWidth ? (row0[x0 * BYTES_PER_PIXEL + c] + row0[x1 * BYTES_PER_PIXEL + c])
+						: (row0[x0 * BYTES_PER_PIXEL + c] + row1[x0 * BYTES_PER_PIXEL + c]);
+					dstRow[x * BYTES_PER_PIXEL + c] = static_cast<unsigned char>((sum + 1) / 2);
+				}
+			}
+		}
+	}
+
+	// Bilinear filter with pixel centers aligned (i.e. the same mapping a GPU sampler uses), edges are clamped.
+	// Only suitable for magnification or minification by less than 2x, use resizeImage for arbitrary ratios.
+	inline void resampleBilinear(const unsigned char* src, uint32_t srcWidth, uint32_t srcHeight,
+		std::vector<unsigned char>& dst, uint32_t dstWidth, uint32_t dstHeight)
+	{
+		dst.resize(imageSizeInBytes(dstWidth, dstHeight));
+
+		const float scaleX = static_cast<float>(srcWidth) / static_cast<float>(dstWidth);
+		const float scaleY = static_cast<float>(srcHeight) / static_cast<float>(dstHeight);
+		const size_t srcRowPitch = static_cast<size_t>(srcWidth) * BYTES_PER_PIXEL;
+
+		// Horizontal taps are the same for every row so compute them once
+		std::vector<uint32_t> tapX0(dstWidth), tapX1(dstWidth);
+		std::vector<float> weightX(dstWidth);
+		for (uint32_t x = 0; x < dstWidth; x++)
+		{
+			const float srcX = std::max(0.0f, (static_cast<float>(x) + 0.5f) * scaleX - 0.5f);
+			const uint32_t x0 = std::min(static_cast<uint32_t>(srcX), srcWidth - 1);
+			tapX0[x] = x0 * BYTES_PER_PIXEL;
+			tapX1[x] = std::min(x0 + 1, srcWidth - 1) * BYTES_PER_PIXEL;
+			weightX[x] = srcX - static_cast<float>(x0);
+		}
+
+		for (uint32_t y = 0; y < dstHeight; y++)
+		{
+			const float srcY = std::max(0.0f, (static_cast<float>(y) + 0.5f) * scaleY - 0.5f);
+			const uint32_t y0 = std::min(static_cast<uint32_t>(srcY), srcHeight - 1);
+			const uint32_t y1 = std::min(y0 + 1, srcHeight - 1);
+			const float wy = srcY - static_cast<float>(y0);
+			const unsigned char* row0 = src + y0 * srcRowPitch;
+			const unsigned char* row1 = src + y1 * srcRowPitch;
+			unsigned char* dstRow = dst.data() + static_cast<size_t>(y) * dstWidth * BYTES_PER_PIXEL;
+
+#ifdef MAGE_IMAGE_PROCESSING_SSE2
+			// One pixel (all 4 channels) per SSE register
+			const __m128 vWy = _mm_set1_ps(wy);
+			for (uint32_t x = 0; x < dstWidth; x++)
+			{
+				const __m128 vWx = _mm_set1_ps(weightX[x]);
+				const __m128 p00 = loadPixel(row0 + tapX0[x]);
+				const __m128 p01 = loadPixel(row0 + tapX1[x]);
+				const __m128 p10 = loadPixel(row1 + tapX0[x]);
+				const __m128 p11 = loadPixel(row1 + tapX1[x]);
+
+				const __m128 top = _mm_add_ps(p00, _mm_mul_ps(_mm_sub_ps(p01, p00), vWx));
+				const __m128 bottom = _mm_add_ps(p10, _mm_mul_ps(_mm_sub_ps(p11, p10), vWx));
+				storePixel(dstRow + x * BYTES_PER_PIXEL, _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), vWy)));
+			}
+#else
+			for (uint32_t x = 0; x < dstWidth; x++)
+			{
+				const float wx = weightX[x];
+				for (uint32_t c = 0; c < BYTES_PER_PIXEL; c++)
+				{
+					const float top = row0[tapX0[x] + c] + (row0[tapX1[x] + c] - row0[tapX0[x] + c]) * wx;
+					const float bottom = row1[tapX0[x] + c] + (row1[tapX1[x] + c] - row1[tapX0[x] + c]) * wx;
+					const float value = top + (bottom - top) * wy;
+					dstRow[x * BYTES_PER_PIXEL + c] = static_cast<unsigned char>(std::min(255.0f, std::max(0.0f, value + 0.5f)));
+				}
+			}
+#endif
+		}
+	}
+
+	// Resizes to any extent. Large reductions are first box filtered by halving (which avoids the aliasing a
+	// plain bilinear minification would introduce) and the remaining < 2x step is handled by the bilinear filter.
+	// Each axis is halved on its own, so a 4096x256 -> 256x256 resize is box filtered along its width as well.
+	inline void resizeImage(const unsigned char* src, uint32_t srcWidth, uint32_t srcHeight,
+		std::vector<unsigned char>& dst, uint32_t dstWidth, uint32_t dstHeight)
+	{
+		if (srcWidth == dstWidth && srcHeight == dstHeight)
+		{
+			dst.assign(src, src + imageSizeInBytes(srcWidth, srcHeight));
+			return;
+		}
+
+		std::vector<unsigned char> current;
+		std::vector<unsigned char> halved;
+		const unsigned char* currentPixels = src;
+		uint32_t currentWidth = srcWidth;
+		uint32_t currentHeight = srcHeight;
+
+		bool shrinkWidth = currentWidth >= 2 * dstWidth;
+		bool shrinkHeight = currentHeight >= 2 * dstHeight;
+		while (shrinkWidth || shrinkHeight)
+		{
+			if (shrinkWidth && shrinkHeight)
+			{
+				halveImage(currentPixels, currentWidth, currentHeight, halved);
+			}
+			else
+			{
+				halveImageAxis(currentPixels, currentWidth, currentHeight, halved, shrinkWidth);
+			}
+			current.swap(halved);
+			currentPixels = current.data();
+			currentWidth = shrinkWidth ? std::max(1u, currentWidth / 2) : currentWidth;
+			currentHeight = shrinkHeight ? std::max(1u, currentHeight / 2) : currentHeight;
+
+			shrinkWidth = currentWidth >= 2 * dstWidth;
+			shrinkHeight = currentHeight >= 2 * dstHeight;
+		}
+
+		if (currentWidth == dstWidth && currentHeight == dstHeight)
+		{
+			dst.swap(current);
+			return;
+		}
+
+		resampleBilinear(currentPixels, currentWidth, currentHeight, dst, dstWidth, dstHeight);
+	}
+
+	// Copies the source image into the top left corner of a bigger image, the rest is filled with opaque black.
+	// Sources bigger than the destination are cropped.
+	inline void padImage(const unsigned char* src, uint32_t srcWidth, uint32_t srcHeight,
+		std::vector<unsigned char>& dst, uint32_t dstWidth, uint32_t dstHeight)
+	{
+		dst.assign(imageSizeInBytes(dstWidth, dstHeight), 0);
+		for (size_t i = 3; i < dst.size(); i += BYTES_PER_PIXEL)
+		{
+			dst[i] = 255;
+		}
+
+		const uint32_t copyWidth = std::min(srcWidth, dstWidth);
+		const uint32_t copyHeight = std::min(srcHeight, dstHeight);
+		for (uint32_t y = 0; y < copyHeight; y++)
+		{
+			memcpy(dst.data() + static_cast<size_t>(y) * dstWidth * BYTES_PER_PIXEL,
+				src + static_cast<size_t>(y) * srcWidth * BYTES_PER_PIXEL,
+				static_cast<size_t>(copyWidth) * BYTES_PER_PIXEL);
+		}
+	}
+
+	//--------------------
+	// Volumes
+	//--------------------
+	// Volumes are tightly packed slices of tightly packed rows with numChannels 8 bit channels per texel (any channel count, not just RGBA)
+
+	inline size_t volumeSizeInBytes(uint32_t width, uint32_t height, uint32_t depth, uint32_t numChannels)
+	{
+		return static_cast<size_t>(width) * height * depth * numChannels;
+	}
+
+	// Averages 2x2x2 blocks of the source volume into the destination slices [dstSliceBegin, dstSliceEnd).
+	// Odd dimensions clamp the last row / column / slice. The full output is max(1, width/2) x max(1, height/2) x max(1, depth/2).
+	// Taking a slice range lets callers spread one mip level across several threads, the ranges write disjoint memory.
+	inline void halveVolumeSlices(const unsigned char* src, uint32_t srcWidth, uint32_t srcHeight, uint32_t srcDepth, uint32_t numChannels,
+		unsigned char* dst, uint32_t dstSliceBegin, uint32_t dstSliceEnd)
+	{
+		const uint32_t dstWidth = std::max(1u, srcWidth / 2);
+		const uint32_t dstHeight = std::max(1u, srcHeight / 2);
+
+		const size_t srcRowPitch = static_cast<size_t>(srcWidth) * numChannels;
+		const size_t srcSlicePitch = srcRowPitch * srcHeight;
+		const size_t dstSlicePitch = static_cast<size_t>(dstWidth) * dstHeight * numChannels;
+
+		for (uint32_t z = dstSliceBegin; z < dstSliceEnd; z++)
+		{
+			const unsigned char* slice0 = src + std::min(2 * z, srcDepth - 1) * srcSlicePitch;
+			const unsigned char* slice1 = src + std::min(2 * z + 1, srcDepth - 1) * srcSlicePitch;
+			unsigned char* dstSlice = dst + z * dstSlicePitch;
+
+			for (uint32_t y = 0; y < dstHeight; y++)
+			{
+				const size_t y0 = std::min(2 * y, srcHeight - 1) * srcRowPitch;
+				const size_t y1 = std::min(2 * y + 1, srcHeight - 1) * srcRowPitch;
+				const unsigned char* rows[4] = { slice0 + y0, slice0 + y1, slice1 + y0, slice1 + y1 };
+				unsigned char* dstRow = dstSlice + static_cast<size_t>(y) * dstWidth * numChannels;
+
+				for (uint32_t x = 0; x < dstWidth; x++)
+				{
+					const size_t x0 = std::min(2 * x, srcWidth - 1) * numChannels;
+					const size_t x1 = std::min(2 * x + 1, srcWidth - 1) * numChannels;
+					for (uint32_t c = 0; c < numChannels; c++)
+					{
+						uint32_t sum = 4;
+						for (const unsigned char* row : rows)
+						{
+							sum += row[x0 + c] + row[x1 + c];
+						}
+						dstRow[x * numChannels + c] = static_cast<unsigned char>(sum / 8);
+					}
+				}
+			}
+		}
+	}
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <Utilities/loadingUtility.h>
+#include <Utilities/threadPool.h>
 
 // Disable Warnings: 
 #pragma warning( disable : 6386 )  // C6386: Buffer overrun possible;
@@ -21,7 +22,8 @@
 
 // Helpers
 void readTinygltfImages( tinygltf::Model& gltfModel, std::vector<std::shared_ptr<Texture2D>>& textures, 
-	VkDevice& logicalDevice, VkPhysicalDevice& pDevice, VkQueue& graphicsQueue, VkCommandPool& commandPool );
+	VkDevice& logicalDevice, VkPhysicalDevice& pDevice, std::shared_ptr<VulkanResourceCache> resourceCache,
+	VkQueue& graphicsQueue, VkCommandPool& commandPool, TextureArrayBuilder* textureArrayBuilder, std::shared_ptr<VulkanUploadQueue> uploadQueue );
 void readTinygltfMaterials( tinygltf::Model& gltfModel, std::vector<vkMaterial*>& materials, std::vector<std::shared_ptr<Texture2D>>& textures,
 	VkDevice& logicalDevice, VkPhysicalDevice& pDevice );
 
@@ -109,6 +111,8 @@ JSONContents loadingUtil::loadJSON(const std::string jsonFilePath)
 
 void loadingUtil::loadImageUsingSTB(const std::string filename, ImageLoaderOutput& out, VkDevice& logicalDevice, VkPhysicalDevice& pDevice)
 {	
+	CPU_PROFILE_SCOPE("Load Image");
+	HEAP_TRACKER_SCOPE(HEAP_TAG::LOADING);
 	std::string str = "../../src/Assets/Textures/";
 	str.append(filename);
 	const char* image_file_path = str.c_str();
@@ -125,11 +129,16 @@ void loadingUtil::loadImageUsingSTB(const std::string filename, ImageLoaderOutpu
 	stbi_image_free(pixels);
 }
 
-void loadingUtil::loadArrayOfImageUsingSTB(std::vector<std::string>& texturePaths, ImageArrayLoaderOutput& out, VkDevice& logicalDevice, VkPhysicalDevice& pDevice)
+void loadingUtil::loadArrayOfImageUsingSTB(std::vector<std::string>& texturePaths, ImageArrayLoaderOutput& out, VkDevice& logicalDevice, VkPhysicalDevice& pDevice,
+	FixTextureFlag fix)
 {
-	VkDeviceSize imageSize = 0;
-	std::vector<unsigned char*> pixelsArray;
-	for (uint32_t layer = 0; layer < texturePaths.size(); layer++)
+	CPU_PROFILE_SCOPE("Load Image Array");
+	HEAP_TRACKER_SCOPE(HEAP_TAG::LOADING);
+	const uint32_t numLayers = static_cast<uint32_t>(texturePaths.size());
+	std::vector<std::vector<unsigned char>> pixelsArray(numLayers);
+	uint32_t maxW = 0, maxH = 0;
+	uint32_t minW = UINT32_MAX, minH = UINT32_MAX;
+	for (uint32_t layer = 0; layer < numLayers; layer++)
 	{
 		std::string str = "../../src/Assets/Textures/";
 		str.append(texturePaths[layer]);
@@ -137,26 +146,237 @@ void loadingUtil::loadArrayOfImageUsingSTB(std::vector<std::string>& texturePath
 
 		// The pointer that is returned is the first element in an array of pixel values. 
 		// The pixels are laid out row by row with 4 bytes per pixel in the case of STBI_rgba_alpha for a total of texWidth * texHeight * 4 values.
-		int imgW, imgH, numChannelsActuallyInImage;;
+		int imgW, imgH, numChannelsActuallyInImage;
 		unsigned char* pixels = stbi_load(image_file_path, &imgW, &imgH, &numChannelsActuallyInImage, STBI_rgb_alpha);
 		if (!pixels) { throw std::runtime_error("failed to load image!"); }
-		pixelsArray.push_back(pixels);
+
+		// Keep our own copy of the pixels; the stb allocation can only be released once the data has been copied out of it
+		pixelsArray[layer].assign(pixels, pixels + ImageProcessingUtil::imageSizeInBytes(imgW, imgH));
 		stbi_image_free(pixels);
 
 		out.imgWidths.push_back(static_cast<uint32_t>(imgW));
 		out.imgHeights.push_back(static_cast<uint32_t>(imgH));
 
-		// Assumption: All images in the array, i.e. all images being loaded are of the same size
-		imageSize = (layer == 0) ? (imgW * imgH * 4) : (imageSize * 2);
+		maxW = std::max(maxW, static_cast<uint32_t>(imgW));
+		maxH = std::max(maxH, static_cast<uint32_t>(imgH));
+		minW = std::min(minW, static_cast<uint32_t>(imgW));
+		minH = std::min(minH, static_cast<uint32_t>(imgH));
+	}
+
+	// All the layers of a texture array have to be the same size
+	const uint32_t desiredW = (fix == FixTextureFlag::SCALE_DOWN) ? minW : maxW;
+	const uint32_t desiredH = (fix == FixTextureFlag::SCALE_DOWN) ? minH : maxH;
+	ImageUtil::fixImagesForTextureArray(fix, desiredW, desiredH, pixelsArray, out.imgWidths, out.imgHeights);
+
+	// The layers are stored back to back in the staging buffer
+	const size_t layerSize = ImageProcessingUtil::imageSizeInBytes(desiredW, desiredH);
+	std::vector<unsigned char> packedPixels(layerSize * numLayers);
+	for (uint32_t layer = 0; layer < numLayers; layer++)
+	{
+		memcpy(packedPixels.data() + layer * layerSize, pixelsArray[layer].data(), layerSize);
+	}
+
+	VkDeviceSize imageSize = static_cast<VkDeviceSize>(packedPixels.size());
+	BufferUtil::createStagingBuffer(logicalDevice, pDevice, packedPixels.data(), out.stagingBuffer, out.stagingBufferMemory, imageSize);
+}
+
+// Builds the 3D mip chain behind mip level 0 of the volume and copies the whole chain into a staging buffer
+static void finishVolume(std::vector<unsigned char>& volume, ThreadPool& threadPool, VolumeLoaderOutput& out,
+	VkDevice& logicalDevice, VkPhysicalDevice& pDevice)
+{
+	for (uint32_t level = 1; level < out.mipLevels; level++)
+	{
+		const uint32_t srcW = std::max(1u, out.width >> (level - 1));
+		const uint32_t srcH = std::max(1u, out.height >> (level - 1));
+		const uint32_t srcD = std::max(1u, out.depth >> (level - 1));
+		const unsigned char* src = volume.data() + out.mipOffsets[level - 1];
+		unsigned char* dst = volume.data() + out.mipOffsets[level];
+
+		// One output slice per job, every level depends on the one before it so the levels themselves stay serial
+		const uint32_t dstD = std::max(1u, srcD / 2);
+		threadPool.parallelFor(dstD, [&](uint32_t z)
+		{
+			ImageProcessingUtil::halveVolumeSlices(src, srcW, srcH, srcD, out.numChannels, dst, z, z + 1);
+		});
+	}
+
+	// The mips are built in regular memory and copied over in one go, reading back from mapped (often write combined) memory is very slow
+	BufferUtil::createStagingBuffer(logicalDevice, pDevice, volume.data(), out.stagingBuffer, out.stagingBufferMemory,
+		static_cast<VkDeviceSize>(volume.size()));
+}
+
+// Sizes the volume allocation for the whole mip chain and fills in the mip offsets
+static void allocateVolume(std::vector<unsigned char>& volume, bool generateMipMaps, VolumeLoaderOutput& out)
+{
+	out.mipLevels = generateMipMaps ?
+		(static_cast<uint32_t>(std::floor(std::log2(std::max(std::max(out.width, out.height), out.depth)))) + 1) : 1;
+
+	out.mipOffsets.resize(out.mipLevels);
+	size_t totalSize = 0;
+	for (uint32_t level = 0; level < out.mipLevels; level++)
+	{
+		out.mipOffsets[level] = static_cast<VkDeviceSize>(totalSize);
+		totalSize += ImageProcessingUtil::volumeSizeInBytes(std::max(1u, out.width >> level), std::max(1u, out.height >> level),
+			std::max(1u, out.depth >> level), out.numChannels);
+	}
+	volume.resize(totalSize);
+}
+
+void loadingUtil::loadVolumeSlicesUsingSTB(const std::vector<std::string>& slicePaths, uint32_t numChannels, bool generateMipMaps,
+	VolumeLoaderOutput& out, VkDevice& logicalDevice, VkPhysicalDevice& pDevice)
+{
+	if (slicePaths.empty()) { throw std::runtime_error("a volume needs at least one slice"); }
+
+	// The first slice decides the size of every slice
+	int sliceW, sliceH, numChannelsActuallyInImage;
+	{
+		std::string str = "../../src/Assets/Textures/";
+		str.append(slicePaths[0]);
+		if (!stbi_info(str.c_str(), &sliceW, &sliceH, &numChannelsActuallyInImage)) { throw std::runtime_error("failed to load image!"); }
+	}
+
+	out.width = static_cast<uint32_t>(sliceW);
+	out.height = static_cast<uint32_t>(sliceH);
+	out.depth = static_cast<uint32_t>(slicePaths.size());
+	out.numChannels = numChannels;
+
+	std::vector<unsigned char> volume;
+	allocateVolume(volume, generateMipMaps, out);
+	const size_t sliceSize = ImageProcessingUtil::volumeSizeInBytes(out.width, out.height, 1, numChannels);
+
+	ThreadPool threadPool(std::min(std::max(1u, std::thread::hardware_concurrency()), out.depth));
+	std::vector<float> sliceDecodeTimes(out.depth, 0.0f);
+
+#ifndef NDEBUG
+	TIME_POINT decodeStart = std::chrono::high_resolution_clock::now();
+#endif
+	threadPool.parallelFor(out.depth, [&](uint32_t slice)
+	{
+		CPU_PROFILE_SCOPE("Decode Slice");
+		TIME_POINT sliceStart = std::chrono::high_resolution_clock::now();
+
+		std::string str = "../../src/Assets/Textures/";
+		str.append(slicePaths[slice]);
+
+		int imgW, imgH, imgChannels;
+		unsigned char* pixels = stbi_load(str.c_str(), &imgW, &imgH, &imgChannels, static_cast<int>(numChannels));
+		if (!pixels) { throw std::runtime_error("failed to load image!"); }
+		if (imgW != sliceW || imgH != sliceH)
+		{
+			stbi_image_free(pixels);
+			throw std::runtime_error("all the slices of a volume need to be the same size");
+		}
+
+		memcpy(volume.data() + slice * sliceSize, pixels, sliceSize);
+		stbi_image_free(pixels);
+
+		sliceDecodeTimes[slice] = TimerUtil::getTimeElapsedSinceStart(sliceStart);
+	});
+
+#ifndef NDEBUG
+	const float decodeTime = TimerUtil::getTimeElapsedSinceStart(decodeStart);
+	TIME_POINT finishStart = std::chrono::high_resolution_clock::now();
+#endif
+	finishVolume(volume, threadPool, out, logicalDevice, pDevice);
+
+#ifndef NDEBUG
+	const float finishTime = TimerUtil::getTimeElapsedSinceStart(finishStart);
+	// The summed per slice decode times are what a serial stb loop would have taken
+	float serialDecodeTime = 0.0f;
+	for (float sliceTime : sliceDecodeTimes) { serialDecodeTime += sliceTime; }
+	const float decodedMB = static_cast<float>(sliceSize * out.depth) / (1024.0f * 1024.0f);
+	std::cout << "Volume " << slicePaths[0] << " (" << out.width << "x" << out.height << "x" << out.depth << "): decoded " << decodedMB
+		<< " MB in " << decodeTime << " ms on " << threadPool.getNumThreads() << " threads (" << decodedMB / (decodeTime / 1000.0f)
+		<< " MB/s), serial stb decode " << serialDecodeTime << " ms (" << decodedMB / (serialDecodeTime / 1000.0f) << " MB/s); "
+		<< out.mipLevels << " mip levels + staging in " << finishTime << " ms" << std::endl;
+#endif
+}
+
+void loadingUtil::loadVolumeAtlasUsingSTB(const std::string filename, uint32_t numChannels, bool generateMipMaps,
+	VolumeLoaderOutput& out, VkDevice& logicalDevice, VkPhysicalDevice& pDevice)
+{
+	std::string str = "../../src/Assets/Textures/";
+	str.append(filename);
+
+	int imgW, imgH, numChannelsActuallyInImage;
+	unsigned char* pixels = stbi_load(str.c_str(), &imgW, &imgH, &numChannelsActuallyInImage, static_cast<int>(numChannels));
+	if (!pixels) { throw std::runtime_error("failed to load image!"); }
+	if (imgH % imgW != 0)
+	{
+		stbi_image_free(pixels);
+		throw std::runtime_error("a volume atlas has to be a vertical strip of square slices");
+	}
+
+	out.width = static_cast<uint32_t>(imgW);
+	out.height = static_cast<uint32_t>(imgW);
+	out.depth = static_cast<uint32_t>(imgH / imgW);
+	out.numChannels = numChannels;
+
+	// Slices stacked vertically are already laid out exactly like a packed volume
+	std::vector<unsigned char> volume;
+	allocateVolume(volume, generateMipMaps, out);
+	memcpy(volume.data(), pixels, ImageProcessingUtil::volumeSizeInBytes(out.width, out.height, out.depth, numChannels));
+	stbi_image_free(pixels);
+
+	ThreadPool threadPool;
+	finishVolume(volume, threadPool, out, logicalDevice, pDevice);
+}
+
+void loadingUtil::loadCloudNoiseVolume(const CloudNoiseUtil::CloudNoiseParams& params, bool generateMipMaps, const std::string& cacheFolder,
+	VolumeLoaderOutput& out, VkDevice& logicalDevice, VkPhysicalDevice& pDevice)
+{
+	out.width = params.resolution;
+	out.height = params.resolution;
+	out.depth = params.resolution;
+	out.numChannels = CloudNoiseUtil::NUM_CHANNELS;
+
+	ThreadPool threadPool;
+#ifndef NDEBUG
+	TIME_POINT bakeStart = std::chrono::high_resolution_clock::now();
+#endif
+
+	if (!generateMipMaps && cacheFolder.empty())
+	{
+		// Nothing has to read the voxels back, so the slices are baked straight into the mapped staging buffer
+		out.mipLevels = 1;
+		out.mipOffsets = { 0 };
+		const VkDeviceSize volumeSize = static_cast<VkDeviceSize>(CloudNoiseUtil::volumeSizeInBytes(params));
+		BufferUtil::createBuffer(logicalDevice, pDevice, out.stagingBuffer, out.stagingBufferMemory, volumeSize,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_SHARING_MODE_EXCLUSIVE,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+		void* mappedData;
+		vkMapMemory(logicalDevice, out.stagingBufferMemory, 0, volumeSize, 0, &mappedData);
+		CloudNoiseUtil::bakeVolume(params, threadPool, static_cast<unsigned char*>(mappedData));
+		vkUnmapMemory(logicalDevice, out.stagingBufferMemory);
+	}
+	else
+	{
+		std::vector<unsigned char> volume;
+		allocateVolume(volume, generateMipMaps, out);
+		if (!CloudNoiseUtil::readFromCache(params, cacheFolder, volume.data()))
+		{
+			CloudNoiseUtil::bakeVolume(params, threadPool, volume.data());
+			CloudNoiseUtil::writeToCache(params, cacheFolder, volume.data());
+		}
+		finishVolume(volume, threadPool, out, logicalDevice, pDevice);
 	}
 
-	BufferUtil::createStagingBuffer(logicalDevice, pDevice, pixelsArray.data(), out.stagingBuffer, out.stagingBufferMemory, imageSize);
+#ifndef NDEBUG
+	std::cout << "Noise volume " << CloudNoiseUtil::getCacheFilePath(params, "") << ": " << out.mipLevels << " mip levels + staging in "
+		<< TimerUtil::getTimeElapsedSinceStart(bakeStart) << " ms on " << threadPool.getNumThreads() << " threads" << std::endl;
+#endif
 }
 
 bool loadingUtil::loadObj(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<std::shared_ptr<Texture2D>>& textures,
 	const std::string meshFilePath, const std::vector<std::string>& textureFilePaths, bool areTexturesMipMapped,
-	VkDevice& logicalDevice, VkPhysicalDevice& pDevice, VkQueue& graphicsQueue, VkCommandPool& commandPool)
+	VkDevice& logicalDevice, VkPhysicalDevice& pDevice, std::shared_ptr<VulkanResourceCache> resourceCache,
+	VkQueue& graphicsQueue, VkCommandPool& commandPool, TextureArrayBuilder* textureArrayBuilder,
+	std::shared_ptr<VulkanUploadQueue> uploadQueue)
 {
+	CPU_PROFILE_SCOPE("Load Obj");
+	HEAP_TRACKER_SCOPE(HEAP_TAG::LOADING);
 	std::string str = "../../src/Assets/Models/obj/";
 	str.append(meshFilePath);
 	const char* obj_file_path = str.c_str();
@@ -166,10 +386,13 @@ bool loadingUtil::loadObj(std::vector<Vertex>& vertices, std::vector<uint32_t>&
 	std::vector<tinyobj::material_t> materials;
 	std::string warn, err;
 
-	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, obj_file_path, nullptr, true))
 	{
-		throw std::runtime_error(err);
-		return false;
+		CPU_PROFILE_SCOPE("Parse Obj");
+		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, obj_file_path, nullptr, true))
+		{
+			throw std::runtime_error(err);
+			return false;
+		}
 	}
 
 	std::unordered_map<Vertex, uint32_t> uniqueVertices = {};
@@ -238,9 +461,35 @@ bool loadingUtil::loadObj(std::vector<Vertex>& vertices, std::vector<uint32_t>&
 	// Textures
 	for (unsigned int i = 0; i < textureFilePaths.size(); i++)
 	{
+		CPU_PROFILE_SCOPE("Obj Texture");
 		std::shared_ptr<Texture2D> texture =
-			std::make_shared<Texture2D>(logicalDevice, pDevice, graphicsQueue, commandPool, VK_FORMAT_R8G8B8A8_UNORM);
-		texture->create2DTexture(textureFilePaths[i], graphicsQueue, commandPool, areTexturesMipMapped);
+			std::make_shared<Texture2D>(logicalDevice, pDevice, resourceCache, graphicsQueue, commandPool, VK_FORMAT_R8G8B8A8_UNORM);
+		texture->setUploadQueue(uploadQueue);
+
+		if (textureArrayBuilder)
+		{
+			// Load the pixels here so they can be handed to the texture array builder first,
+			// a texture it takes is only ever sampled out of its array and is never uploaded on its own
+			std::string texturePath = "../../src/Assets/Textures/";
+			texturePath.append(textureFilePaths[i]);
+
+			int imgW, imgH, numChannelsActuallyInImage;
+			unsigned char* pixels = stbi_load(texturePath.c_str(), &imgW, &imgH, &numChannelsActuallyInImage, STBI_rgb_alpha);
+			if (!pixels) { throw std::runtime_error("failed to load image!"); }
+
+			if (!textureArrayBuilder->addImage(texture.get(), VK_FORMAT_R8G8B8A8_UNORM, imgW, imgH, pixels))
+			{
+				ImageLoaderOutput imgOut = { VK_NULL_HANDLE, VK_NULL_HANDLE, imgW, imgH };
+				VkDeviceSize imageSize = static_cast<VkDeviceSize>(ImageProcessingUtil::imageSizeInBytes(imgW, imgH));
+				BufferUtil::createStagingBuffer(logicalDevice, pDevice, pixels, imgOut.stagingBuffer, imgOut.stagingBufferMemory, imageSize);
+				texture->create2DTexture(imgOut, graphicsQueue, commandPool, areTexturesMipMapped);
+			}
+			stbi_image_free(pixels);
+		}
+		else
+		{
+			texture->create2DTexture(textureFilePaths[i], graphicsQueue, commandPool, areTexturesMipMapped);
+		}
 		textures.push_back(texture);
 	}
 
@@ -258,31 +507,75 @@ bool loadingUtil::loadObj(std::vector<Vertex>& vertices, std::vector<uint32_t>&
 	return true;
 }
 
+namespace
+{
+	std::mutex s_parsedGLTFsMutex;
+	bool s_keepParsedGLTFs = false;
+	std::unordered_map<std::string, std::shared_ptr<tinygltf::Model>> s_parsedGLTFs;
+}
+
+void loadingUtil::setKeepParsedGLTFs(bool keep)
+{
+	std::lock_guard<std::mutex> lock(s_parsedGLTFsMutex);
+	s_keepParsedGLTFs = keep;
+	if (!keep)
+	{
+		s_parsedGLTFs.clear();
+	}
+}
+
 bool loadingUtil::loadGLTF(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices,
 	std::vector<std::shared_ptr<Texture2D>>& textures, std::vector<vkMaterial*>& materials,
 	std::vector<vkNode*>& nodes, std::vector<vkNode*>& linearNodes, 
 	const std::string filename, glm::mat4& transform, uint32_t& primitiveCount, uint32_t& materialCount, unsigned int numFrames,
-	VkDevice& logicalDevice, VkPhysicalDevice& pDevice, VkQueue& graphicsQueue, VkCommandPool& commandPool)
+	VkDevice& logicalDevice, VkPhysicalDevice& pDevice, std::shared_ptr<VulkanResourceCache> resourceCache,
+	VkQueue& graphicsQueue, VkCommandPool& commandPool, TextureArrayBuilder* textureArrayBuilder,
+	std::shared_ptr<VulkanUploadQueue> uploadQueue)
 {
-	tinygltf::Model gltfModel;
-	tinygltf::TinyGLTF gltfLoader;
-	std::string errors, warnings;
-
+	CPU_PROFILE_SCOPE("Load glTF");
+	HEAP_TRACKER_SCOPE(HEAP_TAG::LOADING);
 	std::string str = "../../src/Assets/Models/gltf/";
 	str.append(filename);
 	const char* gltf_file_path = str.c_str();
 
-	bool res = gltfLoader.LoadASCIIFromFile(&gltfModel, &errors, &warnings, gltf_file_path);
-	if (!res) { std::cout << "Failed to load glTF: " << filename << std::endl; }
-	if (!warnings.empty()) { std::cout << "WARNING: " << warnings << std::endl; }
-	if (!errors.empty()) { std::cout << "ERROR: " << errors << std::endl; }
+	// Nothing below modifies the parsed file, so a kept one can be read by several loads
+	std::shared_ptr<tinygltf::Model> parsedModel;
+	{
+		std::lock_guard<std::mutex> lock(s_parsedGLTFsMutex);
+		auto found = s_parsedGLTFs.find(str);
+		if (found != s_parsedGLTFs.end())
+		{
+			parsedModel = found->second;
+		}
+	}
+
+	bool res = true;
+	if (!parsedModel)
+	{
+		CPU_PROFILE_SCOPE("Parse glTF");
+		parsedModel = std::make_shared<tinygltf::Model>();
+		tinygltf::TinyGLTF gltfLoader;
+		std::string errors, warnings;
+		res = gltfLoader.LoadASCIIFromFile(parsedModel.get(), &errors, &warnings, gltf_file_path);
+		if (!res) { std::cout << "Failed to load glTF: " << filename << std::endl; }
+		if (!warnings.empty()) { std::cout << "WARNING: " << warnings << std::endl; }
+		if (!errors.empty()) { std::cout << "ERROR: " << errors << std::endl; }
+
+		std::lock_guard<std::mutex> lock(s_parsedGLTFsMutex);
+		if (res && s_keepParsedGLTFs)
+		{
+			s_parsedGLTFs[str] = parsedModel;
+		}
+	}
+	tinygltf::Model& gltfModel = *parsedModel;
 
 	// Read the data from the loaded in gltf file
 	{
-		readTinygltfImages(gltfModel, textures, logicalDevice, pDevice, graphicsQueue, commandPool);
+		readTinygltfImages(gltfModel, textures, logicalDevice, pDevice, resourceCache, graphicsQueue, commandPool, textureArrayBuilder, uploadQueue);
 		readTinygltfMaterials(gltfModel, materials, textures, logicalDevice, pDevice);
 
 		// Load in the index and vertex buffers
+		CPU_PROFILE_SCOPE("glTF Nodes");
 		std::vector<ImageArrayLoaderOutput::IMAGE_USAGE> imgUsageTypes;
 		const tinygltf::Scene& gltfScene = gltfModel.scenes[gltfModel.defaultScene > -1 ? gltfModel.defaultScene : 0];
 		for (size_t i = 0; i < gltfScene.nodes.size(); i++)
@@ -364,17 +657,21 @@ void loadingUtil::convertObjToNodeStructure(Vertices& vertices, Indices& indices
 //---------------------------------------------------------------
 
 void readTinygltfImages( tinygltf::Model& gltfModel, std::vector<std::shared_ptr<Texture2D>>& textures, 
-	VkDevice& logicalDevice, VkPhysicalDevice& pDevice, VkQueue& graphicsQueue, VkCommandPool& commandPool )
+	VkDevice& logicalDevice, VkPhysicalDevice& pDevice, std::shared_ptr<VulkanResourceCache> resourceCache,
+	VkQueue& graphicsQueue, VkCommandPool& commandPool, TextureArrayBuilder* textureArrayBuilder, std::shared_ptr<VulkanUploadQueue> uploadQueue )
 {
 	for (tinygltf::Image& gltfImage : gltfModel.images)
 	{
+		CPU_PROFILE_SCOPE("glTF Image");
 		VkDeviceSize imageSize = 0;
 		unsigned char* pixels = nullptr;
+		std::vector<unsigned char> rgbaPixels; // Owns the converted pixels until the staging buffer and the texture array builder have copied them
 		if (gltfImage.component == 3) 
 		{
 			// Most devices don't support RGB only on Vulkan so convert if necessary
 			imageSize = gltfImage.width * gltfImage.height * 4;
-			pixels = new unsigned char[imageSize];
+			rgbaPixels.resize(static_cast<size_t>(imageSize));
+			pixels = rgbaPixels.data();
 			unsigned char* rgba = pixels;
 			unsigned char* rgb = &gltfImage.image[0];
 			for (size_t i = 0; i < gltfImage.width * gltfImage.height; i++) 
@@ -382,7 +679,7 @@ void readTinygltfImages( tinygltf::Model& gltfModel, std::vector<std::shared_ptr
 				rgba[i*4 + 0] = rgb[i*3 + 0];
 				rgba[i*4 + 1] = rgb[i*3 + 1];
 				rgba[i*4 + 2] = rgb[i*3 + 2];
-				rgba[i*4 + 3] = static_cast<unsigned char>(1.0f);
+				rgba[i*4 + 3] = 255;
 			}
 		}
 		else
@@ -394,7 +691,15 @@ void readTinygltfImages( tinygltf::Model& gltfModel, std::vector<std::shared_ptr
 		VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
 		uint32_t mipLevels = static_cast<uint32_t>(floor(log2(std::max(gltfImage.width, gltfImage.height))) + 1.0);
 		std::shared_ptr<Texture2D> texture =
-			std::make_shared<Texture2D>(logicalDevice, pDevice, graphicsQueue, commandPool, format,	mipLevels);
+			std::make_shared<Texture2D>(logicalDevice, pDevice, resourceCache, graphicsQueue, commandPool, format,	mipLevels);
+		texture->setUploadQueue(uploadQueue);
+		textures.push_back(texture);
+
+		// A texture the texture array builder takes is only ever sampled out of its array and is never uploaded on its own
+		if (textureArrayBuilder && textureArrayBuilder->addImage(texture.get(), format, gltfImage.width, gltfImage.height, pixels))
+		{
+			continue;
+		}
 
 		VkBuffer stagingBuffer;
 		VkDeviceMemory stagingBufferMemory;
@@ -402,7 +707,6 @@ void readTinygltfImages( tinygltf::Model& gltfModel, std::vector<std::shared_ptr
 
 		ImageLoaderOutput imgOut = { stagingBuffer, stagingBufferMemory, gltfImage.width, gltfImage.height };
 		texture->create2DTexture(imgOut, graphicsQueue, commandPool, true);
-		textures.push_back(texture);
 
 #ifndef NDEBUG
 		//if (gltfImage.name != "")
@@ -491,6 +795,19 @@ void readTinygltfMaterials(tinygltf::Model& gltfModel, std::vector<vkMaterial*>&
 	}
 }
 
+// Buffer views aren't necessarily aligned to the index type, so every index is copied out
+template<typename T>
+void appendGltfIndices(const unsigned char* data, size_t count, uint32_t vertexStart, std::vector<uint32_t>& indices)
+{
+	indices.reserve(indices.size() + count);
+	for (size_t index = 0; index < count; index++)
+	{
+		T value;
+		memcpy(&value, data + index * sizeof(T), sizeof(T));
+		indices.push_back(static_cast<uint32_t>(value) + vertexStart);
+	}
+}
+
 void readTinygltfMesh(tinygltf::Model& gltfModel, tinygltf::Mesh& gltfMesh,
 	vkNode* newNode, std::vector<vkMaterial*>& materials,
 	std::vector<uint32_t>& indices, std::vector<Vertex>& vertices,
@@ -558,38 +875,18 @@ void readTinygltfMesh(tinygltf::Model& gltfModel, tinygltf::Mesh& gltfMesh,
 			const tinygltf::Buffer& buffer = gltfModel.buffers[bufferView.buffer];
 
 			indexCount = static_cast<uint32_t>(indexAccessor.count);
+			const unsigned char* indexData = &buffer.data[indexAccessor.byteOffset + bufferView.byteOffset];
 			switch (indexAccessor.componentType)
 			{
 				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT: 
-				{
-					uint32_t* buf = new uint32_t[indexAccessor.count];
-					memcpy(buf, &buffer.data[indexAccessor.byteOffset + bufferView.byteOffset], indexAccessor.count * sizeof(uint32_t));
-					for (size_t index = 0; index < indexAccessor.count; index++)
-					{
-						indices.push_back(buf[index] + vertexStart);
-					}
+					appendGltfIndices<uint32_t>(indexData, indexAccessor.count, vertexStart, indices);
 					break;
-				}
 				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT: 
-				{
-					uint16_t* buf = new uint16_t[indexAccessor.count];
-					memcpy(buf, &buffer.data[indexAccessor.byteOffset + bufferView.byteOffset], indexAccessor.count * sizeof(uint16_t));
-					for (size_t index = 0; index < indexAccessor.count; index++)
-					{
-						indices.push_back(buf[index] + vertexStart);
-					}
+					appendGltfIndices<uint16_t>(indexData, indexAccessor.count, vertexStart, indices);
 					break;
-				}
 				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE: 
-				{
-					uint8_t* buf = new uint8_t[indexAccessor.count];
-					memcpy(buf, &buffer.data[indexAccessor.byteOffset + bufferView.byteOffset], indexAccessor.count * sizeof(uint8_t));
-					for (size_t index = 0; index < indexAccessor.count; index++)
-					{
-						indices.push_back(buf[index] + vertexStart);
-					}
+					appendGltfIndices<uint8_t>(indexData, indexAccessor.count, vertexStart, indices);
 					break;
-				}
 				default:
 					std::cerr << "Index component type " << indexAccessor.componentType << " not supported!" << std::endl;
 					return;
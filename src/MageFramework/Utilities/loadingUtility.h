@@ -10,6 +10,7 @@
 using json = nlohmann::json;
 
 #include <Utilities/loadingUtilityForward.h>
+#include <Utilities/cloudNoiseUtility.h>
 #include <SceneElements/modelForward.h>
 #include <SceneElements/texture.h>
 #include <SceneElements/model.h>
@@ -34,16 +35,38 @@ namespace loadingUtil
 {
 	// Use STB library to load image into a staging buffer
 	void loadImageUsingSTB(const std::string filename, ImageLoaderOutput& out, VkDevice& logicalDevice, VkPhysicalDevice& pDevice);
-	void loadArrayOfImageUsingSTB(std::vector<std::string>& texturePaths, ImageArrayLoaderOutput& out, VkDevice& logicalDevice, VkPhysicalDevice& pDevice);
+	// Textures of different sizes are brought to a common size using the FixTextureFlag, see ImageUtil::fixImagesForTextureArray
+	void loadArrayOfImageUsingSTB(std::vector<std::string>& texturePaths, ImageArrayLoaderOutput& out, VkDevice& logicalDevice, VkPhysicalDevice& pDevice,
+		FixTextureFlag fix = FixTextureFlag::SCALE_UP);
+	// Decodes the slices in parallel straight into their place in one volume allocation (slice i at i * sliceSize).
+	// Every slice has to have the same size. When generateMipMaps is set the 3D mip chain is built on the CPU in the same allocation.
+	void loadVolumeSlicesUsingSTB(const std::vector<std::string>& slicePaths, uint32_t numChannels, bool generateMipMaps,
+		VolumeLoaderOutput& out, VkDevice& logicalDevice, VkPhysicalDevice& pDevice);
+	// Same as above for a volume stored as one image with its square slices stacked vertically, i.e. height = width * depth
+	void loadVolumeAtlasUsingSTB(const std::string filename, uint32_t numChannels, bool generateMipMaps,
+		VolumeLoaderOutput& out, VkDevice& logicalDevice, VkPhysicalDevice& pDevice);
+	// Bakes one of the cloud noise volumes on the CPU, see CloudNoiseUtil. The cache folder is optional, an empty string disables the cache.
+	// Without mips or a cache the voxels are written straight into the staging buffer.
+	void loadCloudNoiseVolume(const CloudNoiseUtil::CloudNoiseParams& params, bool generateMipMaps, const std::string& cacheFolder,
+		VolumeLoaderOutput& out, VkDevice& logicalDevice, VkPhysicalDevice& pDevice);
 	
+	// With an upload queue the textures are recorded into its open batch, see Texture2D::setUploadQueue.
+	// With a texture array builder the textures it takes are handed to it instead of being uploaded.
 	bool loadObj(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<std::shared_ptr<Texture2D>>& textures,
 		const std::string meshFilePath, const std::vector<std::string>& textureFilePaths, bool areTexturesMipMapped,
-		VkDevice& logicalDevice, VkPhysicalDevice& pDevice, VkQueue& graphicsQueue, VkCommandPool& commandPool);
+		VkDevice& logicalDevice, VkPhysicalDevice& pDevice, std::shared_ptr<VulkanResourceCache> resourceCache,
+		VkQueue& graphicsQueue, VkCommandPool& commandPool, TextureArrayBuilder* textureArrayBuilder = nullptr,
+		std::shared_ptr<VulkanUploadQueue> uploadQueue = nullptr);
+	// Keeps every parsed glTF file, decoded images included, so loading the same file again skips parsing and decoding.
+	// For sweeps that load the same scene over and over, switching it off releases the kept files.
+	void setKeepParsedGLTFs(bool keep);
 	bool loadGLTF(std::vector<Vertex>& vertexBuffer, std::vector<uint32_t>& indexBuffer,
 		std::vector<std::shared_ptr<Texture2D>>& textures, std::vector<vkMaterial*>& materials,
 		std::vector<vkNode*>& nodes, std::vector<vkNode*>& linearNodes,
 		const std::string filename, glm::mat4& transform, uint32_t& primitiveCount, uint32_t& materialCount, unsigned int numFrames,
-		VkDevice& logicalDevice, VkPhysicalDevice& pDevice, VkQueue& graphicsQueue, VkCommandPool& commandPool);
+		VkDevice& logicalDevice, VkPhysicalDevice& pDevice, std::shared_ptr<VulkanResourceCache> resourceCache,
+		VkQueue& graphicsQueue, VkCommandPool& commandPool, TextureArrayBuilder* textureArrayBuilder = nullptr,
+		std::shared_ptr<VulkanUploadQueue> uploadQueue = nullptr);
 
 	void convertObjToNodeStructure(Vertices& vertices, Indices& indices,
 		std::vector<std::shared_ptr<Texture2D>>& textures, std::vector<vkMaterial*>& materials,
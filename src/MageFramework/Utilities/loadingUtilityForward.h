@@ -58,4 +58,14 @@ struct ImageArrayLoaderOutput
 	std::vector<IMAGE_USAGE> imgUsageTypes;
 	std::vector<uint32_t> imgWidths;
 	std::vector<uint32_t> imgHeights;
-};
\ No newline at end of file
+};
+
+struct VolumeLoaderOutput
+{
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+	uint32_t width, height, depth;
+	uint32_t numChannels;
+	uint32_t mipLevels;
+	std::vector<VkDeviceSize> mipOffsets; // Byte offset of each mip level in the staging buffer
+};
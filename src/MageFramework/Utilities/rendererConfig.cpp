@@ -0,0 +1,282 @@
+#include "rendererConfig.h"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+
+using json = nlohmann::json;
+
+namespace
+{
+	const std::pair<RENDER_TYPE, const char*> s_renderTypes[] = {
+		{ RENDER_TYPE::RASTERIZATION, "RASTERIZATION" }, { RENDER_TYPE::RAYTRACE, "RAYTRACE" }, { RENDER_TYPE::HYBRID, "HYBRID" } };
+	const std::pair<VkPresentModeKHR, const char*> s_presentModes[] = {
+		{ VK_PRESENT_MODE_FIFO_KHR, "FIFO" }, { VK_PRESENT_MODE_MAILBOX_KHR, "MAILBOX" }, { VK_PRESENT_MODE_IMMEDIATE_KHR, "IMMEDIATE" } };
+
+	std::string toUpper(std::string text)
+	{
+		std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+		return text;
+	}
+
+	template<typename T, size_t N>
+	T enumFromName(const std::pair<T, const char*>(&names)[N], const std::string& option, const json& value)
+	{
+		if (value.is_string())
+		{
+			const std::string name = toUpper(value.get<std::string>());
+			for (const std::pair<T, const char*>& entry : names)
+			{
+				if (name == entry.second)
+				{
+					return entry.first;
+				}
+			}
+		}
+		throw std::runtime_error("invalid value " + value.dump() + " for " + option);
+	}
+	template<typename T, size_t N>
+	const char* enumName(const std::pair<T, const char*>(&names)[N], T value)
+	{
+		for (const std::pair<T, const char*>& entry : names)
+		{
+			if (entry.first == value)
+			{
+				return entry.second;
+			}
+		}
+		return "UNKNOWN";
+	}
+
+	VkExtent2D parseResolution(const json& value)
+	{
+		if (value.is_array() && value.size() == 2 && value[0].is_number_unsigned() && value[1].is_number_unsigned())
+		{
+			return { value[0].get<uint32_t>(), value[1].get<uint32_t>() };
+		}
+		if (value.is_string())
+		{
+			uint32_t width = 0, height = 0;
+			if (sscanf(value.get<std::string>().c_str(), "%ux%u", &width, &height) == 2 && width > 0 && height > 0)
+			{
+				return { width, height };
+			}
+		}
+		throw std::runtime_error("invalid resolution " + value.dump() + ", expected [width, height] or \"<width>x<height>\"");
+	}
+
+	// Command line values are JSON where they parse as JSON (true, 2, 16.0), anything else is a string (RAYTRACE)
+	json parseValue(const std::string& text)
+	{
+		json value = json::parse(text, nullptr, false);
+		return value.is_discarded() ? json(text) : value;
+	}
+
+	bool isNumber(const std::string& text)
+	{
+		return !text.empty() && std::all_of(text.begin(), text.end(), [](unsigned char c) { return std::isdigit(c) != 0; });
+	}
+}
+
+void RendererConfigUtil::setOption(RendererOptions& options, const std::string& name, const json& value)
+{
+	auto asBool = [&]() -> bool
+	{
+		if (value.is_boolean()) { return value.get<bool>(); }
+		if (value.is_number_integer() && (value.get<int>() == 0 || value.get<int>() == 1)) { return value.get<int>() == 1; }
+		throw std::runtime_error("invalid value " + value.dump() + " for " + name + ", expected true or false");
+	};
+	auto asFloat = [&]() -> float
+	{
+		if (value.is_number()) { return value.get<float>(); }
+		throw std::runtime_error("invalid value " + value.dump() + " for " + name + ", expected a number");
+	};
+	auto asUInt = [&]() -> uint32_t
+	{
+		if (value.is_number_unsigned()) { return value.get<uint32_t>(); }
+		throw std::runtime_error("invalid value " + value.dump() + " for " + name + ", expected a positive integer");
+	};
+
+	if (name == "renderType") { options.renderType = enumFromName(s_renderTypes, name, value); }
+	else if (name == "MSAA") { options.MSAA = asBool(); }
+	else if (name == "FXAA") { options.FXAA = asBool(); }
+	else if (name == "TXAA") { options.TXAA = asBool(); }
+	else if (name == "enableSampleRateShading") { options.enableSampleRateShading = asBool(); }
+	else if (name == "minSampleShading") { options.minSampleShading = asFloat(); }
+	else if (name == "enableAnisotropy") { options.enableAnisotropy = asBool(); }
+	else if (name == "anisotropy") { options.anisotropy = asFloat(); }
+	else if (name == "batchTexturesIntoArrays") { options.batchTexturesIntoArrays = asBool(); }
+	else if (name == "bindlessTextures") { options.bindlessTextures = asBool(); }
+	else if (name == "recordEveryFrame") { options.recordEveryFrame = asBool(); }
+	else if (name == "numRecordingThreads") { options.numRecordingThreads = asUInt(); }
+	else if (name == "timelineSemaphores") { options.timelineSemaphores = asBool(); }
+	else if (name == "framesInFlight") { options.framesInFlight = asUInt(); }
+	else if (name == "presentMode") { options.presentMode = enumFromName(s_presentModes, name, value); }
+	else if (name == "lowLatency") { options.lowLatency = asBool(); }
+	else if (name == "asyncCompute") { options.asyncCompute = asBool(); }
+	else if (name == "dedicatedTransfer") { options.dedicatedTransfer = asBool(); }
+	else if (name == "lateLatchCamera") { options.lateLatchCamera = asBool(); }
+	else
+	{
+		throw std::runtime_error("unknown renderer option " + name);
+	}
+}
+
+json RendererConfigUtil::getOption(const RendererOptions& options, const std::string& name)
+{
+	if (name == "renderType") { return enumName(s_renderTypes, options.renderType); }
+	if (name == "MSAA") { return options.MSAA; }
+	if (name == "FXAA") { return options.FXAA; }
+	if (name == "TXAA") { return options.TXAA; }
+	if (name == "enableSampleRateShading") { return options.enableSampleRateShading; }
+	if (name == "minSampleShading") { return options.minSampleShading; }
+	if (name == "enableAnisotropy") { return options.enableAnisotropy; }
+	if (name == "anisotropy") { return options.anisotropy; }
+	if (name == "batchTexturesIntoArrays") { return options.batchTexturesIntoArrays; }
+	if (name == "bindlessTextures") { return options.bindlessTextures; }
+	if (name == "recordEveryFrame") { return options.recordEveryFrame; }
+	if (name == "numRecordingThreads") { return options.numRecordingThreads; }
+	if (name == "timelineSemaphores") { return options.timelineSemaphores; }
+	if (name == "framesInFlight") { return options.framesInFlight; }
+	if (name == "presentMode") { return enumName(s_presentModes, options.presentMode); }
+	if (name == "lowLatency") { return options.lowLatency; }
+	if (name == "asyncCompute") { return options.asyncCompute; }
+	if (name == "dedicatedTransfer") { return options.dedicatedTransfer; }
+	if (name == "lateLatchCamera") { return options.lateLatchCamera; }
+	throw std::runtime_error("unknown renderer option " + name);
+}
+
+void RendererConfigUtil::loadConfig(const std::string& path, RendererConfig& config)
+{
+	std::ifstream file(path);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("failed to open config " + path);
+	}
+	json j;
+	file >> j;
+
+	for (auto& element : j.items())
+	{
+		const std::string& key = element.key();
+		const json& value = element.value();
+		if (key == "scene") { config.sceneFile = value.get<std::string>(); }
+		else if (key == "resolution") { config.resolution = parseResolution(value); }
+		else if (key == "frames") { config.numFrames = std::max(1u, value.get<uint32_t>()); }
+		else if (key == "headless") { config.headless = value.get<bool>(); }
+		else if (key == "options")
+		{
+			for (auto& option : value.items())
+			{
+				setOption(config.options, option.key(), option.value());
+			}
+		}
+		else if (key == "sweep")
+		{
+			config.sweepOptions.clear();
+			config.sweepResolutions.clear();
+			for (auto& dimension : value.items())
+			{
+				if (!dimension.value().is_array() || dimension.value().empty())
+				{
+					throw std::runtime_error("sweep " + dimension.key() + " needs a non-empty list of values");
+				}
+				if (dimension.key() == "resolution")
+				{
+					for (const json& resolution : dimension.value())
+					{
+						config.sweepResolutions.push_back(parseResolution(resolution));
+					}
+					continue;
+				}
+
+				// Catches typos before anything is loaded
+				RendererOptions validated = config.options;
+				for (const json& option : dimension.value())
+				{
+					setOption(validated, dimension.key(), option);
+				}
+				config.sweepOptions.push_back({ dimension.key(), std::vector<json>(dimension.value().begin(), dimension.value().end()) });
+			}
+		}
+		else
+		{
+			throw std::runtime_error("unknown config entry " + key + " in " + path);
+		}
+	}
+}
+
+void RendererConfigUtil::parseCommandLine(int argc, char** argv, int firstArg, RendererConfig& config)
+{
+	for (int i = firstArg; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		auto nextArg = [&]() -> std::string
+		{
+			if (i + 1 >= argc)
+			{
+				throw std::runtime_error(arg + " needs a value");
+			}
+			return argv[++i];
+		};
+
+		const size_t equals = arg.find('=');
+		if (arg == "--config") { loadConfig(nextArg(), config); }
+		else if (arg == "--scene") { config.sceneFile = nextArg(); }
+		else if (arg == "--resolution") { config.resolution = parseResolution(nextArg()); }
+		else if (arg == "--frames") { config.numFrames = static_cast<uint32_t>(std::max(1, std::atoi(nextArg().c_str()))); }
+		else if (arg == "--headless") { config.headless = true; }
+		else if (equals != std::string::npos && equals > 0) { setOption(config.options, arg.substr(0, equals), parseValue(arg.substr(equals + 1))); }
+		else if (arg.size() > 5 && arg.compare(arg.size() - 5, 5, ".json") == 0) { config.sceneFile = arg; }
+		else if (isNumber(arg)) { config.numFrames = static_cast<uint32_t>(std::max(1, std::atoi(arg.c_str()))); }
+		else
+		{
+			throw std::runtime_error("unknown argument " + arg);
+		}
+	}
+}
+
+std::vector<RendererSweepRun> RendererConfigUtil::expandSweep(const RendererConfig& config)
+{
+	const std::vector<VkExtent2D> resolutions = config.sweepResolutions.empty() ?
+		std::vector<VkExtent2D>{ config.resolution } : config.sweepResolutions;
+
+	std::vector<RendererSweepRun> runs;
+	for (const VkExtent2D& resolution : resolutions)
+	{
+		// Counts through the option values like an odometer, the last option turns fastest
+		std::vector<size_t> indices(config.sweepOptions.size(), 0);
+		while (true)
+		{
+			RendererSweepRun run;
+			run.options = config.options;
+			run.resolution = resolution;
+			if (!config.sweepResolutions.empty())
+			{
+				run.label = std::to_string(resolution.width) + "x" + std::to_string(resolution.height);
+			}
+			for (size_t i = 0; i < config.sweepOptions.size(); i++)
+			{
+				const std::pair<std::string, std::vector<json>>& dimension = config.sweepOptions[i];
+				setOption(run.options, dimension.first, dimension.second[indices[i]]);
+				const json value = getOption(run.options, dimension.first);
+				run.label += (run.label.empty() ? "" : " ") + dimension.first + "=" + (value.is_string() ? value.get<std::string>() : value.dump());
+			}
+			if (run.label.empty())
+			{
+				run.label = "default";
+			}
+			runs.push_back(run);
+
+			size_t dimension = config.sweepOptions.size();
+			while (dimension > 0 && ++indices[dimension - 1] == config.sweepOptions[dimension - 1].second.size())
+			{
+				indices[--dimension] = 0;
+			}
+			if (dimension == 0)
+			{
+				break;
+			}
+		}
+	}
+	return runs;
+}
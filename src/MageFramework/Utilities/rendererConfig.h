@@ -0,0 +1,52 @@
+#pragma once
+#include <global.h>
+#include <string>
+#include <json.hpp>
+
+// What to render and how: the scene, the RendererOptions and optionally a sweep over option values and resolutions.
+// Filled from a JSON config file and the command line, later arguments override earlier ones:
+//
+//   --config <file.json>    { "scene": "...", "resolution": [w, h], "frames": n, "headless": true,
+//                             "options": { "<option>": value, ... },
+//                             "sweep": { "<option>": [values], ..., "resolution": [[w, h], ...] } }
+//   --scene <file.json>     a scene from src/Assets/Scenes, a bare *.json argument does the same
+//   --resolution <w>x<h>    overrides the scene camera's resolution
+//   --frames <n>            frames to measure in headless runs and sweeps, a bare number does the same
+//   --headless
+//   <option>=<value>        any RendererOptions member by name, e.g. renderType=RASTERIZATION FXAA=true framesInFlight=2
+//
+// Enums are given by name (renderType: RASTERIZATION, RAYTRACE; presentMode: FIFO, MAILBOX, IMMEDIATE).
+struct RendererConfig
+{
+	std::string sceneFile = "gltfTest_gltf_and_obj.json";
+	VkExtent2D resolution = { 0, 0 }; // 0 keeps the scene camera's
+	uint32_t numFrames = 300;
+	bool headless = false;
+	RendererOptions options; // Start from defaultRendererOptions()
+
+	// Every combination of these values is one sweep run. The options are sorted by name (JSON objects don't keep their order),
+	// the last one varies fastest and the resolution slowest.
+	std::vector<std::pair<std::string, std::vector<nlohmann::json>>> sweepOptions;
+	std::vector<VkExtent2D> sweepResolutions;
+};
+
+struct RendererSweepRun
+{
+	std::string label; // The swept values of this run, e.g. "1280x720 renderType=RAYTRACE FXAA=true"
+	RendererOptions options;
+	VkExtent2D resolution;
+};
+
+namespace RendererConfigUtil
+{
+	// Throws on unknown options and values of the wrong type
+	void setOption(RendererOptions& options, const std::string& name, const nlohmann::json& value);
+	nlohmann::json getOption(const RendererOptions& options, const std::string& name);
+
+	void loadConfig(const std::string& path, RendererConfig& config);
+	// Parses argv[firstArg] onwards, throws on anything it doesn't understand
+	void parseCommandLine(int argc, char** argv, int firstArg, RendererConfig& config);
+
+	// One run without a sweep
+	std::vector<RendererSweepRun> expandSweep(const RendererConfig& config);
+}
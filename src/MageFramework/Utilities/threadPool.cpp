@@ -0,0 +1,131 @@
+#include "threadPool.h"
+#include "cpuProfiler.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(uint32_t numThreads)
+{
+	if (numThreads == 0)
+	{
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	m_workers.reserve(numThreads);
+	for (uint32_t i = 0; i < numThreads; i++)
+	{
+		m_workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_condition.notify_all();
+
+	// Workers finish whatever is still queued before they exit
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::workerLoop()
+{
+	CpuProfiler::setThreadName("Worker");
+	uint64_t joinedLoopGeneration = 0;
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [&]() { return m_stopping || !m_tasks.empty() || (m_loopOpen && m_loopGeneration != joinedLoopGeneration); });
+			if (m_loopOpen && m_loopGeneration != joinedLoopGeneration)
+			{
+				// A parallelFor goes ahead of the queued tasks, its caller is blocked on it
+				joinedLoopGeneration = m_loopGeneration;
+				m_loop.numBusyWorkers++;
+			}
+			else if (m_tasks.empty())
+			{
+				return;
+			}
+			else
+			{
+				task = std::move(m_tasks.front());
+				m_tasks.pop();
+			}
+		}
+
+		if (!task)
+		{
+			runLoopIndices();
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (--m_loop.numBusyWorkers == 0)
+			{
+				m_loopDone.notify_all();
+			}
+			continue;
+		}
+		task();
+	}
+}
+
+void ThreadPool::runLoopIndices()
+{
+	// Each thread pulls the next index off a shared counter, so uneven work per index still balances out
+	try
+	{
+		for (uint32_t index = m_loop.nextIndex++; index < m_loop.count; index = m_loop.nextIndex++)
+		{
+			m_loop.invoke(m_loop.body, index);
+		}
+	}
+	catch (...)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_loop.exception)
+		{
+			m_loop.exception = std::current_exception();
+		}
+	}
+}
+
+void ThreadPool::runParallelFor(uint32_t count, void (*invoke)(void* body, uint32_t index), void* body)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> serialize(m_parallelForMutex);
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_loop.invoke = invoke;
+		m_loop.body = body;
+		m_loop.count = count;
+		m_loop.nextIndex = 0;
+		m_loop.numBusyWorkers = 0;
+		m_loop.exception = nullptr;
+		m_loopOpen = true;
+		m_loopGeneration++;
+	}
+	m_condition.notify_all();
+
+	// The calling thread would only wait otherwise
+	runLoopIndices();
+
+	std::exception_ptr exception;
+	{
+		// Workers that haven't joined by now would find no indices left, so the loop is closed to them
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_loopOpen = false;
+		m_loopDone.wait(lock, [this]() { return m_loop.numBusyWorkers == 0; });
+		exception = m_loop.exception;
+		m_loop.exception = nullptr;
+	}
+	if (exception)
+	{
+		std::rethrow_exception(exception);
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <type_traits>
+
+// Fixed size pool of worker threads for CPU side work like decoding images.
+// Tasks are run in the order they were submitted, exceptions thrown by a task are handed back through its future.
+class ThreadPool
+{
+public:
+	// numThreads == 0 uses one thread per hardware thread
+	explicit ThreadPool(uint32_t numThreads = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	template<typename F>
+	std::future<void> submit(F&& task)
+	{
+		std::shared_ptr<std::packaged_task<void()>> packagedTask = std::make_shared<std::packaged_task<void()>>(std::forward<F>(task));
+		std::future<void> future = packagedTask->get_future();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_tasks.push([packagedTask]() { (*packagedTask)(); });
+		}
+		m_condition.notify_one();
+		return future;
+	}
+
+	// Calls body(i) for every i in [0, count) spread across the workers and the calling thread, and blocks until all of them are done.
+	// The first exception thrown by body is rethrown here once every worker has stopped.
+	// Nothing is allocated per call: body is only referenced and the workers pick the loop up from the pool itself, so this is
+	// cheap enough to run every frame. Calls from several threads take turns. Must not be called from inside one of this pool's own tasks.
+	template<typename F>
+	void parallelFor(uint32_t count, F&& body)
+	{
+		using Body = typename std::remove_reference<F>::type;
+		runParallelFor(count, [](void* loopBody, uint32_t index) { (*static_cast<Body*>(loopBody))(index); },
+			const_cast<void*>(static_cast<const void*>(&body)));
+	}
+
+	uint32_t getNumThreads() const { return static_cast<uint32_t>(m_workers.size()); }
+
+private:
+	// The loop parallelFor is running, the workers join it instead of picking up queued tasks
+	struct ParallelForLoop
+	{
+		void (*invoke)(void* body, uint32_t index) = nullptr;
+		void* body = nullptr;
+		uint32_t count = 0;
+		std::atomic<uint32_t> nextIndex{ 0 };
+		uint32_t numBusyWorkers = 0;
+		std::exception_ptr exception;
+	};
+
+	void workerLoop();
+	void runParallelFor(uint32_t count, void (*invoke)(void* body, uint32_t index), void* body);
+	void runLoopIndices();
+
+private:
+	std::vector<std::thread> m_workers;
+	std::queue<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_stopping = false;
+
+	std::mutex m_parallelForMutex; // One parallelFor at a time
+	ParallelForLoop m_loop;
+	uint64_t m_loopGeneration = 0; // Bumped for every loop so a worker joins each one at most once
+	bool m_loopOpen = false;
+	std::condition_variable m_loopDone;
+};
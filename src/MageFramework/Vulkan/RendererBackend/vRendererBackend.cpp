@@ -1,10 +1,10 @@
 #include "Vulkan/RendererBackend/vRendererBackend.h"
 
 VulkanRendererBackend::VulkanRendererBackend(std::shared_ptr<VulkanManager> vulkanManager, 
-	RendererOptions& rendererOptions, int numSwapChainImages, VkExtent2D windowExtents) :
+	RendererOptions& rendererOptions, int numFramesInFlight, VkExtent2D windowExtents) :
 	m_vulkanManager(vulkanManager), m_logicalDevice(vulkanManager->getLogicalDevice()), m_physicalDevice(vulkanManager->getPhysicalDevice()),
 	m_graphicsQueue(vulkanManager->getQueue(QueueFlags::Graphics)), m_computeQueue(vulkanManager->getQueue(QueueFlags::Compute)),
-	m_rendererOptions(rendererOptions), m_numSwapChainImages(numSwapChainImages), m_windowExtents(windowExtents)
+	m_rendererOptions(rendererOptions), m_numFramesInFlight(numFramesInFlight), m_windowExtents(windowExtents)
 {
 	m_highResolutionRenderFormat = VK_FORMAT_R32G32B32A32_SFLOAT;
 	m_lowResolutionRenderFormat = m_vulkanManager->getSwapChainImageFormat();
@@ -15,38 +15,56 @@ VulkanRendererBackend::VulkanRendererBackend(std::shared_ptr<VulkanManager> vulk
 		getRayTracingFunctionPointers();
 	}
 
+	m_gpuProfiler = m_vulkanManager->getGpuProfiler();
+	m_computeProfilerPass = m_gpuProfiler->registerPass("Compute", QueueFlags::Compute);
+
 	createCommandPoolsAndBuffers();
 	createRenderPassesAndFrameResources();
 }
 VulkanRendererBackend::~VulkanRendererBackend()
 {
-	vkDeviceWaitIdle(m_logicalDevice);
-
-	// Destroy Sync Objects
-	const uint32_t numFrames = m_vulkanManager->getSwapChainImageCount();
-	for (size_t i = 0; i < numFrames; i++)
+	// Nothing here waits on the device, the objects go once the frames that may still use them have finished
+	std::vector<VkCommandPool> cmdPools = { m_graphicsCmdPool, m_computeCmdPool };
+	for (FrameCommandBuffers& frame : m_frameCommandBuffers)
 	{
-		vkDestroySemaphore(m_logicalDevice, m_renderOperationsFinishedSemaphores[i], nullptr);
-		vkDestroySemaphore(m_logicalDevice, m_computeOperationsFinishedSemaphores[i], nullptr);
-		vkDestroySemaphore(m_logicalDevice, m_postProcessFinishedSemaphores[i], nullptr);
+		cmdPools.push_back(frame.graphicsCmdPool);
+		cmdPools.push_back(frame.computeCmdPool);
+	}
+	for (std::vector<VkCommandPool>& frameCmdPools : m_secondaryGraphicsCmdPools)
+	{
+		cmdPools.insert(cmdPools.end(), frameCmdPools.begin(), frameCmdPools.end());
 	}
 
-	// Destroy Command Pools
-	vkDestroyCommandPool(m_logicalDevice, m_graphicsCmdPool, nullptr);
-	vkDestroyCommandPool(m_logicalDevice, m_computeCmdPool, nullptr);
-
-	// Descriptor Pool
-	vkDestroyDescriptorPool(m_logicalDevice, m_descriptorPool, nullptr);
-
-	// Descriptor Set Layouts
-	vkDestroyDescriptorSetLayout(m_logicalDevice, m_DSL_rayTrace, nullptr);
+	std::vector<VkDescriptorSetLayout> descriptorSetLayouts = { m_DSL_rayTrace };
 	for (PostProcessDescriptors postProcessDescriptor_specific : m_postProcessDescriptorsSpecific) {
-		vkDestroyDescriptorSetLayout(m_logicalDevice, postProcessDescriptor_specific.postProcess_DSL, nullptr);
+		descriptorSetLayouts.push_back(postProcessDescriptor_specific.postProcess_DSL);
 	}
 	for (PostProcessDescriptors postProcessDescriptor_common : m_postProcessDescriptorsCommon)	{
-		vkDestroyDescriptorSetLayout(m_logicalDevice, postProcessDescriptor_common.postProcess_DSL, nullptr);
+		descriptorSetLayouts.push_back(postProcessDescriptor_common.postProcess_DSL);
 	}
 
+	VkDevice logicalDevice = m_logicalDevice;
+	m_vulkanManager->deferDestruction([logicalDevice, semaphores = m_computeOperationsFinishedSemaphores, cmdPools, descriptorPool = m_descriptorPool, descriptorSetLayouts]()
+	{
+		// Destroy Sync Objects
+		for (VkSemaphore semaphore : semaphores)
+		{
+			vkDestroySemaphore(logicalDevice, semaphore, nullptr);
+		}
+		// Destroy Command Pools, the command buffers allocated from them go with them
+		for (VkCommandPool cmdPool : cmdPools)
+		{
+			vkDestroyCommandPool(logicalDevice, cmdPool, nullptr);
+		}
+		// Descriptor Pool
+		vkDestroyDescriptorPool(logicalDevice, descriptorPool, nullptr);
+		// Descriptor Set Layouts
+		for (VkDescriptorSetLayout descriptorSetLayout : descriptorSetLayouts)
+		{
+			vkDestroyDescriptorSetLayout(logicalDevice, descriptorSetLayout, nullptr);
+		}
+	});
+
 	if (m_rendererOptions.renderType == RENDER_TYPE::RAYTRACE)
 	{
 		destroyRayTracing();
@@ -54,13 +72,21 @@ VulkanRendererBackend::~VulkanRendererBackend()
 }
 void VulkanRendererBackend::cleanup()
 {
-	vkDeviceWaitIdle(m_logicalDevice);
-
-	// Command Buffers
-	vkFreeCommandBuffers(m_logicalDevice, m_computeCmdPool, static_cast<uint32_t>(m_computeCommandBuffers.size()), m_computeCommandBuffers.data());
-	vkFreeCommandBuffers(m_logicalDevice, m_graphicsCmdPool, static_cast<uint32_t>(m_graphicsCommandBuffers.size()), m_graphicsCommandBuffers.data());
-	vkFreeCommandBuffers(m_logicalDevice, m_graphicsCmdPool, static_cast<uint32_t>(m_rayTracingCommandBuffers.size()), m_rayTracingCommandBuffers.data());
-	vkFreeCommandBuffers(m_logicalDevice, m_graphicsCmdPool, static_cast<uint32_t>(m_postProcessCommandBuffers.size()), m_postProcessCommandBuffers.data());
+	// Command Buffers -- the ones recorded every frame stay allocated in their transient pools.
+	// The frames in flight may still execute them, so they are freed once those frames have finished.
+	if (!m_rendererOptions.recordEveryFrame)
+	{
+		VkDevice logicalDevice = m_logicalDevice;
+		m_vulkanManager->deferDestruction([logicalDevice, computeCmdPool = m_computeCmdPool, graphicsCmdPool = m_graphicsCmdPool,
+			computeCommandBuffers = m_computeCommandBuffers, graphicsCommandBuffers = m_graphicsCommandBuffers,
+			rayTracingCommandBuffers = m_rayTracingCommandBuffers, postProcessCommandBuffers = m_postProcessCommandBuffers]()
+		{
+			vkFreeCommandBuffers(logicalDevice, computeCmdPool, static_cast<uint32_t>(computeCommandBuffers.size()), computeCommandBuffers.data());
+			vkFreeCommandBuffers(logicalDevice, graphicsCmdPool, static_cast<uint32_t>(graphicsCommandBuffers.size()), graphicsCommandBuffers.data());
+			vkFreeCommandBuffers(logicalDevice, graphicsCmdPool, static_cast<uint32_t>(rayTracingCommandBuffers.size()), rayTracingCommandBuffers.data());
+			vkFreeCommandBuffers(logicalDevice, graphicsCmdPool, static_cast<uint32_t>(postProcessCommandBuffers.size()), postProcessCommandBuffers.data());
+		});
+	}
 
 	cleanupPipelines();
 	cleanupRenderPassesAndFrameResources();
@@ -110,7 +136,7 @@ void VulkanRendererBackend::createAllPostProcessEffects(std::shared_ptr<Scene> s
 			const DSL_TYPE inputToBeRead = DSL_TYPE::BEFOREPOST_FRAME;
 			effectDSL.push_back(getDescriptorSetLayout(inputToBeRead));
 			effectDSL.push_back(scene->getDescriptorSetLayout(DSL_TYPE::COMPUTE));
-			for (uint32_t j = 0; j < m_numSwapChainImages; j++)
+			for (uint32_t j = 0; j < m_numFramesInFlight; j++)
 			{
 				postRPI.descriptors.push_back(getDescriptorSet(inputToBeRead, j));
 				postRPI.descriptors.push_back(scene->getDescriptorSet(DSL_TYPE::COMPUTE, j));
@@ -124,7 +150,7 @@ void VulkanRendererBackend::createAllPostProcessEffects(std::shared_ptr<Scene> s
 			std::vector<VkDescriptorSetLayout> effectDSL;
 			const DSL_TYPE inputToBeRead = chooseHighResInput();
 			effectDSL.push_back(getDescriptorSetLayout(inputToBeRead));
-			for (uint32_t j = 0; j < m_numSwapChainImages; j++)
+			for (uint32_t j = 0; j < m_numFramesInFlight; j++)
 			{
 				postRPI.descriptors.push_back(getDescriptorSet(inputToBeRead, j));
 			}
@@ -140,7 +166,7 @@ void VulkanRendererBackend::createAllPostProcessEffects(std::shared_ptr<Scene> s
 		effectDSL.push_back(getDescriptorSetLayout(inputToBeRead));
 		effectDSL.push_back(scene->getDescriptorSetLayout(DSL_TYPE::TIME));
 		// effectDSL.push_back(m_postProcessDescriptorsSpecific[postProcessIndex].postProcess_DSL);
-		for (uint32_t j = 0; j < m_numSwapChainImages; j++)
+		for (uint32_t j = 0; j < m_numFramesInFlight; j++)
 		{
 			postRPI.descriptors.push_back(getDescriptorSet(inputToBeRead, j));
 			postRPI.descriptors.push_back(scene->getDescriptorSet(DSL_TYPE::TIME, j));
@@ -149,6 +175,8 @@ void VulkanRendererBackend::createAllPostProcessEffects(std::shared_ptr<Scene> s
 
 		shaderConstants.toneMap_Exposure = 1.0f;
 		shaderConstants.toneMap_WhitePoint = 1.0f;
+		// The low resolution passes and the swapchain share a format, an sRGB one already gamma encodes when it's written to
+		shaderConstants.toneMap_EncodeGamma = FormatUtil::isSRGBFormat(m_lowResolutionRenderFormat) ? 0.0f : 1.0f;
 	}
 
 	// Add Low Resolution Passes
@@ -159,7 +187,7 @@ void VulkanRendererBackend::createAllPostProcessEffects(std::shared_ptr<Scene> s
 			std::vector<VkDescriptorSetLayout> effectDSL;
 			const DSL_TYPE inputToBeRead = chooseLowResInput();
 			effectDSL.push_back(getDescriptorSetLayout(inputToBeRead));
-			for (uint32_t j = 0; j < m_numSwapChainImages; j++)
+			for (uint32_t j = 0; j < m_numFramesInFlight; j++)
 			{
 				postRPI.descriptors.push_back(getDescriptorSet(inputToBeRead, j));
 			}
@@ -172,17 +200,19 @@ void VulkanRendererBackend::createAllPostProcessEffects(std::shared_ptr<Scene> s
 			std::vector<VkDescriptorSetLayout> effectDSL;
 			const DSL_TYPE inputToBeRead = chooseLowResInput();
 			effectDSL.push_back(getDescriptorSetLayout(inputToBeRead));
-			for (uint32_t j = 0; j < m_numSwapChainImages; j++)
+			for (uint32_t j = 0; j < m_numFramesInFlight; j++)
 			{
 				postRPI.descriptors.push_back(getDescriptorSet(inputToBeRead, j));
 			}
 			addPostProcessPass("LowResTestPass2", effectDSL, POST_PROCESS_TYPE::LOW_RESOLUTION, postRPI);
 		}
 	}
+
+	writeLastPostProcessPassToSwapChain();
 }
 
 
-void VulkanRendererBackend::update(uint32_t currentImageIndex)
+void VulkanRendererBackend::update(uint32_t frameIndex)
 {}
 
 //===============================================================================================
@@ -193,13 +223,13 @@ void VulkanRendererBackend::update(uint32_t currentImageIndex)
 void VulkanRendererBackend::expandDescriptorPool(std::vector<VkDescriptorPoolSize>& poolSizes)
 {
 	// COMPOSITE COMPUTE onto Raster Image in First Post Process Pass
-	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_numSwapChainImages }); // compute image read by First Post Process Pass
+	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_numFramesInFlight }); // compute image read by First Post Process Pass
 
 	// RAY TRACING
-	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_NV, m_numSwapChainImages }); // ray Tracing acceleration structures
-	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_numSwapChainImages }); // rayTraced Image
-	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2*m_numSwapChainImages }); // Camera & Lights UBO
-	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2*m_numSwapChainImages }); // Vertex and Index Buffers
+	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_NV, m_numFramesInFlight }); // ray Tracing acceleration structures
+	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_numFramesInFlight }); // rayTraced Image
+	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2*m_numFramesInFlight }); // Camera & Lights UBO
+	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2*m_numFramesInFlight }); // Vertex and Index Buffers
 
 	expandDescriptorPool_PostProcess(poolSizes);
 }
@@ -208,7 +238,7 @@ void VulkanRendererBackend::createDescriptorPool(std::vector<VkDescriptorPoolSiz
 	// There's a  difference between descriptor Sets and bindings inside a descriptor Set, 
 	// multiple bindings can exist inside a descriptor set. So a pool can have fewer sets than number of bindings.
 	const uint32_t numSets = 1000;
-	const uint32_t numFrames = static_cast<uint32_t>(m_numSwapChainImages);
+	const uint32_t numFrames = static_cast<uint32_t>(m_numFramesInFlight);
 	const uint32_t maxSets = numSets * numFrames;
 	const uint32_t poolSizesCount = static_cast<uint32_t>(poolSizes.size());
 	DescriptorUtil::createDescriptorPool(m_logicalDevice, maxSets, poolSizesCount, poolSizes.data(), m_descriptorPool);
@@ -9,6 +9,8 @@
 #include <Vulkan/Utilities/vAccelerationStructureUtil.h>
 #include <Utilities/generalUtility.h>
 #include <Vulkan/vulkanManager.h>
+#include <Vulkan/vulkanFrameSubmission.h>
+#include <Utilities/threadPool.h>
 
 #include "Camera.h"
 #include "Scene.h"
@@ -22,6 +24,17 @@ struct DescriptorSetLayouts
 	std::vector<VkDescriptorSetLayout> raytraceDSL;
 };
 
+// Used when every frame's commands are recorded right before they are submitted.
+// Everything recorded for a frame in flight comes out of that frame's transient pools, which are reset as a whole once its fence has signaled.
+struct FrameCommandBuffers
+{
+	VkCommandPool graphicsCmdPool;
+	VkCommandPool computeCmdPool;
+	VkCommandBuffer computeCmdBuffer;
+	VkCommandBuffer renderCmdBuffer; // Rasterization or ray tracing depending on the render type
+	VkCommandBuffer postProcessCmdBuffer;
+};
+
 struct ComputePipelineLayouts
 {
 	VkPipelineLayout sky;
@@ -38,7 +51,7 @@ class VulkanRendererBackend
 public:
 	VulkanRendererBackend() = delete;
 	VulkanRendererBackend(std::shared_ptr<VulkanManager> vulkanManager,
-		RendererOptions& rendererOptions, int numSwapChainImages, VkExtent2D windowExtents);
+		RendererOptions& rendererOptions, int numFramesInFlight, VkExtent2D windowExtents);
 	~VulkanRendererBackend();
 	void cleanup();
 
@@ -47,7 +60,7 @@ public:
 	void createAllPostProcessEffects(std::shared_ptr<Scene> scene);
 	
 	// Update Descriptors and Resources
-	void update(uint32_t currentImageIndex);
+	void update(uint32_t frameIndex);
 
 	// Descriptor Sets
 	void expandDescriptorPool(std::vector<VkDescriptorPoolSize>& poolSizes);
@@ -60,15 +73,26 @@ public:
 
 	// Command Buffers
 	void recreateCommandBuffers();
-	void submitCommandBuffers();
+	// Sets up the draw recording threads and their secondary command buffers, the automatic thread count depends on the scene's size
+	// so this has to be called once the scene is loaded and before anything is recorded
+	void createRecordingThreads(uint32_t numModels);
+	// Adds the frame's render, compute and post process command buffers with the semaphores between them
+	void addCommandBuffersToSubmission(VulkanFrameSubmission& frameSubmission);
 	void recordAllCommandBuffers(std::shared_ptr<Camera> m_camera, std::shared_ptr<Scene> m_scene);
+	// RendererOptions::recordEveryFrame -- records the current frame in flight's command buffers, the last post process pass for the acquired swapchain image
+	void recordFrameCommandBuffers(std::shared_ptr<Camera> camera, std::shared_ptr<Scene> scene);
+	float getLastRecordTime() const { return m_lastRecordTime; } // ms
+	// Draw calls recorded into the frame in flight's command buffers, ray tracing and compute dispatches aren't draws
+	uint32_t getDrawCount(uint32_t frameIndex) const { return (frameIndex < m_drawCounts.size()) ? m_drawCounts[frameIndex] : 0; }
+	// Rasterization only -- records the scene's models repeated up to numSyntheticModels into secondary command buffers
+	// on 1, 2, 4 and 8 threads and prints the recording time of each
+	void benchmarkDrawRecording(std::shared_ptr<Scene> scene, std::shared_ptr<Camera> camera, uint32_t numSyntheticModels);
 	
 
 	// Getters
 	VkDescriptorSet getDescriptorSet(DSL_TYPE type, int frameIndex, int postProcessIndex = 0);
 	VkDescriptorSetLayout getDescriptorSetLayout(DSL_TYPE type, int postProcessIndex = 0);
 	const VkDescriptorPool getDescriptorPool() const { return m_descriptorPool; }
-	VkSemaphore getpostProcessFinishedVkSemaphore(uint32_t index) const { return m_postProcessFinishedSemaphores[index]; }
 	const VkCommandPool getComputeCommandPool() const { return m_computeCmdPool; }
 	const VkCommandPool getGraphicsCommandPool() const { return m_graphicsCmdPool; }
 
@@ -96,17 +120,29 @@ private:
 
 	// Command Buffers
 	void createCommandPoolsAndBuffers();
+	// The compute and render command buffers only touch the frame in flight's resources, the post process one also
+	// the swapchain image its last pass writes into. Both return the number of draws they recorded.
+	uint32_t recordCommandBuffers(uint32_t frameIndex, VkCommandBuffer& computeCmdBuffer, VkCommandBuffer& renderCmdBuffer,
+		std::shared_ptr<Camera> camera, std::shared_ptr<Scene> scene, VkCommandBufferUsageFlags usageFlags);
+	uint32_t recordPostProcessCommandBuffer(uint32_t frameIndex, uint32_t imageIndex, VkCommandBuffer& postProcessCmdBuffer,
+		std::shared_ptr<Scene> scene, VkCommandBufferUsageFlags usageFlags);
+	void setDrawCount(uint32_t frameIndex, uint32_t numDraws);
+	// The passes record through a VulkanCommandRecorder so the GPU profiler gets their command counters
 	void recordCommandBuffer_rayTracingCmds(
-		unsigned int frameIndex, VkCommandBuffer& rayTracingCmdBuffer, std::shared_ptr<Camera> m_camera, std::shared_ptr<Scene> m_scene);
+		unsigned int frameIndex, VulkanCommandRecorder& rayTracingRecorder, std::shared_ptr<Camera> m_camera, std::shared_ptr<Scene> m_scene);
 	void recordCommandBuffer_ComputeCmds(
-		unsigned int frameIndex, VkCommandBuffer& ComputeCmdBuffer, std::shared_ptr<Scene> scene);
-	void recordCommandBuffer_GraphicsCmds(
-		unsigned int frameIndex, VkCommandBuffer& graphicsCmdBuffer, std::shared_ptr<Scene> scene, std::shared_ptr<Camera> camera,
+		unsigned int frameIndex, VulkanCommandRecorder& computeRecorder, std::shared_ptr<Scene> scene);
+	uint32_t recordCommandBuffer_GraphicsCmds(
+		unsigned int frameIndex, VulkanCommandRecorder& graphicsRecorder, std::shared_ptr<Scene> scene, std::shared_ptr<Camera> camera,
 		VkRect2D renderArea, uint32_t clearValueCount, const VkClearValue* clearValues);
-	void recordCommandBuffer_PostProcessCmds(
-		unsigned int frameIndex, VkCommandBuffer& postProcessCmdBuffer, std::shared_ptr<Scene> scene,
+	// Hands every post process pass's counters to the GPU profiler
+	uint32_t recordCommandBuffer_PostProcessCmds(
+		unsigned int frameIndex, unsigned int imageIndex, VulkanCommandRecorder& postProcessRecorder, std::shared_ptr<Scene> scene,
 		VkRect2D renderArea, uint32_t clearValueCount, const VkClearValue* clearValues);
-	void recordCommandBuffer_FinalCmds(unsigned int frameIndex, VkCommandBuffer& cmdBuffer);
+	// These return the number of draws they recorded
+	uint32_t recordCommandBuffer_ModelDraws(
+		unsigned int frameIndex, VulkanCommandRecorder& recorder, std::shared_ptr<Scene> scene, VkDescriptorSet DS_camera,
+		const std::vector<Model*>& models, size_t firstModel, size_t lastModel);
 
 
 	// Ray Tracing
@@ -145,12 +181,16 @@ private:
 	void prePostProcess();
 	void addPostProcessPass(std::string effectName, std::vector<VkDescriptorSetLayout>& effectDSL, 
 		POST_PROCESS_TYPE postType,	PostProcessRPI& postRPI);
+	// Points the last pass added at framebuffers wrapping the swapchain images, called once every pass has been added.
+	// Its framebuffers are indexed by swapchain image, every other pass's by frame in flight.
+	void writeLastPostProcessPassToSwapChain();
 
 	// A image that is rendered to in one pass will be read from in the next pass. For this reason we treat the images as storage images,
 	// which helps us avoid constantly transitioning the images from a color attachment optimal state to a read only optimal state.
 	// Load and store operations on storage images can only be done on images in VK_IMAGE_LAYOUT_GENERAL layout.
 	void addRenderPass_PostProcess(VkRenderPass& l_renderPass, const VkFormat colorFormat, const VkFormat depthFormat,
 		const VkImageLayout initialLayout, const VkImageLayout finalLayout);
+	void addRenderPass_PostProcessToSwapChain(VkRenderPass& l_renderPass);
 	void addFrameBuffers_PostProcess(PostProcessRPI& passRPI, VkFormat colorFormat, POST_PROCESS_TYPE postType,
 		std::vector<FrameBufferAttachment>& fbAttachments, const VkImageLayout afterRenderPassExecuted);
 	void addPipeline_PostProcess(const std::string &shaderName, std::vector<VkDescriptorSetLayout>& l_postProcessDSL,
@@ -164,7 +204,7 @@ private:
 	std::shared_ptr<VulkanManager> m_vulkanManager;
 	VkDevice m_logicalDevice;
 	VkPhysicalDevice m_physicalDevice;
-	uint32_t m_numSwapChainImages;
+	uint32_t m_numFramesInFlight; // Offscreen images, framebuffers, descriptor sets and command buffers are per frame in flight
 	VkExtent2D m_windowExtents;
 
 	VkFormat m_highResolutionRenderFormat;
@@ -222,12 +262,27 @@ private:
 	VkCommandPool m_graphicsCmdPool;
 	std::vector<VkCommandBuffer> m_graphicsCommandBuffers;
 	std::vector<VkCommandBuffer> m_rayTracingCommandBuffers;	
-	std::vector<VkCommandBuffer> m_postProcessCommandBuffers;
+	std::vector<VkCommandBuffer> m_postProcessCommandBuffers; // [frame * numSwapChainImages + image], the last pass writes to the image
+	std::vector<FrameCommandBuffers> m_frameCommandBuffers; // Per frame in flight, only used with RendererOptions::recordEveryFrame
+	float m_lastRecordTime = 0.0f;
+	std::vector<uint32_t> m_drawCounts; // Per frame in flight
+
+	// Multithreaded draw recording -- the scene's models are split into one range per recording thread and each range is recorded
+	// into its own secondary command buffer. Every range has its own command pool per frame, so the pools never need a lock.
+	std::unique_ptr<ThreadPool> m_recordingThreadPool; // nullptr when the draws are recorded inline on the calling thread
+	std::vector<Model*> m_recordedModels; // The models recordCommandBuffer_GraphicsCmds is recording, only valid while it runs
+	std::vector<std::vector<VkCommandPool>> m_secondaryGraphicsCmdPools; // [frame][range]
+	std::vector<std::vector<VkCommandBuffer>> m_secondaryGraphicsCommandBuffers; // [frame][range]
+	std::vector<CommandCounters> m_secondaryCommandCounters; // [range], of the last recording
 
 	// Synchronization
-	std::vector<VkSemaphore> m_renderOperationsFinishedSemaphores;
 	std::vector<VkSemaphore> m_computeOperationsFinishedSemaphores;
-	std::vector<VkSemaphore> m_postProcessFinishedSemaphores;
+
+	// GPU pass timings, the profiler slot of a frame is its frame in flight
+	std::shared_ptr<VulkanGpuProfiler> m_gpuProfiler;
+	uint32_t m_computeProfilerPass;
+	uint32_t m_renderProfilerPass;
+	std::vector<uint32_t> m_postProcessProfilerPasses; // Per post process pass
 
 	// --- Queues --- 
 	VkQueue m_graphicsQueue;
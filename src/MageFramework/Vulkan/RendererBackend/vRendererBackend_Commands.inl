@@ -11,81 +11,161 @@ inline void VulkanRendererBackend::createCommandPoolsAndBuffers()
 
 	// Command buffers will be automatically freed when their command pool is destroyed, so we don't need an explicit cleanup.
 
-	// Because one of the drawing commands involves binding the right VkFramebuffer, we'll actually have to 
-	// record a command buffer for every image in the swap chain once again.
+	// Everything the frame renders into offscreen is owned by a frame in flight, only the last post process pass
+	// binds a framebuffer on the acquired swapchain image. So the compute and render command buffers are recorded per frame in flight
+	// and the post process ones per frame in flight and swapchain image.
 
 	VulkanCommandUtil::createCommandPool(m_logicalDevice, m_computeCmdPool, m_vulkanManager->getQueueIndex(QueueFlags::Compute));
 	VulkanCommandUtil::createCommandPool(m_logicalDevice, m_graphicsCmdPool, m_vulkanManager->getQueueIndex(QueueFlags::Graphics));
+
+	if (m_rendererOptions.recordEveryFrame)
+	{
+		// One set of transient pools per frame in flight, their command buffers are allocated once and re-recorded every frame
+		m_frameCommandBuffers.resize(m_vulkanManager->getNumFramesInFlight());
+		for (FrameCommandBuffers& frame : m_frameCommandBuffers)
+		{
+			VulkanCommandUtil::createCommandPool(m_logicalDevice, frame.graphicsCmdPool,
+				m_vulkanManager->getQueueIndex(QueueFlags::Graphics), VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+			VulkanCommandUtil::createCommandPool(m_logicalDevice, frame.computeCmdPool,
+				m_vulkanManager->getQueueIndex(QueueFlags::Compute), VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+
+			VulkanCommandUtil::allocateCommandBuffers(m_logicalDevice, frame.computeCmdPool, 1, &frame.computeCmdBuffer);
+			VulkanCommandUtil::allocateCommandBuffers(m_logicalDevice, frame.graphicsCmdPool, 1, &frame.renderCmdBuffer);
+			VulkanCommandUtil::allocateCommandBuffers(m_logicalDevice, frame.graphicsCmdPool, 1, &frame.postProcessCmdBuffer);
+		}
+	}
+
 	recreateCommandBuffers();
 }
+inline void VulkanRendererBackend::createRecordingThreads(uint32_t numModels)
+{
+	// Each recording thread needs enough models to cover waking it up and executing its secondary command buffer,
+	// and the main thread still has the rest of the frame to do, so the automatic count stays small
+	const uint32_t MODELS_PER_RECORDING_THREAD = 128;
+	const uint32_t MAX_AUTOMATIC_RECORDING_THREADS = 4;
+
+	uint32_t numRecordingThreads = m_rendererOptions.numRecordingThreads;
+	if (numRecordingThreads == 0)
+	{
+		const uint32_t numSpareHardwareThreads = std::max(1u, std::thread::hardware_concurrency()) - 1;
+		numRecordingThreads = std::min({ numModels / MODELS_PER_RECORDING_THREAD, numSpareHardwareThreads, MAX_AUTOMATIC_RECORDING_THREADS });
+	}
+
+	// Secondary command buffers only pay off when there are several threads recording into them
+	if (m_rendererOptions.renderType == RENDER_TYPE::RASTERIZATION && numRecordingThreads > 1)
+	{
+		m_recordingThreadPool = std::make_unique<ThreadPool>(numRecordingThreads);
+
+		// The secondary command buffers live as long as their pools, re-recording them resets the whole pool at once.
+		// The pools are per frame in flight, so a pool is only reset once the frame that last executed its command buffer has finished.
+		m_secondaryGraphicsCmdPools.resize(m_numFramesInFlight);
+		m_secondaryGraphicsCommandBuffers.resize(m_numFramesInFlight);
+		m_secondaryCommandCounters.resize(numRecordingThreads);
+		for (uint32_t i = 0; i < m_numFramesInFlight; i++)
+		{
+			m_secondaryGraphicsCmdPools[i].resize(numRecordingThreads);
+			m_secondaryGraphicsCommandBuffers[i].resize(numRecordingThreads);
+			for (uint32_t range = 0; range < numRecordingThreads; range++)
+			{
+				VulkanCommandUtil::createCommandPool(m_logicalDevice, m_secondaryGraphicsCmdPools[i][range],
+					m_vulkanManager->getQueueIndex(QueueFlags::Graphics), VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+				VulkanCommandUtil::allocateCommandBuffers(m_logicalDevice, m_secondaryGraphicsCmdPools[i][range], 1,
+					&m_secondaryGraphicsCommandBuffers[i][range], VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+			}
+		}
+	}
+
+	// Only known now: with recording threads the raster pass executes secondary command buffers
+	m_renderProfilerPass = m_gpuProfiler->registerPass((m_rendererOptions.renderType == RENDER_TYPE::RAYTRACE) ? "Ray Trace" : "Raster",
+		QueueFlags::Graphics, m_recordingThreadPool != nullptr);
+}
 inline void VulkanRendererBackend::recreateCommandBuffers()
 {
-	m_computeCommandBuffers.resize(m_numSwapChainImages);
-	m_graphicsCommandBuffers.resize(m_numSwapChainImages);
-	m_rayTracingCommandBuffers.resize(m_numSwapChainImages);
-	m_postProcessCommandBuffers.resize(m_numSwapChainImages);
+	// Frames that are recorded every frame don't need prerecorded command buffers
+	if (m_rendererOptions.recordEveryFrame)
+	{
+		return;
+	}
+
+	// The swapchain image count can change when the swapchain is recreated, the frames in flight stay the same
+	m_computeCommandBuffers.resize(m_numFramesInFlight);
+	m_graphicsCommandBuffers.resize(m_numFramesInFlight);
+	m_rayTracingCommandBuffers.resize(m_numFramesInFlight);
+	m_postProcessCommandBuffers.resize(m_numFramesInFlight * m_vulkanManager->getSwapChainImageCount());
 
 	VulkanCommandUtil::allocateCommandBuffers(m_logicalDevice, m_computeCmdPool, m_computeCommandBuffers);
 	VulkanCommandUtil::allocateCommandBuffers(m_logicalDevice, m_graphicsCmdPool, m_graphicsCommandBuffers);
 	VulkanCommandUtil::allocateCommandBuffers(m_logicalDevice, m_graphicsCmdPool, m_rayTracingCommandBuffers);
 	VulkanCommandUtil::allocateCommandBuffers(m_logicalDevice, m_graphicsCmdPool, m_postProcessCommandBuffers);
 }
-inline void VulkanRendererBackend::submitCommandBuffers()
+inline void VulkanRendererBackend::addCommandBuffersToSubmission(VulkanFrameSubmission& frameSubmission)
 {
 	// We don't want to write to resources like images and buffers if they are currently in use, and hence not available. Thus we specify 
 	// the stage of a pipeline that we can write to resources in.
 	// e.g In a graphics pipeline we qould want to wait with writing colors to the render image until it's available, so we
 	// specify the 'VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT' stage, as the stage we should wait on until the image is available for writing
 	// That means that theoretically the implementation can already start executing our vertex shader and such while the image is not available yet.
-	
-	// There is a fence attached to the submission of commands to the graphics queue. Since the fence is a CPU-GPU synchronization
-	// it will wait  here until the frame is deemed available, meaning the other queues (in this case only the compute queue) 
-	// dont have to create they're own fences that they need to keep track of.
-	// The inflight fence basically tells us when a frame has finished rendering, and the submitToQueueSynced function 
-	// signals the fence, informing it and thus us of the same.
 
-	uint32_t index = m_vulkanManager->getImageIndex();
-	VkFence inFlightFence = m_vulkanManager->getInFlightFence();
+	// Compute doesn't read anything the render writes, so compute and render only meet again at post processing:
+	//	Compute queue:  Compute, signals
+	//	Graphics queue: Render, waits on compute, Post Process
+	// With async compute the two overlap on the GPU. When compute shares the graphics queue all of it runs in submission order and
+	// the barrier at the start of the post process command buffer takes the place of the semaphore (see recordCommandBuffers).
+	// Whatever ends the frame (UI, fence or timeline signal) is added by the renderer after this.
+
+	const uint32_t frameIndex = m_vulkanManager->getFrameIndex();
+	const uint32_t imageIndex = m_vulkanManager->getImageIndex();
 
-	//	Submit Commands
+	VkCommandBuffer computeCmdBuffer, renderCmdBuffer, postProcessCmdBuffer;
+	if (m_rendererOptions.recordEveryFrame)
 	{
-		if (m_rendererOptions.renderType == RENDER_TYPE::RASTERIZATION)
-		{
-			// Graphics Command Buffer Synchronization
-			VkSemaphore waitSemaphores_rasterization[] = { m_vulkanManager->getImageAvailableVkSemaphore() };
-			VkPipelineStageFlags waitStages_rasterization[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-			VkSemaphore signalSemaphores_rasterization[] = { m_renderOperationsFinishedSemaphores[index] };
+		const FrameCommandBuffers& frame = m_frameCommandBuffers[frameIndex];
+		computeCmdBuffer = frame.computeCmdBuffer;
+		renderCmdBuffer = frame.renderCmdBuffer;
+		postProcessCmdBuffer = frame.postProcessCmdBuffer;
+	}
+	else
+	{
+		computeCmdBuffer = m_computeCommandBuffers[frameIndex];
+		renderCmdBuffer = (m_rendererOptions.renderType == RENDER_TYPE::RAYTRACE) ? m_rayTracingCommandBuffers[frameIndex] : m_graphicsCommandBuffers[frameIndex];
+		postProcessCmdBuffer = m_postProcessCommandBuffers[frameIndex * m_vulkanManager->getSwapChainImageCount() + imageIndex];
+	}
 
-			VulkanCommandUtil::submitToQueueSynced(m_graphicsQueue, 1, &m_graphicsCommandBuffers[index],
-				1, waitSemaphores_rasterization, waitStages_rasterization, 1, signalSemaphores_rasterization, inFlightFence);
-		}
-		else if (m_rendererOptions.renderType == RENDER_TYPE::RAYTRACE)
+	const bool useTimelineSemaphores = m_vulkanManager->usesTimelineSemaphores();
+	auto addQueueDependency = [&](VkQueue srcQueue, QueueFlags srcQueueFlag, VkSemaphore binarySemaphore, VkQueue dstQueue, VkPipelineStageFlags dstStage)
+	{
+		if (srcQueue == dstQueue)
 		{
-			// Ray Tracing Command Buffer Synchronization
-			VkSemaphore waitSemaphores_rayTracing[] = { m_vulkanManager->getImageAvailableVkSemaphore() };
-			VkPipelineStageFlags waitStages_rayTracing[] = { VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_NV };
-			VkSemaphore signalSemaphores_rayTracing[] = { m_renderOperationsFinishedSemaphores[index] };
+			return;
+		}
 
-			VulkanCommandUtil::submitToQueueSynced(m_graphicsQueue, 1, &m_rayTracingCommandBuffers[index],
-				1, waitSemaphores_rayTracing, waitStages_rayTracing, 1, signalSemaphores_rayTracing, inFlightFence);
+		// With timeline semaphores the work signals the next value on its queue's timeline
+		VkSemaphore semaphore = binarySemaphore;
+		uint64_t value = 0;
+		if (useTimelineSemaphores)
+		{
+			semaphore = m_vulkanManager->getTimelineSemaphore(srcQueueFlag);
+			value = m_vulkanManager->getNextTimelineValue(srcQueueFlag);
 		}
+		frameSubmission.addSignal(srcQueue, semaphore, value);
+		frameSubmission.addWait(dstQueue, semaphore, dstStage, value);
+	};
 
-		// Compute Command Buffer Synchronization
-		VkSemaphore waitSemaphores_compute[] = { m_renderOperationsFinishedSemaphores[index] };
-		VkPipelineStageFlags waitStages_compute[] = { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT };
-		VkSemaphore signalSemaphores_compute[] = { m_computeOperationsFinishedSemaphores[index] };
+	// Compute -- added first so it is also submitted first, binary semaphores have to be signaled before their wait is submitted
+	frameSubmission.addCommandBuffer(m_computeQueue, computeCmdBuffer);
 
-		// Post Process Command Buffer Synchronization
-		VkSemaphore waitSemaphores_postProcess[] = { m_computeOperationsFinishedSemaphores[index] };
-		VkPipelineStageFlags waitStages_postProcess[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-		VkSemaphore signalSemaphores_postProcess[] = { m_postProcessFinishedSemaphores[index] };
-		
-		VulkanCommandUtil::submitToQueueSynced(m_computeQueue, 1, &m_computeCommandBuffers[index],
-			1, waitSemaphores_compute, waitStages_compute, 1, signalSemaphores_compute, nullptr);
-
-		VulkanCommandUtil::submitToQueueSynced(m_graphicsQueue, 1, &m_postProcessCommandBuffers[index],
-			1, waitSemaphores_postProcess, waitStages_postProcess, 1, signalSemaphores_postProcess, nullptr);
+	// Render -- Acquiring the swapchain image can only signal a binary semaphore, offscreen images are ready as soon as they are handed out.
+	// Only the last post process pass writes the swapchain image, in both render paths, so the wait is at the stage its render pass's
+	// external dependency starts from and the ray tracing shaders don't wait on the acquire
+	if (!m_vulkanManager->isHeadless())
+	{
+		frameSubmission.addWait(m_graphicsQueue, m_vulkanManager->getImageAvailableVkSemaphore(), VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
 	}
+	frameSubmission.addCommandBuffer(m_graphicsQueue, renderCmdBuffer);
+
+	// Post Process -- the compute image is first sampled in a fragment shader, the vertex work can start before compute is done
+	addQueueDependency(m_computeQueue, QueueFlags::Compute, m_computeOperationsFinishedSemaphores[frameIndex], m_graphicsQueue, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+	frameSubmission.addCommandBuffer(m_graphicsQueue, postProcessCmdBuffer);
 }
 
 inline void VulkanRendererBackend::createSyncObjects()
@@ -101,18 +181,14 @@ inline void VulkanRendererBackend::createSyncObjects()
 	// vkFence: GPU to CPU synchronization
 
 	// Create Semaphores
-	m_renderOperationsFinishedSemaphores.resize(m_numSwapChainImages);
-	m_computeOperationsFinishedSemaphores.resize(m_numSwapChainImages);
-	m_postProcessFinishedSemaphores.resize(m_numSwapChainImages);
+	m_computeOperationsFinishedSemaphores.resize(m_numFramesInFlight);
 
 	VkSemaphoreCreateInfo semaphoreInfo = {};
 	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	for (uint32_t i = 0; i < m_numSwapChainImages; i++)
+	for (uint32_t i = 0; i < m_numFramesInFlight; i++)
 	{
-		if (vkCreateSemaphore(m_logicalDevice, &semaphoreInfo, nullptr, &m_renderOperationsFinishedSemaphores[i]) != VK_SUCCESS ||
-			vkCreateSemaphore(m_logicalDevice, &semaphoreInfo, nullptr, &m_computeOperationsFinishedSemaphores[i]) != VK_SUCCESS ||
-			vkCreateSemaphore(m_logicalDevice, &semaphoreInfo, nullptr, &m_postProcessFinishedSemaphores[i]) != VK_SUCCESS)
+		if (vkCreateSemaphore(m_logicalDevice, &semaphoreInfo, nullptr, &m_computeOperationsFinishedSemaphores[i]) != VK_SUCCESS)
 		{
 			throw std::runtime_error("Failed to create synchronization objects for a frame");
 		}
@@ -120,6 +196,55 @@ inline void VulkanRendererBackend::createSyncObjects()
 }
 
 inline void VulkanRendererBackend::recordAllCommandBuffers(std::shared_ptr<Camera> camera, std::shared_ptr<Scene> scene)
+{
+	CPU_PROFILE_SCOPE("Record All");
+	const uint32_t numSwapChainImages = m_vulkanManager->getSwapChainImageCount();
+	TIME_POINT recordStart = std::chrono::high_resolution_clock::now();
+	for (uint32_t frameIndex = 0; frameIndex < m_numFramesInFlight; frameIndex++)
+	{
+		VkCommandBuffer& renderCmdBuffer = (m_rendererOptions.renderType == RENDER_TYPE::RAYTRACE) ? 
+			m_rayTracingCommandBuffers[frameIndex] : m_graphicsCommandBuffers[frameIndex];
+		uint32_t numDraws = recordCommandBuffers(frameIndex, m_computeCommandBuffers[frameIndex], renderCmdBuffer,
+			camera, scene, VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT);
+
+		// Every swapchain image the frame can end up on gets its own post process command buffer, they only differ in the last pass
+		uint32_t numPostProcessDraws = 0;
+		for (uint32_t imageIndex = 0; imageIndex < numSwapChainImages; imageIndex++)
+		{
+			numPostProcessDraws = recordPostProcessCommandBuffer(frameIndex, imageIndex, 
+				m_postProcessCommandBuffers[frameIndex * numSwapChainImages + imageIndex], scene, VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT);
+		}
+		setDrawCount(frameIndex, numDraws + numPostProcessDraws);
+	}
+	m_lastRecordTime = TimerUtil::getTimeElapsedSinceStart(recordStart);
+#ifndef NDEBUG
+	std::cout << "Recorded " << m_numFramesInFlight << " frames of command buffers for " << numSwapChainImages << " swapchain images in " 
+		<< m_lastRecordTime << " ms (" << (m_recordingThreadPool ? m_recordingThreadPool->getNumThreads() : 1) << " draw recording threads)" << std::endl;
+#endif
+}
+inline void VulkanRendererBackend::recordFrameCommandBuffers(std::shared_ptr<Camera> camera, std::shared_ptr<Scene> scene)
+{
+	CPU_PROFILE_SCOPE("Record");
+	TIME_POINT recordStart = std::chrono::high_resolution_clock::now();
+	const uint32_t frameIndex = m_vulkanManager->getFrameIndex();
+	FrameCommandBuffers& frame = m_frameCommandBuffers[frameIndex];
+
+	// The frame in flight's fence has already been waited on, so nothing allocated from its pools is still executing.
+	// Resetting the pool recycles the memory of every command buffer in it at once, which is much cheaper than resetting them one by one.
+	VK_CHECK_RESULT(vkResetCommandPool(m_logicalDevice, frame.graphicsCmdPool, 0));
+	VK_CHECK_RESULT(vkResetCommandPool(m_logicalDevice, frame.computeCmdPool, 0));
+
+	// Only the last post process pass needs the acquired image, everything else belongs to the frame in flight
+	uint32_t numDraws = recordCommandBuffers(frameIndex, frame.computeCmdBuffer, frame.renderCmdBuffer,
+		camera, scene, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+	numDraws += recordPostProcessCommandBuffer(frameIndex, m_vulkanManager->getImageIndex(), frame.postProcessCmdBuffer,
+		scene, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+	setDrawCount(frameIndex, numDraws);
+	m_lastRecordTime = TimerUtil::getTimeElapsedSinceStart(recordStart);
+}
+inline uint32_t VulkanRendererBackend::recordCommandBuffers(uint32_t frameIndex,
+	VkCommandBuffer& computeCmdBuffer, VkCommandBuffer& renderCmdBuffer,
+	std::shared_ptr<Camera> camera, std::shared_ptr<Scene> scene, VkCommandBufferUsageFlags usageFlags)
 {
 	const uint32_t numClearValues = 2;
 	std::array<VkClearValue, numClearValues> clearValues = {};
@@ -127,39 +252,107 @@ inline void VulkanRendererBackend::recordAllCommandBuffers(std::shared_ptr<Camer
 	clearValues[1].depthStencil = { 1.0f, 0 };
 
 	const VkRect2D renderArea = Util::createRectangle(m_vulkanManager->getSwapChainVkExtent());
-	const unsigned int numCommandBuffers = m_vulkanManager->getSwapChainImageCount();
-	for (unsigned int i = 0; i < numCommandBuffers; i++)
+
+	// The compute image is exclusive to one queue family at a time, with async compute it is released by the compute queue
+	// and acquired by the graphics queue every frame. See addCommandBuffersToSubmission for the order the command buffers run in.
+	const bool asyncCompute = m_vulkanManager->usesAsyncCompute();
+	const uint32_t computeQueueFamily = m_vulkanManager->getQueueIndex(QueueFlags::Compute);
+	const uint32_t graphicsQueueFamily = m_vulkanManager->getQueueIndex(QueueFlags::Graphics);
+	VkImage computeImage = scene->getTexture("compute", frameIndex)->m_image;
+	VkImageSubresourceRange computeImageRange = ImageUtil::createImageSubResourceRange(VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1);
+
+	// The passes recorded below replace whatever was recorded for this frame in flight before.
+	// A pass's command counters are everything recorded into its command buffer since the previous pass's were taken, barriers included.
+	m_gpuProfiler->clearSlot(frameIndex);
+	uint32_t numDraws = 0;
+
+	VulkanCommandUtil::beginCommandBuffer(computeCmdBuffer, usageFlags);
+	VulkanCommandRecorder computeRecorder(computeCmdBuffer);
 	{
-		VkCommandBuffer& computeCmdBuffer = m_computeCommandBuffers[i];
-		VkCommandBuffer& rayTracingCmdBuffer = m_rayTracingCommandBuffers[i];
-		VkCommandBuffer& graphicsCmdBuffer = m_graphicsCommandBuffers[i];
-		VkCommandBuffer& postProcessCmdBuffer = m_postProcessCommandBuffers[i];
-		
-		VulkanCommandUtil::beginCommandBuffer(computeCmdBuffer);
-		recordCommandBuffer_ComputeCmds(i, computeCmdBuffer, scene);
-		VulkanCommandUtil::endCommandBuffer(computeCmdBuffer);
+		// Every texel gets overwritten, so the old contents are discarded instead of acquiring the image back from the graphics queue.
+		// The frame that last read it used the same frame in flight, whose fence was waited on before this frame was submitted.
+		VkImageMemoryBarrier discardComputeImage = ImageUtil::createImageMemoryBarrier(computeImage, 
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 0, VK_ACCESS_SHADER_WRITE_BIT, computeImageRange);
+		computeRecorder.pipelineBarrier(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &discardComputeImage);
+	}
+	m_gpuProfiler->beginPass(computeCmdBuffer, frameIndex, m_computeProfilerPass);
+	recordCommandBuffer_ComputeCmds(frameIndex, computeRecorder, scene);
+	m_gpuProfiler->endPass(computeCmdBuffer, frameIndex, m_computeProfilerPass);
+	if (asyncCompute)
+	{
+		// Release half of the ownership transfer, the acquire is at the start of the post process command buffer
+		VkImageMemoryBarrier releaseComputeImage = ImageUtil::createImageMemoryBarrier(computeImage,
+			VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT, 0, computeImageRange,
+			computeQueueFamily, graphicsQueueFamily);
+		computeRecorder.pipelineBarrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &releaseComputeImage);
+	}
+	VulkanCommandUtil::endCommandBuffer(computeCmdBuffer);
+	m_gpuProfiler->setPassCounters(frameIndex, m_computeProfilerPass, computeRecorder.takeCounters());
 
-		if (m_rendererOptions.renderType == RENDER_TYPE::RAYTRACE)
-		{
-			VulkanCommandUtil::beginCommandBuffer(rayTracingCmdBuffer);
-			recordCommandBuffer_rayTracingCmds(i, rayTracingCmdBuffer, camera, scene);
-			VulkanCommandUtil::endCommandBuffer(rayTracingCmdBuffer);
-		}
-		else if (m_rendererOptions.renderType == RENDER_TYPE::RASTERIZATION)
-		{
-			VulkanCommandUtil::beginCommandBuffer(graphicsCmdBuffer);
-			recordCommandBuffer_GraphicsCmds(i, graphicsCmdBuffer, scene, camera, renderArea, numClearValues, clearValues.data());
-			VulkanCommandUtil::endCommandBuffer(graphicsCmdBuffer);
-		}
+	VulkanCommandUtil::beginCommandBuffer(renderCmdBuffer, usageFlags);
+	VulkanCommandRecorder renderRecorder(renderCmdBuffer);
+	m_gpuProfiler->beginPass(renderCmdBuffer, frameIndex, m_renderProfilerPass);
+	if (m_rendererOptions.renderType == RENDER_TYPE::RAYTRACE)
+	{
+		recordCommandBuffer_rayTracingCmds(frameIndex, renderRecorder, camera, scene);
+	}
+	else if (m_rendererOptions.renderType == RENDER_TYPE::RASTERIZATION)
+	{
+		numDraws += recordCommandBuffer_GraphicsCmds(frameIndex, renderRecorder, scene, camera, renderArea, numClearValues, clearValues.data());
+	}
+	m_gpuProfiler->endPass(renderCmdBuffer, frameIndex, m_renderProfilerPass);
+	VulkanCommandUtil::endCommandBuffer(renderCmdBuffer);
+	m_gpuProfiler->setPassCounters(frameIndex, m_renderProfilerPass, renderRecorder.takeCounters());
 
-		VulkanCommandUtil::beginCommandBuffer(postProcessCmdBuffer);
-		recordCommandBuffer_PostProcessCmds(i, postProcessCmdBuffer, scene, renderArea, numClearValues, clearValues.data());
-		recordCommandBuffer_FinalCmds(i, postProcessCmdBuffer);
-		VulkanCommandUtil::endCommandBuffer(postProcessCmdBuffer);
+	return numDraws;
+}
+inline uint32_t VulkanRendererBackend::recordPostProcessCommandBuffer(uint32_t frameIndex, uint32_t imageIndex,
+	VkCommandBuffer& postProcessCmdBuffer, std::shared_ptr<Scene> scene, VkCommandBufferUsageFlags usageFlags)
+{
+	const uint32_t numClearValues = 2;
+	std::array<VkClearValue, numClearValues> clearValues = {};
+	clearValues[0].color = { 0.412f, 0.796f, 1.0f, 1.0f };
+	clearValues[1].depthStencil = { 1.0f, 0 };
+
+	const VkRect2D renderArea = Util::createRectangle(m_vulkanManager->getSwapChainVkExtent());
+
+	const bool asyncCompute = m_vulkanManager->usesAsyncCompute();
+	const uint32_t computeQueueFamily = m_vulkanManager->getQueueIndex(QueueFlags::Compute);
+	const uint32_t graphicsQueueFamily = m_vulkanManager->getQueueIndex(QueueFlags::Graphics);
+	VkImage computeImage = scene->getTexture("compute", frameIndex)->m_image;
+	VkImageSubresourceRange computeImageRange = ImageUtil::createImageSubResourceRange(VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1);
+
+	VulkanCommandUtil::beginCommandBuffer(postProcessCmdBuffer, usageFlags);
+	VulkanCommandRecorder postProcessRecorder(postProcessCmdBuffer);
+	{
+		// The render (and with a shared compute queue the compute) results come from earlier on the same queue, no semaphore orders them.
+		// The acquire half of the ownership transfer chains onto the semaphore wait on the compute queue.
+		VkMemoryBarrier renderToPostProcess = { VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr,
+			VK_ACCESS_MEMORY_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT };
+		VkImageMemoryBarrier acquireComputeImage = ImageUtil::createImageMemoryBarrier(computeImage,
+			VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL, 0, VK_ACCESS_SHADER_READ_BIT, computeImageRange,
+			computeQueueFamily, graphicsQueueFamily);
+		postProcessRecorder.pipelineBarrier(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			0, 1, &renderToPostProcess, 0, nullptr, asyncCompute ? 1 : 0, &acquireComputeImage);
+	}
+	const uint32_t numDraws = recordCommandBuffer_PostProcessCmds(frameIndex, imageIndex, postProcessRecorder, scene, 
+		renderArea, numClearValues, clearValues.data());
+	VulkanCommandUtil::endCommandBuffer(postProcessCmdBuffer);
+
+	return numDraws;
+}
+inline void VulkanRendererBackend::setDrawCount(uint32_t frameIndex, uint32_t numDraws)
+{
+	if (frameIndex >= m_drawCounts.size())
+	{
+		m_drawCounts.resize(frameIndex + 1, 0);
 	}
+	m_drawCounts[frameIndex] = numDraws;
 }
 inline void VulkanRendererBackend::recordCommandBuffer_ComputeCmds(
-	unsigned int frameIndex, VkCommandBuffer& ComputeCmdBuffer, std::shared_ptr<Scene> scene)
+	unsigned int frameIndex, VulkanCommandRecorder& computeRecorder, std::shared_ptr<Scene> scene)
 {
 	// Test Compute Pass/Kernel
 	{
@@ -174,25 +367,24 @@ inline void VulkanRendererBackend::recordCommandBuffer_ComputeCmds(
 		
 		const VkDescriptorSet DS_compute = scene->getDescriptorSet(DSL_TYPE::COMPUTE, frameIndex);
 
-		vkCmdBindPipeline(ComputeCmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_compute_P);
-		vkCmdBindDescriptorSets(ComputeCmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_compute_PL, 0, 1, &DS_compute, 0, nullptr);
-		vkCmdDispatch(ComputeCmdBuffer, numBlocksX, numBlocksY, numBlocksZ); // Dispatch the Compute Kernel
+		computeRecorder.bindPipeline(VK_PIPELINE_BIND_POINT_COMPUTE, m_compute_P);
+		computeRecorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_COMPUTE, m_compute_PL, 0, 1, &DS_compute);
+		computeRecorder.dispatch(numBlocksX, numBlocksY, numBlocksZ); // Dispatch the Compute Kernel
 	}
 }
 
 inline void VulkanRendererBackend::recordCommandBuffer_rayTracingCmds(
-	unsigned int frameIndex, VkCommandBuffer& rayTracingCmdBuffer, std::shared_ptr<Camera> camera, std::shared_ptr<Scene> scene)
+	unsigned int frameIndex, VulkanCommandRecorder& rayTracingRecorder, std::shared_ptr<Camera> camera, std::shared_ptr<Scene> scene)
 {
 	uint32_t width = m_vulkanManager->getSwapChainVkExtent().width;
 	uint32_t height = m_vulkanManager->getSwapChainVkExtent().height;
-	const unsigned int numCommandBuffers = m_vulkanManager->getSwapChainImageCount();
 	VkImageSubresourceRange subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
 
-	for (unsigned int i = 0; i < numCommandBuffers; i++)
+	// Only this frame's rays are traced, every frame in flight has its own command buffer and ray traced image
 	{
 		// Dispatch the ray tracing commands
-		vkCmdBindPipeline(rayTracingCmdBuffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_NV, m_rayTrace_P);
-		vkCmdBindDescriptorSets(rayTracingCmdBuffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_NV, m_rayTrace_PL, 0, 1, &m_DS_rayTrace[i], 0, 0);
+		rayTracingRecorder.bindPipeline(VK_PIPELINE_BIND_POINT_RAY_TRACING_NV, m_rayTrace_P);
+		rayTracingRecorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_RAY_TRACING_NV, m_rayTrace_PL, 0, 1, &m_DS_rayTrace[frameIndex]);
 
 		// Calculate shader binding offsets, which is pretty straight forward in our example 
 		VkDeviceSize bindingOffsetRayGenShader = m_rayTracingProperties.shaderGroupHandleSize * INDEX_RAYGEN;
@@ -200,72 +392,206 @@ inline void VulkanRendererBackend::recordCommandBuffer_rayTracingCmds(
 		VkDeviceSize bindingOffsetHitShader = m_rayTracingProperties.shaderGroupHandleSize * INDEX_CLOSEST_HIT;
 		VkDeviceSize bindingStride = m_rayTracingProperties.shaderGroupHandleSize;
 
-		vkCmdTraceRaysNV(rayTracingCmdBuffer,
-			m_shaderBindingTable.buffer, bindingOffsetRayGenShader,              // Ray Gen Shader Binding
-			m_shaderBindingTable.buffer, bindingOffsetMissShader, bindingStride, // Miss Shader Binding
-			m_shaderBindingTable.buffer, bindingOffsetHitShader, bindingStride,  // Hit Shader Binding
-			VK_NULL_HANDLE, 0, 0,                                              // Callable Shader Binding
+		// Ray gen, miss and hit shaders all come from the one shader binding table, there are no callable shaders
+		rayTracingRecorder.traceRays(vkCmdTraceRaysNV, m_shaderBindingTable.buffer, bindingOffsetRayGenShader,
+			bindingOffsetMissShader, bindingStride, bindingOffsetHitShader, bindingStride,
 			width, height, 1);
 	}
 }
-inline void VulkanRendererBackend::recordCommandBuffer_GraphicsCmds(
-	unsigned int frameIndex, VkCommandBuffer& graphicsCmdBuffer, std::shared_ptr<Scene> scene, std::shared_ptr<Camera> camera,
+inline uint32_t VulkanRendererBackend::recordCommandBuffer_GraphicsCmds(
+	unsigned int frameIndex, VulkanCommandRecorder& graphicsRecorder, std::shared_ptr<Scene> scene, std::shared_ptr<Camera> camera,
 	VkRect2D renderArea, uint32_t clearValueCount, const VkClearValue* clearValues)
 {
-	// Create a Image Memory Barrier between the compute pipeline that creates the image and the graphics pipeline that access the image
-	// Image barriers should come before render passes begin, unless you're working with subpasses
-	{
-		std::shared_ptr<Texture2D> computeTexture = scene->getTexture("compute", frameIndex);
-		VkImageSubresourceRange imageSubresourceRange = ImageUtil::createImageSubResourceRange(VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1);
-		VkImageMemoryBarrier imageMemoryBarrier = ImageUtil::createImageMemoryBarrier(computeTexture->m_image,
-			computeTexture->m_imageLayout, VK_IMAGE_LAYOUT_GENERAL,
-			VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, imageSubresourceRange,
-			m_vulkanManager->getQueueIndex(QueueFlags::Compute), m_vulkanManager->getQueueIndex(QueueFlags::Graphics));
-
-		VulkanCommandUtil::pipelineBarrier(graphicsCmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-			0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
-	}
-
+	// Nothing in the render pass reads the compute image. Post processing acquires it from the compute queue after waiting on
+	// the compute semaphore (see recordCommandBuffers), an acquire here would have no matching release yet.
 
 	// Model Rendering Pipeline
+	uint32_t numDraws = 0;
 	{
 		const VkDescriptorSet DS_camera = camera->getDescriptorSet(frameIndex);
 
-		VulkanCommandUtil::beginRenderPass(graphicsCmdBuffer,
-			m_rasterRPI.renderPass, m_rasterRPI.frameBuffers[frameIndex],
-			renderArea, clearValueCount, clearValues);
-
+		// Reused from frame to frame, clearing keeps its capacity so the frame loop doesn't allocate here
+		std::vector<Model*>& models = m_recordedModels;
+		models.clear();
 		for (auto const& element : scene->m_modelMap)
-		{	
+		{
+			models.push_back(element.second.get());
+		}
+
+		if (m_recordingThreadPool)
+		{
+			// Each thread records a contiguous range of the models into its own secondary command buffer,
+			// the primary command buffer only begins the render pass and executes them in order
+			graphicsRecorder.beginRenderPass(m_rasterRPI.renderPass, m_rasterRPI.frameBuffers[frameIndex],
+				renderArea, clearValueCount, clearValues, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+			std::vector<VkCommandBuffer>& secondaryCmdBuffers = m_secondaryGraphicsCommandBuffers[frameIndex];
+			const uint32_t numRanges = static_cast<uint32_t>(secondaryCmdBuffers.size());
+			std::atomic<uint32_t> numRangeDraws{ 0 };
+			m_recordingThreadPool->parallelFor(numRanges, [&](uint32_t range)
+			{
+				CPU_PROFILE_SCOPE("Record Draws");
+				const size_t firstModel = models.size() * range / numRanges;
+				const size_t lastModel = models.size() * (range + 1) / numRanges;
+
+				VK_CHECK_RESULT(vkResetCommandPool(m_logicalDevice, m_secondaryGraphicsCmdPools[frameIndex][range], 0));
+				VkCommandBuffer& secondaryCmdBuffer = secondaryCmdBuffers[range];
+				VulkanCommandUtil::beginSecondaryCommandBuffer(secondaryCmdBuffer, m_rasterRPI.renderPass, 0, m_rasterRPI.frameBuffers[frameIndex],
+					m_gpuProfiler->getGraphicsStatisticsFlags());
+				VulkanCommandRecorder secondaryRecorder(secondaryCmdBuffer);
+				numRangeDraws += recordCommandBuffer_ModelDraws(frameIndex, secondaryRecorder, scene, DS_camera, models, firstModel, lastModel);
+				VulkanCommandUtil::endCommandBuffer(secondaryCmdBuffer);
+				m_secondaryCommandCounters[range] = secondaryRecorder.getCounters();
+			});
+			numDraws = numRangeDraws;
+
+			CommandCounters secondaryCounters;
+			for (uint32_t range = 0; range < numRanges; range++)
+			{
+				secondaryCounters += m_secondaryCommandCounters[range];
+			}
+			graphicsRecorder.executeCommands(numRanges, secondaryCmdBuffers.data(), secondaryCounters);
+		}
+		else
+		{
+			graphicsRecorder.beginRenderPass(m_rasterRPI.renderPass, m_rasterRPI.frameBuffers[frameIndex],
+				renderArea, clearValueCount, clearValues);
+
+			numDraws = recordCommandBuffer_ModelDraws(frameIndex, graphicsRecorder, scene, DS_camera, models, 0, models.size());
+		}
+		graphicsRecorder.endRenderPass();
+	}
+	return numDraws;
+}
+inline uint32_t VulkanRendererBackend::recordCommandBuffer_ModelDraws(
+	unsigned int frameIndex, VulkanCommandRecorder& recorder, std::shared_ptr<Scene> scene, VkDescriptorSet DS_camera,
+	const std::vector<Model*>& models, size_t firstModel, size_t lastModel)
+{
+	// Called from several recording threads at once, so this may only read from the scene
+	uint32_t numDraws = 0;
+	if (scene->usesBindlessTextures())
+	{
+		// Every material is reachable from the one bindless set so it only needs to be bound once per command buffer
+		const VkDescriptorSet DS_bindless = scene->getDescriptorSet(DSL_TYPE::BINDLESS_MATERIALS, frameIndex);
+		recorder.bindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, m_rasterization_P);
+		recorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, m_rasterization_PL, 0, 1, &DS_camera);
+		recorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, m_rasterization_PL, 1, 1, &DS_bindless);
+
+		for (size_t i = firstModel; i < lastModel; i++)
+		{
+			numDraws += models[i]->recordDrawCmds_Bindless(m_rasterization_PL, recorder);
+		}
+	}
+	else
+	{
+		for (size_t i = firstModel; i < lastModel; i++)
+		{
 			// Actual commands for the renderPass
-			std::shared_ptr<Model> model = scene->getModel(element.first);
-			model->recordDrawCmds(frameIndex, DS_camera, m_rasterization_P, m_rasterization_PL, graphicsCmdBuffer);
+			numDraws += models[i]->recordDrawCmds(frameIndex, DS_camera, m_rasterization_P, m_rasterization_PL, recorder);
 		}
-		vkCmdEndRenderPass(graphicsCmdBuffer);
 	}
+	return numDraws;
 }
 
-inline void VulkanRendererBackend::recordCommandBuffer_PostProcessCmds(
-	unsigned int frameIndex, VkCommandBuffer& postProcessCmdBuffer, std::shared_ptr<Scene> scene,
+inline void VulkanRendererBackend::benchmarkDrawRecording(std::shared_ptr<Scene> scene, std::shared_ptr<Camera> camera, uint32_t numSyntheticModels)
+{
+	if (m_rendererOptions.renderType != RENDER_TYPE::RASTERIZATION)
+	{
+		throw std::runtime_error("the draw recording benchmark needs the rasterization pipeline");
+	}
+	if (scene->m_modelMap.empty())
+	{
+		throw std::runtime_error("the draw recording benchmark needs at least one model in the scene");
+	}
+
+	// The synthetic scene is the real scene's models repeated, so every draw binds real buffers and descriptor sets
+	std::vector<Model*> sceneModels;
+	for (auto const& element : scene->m_modelMap)
+	{
+		sceneModels.push_back(element.second.get());
+	}
+	std::vector<Model*> models(numSyntheticModels);
+	for (uint32_t i = 0; i < numSyntheticModels; i++)
+	{
+		models[i] = sceneModels[i % sceneModels.size()];
+	}
+
+	const unsigned int frameIndex = 0;
+	const VkDescriptorSet DS_camera = camera->getDescriptorSet(frameIndex);
+	const uint32_t numIterations = 10;
+	const uint32_t threadCounts[] = { 1, 2, 4, 8 };
+	float singleThreadTime = 0.0f;
+
+	std::cout << "Draw recording benchmark: " << numSyntheticModels << " models, best of " << numIterations << " recordings" << std::endl;
+	for (uint32_t numThreads : threadCounts)
+	{
+		ThreadPool threadPool(numThreads);
+		std::vector<VkCommandPool> cmdPools(numThreads);
+		std::vector<VkCommandBuffer> cmdBuffers(numThreads);
+		for (uint32_t range = 0; range < numThreads; range++)
+		{
+			VulkanCommandUtil::createCommandPool(m_logicalDevice, cmdPools[range],
+				m_vulkanManager->getQueueIndex(QueueFlags::Graphics), VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+			VulkanCommandUtil::allocateCommandBuffers(m_logicalDevice, cmdPools[range], 1, &cmdBuffers[range], VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+		}
+
+		float bestTime = FLT_MAX;
+		for (uint32_t iteration = 0; iteration < numIterations; iteration++)
+		{
+			TIME_POINT recordStart = std::chrono::high_resolution_clock::now();
+			threadPool.parallelFor(numThreads, [&](uint32_t range)
+			{
+				const size_t firstModel = models.size() * range / numThreads;
+				const size_t lastModel = models.size() * (range + 1) / numThreads;
+
+				VK_CHECK_RESULT(vkResetCommandPool(m_logicalDevice, cmdPools[range], 0));
+				VulkanCommandUtil::beginSecondaryCommandBuffer(cmdBuffers[range], m_rasterRPI.renderPass, 0, m_rasterRPI.frameBuffers[frameIndex]);
+				VulkanCommandRecorder recorder(cmdBuffers[range]);
+				recordCommandBuffer_ModelDraws(frameIndex, recorder, scene, DS_camera, models, firstModel, lastModel);
+				VulkanCommandUtil::endCommandBuffer(cmdBuffers[range]);
+			});
+			bestTime = std::min(bestTime, TimerUtil::getTimeElapsedSinceStart(recordStart));
+		}
+
+		for (VkCommandPool cmdPool : cmdPools)
+		{
+			vkDestroyCommandPool(m_logicalDevice, cmdPool, nullptr);
+		}
+
+		if (numThreads == 1)
+		{
+			singleThreadTime = bestTime;
+		}
+		std::cout << "  " << numThreads << " threads: " << bestTime << " ms, " << numSyntheticModels / (bestTime / 1000.0f) / 1e6f
+			<< " Mmodels/s, " << singleThreadTime / bestTime << "x" << std::endl;
+	}
+}
+
+inline uint32_t VulkanRendererBackend::recordCommandBuffer_PostProcessCmds(
+	unsigned int frameIndex, unsigned int imageIndex, VulkanCommandRecorder& postProcessRecorder, std::shared_ptr<Scene> scene,
 	VkRect2D renderArea, uint32_t clearValueCount, const VkClearValue* clearValues)
 {
+	VkCommandBuffer postProcessCmdBuffer = postProcessRecorder.getCommandBuffer();
 	for (unsigned int postProcessIndex =0; postProcessIndex <m_numPostEffects; postProcessIndex++)
 	{
 		const VkPipeline l_Pipeline = m_postProcess_Ps[postProcessIndex];
 		const VkPipelineLayout l_PipelineLayout = m_postProcess_PLs[postProcessIndex];
 		const VkRenderPass l_renderPass = m_postProcessRPIs[postProcessIndex].renderPass;
-		const VkFramebuffer l_frameBuffer = m_postProcessRPIs[postProcessIndex].frameBuffers[frameIndex];
+		// The last pass writes into the acquired swapchain image (see writeLastPostProcessPassToSwapChain)
+		const bool lastPass = (postProcessIndex == m_numPostEffects - 1);
+		const VkFramebuffer l_frameBuffer = m_postProcessRPIs[postProcessIndex].frameBuffers[lastPass ? imageIndex : frameIndex];
 
 		// Actual commands for the renderPass
 		{
-			VulkanCommandUtil::beginRenderPass(postProcessCmdBuffer, l_renderPass, l_frameBuffer, renderArea, clearValueCount, clearValues);
+			m_gpuProfiler->beginPass(postProcessCmdBuffer, frameIndex, m_postProcessProfilerPasses[postProcessIndex]);
+			postProcessRecorder.beginRenderPass(l_renderPass, l_frameBuffer, renderArea, clearValueCount, clearValues);
 			
-			const int numDescriptors = static_cast<int>(m_postProcessRPIs[postProcessIndex].descriptors.size() / 3);
+			const int numDescriptors = static_cast<int>(m_postProcessRPIs[postProcessIndex].descriptors.size() / m_numFramesInFlight);
 			for (int i = 0; i < numDescriptors; i++)
 			{
 				const int index = i + frameIndex * numDescriptors;
 				VkDescriptorSet DescSet = m_postProcessRPIs[postProcessIndex].descriptors[index];
-				vkCmdBindDescriptorSets(postProcessCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, l_PipelineLayout, i, 1, &DescSet, 0, nullptr);
+				postProcessRecorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, l_PipelineLayout, i, 1, &DescSet);
 			}
 			
 			// Check requested push constant size against hardware limit
@@ -276,61 +602,15 @@ inline void VulkanRendererBackend::recordCommandBuffer_PostProcessCmds(
 			assert(sizeof(shaderConstants) <= physicalDeviceProperties.limits.maxPushConstantsSize);
 #endif
 			// Submit shaderConstants via push constant (rather than a UBO)
-			vkCmdPushConstants(	postProcessCmdBuffer, l_PipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(shaderConstants), &shaderConstants);
-
-			vkCmdBindPipeline(postProcessCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, l_Pipeline);
-			vkCmdDraw(postProcessCmdBuffer, 3, 1, 0, 0);
-
-			vkCmdEndRenderPass(postProcessCmdBuffer);
-		}
-	}
-}
-inline void VulkanRendererBackend::recordCommandBuffer_FinalCmds(
-	unsigned int frameIndex, VkCommandBuffer& cmdBuffer)
-{
-	//--- Decoupling Post Process Passes from the swapchain ---
-	// We are not going to be making the last post process effect write to the swapchain directly. 
-	// This is because we want to decouple the post process passes, and hence their ordering, from the swapchain. 
-	// Instead of creating a renderpass to copy the results of the last post process pass into the swapchain we simply use a copy image command.
-	// The vkCmdCopyImage command requires that we do some image tranisitions for the source and destination images
-	{
-		const unsigned int fbaLowResLastUsed = (2 + (m_fbaLowResIndexInUse - 1)) % 2;
-		VkImage& srcImage = m_fbaLowRes[fbaLowResLastUsed][frameIndex].image;
-
-		VkImageLayout srcImageLayoutInitial = VK_IMAGE_LAYOUT_GENERAL;
-		VkImageLayout srcImageLayoutForTransition = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			postProcessRecorder.pushConstants(l_PipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(shaderConstants), &shaderConstants);
 
-		VkImageLayout swapChainImageLayoutInitial = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; ;
-		VkImageLayout swapChainImageLayoutBeforeUIPass = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		
-		const uint32_t mipLevels = 1;
-		// Pre-copy Transitions
-		{
-			// Transition Last post process pass's result image into VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
-			ImageUtil::transitionImageLayout(m_logicalDevice, m_graphicsQueue, m_graphicsCmdPool, cmdBuffer,
-				srcImage, m_lowResolutionRenderFormat, srcImageLayoutInitial, srcImageLayoutForTransition, mipLevels);
-
-			// Transition swapchain to VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-			m_vulkanManager->transitionSwapChainImageLayout(frameIndex, swapChainImageLayoutInitial, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, cmdBuffer, m_graphicsCmdPool);
-		}
-
-		// Copy last post process pass's image into the swapchain image
-		m_vulkanManager->copyImageToSwapChainImage(frameIndex, srcImage, cmdBuffer, m_graphicsCmdPool, m_windowExtents);
-
-		// Post-copy Transitions
-		{
-			// Transition Last post process pass's result image back into it's original layout
-			const VkAccessFlags srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
-			const VkPipelineStageFlags srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-			const VkAccessFlags dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-			const VkPipelineStageFlags dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
-			
-			ImageUtil::transitionImageLayout(m_logicalDevice, m_graphicsQueue, m_graphicsCmdPool, cmdBuffer,
-				srcImage, m_lowResolutionRenderFormat, srcImageLayoutForTransition, srcImageLayoutInitial, mipLevels,
-				srcAccessMask, dstAccessMask, srcStageMask, dstStageMask);
+			postProcessRecorder.bindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, l_Pipeline);
+			postProcessRecorder.draw(3, 1, 0, 0);
 
-			// Transition swapchain to the VkImageLayout expected by our UI manager
-			m_vulkanManager->transitionSwapChainImageLayout(frameIndex, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, swapChainImageLayoutBeforeUIPass, cmdBuffer, m_graphicsCmdPool);
+			postProcessRecorder.endRenderPass();
+			m_gpuProfiler->endPass(postProcessCmdBuffer, frameIndex, m_postProcessProfilerPasses[postProcessIndex]);
+			m_gpuProfiler->setPassCounters(frameIndex, m_postProcessProfilerPasses[postProcessIndex], postProcessRecorder.takeCounters());
 		}
 	}
+	return m_numPostEffects; // One fullscreen triangle each
 }
\ No newline at end of file
@@ -4,21 +4,31 @@
 inline void VulkanRendererBackend::cleanupPipelines()
 {
 	// Compute Pipeline
-	vkDestroyPipeline(m_logicalDevice, m_compute_P, nullptr);
-	vkDestroyPipelineLayout(m_logicalDevice, m_compute_PL, nullptr);
+	std::vector<VkPipeline> pipelines = { m_compute_P };
+	std::vector<VkPipelineLayout> pipelineLayouts = { m_compute_PL };
 
 	if (m_rendererOptions.renderType == RENDER_TYPE::RASTERIZATION)
 	{
 		// Rasterization Pipeline
-		vkDestroyPipeline(m_logicalDevice, m_rasterization_P, nullptr);
-		vkDestroyPipelineLayout(m_logicalDevice, m_rasterization_PL, nullptr);
+		pipelines.push_back(m_rasterization_P);
+		pipelineLayouts.push_back(m_rasterization_PL);
 	}
 	if (m_rendererOptions.renderType == RENDER_TYPE::RAYTRACE)
 	{
 		// Ray Tracing Pipeline
-		vkDestroyPipeline(m_logicalDevice, m_rayTrace_P, nullptr);
-		vkDestroyPipelineLayout(m_logicalDevice, m_rayTrace_PL, nullptr);
+		pipelines.push_back(m_rayTrace_P);
+		pipelineLayouts.push_back(m_rayTrace_PL);
 	}
+
+	VkDevice logicalDevice = m_logicalDevice;
+	m_vulkanManager->deferDestruction([logicalDevice, pipelines, pipelineLayouts]()
+	{
+		for (size_t i = 0; i < pipelines.size(); i++)
+		{
+			vkDestroyPipeline(logicalDevice, pipelines[i], nullptr);
+			vkDestroyPipelineLayout(logicalDevice, pipelineLayouts[i], nullptr);
+		}
+	});
 }
 inline void VulkanRendererBackend::createComputePipeline(VkPipeline& computePipeline, VkPipelineLayout computePipelineLayout, const std::string &shaderName)
 {
@@ -35,7 +45,11 @@ inline void VulkanRendererBackend::createComputePipeline(VkPipeline& computePipe
 inline void VulkanRendererBackend::createRasterizationRenderPipeline(std::vector<VkDescriptorSetLayout>& rasterizationDSL)
 {
 	// -------- Create Rasterization Layout -------------
-	m_rasterization_PL = VulkanPipelineCreation::createPipelineLayout(m_logicalDevice, rasterizationDSL, 0, nullptr);
+	// The bindless path has no per primitive descriptor sets, the model matrix and material index are pushed per draw instead
+	const bool isBindless = m_rendererOptions.bindlessTextures;
+	VkPushConstantRange bindlessPushConstantRange = { VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(BindlessDrawPushConstants) };
+	m_rasterization_PL = VulkanPipelineCreation::createPipelineLayout(m_logicalDevice, rasterizationDSL,
+		isBindless ? 1 : 0, isBindless ? &bindlessPushConstantRange : nullptr);
 
 	// -------- Vertex Input --------
 	// Vertex binding describes at which rate to load data from GPU memory 
@@ -57,7 +71,7 @@ inline void VulkanRendererBackend::createRasterizationRenderPipeline(std::vector
 	VkShaderModule vertShaderModule, fragShaderModule;
 	std::vector<VkPipelineShaderStageCreateInfo> shaderStages; shaderStages.resize(2);
 
-	ShaderUtil::createShaderStageInfos(shaderStages, "geometryPlain", vertShaderModule, fragShaderModule, m_logicalDevice);
+	ShaderUtil::createShaderStageInfos(shaderStages, isBindless ? "geometryBindless" : "geometryPlain", vertShaderModule, fragShaderModule, m_logicalDevice);
 
 	// -------- Create graphics pipeline ---------	
 	VulkanPipelineCreation::createGraphicsPipeline(m_logicalDevice,
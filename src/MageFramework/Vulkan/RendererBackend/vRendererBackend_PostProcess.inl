@@ -4,49 +4,59 @@
 
 inline void VulkanRendererBackend::cleanupPostProcess()
 {
-	// Destroy Pipelines
-	for (unsigned int i = 0; i<m_numPostEffects; i++)
+	// The frames in flight may still run the post process passes, their objects go once those frames have finished
+	VkDevice logicalDevice = m_logicalDevice;
+	m_vulkanManager->deferDestruction([logicalDevice, numFramesInFlight = m_numFramesInFlight,
+		postProcess_Ps = std::vector<VkPipeline>(m_postProcess_Ps.begin(), m_postProcess_Ps.begin() + m_numPostEffects),
+		postProcess_PLs = std::vector<VkPipelineLayout>(m_postProcess_PLs.begin(), m_postProcess_PLs.begin() + m_numPostEffects),
+		fbaHighRes = m_fbaHighRes, fbaLowRes = m_fbaLowRes, postProcessRPIs = m_postProcessRPIs]()
 	{
-		vkDestroyPipeline(m_logicalDevice, m_postProcess_Ps[i], nullptr);
-		vkDestroyPipelineLayout(m_logicalDevice, m_postProcess_PLs[i], nullptr);
-	}
+		// Destroy Pipelines
+		for (size_t i = 0; i < postProcess_Ps.size(); i++)
+		{
+			vkDestroyPipeline(logicalDevice, postProcess_Ps[i], nullptr);
+			vkDestroyPipelineLayout(logicalDevice, postProcess_PLs[i], nullptr);
+		}
+
+		//Destroy the common frame buffer attachments
+		for (unsigned int j = 0; j < 2; j++)
+		{
+			for (uint32_t i = 0; i < numFramesInFlight; i++)
+			{
+				// Destroy the frame buffer attachment
+				vkDestroyImage(logicalDevice, fbaHighRes[j][i].image, nullptr);
+				vkDestroyImageView(logicalDevice, fbaHighRes[j][i].view, nullptr);
+				VulkanMemoryTracker::free(logicalDevice, fbaHighRes[j][i].memory);
+
+				vkDestroyImage(logicalDevice, fbaLowRes[j][i].image, nullptr);
+				vkDestroyImageView(logicalDevice, fbaLowRes[j][i].view, nullptr);
+				VulkanMemoryTracker::free(logicalDevice, fbaLowRes[j][i].memory);
+			}
+		}
+
+		// Destroy all post process passes
+		for (const PostProcessRPI& postProcessRPI : postProcessRPIs)
+		{
+			// Destroy Framebuffers, the last pass has one per swapchain image instead of one per frame in flight
+			for (VkFramebuffer frameBuffer : postProcessRPI.frameBuffers)
+			{
+				vkDestroyFramebuffer(logicalDevice, frameBuffer, nullptr);
+			}
+			// Destroy Renderpasses
+			vkDestroyRenderPass(logicalDevice, postProcessRPI.renderPass, nullptr);
+		}
+	});
+
 	m_postEffectNames.clear();
+	m_postProcessProfilerPasses.clear();
 	m_postProcess_Ps.clear();
 	m_postProcess_PLs.clear();
 	m_numPostEffects = 0;
-	
-	// Destroy Samplers
-	vkDestroySampler(m_logicalDevice, m_postProcessSampler, nullptr);
-
-	//Destroy the common frame buffer attachments
 	for (unsigned int j = 0; j < 2; j++)
 	{
-		for (uint32_t i = 0; i < m_numSwapChainImages; i++)
-		{
-			// Destroy the frame buffer attachment
-			vkDestroyImage(m_logicalDevice, m_fbaHighRes[j][i].image, nullptr);
-			vkDestroyImageView(m_logicalDevice, m_fbaHighRes[j][i].view, nullptr);
-			vkFreeMemory(m_logicalDevice, m_fbaHighRes[j][i].memory, nullptr);
-
-			vkDestroyImage(m_logicalDevice, m_fbaLowRes[j][i].image, nullptr);
-			vkDestroyImageView(m_logicalDevice, m_fbaLowRes[j][i].view, nullptr);
-			vkFreeMemory(m_logicalDevice, m_fbaLowRes[j][i].memory, nullptr);
-		}
 		m_fbaHighRes[j].clear();
 		m_fbaLowRes[j].clear();
 	}
-
-	// Destroy all post process passes
-	for (unsigned int j = 0; j < m_postProcessRPIs.size(); j++)
-	{
-		for (uint32_t i = 0; i < m_numSwapChainImages; i++)
-		{
-			// Destroy Framebuffers
-			vkDestroyFramebuffer(m_logicalDevice, m_postProcessRPIs[j].frameBuffers[i], nullptr);
-		}
-		// Destroy Renderpasses
-		vkDestroyRenderPass(m_logicalDevice, m_postProcessRPIs[j].renderPass, nullptr);
-	}
 	m_postProcessRPIs.clear();
 }
 
@@ -56,20 +66,19 @@ inline void VulkanRendererBackend::prePostProcess()
 	m_fbaHighResIndexInUse = 0;
 	m_fbaLowResIndexInUse = 0;
 
-	// Create the post Process sampler
+	// Get the post Process sampler, the resource cache owns it and the geometry pass uses the same sampler state
 	{
 		const float mipLevels = 1;
-		const uint32_t arrayLayers = 1;
 		const float anisotropy = 16.0f;
 
-		ImageUtil::createImageSampler(m_logicalDevice, m_postProcessSampler, 
+		m_postProcessSampler = m_vulkanManager->getResourceCache()->getSampler(ImageUtil::createSamplerCreateInfo(
 			VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, 
-			VK_SAMPLER_MIPMAP_MODE_LINEAR, 0, 0, mipLevels, anisotropy, VK_COMPARE_OP_NEVER);
+			VK_SAMPLER_MIPMAP_MODE_LINEAR, 0, 0, mipLevels, anisotropy, VK_COMPARE_OP_NEVER));
 	}
 
 	// Store info used to fill out descriptors sets
-	m_prePostProcessInput.resize(m_numSwapChainImages);
-	for (uint32_t i = 0; i < m_numSwapChainImages; i++)
+	m_prePostProcessInput.resize(m_numFramesInFlight);
+	for (uint32_t i = 0; i < m_numFramesInFlight; i++)
 	{
 		if (m_rendererOptions.renderType == RENDER_TYPE::RASTERIZATION)
 		{
@@ -85,14 +94,6 @@ inline void VulkanRendererBackend::prePostProcess()
 		}
 	}
 
-	// Transition swapchain images to VK_IMAGE_LAYOUT_PRESENT_SRC_KHR for consistency during later transitions
-	for (uint32_t index = 0; index < m_numSwapChainImages; index++)
-	{
-		VkImageLayout oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		VkImageLayout newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;// VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL; //VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-		m_vulkanManager->transitionSwapChainImageLayout_SingleTimeCommand(index, oldLayout, newLayout, m_graphicsCmdPool);
-	}
-
 	// Create the framebuffer attachments used by more than one post process pass
 	{
 		// Ping pong post process framebuffers that will be alternatively read from and written into.
@@ -100,20 +101,19 @@ inline void VulkanRendererBackend::prePostProcess()
 		const VkImageLayout layoutBeforeImageCreation = VK_IMAGE_LAYOUT_UNDEFINED;
 		const VkImageLayout layoutToTransitionImageToAfterCreation = VK_IMAGE_LAYOUT_GENERAL; // No transition if same as layoutBeforeImageCreation
 		const VkImageUsageFlags frameBufferUsage = 
-			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | 
-			VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
 
 		for (uint32_t j = 0; j < 2; j++)
 		{
-			m_fbaHighRes[j].resize(m_numSwapChainImages);
-			m_fbaLowRes[j].resize(m_numSwapChainImages);
+			m_fbaHighRes[j].resize(m_numFramesInFlight);
+			m_fbaLowRes[j].resize(m_numFramesInFlight);
 
 			FrameResourcesUtil::createFrameBufferAttachments(m_logicalDevice, m_physicalDevice, m_graphicsQueue, m_graphicsCmdPool,
-				m_numSwapChainImages, m_fbaHighRes[j], m_highResolutionRenderFormat,
+				m_numFramesInFlight, m_fbaHighRes[j], m_highResolutionRenderFormat,
 				layoutBeforeImageCreation, layoutToTransitionImageToAfterCreation, m_windowExtents, frameBufferUsage);
 
 			FrameResourcesUtil::createFrameBufferAttachments(m_logicalDevice, m_physicalDevice, m_graphicsQueue, m_graphicsCmdPool,
-				m_numSwapChainImages, m_fbaLowRes[j], m_lowResolutionRenderFormat,
+				m_numFramesInFlight, m_fbaLowRes[j], m_lowResolutionRenderFormat,
 				layoutBeforeImageCreation, layoutToTransitionImageToAfterCreation, m_windowExtents, frameBufferUsage);
 		}
 	}
@@ -124,11 +124,11 @@ inline void VulkanRendererBackend::prePostProcess()
 inline void VulkanRendererBackend::expandDescriptorPool_PostProcess(std::vector<VkDescriptorPoolSize>& poolSizes)
 {
 	//Common
-	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_numSwapChainImages }); // before post process
-	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_numSwapChainImages }); // high res frame 1
-	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_numSwapChainImages }); // high res frame 2
-	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_numSwapChainImages }); // low res frame 1
-	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_numSwapChainImages }); // low res frame 2
+	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_numFramesInFlight }); // before post process
+	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_numFramesInFlight }); // high res frame 1
+	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_numFramesInFlight }); // high res frame 2
+	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_numFramesInFlight }); // low res frame 1
+	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_numFramesInFlight }); // low res frame 2
 
 	// Test High Res Pass
 	// Tonemap
@@ -139,23 +139,23 @@ inline void VulkanRendererBackend::createDescriptors_PostProcess_Common(VkDescri
 	int serialCount = 0;
 
 	m_postProcessDescriptorsCommon.push_back(DescriptorUtil::createImgSamplerDescriptor(
-		serialCount, "SampleFrameBeforePostProcess", m_numSwapChainImages, descriptorPool, m_logicalDevice));
+		serialCount, "SampleFrameBeforePostProcess", m_numFramesInFlight, descriptorPool, m_logicalDevice));
 	serialCount++;
 
 	m_postProcessDescriptorsCommon.push_back( DescriptorUtil::createImgSamplerDescriptor(
-		serialCount, "SampleFrameHighResolution1", m_numSwapChainImages, descriptorPool, m_logicalDevice) );
+		serialCount, "SampleFrameHighResolution1", m_numFramesInFlight, descriptorPool, m_logicalDevice) );
 	serialCount++;
 
 	m_postProcessDescriptorsCommon.push_back(DescriptorUtil::createImgSamplerDescriptor(
-		serialCount, "SampleFrameHighResolution2", m_numSwapChainImages, descriptorPool, m_logicalDevice));
+		serialCount, "SampleFrameHighResolution2", m_numFramesInFlight, descriptorPool, m_logicalDevice));
 	serialCount++;
 
 	m_postProcessDescriptorsCommon.push_back(DescriptorUtil::createImgSamplerDescriptor(
-		serialCount, "SampleFrameLowResolution1", m_numSwapChainImages, descriptorPool, m_logicalDevice));
+		serialCount, "SampleFrameLowResolution1", m_numFramesInFlight, descriptorPool, m_logicalDevice));
 	serialCount++;
 
 	m_postProcessDescriptorsCommon.push_back(DescriptorUtil::createImgSamplerDescriptor(
-		serialCount, "SampleFrameLowResolution2", m_numSwapChainImages, descriptorPool, m_logicalDevice));
+		serialCount, "SampleFrameLowResolution2", m_numFramesInFlight, descriptorPool, m_logicalDevice));
 	serialCount++;
 }
 inline void VulkanRendererBackend::createDescriptors_PostProcess_Specific(VkDescriptorPool descriptorPool)
@@ -166,14 +166,14 @@ inline void VulkanRendererBackend::createDescriptors_PostProcess_Specific(VkDesc
 	//	PostProcessDescriptors tonemapDescriptor;
 	//	tonemapDescriptor.descriptorName = "HighResTestPass";
 	//	tonemapDescriptor.serialIndex = serialCount;
-	//	tonemapDescriptor.postProcess_DSs.resize(m_numSwapChainImages);
+	//	tonemapDescriptor.postProcess_DSs.resize(m_numFramesInFlight);
 
 	//	const uint32_t numBindings = 1;
 	//	VkDescriptorSetLayoutBinding inputImageLayoutBinding = { 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr };
 	//	std::array<VkDescriptorSetLayoutBinding, numBindings> toneMapBindings = { inputImageLayoutBinding };
 	//	DescriptorUtil::createDescriptorSetLayout(m_logicalDevice, tonemapDescriptor.postProcess_DSL, numBindings, toneMapBindings.data());
 
-	//	for (uint32_t i = 0; i < m_numSwapChainImages; i++)
+	//	for (uint32_t i = 0; i < m_numFramesInFlight; i++)
 	//	{
 	//		DescriptorUtil::createDescriptorSets(m_logicalDevice, descriptorPool, 1, &tonemapDescriptor.postProcess_DSL, &tonemapDescriptor.postProcess_DSs[i]);
 	//	}
@@ -188,7 +188,7 @@ inline void VulkanRendererBackend::createDescriptors_PostProcess_Specific(VkDesc
 		//PostProcessDescriptors tonemapDescriptor;
 		//tonemapDescriptor.descriptorName = "Tonemap";
 		//tonemapDescriptor.serialIndex = serialCount;
-		//tonemapDescriptor.postProcess_DSs.resize(m_numSwapChainImages);
+		//tonemapDescriptor.postProcess_DSs.resize(m_numFramesInFlight);
 
 		//tonemapDescriptor.genericDescriptorsUsed.push_back(DSL_TYPE::BEFOREPOST_FRAME);
 
@@ -205,28 +205,28 @@ inline void VulkanRendererBackend::writeToAndUpdateDescriptorSets_PostProcess_Co
 	int index = 0;
 
 	DescriptorUtil::writeToImageSamplerDescriptor(m_postProcessDescriptorsCommon[index].postProcess_DSs,
-		m_prePostProcessInput, m_postProcessSampler, m_numSwapChainImages, m_logicalDevice);
+		m_prePostProcessInput, m_postProcessSampler, m_numFramesInFlight, m_logicalDevice);
 	index++;
 
 	DescriptorUtil::writeToImageSamplerDescriptor(m_postProcessDescriptorsCommon[index].postProcess_DSs,
-		m_fbaHighRes[0], VK_IMAGE_LAYOUT_GENERAL, m_postProcessSampler, m_numSwapChainImages, m_logicalDevice);
+		m_fbaHighRes[0], VK_IMAGE_LAYOUT_GENERAL, m_postProcessSampler, m_numFramesInFlight, m_logicalDevice);
 	index++;
 
 	DescriptorUtil::writeToImageSamplerDescriptor(m_postProcessDescriptorsCommon[index].postProcess_DSs,
-		m_fbaHighRes[1], VK_IMAGE_LAYOUT_GENERAL, m_postProcessSampler, m_numSwapChainImages, m_logicalDevice);
+		m_fbaHighRes[1], VK_IMAGE_LAYOUT_GENERAL, m_postProcessSampler, m_numFramesInFlight, m_logicalDevice);
 	index++;
 
 	DescriptorUtil::writeToImageSamplerDescriptor(m_postProcessDescriptorsCommon[index].postProcess_DSs,
-		m_fbaLowRes[0], VK_IMAGE_LAYOUT_GENERAL, m_postProcessSampler, m_numSwapChainImages, m_logicalDevice);
+		m_fbaLowRes[0], VK_IMAGE_LAYOUT_GENERAL, m_postProcessSampler, m_numFramesInFlight, m_logicalDevice);
 	index++;
 
 	DescriptorUtil::writeToImageSamplerDescriptor(m_postProcessDescriptorsCommon[index].postProcess_DSs,
-		m_fbaLowRes[1], VK_IMAGE_LAYOUT_GENERAL, m_postProcessSampler, m_numSwapChainImages, m_logicalDevice);
+		m_fbaLowRes[1], VK_IMAGE_LAYOUT_GENERAL, m_postProcessSampler, m_numFramesInFlight, m_logicalDevice);
 	index++;
 }
 inline void VulkanRendererBackend::writeToAndUpdateDescriptorSets_PostProcess_Specific()
 {
-	for (uint32_t i = 0; i < m_numSwapChainImages; i++)
+	for (uint32_t i = 0; i < m_numFramesInFlight; i++)
 	{
 		// Tone Map
 		// TODO: change to something that searches for the particular string name later
@@ -261,12 +261,12 @@ inline void VulkanRendererBackend::addPostProcessPass(std::string effectName,
 	std::vector<VkDescriptorSetLayout>& effectDSL, POST_PROCESS_TYPE postType, PostProcessRPI& postRPI)
 {
 	m_postEffectNames.push_back(effectName);	
+	m_postProcessProfilerPasses.push_back(m_gpuProfiler->registerPass(effectName, QueueFlags::Graphics));
 	postRPI.serialIndex = m_numPostEffects;
 	postRPI.postType = postType;
 
 	// All framebuffer attachments have been transitioned to VK_IMAGE_LAYOUT_GENERAL after creation
-	// Currently we only need to tranisiont the image to something other than VK_IMAGE_LAYOUT_GENERAL if it is the last pass.
-	// This is because after the last pass we will directly copy the result into the swapchain
+	// The last pass is moved onto the swapchain later (see writeLastPostProcessPassToSwapChain), so every pass starts out the same
 	const VkImageLayout layoutAfterImageCreation = VK_IMAGE_LAYOUT_GENERAL;
 	const VkImageLayout layoutAfterRenderPassExecuted = VK_IMAGE_LAYOUT_GENERAL;
 	const VkFormat depthFormat = VK_FORMAT_UNDEFINED; // m_depth.format
@@ -301,6 +301,69 @@ inline void VulkanRendererBackend::addPostProcessPass(std::string effectName,
 	m_numPostEffects++;
 }
 
+inline void VulkanRendererBackend::writeLastPostProcessPassToSwapChain()
+{
+	//--- Decoupling Post Process Passes from the swapchain ---
+	// Passes are added without knowing which one ends up last, so the post process chain can be reordered freely.
+	// Once all of them exist the last one gets a render pass and framebuffers on the swapchain images instead of its ping pong image,
+	// which saves copying that image into the swapchain every frame.
+	// Its pipeline is kept, render passes only have to match in their attachment formats to be compatible.
+	PostProcessRPI& lastRPI = m_postProcessRPIs.back();
+	if (lastRPI.postType == POST_PROCESS_TYPE::HIGH_RESOLUTION)
+	{
+		throw std::runtime_error("the last post process pass has to be a tonemap or low resolution pass to write to the swapchain!");
+	}
+
+	for (VkFramebuffer frameBuffer : lastRPI.frameBuffers)
+	{
+		vkDestroyFramebuffer(m_logicalDevice, frameBuffer, nullptr);
+	}
+	vkDestroyRenderPass(m_logicalDevice, lastRPI.renderPass, nullptr);
+
+	// The other passes render into images owned by the frame in flight, this one into whichever swapchain image was acquired
+	const uint32_t numSwapChainImages = m_vulkanManager->getSwapChainImageCount();
+	lastRPI.frameBuffers.resize(numSwapChainImages);
+	lastRPI.imageSetInfo.resize(numSwapChainImages);
+	addRenderPass_PostProcessToSwapChain(lastRPI.renderPass);
+	for (uint32_t i = 0; i < numSwapChainImages; i++)
+	{
+		std::array<VkImageView, 1> attachments = { m_vulkanManager->getSwapChainImageView(i) };
+
+		FrameResourcesUtil::createFrameBuffer(m_logicalDevice, lastRPI.frameBuffers[i], lastRPI.renderPass,
+			m_windowExtents, static_cast<uint32_t>(attachments.size()), attachments.data());
+
+		// Nothing samples the swapchain, this only keeps the output info accurate
+		lastRPI.imageSetInfo[i].imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		lastRPI.imageSetInfo[i].imageView = attachments[0];
+	}
+}
+
+inline void VulkanRendererBackend::addRenderPass_PostProcessToSwapChain(VkRenderPass& l_renderPass)
+{
+	std::vector<VkSubpassDependency> subpassDependencies;
+	{
+		// Waits on the previous pass's output and on the swapchain image being acquired, 
+		// the acquire semaphore is waited on at the color attachment output stage so the layout transition chains onto it
+		subpassDependencies.push_back(
+			RenderPassUtil::subpassDependency(VK_SUBPASS_EXTERNAL, 0,
+				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 
+				VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT));
+
+		// The UI is drawn on top afterwards
+		subpassDependencies.push_back(
+			RenderPassUtil::subpassDependency(0, VK_SUBPASS_EXTERNAL,
+				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT));
+	}
+
+	// Every pixel is overwritten, so the previous contents can be discarded with an undefined initial layout.
+	// The UI render pass expects the image in VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL and transitions it for presentation.
+	RenderPassUtil::renderPassCreationHelper(m_logicalDevice, l_renderPass,
+		m_vulkanManager->getSwapChainImageFormat(), VK_FORMAT_UNDEFINED, 
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, subpassDependencies);
+}
+
 inline void VulkanRendererBackend::addRenderPass_PostProcess( VkRenderPass& l_renderPass, 
 	const VkFormat colorFormat, const VkFormat depthFormat, const VkImageLayout initialLayout, const VkImageLayout finalLayout)
 {
@@ -326,10 +389,10 @@ inline void VulkanRendererBackend::addFrameBuffers_PostProcess(
 	PostProcessRPI& passRPI, VkFormat colorFormat, POST_PROCESS_TYPE postType,
 	std::vector<FrameBufferAttachment>& fbAttachments, const VkImageLayout afterRenderPassExecuted)
 {
-	passRPI.frameBuffers.resize(m_numSwapChainImages);
-	passRPI.imageSetInfo.resize(m_numSwapChainImages);
+	passRPI.frameBuffers.resize(m_numFramesInFlight);
+	passRPI.imageSetInfo.resize(m_numFramesInFlight);
 	
-	for (uint32_t i = 0; i < m_numSwapChainImages; i++)
+	for (uint32_t i = 0; i < m_numFramesInFlight; i++)
 	{
 		std::array<VkImageView, 1> attachments = { fbAttachments[i].view };
 
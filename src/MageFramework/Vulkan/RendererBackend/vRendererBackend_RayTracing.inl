@@ -3,17 +3,24 @@
 
 inline void VulkanRendererBackend::cleanupRayTracing()
 {
-	for (auto rayTracedImage : m_rayTracedImages)
+	// The frames in flight may still trace into the images, the last reference is handed to the deletion queue
+	for (std::shared_ptr<Texture2D>& rayTracedImage : m_rayTracedImages)
 	{
-		rayTracedImage.reset();
+		m_vulkanManager->deferDestruction(rayTracedImage);
 	}
+	m_rayTracedImages.clear();
 }
 inline void VulkanRendererBackend::destroyRayTracing()
 {	
-	vkFreeMemory(m_logicalDevice, m_topLevelAS.m_memory, nullptr);
-	vkDestroyAccelerationStructureNV(m_logicalDevice, m_topLevelAS.m_accelerationStructure, nullptr);
+	VkDevice logicalDevice = m_logicalDevice;
+	m_vulkanManager->deferDestruction([logicalDevice, topLevelASMemory = m_topLevelAS.m_memory, topLevelAS = m_topLevelAS.m_accelerationStructure,
+		shaderBindingTable = m_shaderBindingTable, destroyAccelerationStructure = vkDestroyAccelerationStructureNV]() mutable
+	{
+		VulkanMemoryTracker::free(logicalDevice, topLevelASMemory);
+		destroyAccelerationStructure(logicalDevice, topLevelAS, nullptr);
 
-	m_shaderBindingTable.destroy(m_logicalDevice);
+		shaderBindingTable.destroy(logicalDevice);
+	});
 }
 
 
@@ -49,15 +56,15 @@ inline void VulkanRendererBackend::createDescriptors_rayTracing(VkDescriptorPool
 	}
 
 	// Descriptor Sets
-	m_DS_rayTrace.resize(3);
-	for (uint32_t i = 0; i < m_numSwapChainImages; i++)
+	m_DS_rayTrace.resize(m_numFramesInFlight);
+	for (uint32_t i = 0; i < m_numFramesInFlight; i++)
 	{
 		DescriptorUtil::createDescriptorSets(m_logicalDevice, descriptorPool, 1, &m_DSL_rayTrace, &m_DS_rayTrace[i]);
 	}
 }
 inline void VulkanRendererBackend::writeToAndUpdateDescriptorSets_rayTracing(std::shared_ptr<Camera> camera, std::shared_ptr<Scene> scene)
 {
-	for (uint32_t i = 0; i < m_numSwapChainImages; i++)
+	for (uint32_t i = 0; i < m_numFramesInFlight; i++)
 	{
 		std::vector<VkWriteDescriptorSet> writeRayTracingDescriptorSets;
 
@@ -105,11 +112,11 @@ inline void VulkanRendererBackend::writeToAndUpdateDescriptorSets_rayTracing(std
 
 inline void VulkanRendererBackend::createStorageImages()
 {
-	m_rayTracedImages.resize(m_numSwapChainImages);
-	for (uint32_t i = 0; i < m_numSwapChainImages; i++)
+	m_rayTracedImages.resize(m_numFramesInFlight);
+	for (uint32_t i = 0; i < m_numFramesInFlight; i++)
 	{
 		m_rayTracedImages[i] = std::make_shared<Texture2D>(
-			m_logicalDevice, m_physicalDevice, m_graphicsQueue, m_graphicsCmdPool, m_lowResolutionRenderFormat);
+			m_vulkanManager, m_graphicsQueue, m_graphicsCmdPool, m_lowResolutionRenderFormat);
 		m_rayTracedImages[i]->createEmptyTexture(
 			m_windowExtents.width, m_windowExtents.height, 1, 1, 
 			m_graphicsQueue, m_graphicsCmdPool, false,
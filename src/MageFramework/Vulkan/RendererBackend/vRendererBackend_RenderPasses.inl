@@ -6,30 +6,32 @@
 
 inline void VulkanRendererBackend::cleanupRenderPassesAndFrameResources()
 {
-	// Destroy Depth Image Common to every render pass
-	vkDestroyImage(m_logicalDevice, m_depth.image, nullptr);
-	vkFreeMemory(m_logicalDevice, m_depth.memory, nullptr);
-	vkDestroyImageView(m_logicalDevice, m_depth.view, nullptr);
-
-	for (uint32_t i = 0; i < m_numSwapChainImages; i++)
+	// The frames in flight may still render into the attachments, they go once those frames have finished
+	VkDevice logicalDevice = m_logicalDevice;
+	m_vulkanManager->deferDestruction([logicalDevice, depth = m_depth, rasterRPI = m_rasterRPI, numFramesInFlight = m_numFramesInFlight]()
 	{
-		// Destroy Framebuffers
-		vkDestroyFramebuffer(m_logicalDevice, m_rasterRPI.frameBuffers[i], nullptr);
+		// Destroy Depth Image Common to every render pass
+		vkDestroyImage(logicalDevice, depth.image, nullptr);
+		VulkanMemoryTracker::free(logicalDevice, depth.memory);
+		vkDestroyImageView(logicalDevice, depth.view, nullptr);
 
-		// Destroy the color attachments
+		for (uint32_t i = 0; i < numFramesInFlight; i++)
 		{
-			// m_rasterRPI.color
-			vkDestroyImage(m_logicalDevice, m_rasterRPI.color[i].image, nullptr);
-			vkDestroyImageView(m_logicalDevice, m_rasterRPI.color[i].view, nullptr);
-			vkFreeMemory(m_logicalDevice, m_rasterRPI.color[i].memory, nullptr);
+			// Destroy Framebuffers
+			vkDestroyFramebuffer(logicalDevice, rasterRPI.frameBuffers[i], nullptr);
+
+			// Destroy the color attachments
+			{
+				// rasterRPI.color
+				vkDestroyImage(logicalDevice, rasterRPI.color[i].image, nullptr);
+				vkDestroyImageView(logicalDevice, rasterRPI.color[i].view, nullptr);
+				VulkanMemoryTracker::free(logicalDevice, rasterRPI.color[i].memory);
+			}
 		}
-	}
 
-	// Destroy Samplers
-	vkDestroySampler(m_logicalDevice, m_rasterRPI.sampler, nullptr);
-
-	// Destroy Renderpasses
-	vkDestroyRenderPass(m_logicalDevice, m_rasterRPI.renderPass, nullptr);
+		// Destroy Renderpasses
+		vkDestroyRenderPass(logicalDevice, rasterRPI.renderPass, nullptr);
+	});
 }
 inline void VulkanRendererBackend::createRenderPasses(const VkImageLayout& beforeRenderPassExecuted, const VkImageLayout& afterRenderPassExecuted)
 {
@@ -96,17 +98,21 @@ inline void VulkanRendererBackend::createFrameBuffers(
 
 	// Render Geometry
 	{
-		m_rasterRPI.frameBuffers.resize(m_numSwapChainImages);
-		m_rasterRPI.color.resize(m_numSwapChainImages);
-		m_rasterRPI.imageSetInfo.resize(m_numSwapChainImages);
+		m_rasterRPI.frameBuffers.resize(m_numFramesInFlight);
+		m_rasterRPI.color.resize(m_numFramesInFlight);
+		m_rasterRPI.imageSetInfo.resize(m_numFramesInFlight);
 		m_rasterRPI.extents = m_windowExtents;
 
 		FrameResourcesUtil::createFrameBufferAttachments(m_logicalDevice, m_physicalDevice, m_graphicsQueue, m_graphicsCmdPool,
-			m_numSwapChainImages, m_rasterRPI.color, m_rasterRPI.sampler, m_highResolutionRenderFormat,
+			m_numFramesInFlight, m_rasterRPI.color, m_highResolutionRenderFormat,
 			layoutBeforeImageCreation, layoutToTransitionImageToAfterCreation, m_windowExtents, frameBufferUsage);
 
+		// Shared sampler, owned by the resource cache so it isn't destroyed with the render pass
+		m_rasterRPI.sampler = m_vulkanManager->getResourceCache()->getSampler(ImageUtil::createSamplerCreateInfo(
+			VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_SAMPLER_MIPMAP_MODE_LINEAR, 0, 0, 1.0f));
+
 		const uint32_t numAttachments = 2;
-		for (uint32_t i = 0; i < m_numSwapChainImages; i++)
+		for (uint32_t i = 0; i < m_numFramesInFlight; i++)
 		{
 			std::array<VkImageView, numAttachments> attachments = { m_rasterRPI.color[i].view, m_depth.view };
 
@@ -44,7 +44,7 @@ namespace AccelerationUtil
         memoryAllocateInfo.memoryTypeIndex = BufferUtil::findMemoryType(
             pDevice, l_memoryRequirements2.memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-        VK_CHECK_RESULT(vkAllocateMemory(logicalDevice, &memoryAllocateInfo, nullptr, &accelerationStructure.m_memory));
+        VK_CHECK_RESULT(VulkanMemoryTracker::allocate(logicalDevice, memoryAllocateInfo, accelerationStructure.m_memory, MEMORY_CATEGORY::ACCELERATION_STRUCTURE));
     }
 
     inline void bindAccelerationStructure(VkDevice& logicalDevice, vAccelerationStructure& accelerationStructure,
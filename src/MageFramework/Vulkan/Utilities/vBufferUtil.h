@@ -1,6 +1,7 @@
 #pragma once
 #include <global.h>
 #include <Vulkan/Utilities/vCommandUtil.h>
+#include <Vulkan/vulkanMemoryTracker.h>
 
 struct mageVKBuffer
 {
@@ -39,7 +40,7 @@ struct mageVKBuffer
 	void destroy(VkDevice& logicalDevice)
 	{
 		vkDestroyBuffer(logicalDevice, buffer, nullptr);
-		vkFreeMemory(logicalDevice, memory, nullptr);
+		VulkanMemoryTracker::free(logicalDevice, memory);
 	}
 };
 
@@ -69,7 +70,7 @@ namespace BufferUtil
 	}
 
 	inline void allocateMemory(VkPhysicalDevice& pDevice, VkDevice& logicalDevice,
-		VkBuffer& buffer, VkDeviceMemory& bufferMemory, VkMemoryPropertyFlags properties)
+		VkBuffer& buffer, VkDeviceMemory& bufferMemory, VkMemoryPropertyFlags properties, MEMORY_CATEGORY category)
 	{
 		// The VkMemoryRequirements struct has three fields:
 		// - size: The size of the required amount of memory in bytes, may differ from bufferInfo.size.
@@ -83,7 +84,7 @@ namespace BufferUtil
 		allocInfo.allocationSize = memRequirements.size;
 		allocInfo.memoryTypeIndex = findMemoryType(pDevice, memRequirements.memoryTypeBits, properties);
 
-		if (vkAllocateMemory(logicalDevice, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
+		if (VulkanMemoryTracker::allocate(logicalDevice, allocInfo, bufferMemory, category) != VK_SUCCESS)
 		{
 			throw std::runtime_error("failed to allocate buffer memory!");
 		}
@@ -111,7 +112,7 @@ namespace BufferUtil
 
 		VK_CHECK_RESULT( vkCreateBuffer(logicalDevice, &bufferCreationInfo, nullptr, &buffer) );
 
-		BufferUtil::allocateMemory(pDevice, logicalDevice, buffer, bufferMemory, properties);
+		BufferUtil::allocateMemory(pDevice, logicalDevice, buffer, bufferMemory, properties, VulkanMemoryTracker::categorizeBuffer(allowedUsage, properties));
 
 		// The fourth parameter in vkBindBufferMemory is the offset within the region of memory. 
 		// Since this memory is allocated specifically for this the vertex buffer, the offset is simply 0.
@@ -119,6 +120,24 @@ namespace BufferUtil
 		vkBindBufferMemory(logicalDevice, buffer, bufferMemory, 0);
 	}
 
+	inline VkBufferMemoryBarrier createBufferMemoryBarrier(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size,
+		VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask,
+		uint32_t srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED, uint32_t dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED)
+	{
+		// Same as VkImageMemoryBarrier minus the layouts, the queue family indices transfer ownership of the buffer
+		VkBufferMemoryBarrier l_bufferBarrier = {};
+		l_bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		l_bufferBarrier.buffer = buffer;
+		l_bufferBarrier.offset = offset;
+		l_bufferBarrier.size = size;
+		l_bufferBarrier.srcAccessMask = srcAccessMask;
+		l_bufferBarrier.dstAccessMask = dstAccessMask;
+		l_bufferBarrier.srcQueueFamilyIndex = srcQueueFamilyIndex;
+		l_bufferBarrier.dstQueueFamilyIndex = dstQueueFamilyIndex;
+
+		return l_bufferBarrier;
+	}
+
 	inline void copyBuffer(VkDevice& logicalDevice, VkQueue& queue, VkCommandPool& cmdPool,
 		VkBuffer& srcBuffer, VkBuffer& dstBuffer, VkDeviceSize srcOffset, VkDeviceSize dstOffset, VkDeviceSize size)
 	{
@@ -198,7 +217,7 @@ namespace BufferUtil
 
 		// ----- Free Staging Buffer and its memory -----
 		vkDestroyBuffer(logicalDevice, stagingBuffer, nullptr);
-		vkFreeMemory(logicalDevice, stagingBufferMemory, nullptr);
+		VulkanMemoryTracker::free(logicalDevice, stagingBufferMemory);
 	}
 	
 	inline void createMageIndexBuffer(VkDevice& logicalDevice, VkPhysicalDevice& pDevice, VkQueue& graphicsQueue, VkCommandPool& cmdPool,
@@ -221,6 +240,6 @@ namespace BufferUtil
 
 		// ----- Free Staging Buffer and its memory -----
 		vkDestroyBuffer(logicalDevice, stagingBuffer, nullptr);
-		vkFreeMemory(logicalDevice, stagingBufferMemory, nullptr);
+		VulkanMemoryTracker::free(logicalDevice, stagingBufferMemory);
 	}
 }
\ No newline at end of file
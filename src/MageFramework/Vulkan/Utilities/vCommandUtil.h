@@ -76,7 +76,7 @@ namespace VulkanCommandUtil
 		return cmdBuffer;
 	}
 
-	inline void beginCommandBuffer(VkCommandBuffer& cmdBuffer)
+	inline void beginCommandBuffer(VkCommandBuffer& cmdBuffer, VkCommandBufferUsageFlags flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT)
 	{
 		// Begin recording a command buffer by calling vkBeginCommandBuffer
 
@@ -85,8 +85,8 @@ namespace VulkanCommandUtil
 		// - VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT : This is a secondary command buffer that will be entirely within a single render pass.
 		// - VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT : The command buffer can be resubmitted while it is also already pending execution.
 
-		// We use VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT because we may already be scheduling the drawing commands for the next frame 
-		// while the last frame is not finished yet.
+		// Prerecorded command buffers use VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT because we may already be scheduling the drawing
+		// commands for the next frame while the last frame is not finished yet. Command buffers recorded every frame are one time submits.
 
 		// The pInheritanceInfo parameter is only relevant for secondary command buffers. 
 		// It specifies which state to inherit from the calling primary command buffers.
@@ -96,7 +96,7 @@ namespace VulkanCommandUtil
 
 		VkCommandBufferBeginInfo beginInfo = {};
 		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+		beginInfo.flags = flags;
 		beginInfo.pInheritanceInfo = nullptr; // Optional
 
 		if (vkBeginCommandBuffer(cmdBuffer, &beginInfo) != VK_SUCCESS)
@@ -105,6 +105,30 @@ namespace VulkanCommandUtil
 		}
 	}
 
+	inline void beginSecondaryCommandBuffer(VkCommandBuffer& cmdBuffer, VkRenderPass renderPass, uint32_t subpass, VkFramebuffer framebuffer,
+		VkQueryPipelineStatisticFlags pipelineStatistics = 0)
+	{
+		// Secondary command buffers that are executed inside a render pass have to know which render pass, subpass and framebuffer
+		// they'll be executed in. Nothing else is inherited from the primary, so pipelines and descriptor sets have to be bound again.
+		VkCommandBufferInheritanceInfo inheritanceInfo = {};
+		inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritanceInfo.renderPass = renderPass;
+		inheritanceInfo.subpass = subpass;
+		inheritanceInfo.framebuffer = framebuffer; // Optional, but lets the driver optimize for the exact framebuffer
+		// Has to cover the pipeline statistics query the primary has active while it executes this one
+		inheritanceInfo.pipelineStatistics = pipelineStatistics;
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+		beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+		if (vkBeginCommandBuffer(cmdBuffer, &beginInfo) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to begin recording secondary command buffer!");
+		}
+	}
+
 	inline void endCommandBuffer(VkCommandBuffer& cmdBuffer)
 	{
 		VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
@@ -181,7 +205,8 @@ namespace VulkanCommandUtil
 	}
 
 	inline void beginRenderPass(VkCommandBuffer& cmdBuffer, VkRenderPass renderPass, VkFramebuffer framebuffer,
-		VkRect2D renderArea, uint32_t clearValueCount, const VkClearValue* clearValue)
+		VkRect2D renderArea, uint32_t clearValueCount, const VkClearValue* clearValue,
+		VkSubpassContents subpassContents = VK_SUBPASS_CONTENTS_INLINE)
 	{
 		VkRenderPassBeginInfo renderPassInfo = {};
 		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -198,7 +223,7 @@ namespace VulkanCommandUtil
 		// - VK_SUBPASS_CONTENTS_INLINE: The render pass commands will be embedded in the primary command buffer itself 
 		//								and no secondary command buffers will be executed.
 		// - VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : The render pass commands will be executed from secondary command buffers.
-		vkCmdBeginRenderPass(cmdBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBeginRenderPass(cmdBuffer, &renderPassInfo, subpassContents);
 	}
 
 	inline void pipelineBarrier(VkCommandBuffer cmdBuffer,
@@ -219,7 +244,7 @@ namespace VulkanCommandUtil
 		//					That means that the implementation is allowed to already begin reading from the parts of a resource that
 		//					were written so far, for example.
 		vkCmdPipelineBarrier(cmdBuffer, srcStageMask, dstStageMask, dependencyFlags,
-			bufferMemoryBarrierCount, pMemoryBarriers,
+			memoryBarrierCount, pMemoryBarriers,
 			bufferMemoryBarrierCount, pBufferMemoryBarriers,
 			imageMemoryBarrierCount, pImageMemoryBarriers);
 	}
@@ -25,11 +25,14 @@ namespace DescriptorUtil
 	}
 
 	inline void createDescriptorSetLayout(VkDevice& logicalDevice, VkDescriptorSetLayout& descriptorSetLayout,
-		uint32_t bindingCount, VkDescriptorSetLayoutBinding* data)
+		uint32_t bindingCount, VkDescriptorSetLayoutBinding* data,
+		const void* pNext = nullptr, VkDescriptorSetLayoutCreateFlags flags = 0)
 	{
+		// pNext and flags are only needed for extension features, e.g. binding flags from VK_EXT_descriptor_indexing
 		VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = {};
 		descriptorSetLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-		descriptorSetLayoutCreateInfo.pNext = nullptr;
+		descriptorSetLayoutCreateInfo.pNext = pNext;
+		descriptorSetLayoutCreateInfo.flags = flags;
 		descriptorSetLayoutCreateInfo.bindingCount = bindingCount;
 		descriptorSetLayoutCreateInfo.pBindings = data;
 
@@ -48,12 +51,13 @@ namespace DescriptorUtil
 		return l_poolSize;
 	}
 
-	inline void createDescriptorPool(VkDevice& logicalDevice, uint32_t maxSets, uint32_t poolSizeCount, VkDescriptorPoolSize* data, VkDescriptorPool& descriptorPool)
+	inline void createDescriptorPool(VkDevice& logicalDevice, uint32_t maxSets, uint32_t poolSizeCount, VkDescriptorPoolSize* data, VkDescriptorPool& descriptorPool,
+		VkDescriptorPoolCreateFlags flags = 0)
 	{
 		VkDescriptorPoolCreateInfo descriptorPoolInfo = {};
 		descriptorPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 		descriptorPoolInfo.pNext = nullptr;
-		descriptorPoolInfo.flags = 0; // Change if you're going to modify the descriptor set after its creation
+		descriptorPoolInfo.flags = flags; // Change if you're going to modify the descriptor set after its creation
 		descriptorPoolInfo.poolSizeCount = poolSizeCount;
 		descriptorPoolInfo.pPoolSizes = data;
 		descriptorPoolInfo.maxSets = maxSets; // max number of descriptor sets allowed
@@ -64,10 +68,11 @@ namespace DescriptorUtil
 	}
 
 	inline void createDescriptorSets(VkDevice& logicalDevice, VkDescriptorPool descriptorPool, uint32_t descriptorSetCount,
-		VkDescriptorSetLayout* descriptorSetLayouts, VkDescriptorSet* descriptorSetData)
+		VkDescriptorSetLayout* descriptorSetLayouts, VkDescriptorSet* descriptorSetData, const void* pNext = nullptr)
 	{
 		VkDescriptorSetAllocateInfo allocInfo = {};
 		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.pNext = pNext;
 		allocInfo.descriptorPool = descriptorPool;
 		allocInfo.descriptorSetCount = descriptorSetCount;
 		allocInfo.pSetLayouts = descriptorSetLayouts;
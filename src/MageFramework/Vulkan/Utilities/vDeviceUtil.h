@@ -78,6 +78,38 @@ namespace VulkanDevicesUtil
 		return indices;
 	}
 
+	inline VkQueueFlags getQueueFamilyFlags(VkPhysicalDevice pDevice, int queueFamilyIndex)
+	{
+		uint32_t queueFamilyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(pDevice, &queueFamilyCount, nullptr);
+
+		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(pDevice, &queueFamilyCount, queueFamilies.data());
+
+		return (queueFamilyIndex >= 0 && queueFamilyIndex < static_cast<int>(queueFamilyCount)) ? queueFamilies[queueFamilyIndex].queueFlags : 0;
+	}
+
+	// First queue family that supports all of the required flags and none of the excluded ones, -1 if there is none
+	// e.g. a compute family without graphics is what lets compute work run alongside graphics work
+	inline int findQueueFamily(VkPhysicalDevice pDevice, VkQueueFlags requiredFlags, VkQueueFlags excludedFlags)
+	{
+		uint32_t queueFamilyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(pDevice, &queueFamilyCount, nullptr);
+
+		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(pDevice, &queueFamilyCount, queueFamilies.data());
+
+		for (uint32_t i = 0; i < queueFamilyCount; i++)
+		{
+			const VkQueueFlags flags = queueFamilies[i].queueFlags;
+			if (queueFamilies[i].queueCount > 0 && (flags & requiredFlags) == requiredFlags && (flags & excludedFlags) == 0)
+			{
+				return static_cast<int>(i);
+			}
+		}
+		return -1;
+	}
+
 	inline bool checkDeviceExtensionSupport(VkPhysicalDevice pDevice, std::vector<const char*> requiredExtensions)
 	{
 		uint32_t extensionCount;
@@ -111,10 +143,12 @@ namespace VulkanDevicesUtil
 		VkPhysicalDeviceFeatures* deviceFeatures,
 		uint32_t queueCreateInfoCount, VkDeviceQueueCreateInfo* queueCreateInfos,
 		uint32_t deviceExtensionCount, const char** deviceExtensionNames,
-		uint32_t validationLayerCount, const char* const* validationLayerNames)
+		uint32_t validationLayerCount, const char* const* validationLayerNames,
+		const void* pNext = nullptr)
 	{
 		VkDeviceCreateInfo logicalDeviceCreateInfo = {};
 		logicalDeviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		logicalDeviceCreateInfo.pNext = pNext; // Chain of extension feature structs
 		logicalDeviceCreateInfo.queueCreateInfoCount = queueCreateInfoCount;
 		logicalDeviceCreateInfo.pQueueCreateInfos = queueCreateInfos;
 		logicalDeviceCreateInfo.pEnabledFeatures = deviceFeatures;
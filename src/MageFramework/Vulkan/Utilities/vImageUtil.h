@@ -3,6 +3,7 @@
 #include <Vulkan/Utilities/vBufferUtil.h>
 #include <Vulkan/Utilities/vCommandUtil.h>
 #include <Utilities/generalUtility.h>
+#include <Utilities/imageProcessingUtility.h>
 
 enum class FixTextureFlag { NONE, ADD_PADDING, SCALE_UP, SCALE_DOWN };
 
@@ -74,7 +75,7 @@ namespace ImageUtil
 		allocInfo.allocationSize = memRequirements.size;
 		allocInfo.memoryTypeIndex = BufferUtil::findMemoryType(pDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-		if (vkAllocateMemory(logicalDevice, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
+		if (VulkanMemoryTracker::allocate(logicalDevice, allocInfo, imageMemory, VulkanMemoryTracker::categorizeImage(usage)) != VK_SUCCESS)
 		{
 			throw std::runtime_error("failed to allocate image memory!");
 		}
@@ -82,8 +83,8 @@ namespace ImageUtil
 		vkBindImageMemory(logicalDevice, image, imageMemory, 0);
 	}
 
-	inline void createImageView(VkDevice& logicalDevice, VkImage& image, VkImageView* imageView,
-		VkImageViewType viewType, VkFormat format, VkImageAspectFlags aspectMask, uint32_t mipLevels, const VkAllocationCallbacks* pAllocator)
+	inline VkImageViewCreateInfo createImageViewCreateInfo(VkImage& image, VkImageViewType viewType, VkFormat format, 
+		VkImageAspectFlags aspectMask, uint32_t mipLevels, uint32_t layerCount = 1)
 	{
 		VkImageViewCreateInfo l_createInfo = {};
 		l_createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -97,16 +98,23 @@ namespace ImageUtil
 		l_createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
 		l_createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
 
-		//No Mipmapping and no multiple targets
-		l_createInfo.subresourceRange = createImageSubResourceRange(aspectMask, 0, mipLevels, 0, 1);
+		// Array views (VK_IMAGE_VIEW_TYPE_2D_ARRAY) see all the layers of the image
+		l_createInfo.subresourceRange = createImageSubResourceRange(aspectMask, 0, mipLevels, 0, layerCount);
+		return l_createInfo;
+	}
 
+	inline void createImageView(VkDevice& logicalDevice, VkImage& image, VkImageView* imageView,
+		VkImageViewType viewType, VkFormat format, VkImageAspectFlags aspectMask, uint32_t mipLevels, const VkAllocationCallbacks* pAllocator,
+		uint32_t layerCount = 1)
+	{
+		VkImageViewCreateInfo l_createInfo = createImageViewCreateInfo(image, viewType, format, aspectMask, mipLevels, layerCount);
 		if (vkCreateImageView(logicalDevice, &l_createInfo, pAllocator, imageView) != VK_SUCCESS)
 		{
 			throw std::runtime_error("Failed to create image views!");
 		}
 	}
 
-	inline void createImageSampler(VkDevice& logicalDevice, VkSampler& imageSampler,
+	inline VkSamplerCreateInfo createSamplerCreateInfo(
 		VkFilter magFilter, VkFilter minFilter, VkSamplerAddressMode addressMode,
 		VkSamplerMipmapMode mipmapMode, float mipLodBias, float minLod, float maxLod,
 		float maxAnisotropy = 16, VkCompareOp compareOp = VK_COMPARE_OP_NEVER)
@@ -164,7 +172,17 @@ namespace ImageUtil
 
 		l_samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
 		l_samplerInfo.unnormalizedCoordinates = VK_FALSE;
+		return l_samplerInfo;
+	}
 
+	// Prefer VulkanResourceCache::getSampler, samplers created here are owned by the caller
+	inline void createImageSampler(VkDevice& logicalDevice, VkSampler& imageSampler,
+		VkFilter magFilter, VkFilter minFilter, VkSamplerAddressMode addressMode,
+		VkSamplerMipmapMode mipmapMode, float mipLodBias, float minLod, float maxLod,
+		float maxAnisotropy = 16, VkCompareOp compareOp = VK_COMPARE_OP_NEVER)
+	{
+		VkSamplerCreateInfo l_samplerInfo = createSamplerCreateInfo(magFilter, minFilter, addressMode, 
+			mipmapMode, mipLodBias, minLod, maxLod, maxAnisotropy, compareOp);
 		if (vkCreateSampler(logicalDevice, &l_samplerInfo, nullptr, &imageSampler) != VK_SUCCESS)
 		{
 			throw std::runtime_error("failed to create image sampler!");
@@ -201,7 +219,7 @@ namespace ImageUtil
 	}
 
 	inline void transitionImageLayout(VkDevice& logicalDevice, VkQueue& queue, VkCommandPool& cmdPool, VkCommandBuffer& cmdBuffer,
-		VkImage& image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels)
+		VkImage& image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels, uint32_t layerCount = 1)
 	{
 		// Set VkAccessMasks and VkPipelineStageFlags based on the layouts used in the transition
 		VkAccessFlags srcAccessMask, dstAccessMask;
@@ -294,7 +312,7 @@ namespace ImageUtil
 			throw std::invalid_argument("unsupported layout transition!");
 		}
 
-		VkImageSubresourceRange imageSubresourceRange = createImageSubResourceRange(aspectMask, 0, mipLevels, 0, 1);
+		VkImageSubresourceRange imageSubresourceRange = createImageSubResourceRange(aspectMask, 0, mipLevels, 0, layerCount);
 		VkImageMemoryBarrier imageBarrier = createImageMemoryBarrier(image, oldLayout, newLayout, srcAccessMask, dstAccessMask, imageSubresourceRange);
 		VulkanCommandUtil::pipelineBarrier(cmdBuffer, srcStageMask, dstStageMask, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
 	}
@@ -314,11 +332,11 @@ namespace ImageUtil
 	}
 
 	inline void transitionImageLayout_SingleTimeCommand(VkDevice& logicalDevice, VkQueue& queue, VkCommandPool& cmdPool,
-		VkImage& image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels)
+		VkImage& image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels, uint32_t layerCount = 1)
 	{
 		VkCommandBuffer cmdBuffer;
 		VulkanCommandUtil::beginSingleTimeCommand(logicalDevice, cmdPool, cmdBuffer);
-		transitionImageLayout(logicalDevice, queue, cmdPool, cmdBuffer,	image, format, oldLayout, newLayout, mipLevels);
+		transitionImageLayout(logicalDevice, queue, cmdPool, cmdBuffer,	image, format, oldLayout, newLayout, mipLevels, layerCount);
 		VulkanCommandUtil::endAndSubmitSingleTimeCommand(logicalDevice, queue, cmdPool, cmdBuffer);
 	}
 
@@ -394,7 +412,7 @@ namespace ImageUtil
 		vkCmdCopyImage(cmdBuffer, srcImage, srcImageLayout, dstImage, dstImageLayout, regionCount, &region);
 	}
 
-	inline VkImageBlit imageBlit(int32_t mipWidth, int32_t mipHeight, int32_t mipDepth, uint32_t srcMipLevel, uint32_t dstMipLevel)
+	inline VkImageBlit imageBlit(int32_t mipWidth, int32_t mipHeight, int32_t mipDepth, uint32_t srcMipLevel, uint32_t dstMipLevel, uint32_t layerCount = 1)
 	{
 		// specify the regions that will be used in the blit operation.
 		VkImageBlit l_blit = {};
@@ -406,7 +424,7 @@ namespace ImageUtil
 		l_blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		l_blit.srcSubresource.mipLevel = srcMipLevel; //i-1
 		l_blit.srcSubresource.baseArrayLayer = 0;
-		l_blit.srcSubresource.layerCount = 1;
+		l_blit.srcSubresource.layerCount = layerCount;
 
 		// dstOffsets determines the region that data will be blitted to
 		// dimensions of the dstOffsets[1] are divided by two since each mip level is half the size of the previous level.
@@ -418,13 +436,15 @@ namespace ImageUtil
 		l_blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		l_blit.dstSubresource.mipLevel = dstMipLevel; //i
 		l_blit.dstSubresource.baseArrayLayer = 0;
-		l_blit.dstSubresource.layerCount = 1;
+		l_blit.dstSubresource.layerCount = layerCount;
 
 		return l_blit;
 	}
 
-	inline void generateMipMaps(VkDevice& logicalDevice, VkPhysicalDevice& pDevice, VkQueue& queue, VkCommandPool& cmdPool,
-		VkImage& image, VkFormat imgFormat, int32_t imgWidth, int32_t imgHeight, int32_t imgDepth, uint32_t mipLevels)
+	// Records the mip chain generation into cmdBuffer, every level is expected to be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+	// and ends up in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL. Blits need a queue with graphics support.
+	inline void recordGenerateMipMaps(VkCommandBuffer cmdBuffer, VkPhysicalDevice pDevice,
+		VkImage& image, VkFormat imgFormat, int32_t imgWidth, int32_t imgHeight, int32_t imgDepth, uint32_t mipLevels, uint32_t layerCount = 1)
 	{
 		// Our texture image has multiple mip levels, but the staging buffer can only be used to fill mip level 0. 
 		// The other levels are still undefined. To fill these levels we need to generate the data from the single level that we have.
@@ -454,14 +474,12 @@ namespace ImageUtil
 			throw std::runtime_error("texture image format does not support linear blitting!");
 		}
 
-		VkCommandBuffer cmdBuffer;
-		VulkanCommandUtil::beginSingleTimeCommand(logicalDevice, cmdPool, cmdBuffer);
-
 		VkAccessFlags srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
 		VkAccessFlags dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
 		VkImageLayout oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
 		VkImageLayout newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-		VkImageSubresourceRange imageSubresourceRange = createImageSubResourceRange(VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1);
+		// Every layer of a texture array is blitted at the same time
+		VkImageSubresourceRange imageSubresourceRange = createImageSubResourceRange(VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, layerCount);
 		VkImageMemoryBarrier imageBarrier = createImageMemoryBarrier(image, oldLayout, newLayout, srcAccessMask, dstAccessMask, imageSubresourceRange);
 
 		int32_t mipWidth = imgWidth;
@@ -486,7 +504,7 @@ namespace ImageUtil
 				0, nullptr,
 				1, &imageBarrier);
 
-			VkImageBlit imgBlit = imageBlit(mipWidth, mipHeight, mipDepth, i - 1, i);
+			VkImageBlit imgBlit = imageBlit(mipWidth, mipHeight, mipDepth, i - 1, i, layerCount);
 
 			VulkanCommandUtil::blitImage(cmdBuffer,
 				image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
@@ -525,59 +543,55 @@ namespace ImageUtil
 			0, nullptr,
 			0, nullptr,
 			1, &imageBarrier);
+	}
 
+	inline void generateMipMaps(VkDevice& logicalDevice, VkPhysicalDevice& pDevice, VkQueue& queue, VkCommandPool& cmdPool,
+		VkImage& image, VkFormat imgFormat, int32_t imgWidth, int32_t imgHeight, int32_t imgDepth, uint32_t mipLevels, uint32_t layerCount = 1)
+	{
+		VkCommandBuffer cmdBuffer;
+		VulkanCommandUtil::beginSingleTimeCommand(logicalDevice, cmdPool, cmdBuffer);
+		recordGenerateMipMaps(cmdBuffer, pDevice, image, imgFormat, imgWidth, imgHeight, imgDepth, mipLevels, layerCount);
 		VulkanCommandUtil::endAndSubmitSingleTimeCommand(logicalDevice, queue, cmdPool, cmdBuffer);
 	}
 
 
 	// ------------------------------------------------------------------------------------
-	// DEFINITELY NOT DONE
-	// TODO: decide on an interpolation technique for down and up sampling
-	// TODO: finish the function
-	// This function is a no-op right now;
+	// Texture arrays need every layer to have the same width and height.
+	// This brings every layer to desiredW x desiredH:
+	// - ADD_PADDING pads (or crops) the image, the padding is opaque black
+	// - SCALE_UP and SCALE_DOWN resample the image; the flag only describes how desiredW and desiredH were picked
+	//   (i.e. the size of the biggest or the smallest layer), the filtering is the same for both.
+	// pixelsArray holds one tightly packed RGBA8 image per layer, imgWidths and imgHeights are updated to the new sizes.
 	inline void fixImagesForTextureArray(
-		uint32_t numLayers, FixTextureFlag fix, uint32_t desiredW, uint32_t desiredH,
+		FixTextureFlag fix, uint32_t desiredW, uint32_t desiredH,
+		std::vector<std::vector<unsigned char>>& pixelsArray,
 		std::vector<uint32_t>& imgWidths, std::vector<uint32_t>& imgHeights)
 	{
-		return;
-		if (fix == FixTextureFlag::NONE) { return; }
-
+		const uint32_t numLayers = static_cast<uint32_t>(pixelsArray.size());
+		std::vector<unsigned char> fixedPixels;
 		for (uint32_t layer = 0; layer < numLayers; layer++)
 		{
-			std::vector<unsigned char> pixels;
-			pixels.reserve(desiredW * desiredH * 4);
-			for (uint32_t i = 0; i < desiredW; i++)
+			if (imgWidths[layer] == desiredW && imgHeights[layer] == desiredH)
 			{
-				for (uint32_t j = 0; j < desiredH; j++)
-				{
-					uint32_t pixelIndex = i * desiredW + j;
-
-					if (fix == FixTextureFlag::ADD_PADDING)
-					{
-						//pixels[pixelIndex + 0] = pixelsArray[layer][pixelIndex + 0];
-						//pixels[pixelIndex + 1] = pixelsArray[layer][pixelIndex + 1];
-						//pixels[pixelIndex + 2] = pixelsArray[layer][pixelIndex + 2];
-						//pixels[pixelIndex + 3] = pixelsArray[layer][pixelIndex + 3];
-					}
-					else if (fix == FixTextureFlag::SCALE_UP
-						&& imgWidths[layer] != desiredW
-						&& imgHeights[layer] != desiredH)
-					{
-						//pixels[pixelIndex + 0] = pixelsArray[layer][pixelIndex + 0];
-						//pixels[pixelIndex + 1] = pixelsArray[layer][pixelIndex + 1];
-						//pixels[pixelIndex + 2] = pixelsArray[layer][pixelIndex + 2];
-						//pixels[pixelIndex + 3] = pixelsArray[layer][pixelIndex + 3];
-					}
-					else if (fix == FixTextureFlag::SCALE_DOWN)
-					{
-						//pixels[pixelIndex + 0] = pixelsArray[layer][pixelIndex + 0];
-						//pixels[pixelIndex + 1] = pixelsArray[layer][pixelIndex + 1];
-						//pixels[pixelIndex + 2] = pixelsArray[layer][pixelIndex + 2];
-						//pixels[pixelIndex + 3] = pixelsArray[layer][pixelIndex + 3];
-					}
-				}
+				continue;
 			}
-		}
 
+			if (fix == FixTextureFlag::NONE)
+			{
+				throw std::runtime_error("Textures in a texture array need to be of the same size");
+			}
+			else if (fix == FixTextureFlag::ADD_PADDING)
+			{
+				ImageProcessingUtil::padImage(pixelsArray[layer].data(), imgWidths[layer], imgHeights[layer], fixedPixels, desiredW, desiredH);
+			}
+			else
+			{
+				ImageProcessingUtil::resizeImage(pixelsArray[layer].data(), imgWidths[layer], imgHeights[layer], fixedPixels, desiredW, desiredH);
+			}
+
+			pixelsArray[layer].swap(fixedPixels);
+			imgWidths[layer] = desiredW;
+			imgHeights[layer] = desiredH;
+		}
 	}
 }
\ No newline at end of file
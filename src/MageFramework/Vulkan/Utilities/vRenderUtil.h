@@ -51,6 +51,7 @@ struct PostProcessPushConstants
 	// Updating any of these values requires rebuilding of commandbuffers
 	float toneMap_WhitePoint = 10.0f;
 	float toneMap_Exposure = 2.5f;
+	float toneMap_EncodeGamma = 1.0f; // 0 when the output image is sRGB
 };
 
 namespace RenderPassUtil
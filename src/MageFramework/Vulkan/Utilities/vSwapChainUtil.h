@@ -28,27 +28,34 @@ namespace SwapChainUtil
 	}
 
 	// Specify the presentation mode of the swap chain
-	inline VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR> availablePresentModes)
+	inline VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR> availablePresentModes, VkPresentModeKHR preferredPresentMode)
 	{
-		// Second choice
-		// good for implementing double buffering
-		VkPresentModeKHR bestMode = VK_PRESENT_MODE_FIFO_KHR;
+		// FIFO		 -- waits for vertical blank, no tearing, the queue of presentable images adds latency when the GPU is ahead
+		// MAILBOX	 -- waits for vertical blank but newer images replace the queued one, no tearing and lower latency (triple buffering)
+		// IMMEDIATE -- presents right away, lowest latency but tears
+		for (const auto& availablePresentMode : availablePresentModes)
+		{
+			if (availablePresentMode == preferredPresentMode)
+			{
+				return availablePresentMode;
+			}
+		}
 
+		// The preferred mode isn't supported, fall back to MAILBOX, then IMMEDIATE, then FIFO
+		VkPresentModeKHR bestMode = VK_PRESENT_MODE_FIFO_KHR;
 		for (const auto& availablePresentMode : availablePresentModes)
 		{
 			if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR)
 			{
-				// First choice
-				// good for implementing triple buffering
 				return availablePresentMode;
 			}
 			else if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR)
 			{
-				// Third choice
 				bestMode = availablePresentMode;
 			}
 		}
 
+		// FIFO is the only mode every surface has to support
 		return bestMode;
 	}
 
@@ -0,0 +1,173 @@
+#pragma once
+#include <global.h>
+#include <Vulkan/Utilities/vCommandUtil.h>
+
+// What was recorded into a command buffer, counted on the CPU while recording
+struct CommandCounters
+{
+	uint32_t draws = 0;
+	uint32_t dispatches = 0; // Compute dispatches and ray traces
+	uint32_t pipelineBinds = 0;
+	uint32_t descriptorSetBinds = 0; // Every set counts, also when several are bound by one call
+	uint32_t pushConstants = 0;
+	uint32_t barriers = 0; // Pipeline barrier calls, however many memory, buffer and image barriers each one has
+	// Binds of the pipeline or descriptor set that was already bound there, with the same layout and no dynamic offsets
+	uint32_t redundantBinds = 0;
+
+	CommandCounters& operator+=(const CommandCounters& other)
+	{
+		draws += other.draws;
+		dispatches += other.dispatches;
+		pipelineBinds += other.pipelineBinds;
+		descriptorSetBinds += other.descriptorSetBinds;
+		pushConstants += other.pushConstants;
+		barriers += other.barriers;
+		redundantBinds += other.redundantBinds;
+		return *this;
+	}
+};
+
+// Thin wrapper around the vkCmd* calls of the renderer's passes, every call goes straight through and bumps a counter.
+// It also remembers what is bound so binding the same pipeline or descriptor set again shows up as redundant.
+// One recorder per command buffer and thread, secondary command buffers get their own and are added with executeCommands.
+class VulkanCommandRecorder
+{
+public:
+	explicit VulkanCommandRecorder(VkCommandBuffer cmdBuffer) : m_cmdBuffer(cmdBuffer) {}
+
+	VkCommandBuffer getCommandBuffer() const { return m_cmdBuffer; }
+	const CommandCounters& getCounters() const { return m_counters; }
+	// Returns what was counted since the last call, the bound state is kept since it carries over to the next pass
+	CommandCounters takeCounters()
+	{
+		const CommandCounters counters = m_counters;
+		m_counters = CommandCounters();
+		return counters;
+	}
+
+	void bindPipeline(VkPipelineBindPoint bindPoint, VkPipeline pipeline)
+	{
+		BoundState& bound = getBoundState(bindPoint);
+		m_counters.redundantBinds += (bound.pipeline == pipeline) ? 1 : 0;
+		bound.pipeline = pipeline;
+		m_counters.pipelineBinds++;
+		vkCmdBindPipeline(m_cmdBuffer, bindPoint, pipeline);
+	}
+	void bindDescriptorSets(VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t firstSet, uint32_t descriptorSetCount,
+		const VkDescriptorSet* descriptorSets, uint32_t dynamicOffsetCount = 0, const uint32_t* dynamicOffsets = nullptr)
+	{
+		BoundState& bound = getBoundState(bindPoint);
+		if (bound.layout != layout)
+		{
+			// Sets bound with another layout may or may not still be compatible, forgetting them never reports a needed bind as redundant
+			bound.layout = layout;
+			bound.descriptorSets.fill(VK_NULL_HANDLE);
+		}
+		for (uint32_t i = 0; i < descriptorSetCount; i++)
+		{
+			const uint32_t set = firstSet + i;
+			if (set < MAX_TRACKED_SETS)
+			{
+				m_counters.redundantBinds += (dynamicOffsetCount == 0 && bound.descriptorSets[set] == descriptorSets[i]) ? 1 : 0;
+				bound.descriptorSets[set] = descriptorSets[i];
+			}
+		}
+		m_counters.descriptorSetBinds += descriptorSetCount;
+		vkCmdBindDescriptorSets(m_cmdBuffer, bindPoint, layout, firstSet, descriptorSetCount, descriptorSets, dynamicOffsetCount, dynamicOffsets);
+	}
+	void pushConstants(VkPipelineLayout layout, VkShaderStageFlags stageFlags, uint32_t offset, uint32_t size, const void* values)
+	{
+		m_counters.pushConstants++;
+		vkCmdPushConstants(m_cmdBuffer, layout, stageFlags, offset, size, values);
+	}
+	void bindVertexBuffers(uint32_t firstBinding, uint32_t bindingCount, const VkBuffer* buffers, const VkDeviceSize* offsets)
+	{
+		vkCmdBindVertexBuffers(m_cmdBuffer, firstBinding, bindingCount, buffers, offsets);
+	}
+	void bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType)
+	{
+		vkCmdBindIndexBuffer(m_cmdBuffer, buffer, offset, indexType);
+	}
+
+	void draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance)
+	{
+		m_counters.draws++;
+		vkCmdDraw(m_cmdBuffer, vertexCount, instanceCount, firstVertex, firstInstance);
+	}
+	void drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance)
+	{
+		m_counters.draws++;
+		vkCmdDrawIndexed(m_cmdBuffer, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
+	}
+	void dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
+	{
+		m_counters.dispatches++;
+		vkCmdDispatch(m_cmdBuffer, groupCountX, groupCountY, groupCountZ);
+	}
+	// The ray tracing entry points are loaded at runtime, the renderer backend hands in its pointer
+	void traceRays(PFN_vkCmdTraceRaysNV cmdTraceRays, VkBuffer shaderBindingTable, VkDeviceSize rayGenOffset,
+		VkDeviceSize missOffset, VkDeviceSize missStride, VkDeviceSize hitOffset, VkDeviceSize hitStride,
+		uint32_t width, uint32_t height, uint32_t depth)
+	{
+		m_counters.dispatches++;
+		cmdTraceRays(m_cmdBuffer,
+			shaderBindingTable, rayGenOffset,
+			shaderBindingTable, missOffset, missStride,
+			shaderBindingTable, hitOffset, hitStride,
+			VK_NULL_HANDLE, 0, 0,
+			width, height, depth);
+	}
+
+	void pipelineBarrier(VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask, VkDependencyFlags dependencyFlags,
+		uint32_t memoryBarrierCount, const VkMemoryBarrier* pMemoryBarriers,
+		uint32_t bufferMemoryBarrierCount, const VkBufferMemoryBarrier* pBufferMemoryBarriers,
+		uint32_t imageMemoryBarrierCount, const VkImageMemoryBarrier* pImageMemoryBarriers)
+	{
+		m_counters.barriers++;
+		VulkanCommandUtil::pipelineBarrier(m_cmdBuffer, srcStageMask, dstStageMask, dependencyFlags,
+			memoryBarrierCount, pMemoryBarriers, bufferMemoryBarrierCount, pBufferMemoryBarriers, imageMemoryBarrierCount, pImageMemoryBarriers);
+	}
+
+	void beginRenderPass(VkRenderPass renderPass, VkFramebuffer framebuffer, VkRect2D renderArea,
+		uint32_t clearValueCount, const VkClearValue* clearValues, VkSubpassContents subpassContents = VK_SUBPASS_CONTENTS_INLINE)
+	{
+		VulkanCommandUtil::beginRenderPass(m_cmdBuffer, renderPass, framebuffer, renderArea, clearValueCount, clearValues, subpassContents);
+	}
+	void endRenderPass()
+	{
+		vkCmdEndRenderPass(m_cmdBuffer);
+	}
+	// The secondary command buffers' counters, nothing they bound carries over to this command buffer
+	void executeCommands(uint32_t commandBufferCount, const VkCommandBuffer* commandBuffers, const CommandCounters& secondaryCounters)
+	{
+		m_counters += secondaryCounters;
+		vkCmdExecuteCommands(m_cmdBuffer, commandBufferCount, commandBuffers);
+	}
+
+private:
+	static const uint32_t MAX_TRACKED_SETS = 4;
+	struct BoundState
+	{
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		VkPipelineLayout layout = VK_NULL_HANDLE;
+		std::array<VkDescriptorSet, MAX_TRACKED_SETS> descriptorSets = {};
+	};
+
+	BoundState& getBoundState(VkPipelineBindPoint bindPoint)
+	{
+		switch (bindPoint)
+		{
+		case VK_PIPELINE_BIND_POINT_COMPUTE:
+			return m_bound[1];
+		case VK_PIPELINE_BIND_POINT_RAY_TRACING_NV:
+			return m_bound[2];
+		default:
+			return m_bound[0];
+		}
+	}
+
+private:
+	VkCommandBuffer m_cmdBuffer;
+	CommandCounters m_counters;
+	std::array<BoundState, 3> m_bound; // Graphics, compute and ray tracing each have their own bound state
+};
@@ -0,0 +1,63 @@
+#include "vulkanDeletionQueue.h"
+
+VulkanDeletionQueue::~VulkanDeletionQueue()
+{
+	flush();
+}
+
+void VulkanDeletionQueue::retire(uint64_t lastUseFrame, uint64_t lastUploadTicket, std::function<void()> destroy)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_retiredObjects.push_back({ lastUseFrame, lastUploadTicket, std::move(destroy), nullptr });
+	m_numRetired++;
+}
+void VulkanDeletionQueue::retire(uint64_t lastUseFrame, uint64_t lastUploadTicket, std::shared_ptr<void> object)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_retiredObjects.push_back({ lastUseFrame, lastUploadTicket, nullptr, std::move(object) });
+	m_numRetired++;
+}
+
+uint32_t VulkanDeletionQueue::collect(uint64_t completedFrame, uint64_t completedUploadTicket)
+{
+	// Destructors can retire more objects (e.g. a model's textures), so they run without the lock held
+	std::deque<RetiredObject> finishedObjects;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		while (!m_retiredObjects.empty() && m_retiredObjects.front().lastUseFrame <= completedFrame &&
+			m_retiredObjects.front().lastUploadTicket <= completedUploadTicket)
+		{
+			finishedObjects.push_back(std::move(m_retiredObjects.front()));
+			m_retiredObjects.pop_front();
+		}
+	}
+
+	for (RetiredObject& retiredObject : finishedObjects)
+	{
+		destroy(retiredObject);
+	}
+	return static_cast<uint32_t>(finishedObjects.size());
+}
+void VulkanDeletionQueue::flush()
+{
+	// Keep going until destroying objects doesn't retire any new ones
+	while (collect(UINT64_MAX, UINT64_MAX) > 0) {}
+}
+
+void VulkanDeletionQueue::destroy(RetiredObject& retiredObject)
+{
+	if (retiredObject.destroy)
+	{
+		retiredObject.destroy();
+	}
+	retiredObject.object.reset();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_numDestroyed++;
+}
+
+uint32_t VulkanDeletionQueue::getNumPending()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return static_cast<uint32_t>(m_retiredObjects.size());
+}
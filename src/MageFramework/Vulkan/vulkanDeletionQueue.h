@@ -0,0 +1,53 @@
+#pragma once
+#include <global.h>
+#include <mutex>
+#include <deque>
+#include <functional>
+
+// Destroys Vulkan objects once the GPU is done with them instead of waiting for the device to go idle.
+// Every retired object is tagged with the frame that is being prepared when it is retired, i.e. the last frame that may still use it,
+// and with the newest upload batch (see VulkanUploadQueue), which may still be copying into it. It is destroyed once both have finished.
+// The VulkanManager moves the frames along, see VulkanManager::deferDestruction.
+//
+// Objects either hand over a function that destroys their handles, or are kept alive through their last shared_ptr,
+// in which case their destructor runs once the frame has finished. Destructors of the objects that go through here
+// (Texture, Model) don't wait on the device, whoever drops them while frames are in flight has to retire them.
+class VulkanDeletionQueue
+{
+public:
+	VulkanDeletionQueue() = default;
+	~VulkanDeletionQueue();
+
+	VulkanDeletionQueue(const VulkanDeletionQueue&) = delete;
+	VulkanDeletionQueue& operator=(const VulkanDeletionQueue&) = delete;
+
+	void retire(uint64_t lastUseFrame, uint64_t lastUploadTicket, std::function<void()> destroy);
+	void retire(uint64_t lastUseFrame, uint64_t lastUploadTicket, std::shared_ptr<void> object);
+
+	// Destroys everything whose frame and upload batch have finished, never waits. Returns how many objects were destroyed.
+	uint32_t collect(uint64_t completedFrame, uint64_t completedUploadTicket);
+	// Destroys everything, the device has to be idle
+	void flush();
+
+	// Stats
+	uint32_t getNumPending();
+	uint64_t getNumRetired() const { return m_numRetired; }
+	uint64_t getNumDestroyed() const { return m_numDestroyed; }
+
+private:
+	struct RetiredObject
+	{
+		uint64_t lastUseFrame;
+		uint64_t lastUploadTicket;
+		std::function<void()> destroy;
+		std::shared_ptr<void> object;
+	};
+
+	void destroy(RetiredObject& retiredObject);
+
+private:
+	std::mutex m_mutex;
+	std::deque<RetiredObject> m_retiredObjects; // Frames and tickets only ever increase, so this is sorted by both
+	uint64_t m_numRetired = 0;
+	uint64_t m_numDestroyed = 0;
+};
@@ -0,0 +1,354 @@
+#include "vulkanFrameCapture.h"
+#include <Vulkan/Utilities/vCommandUtil.h>
+#include <Vulkan/Utilities/vBufferUtil.h>
+#include <Utilities/threadPool.h>
+#include <Utilities/timerUtility.h>
+#include <stb_image_write.h>
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+
+namespace
+{
+	// The CPU reads these back, uncached memory is write combined and very slow to read from, so cached memory comes first
+	uint32_t findReadbackMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, bool& coherent)
+	{
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+		const VkMemoryPropertyFlags preferences[] = {
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+		for (VkMemoryPropertyFlags properties : preferences)
+		{
+			for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+			{
+				if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+				{
+					coherent = (memoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+					return i;
+				}
+			}
+		}
+		throw std::runtime_error("no host visible memory to read frames back into");
+	}
+
+	bool isBGRA(VkFormat format)
+	{
+		return format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+	}
+	bool isRGBA(VkFormat format)
+	{
+		return format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R8G8B8A8_SRGB;
+	}
+}
+
+VulkanFrameCapture::VulkanFrameCapture(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, uint32_t graphicsFamily)
+	: m_logicalDevice(logicalDevice), m_physicalDevice(physicalDevice)
+{
+	VulkanCommandUtil::createCommandPool(m_logicalDevice, m_cmdPool, graphicsFamily, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+
+	// PNG encoding is the slow part, half the hardware threads keep up with a few frames in flight without starving the recording threads
+	const uint32_t numEncoders = std::max(1u, std::thread::hardware_concurrency() / 2);
+	m_encoders = std::make_unique<ThreadPool>(numEncoders);
+	m_maxPending = 2 * numEncoders;
+}
+VulkanFrameCapture::~VulkanFrameCapture()
+{
+	collectAll();
+	waitForEncoders();
+	m_encoders.reset();
+
+	for (Slot& slot : m_slots)
+	{
+		destroyReadbackBuffer(slot);
+	}
+	vkDestroyCommandPool(m_logicalDevice, m_cmdPool, nullptr);
+}
+
+void VulkanFrameCapture::requestScreenshot(const std::string& path, CAPTURE_FORMAT format)
+{
+	m_screenshotRequested = true;
+	m_screenshotPath = path;
+	m_screenshotFormat = format;
+}
+void VulkanFrameCapture::startSequence(const std::string& pathPrefix, CAPTURE_FORMAT format)
+{
+	const std::filesystem::path directory = std::filesystem::path(pathPrefix).parent_path();
+	if (!directory.empty())
+	{
+		std::filesystem::create_directories(directory);
+	}
+	m_sequenceActive = true;
+	m_sequencePrefix = pathPrefix;
+	m_sequenceFormat = format;
+	m_sequenceFrame = 0;
+}
+void VulkanFrameCapture::stopSequence()
+{
+	m_sequenceActive = false;
+}
+
+VulkanFrameCapture::Slot& VulkanFrameCapture::getSlot(uint32_t slot)
+{
+	if (slot >= m_slots.size())
+	{
+		m_slots.resize(slot + 1);
+	}
+	return m_slots[slot];
+}
+
+void VulkanFrameCapture::resizeReadbackBuffer(Slot& slot, VkDeviceSize size)
+{
+	if (slot.buffer != VK_NULL_HANDLE && slot.size == size)
+	{
+		return;
+	}
+	destroyReadbackBuffer(slot);
+
+	VkBufferCreateInfo bufferCreateInfo = BufferUtil::bufferCreateInfo(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_SHARING_MODE_EXCLUSIVE);
+	VK_CHECK_RESULT(vkCreateBuffer(m_logicalDevice, &bufferCreateInfo, nullptr, &slot.buffer));
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(m_logicalDevice, slot.buffer, &memoryRequirements);
+	VkMemoryAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocateInfo.allocationSize = memoryRequirements.size;
+	allocateInfo.memoryTypeIndex = findReadbackMemoryType(m_physicalDevice, memoryRequirements.memoryTypeBits, slot.coherent);
+	VK_CHECK_RESULT(VulkanMemoryTracker::allocate(m_logicalDevice, allocateInfo, slot.memory, MEMORY_CATEGORY::STAGING));
+	vkBindBufferMemory(m_logicalDevice, slot.buffer, slot.memory, 0);
+
+	// Stays mapped for the lifetime of the buffer
+	vkMapMemory(m_logicalDevice, slot.memory, 0, VK_WHOLE_SIZE, 0, &slot.mappedData);
+	slot.size = size;
+}
+void VulkanFrameCapture::destroyReadbackBuffer(Slot& slot)
+{
+	if (slot.buffer == VK_NULL_HANDLE)
+	{
+		return;
+	}
+	vkUnmapMemory(m_logicalDevice, slot.memory);
+	vkDestroyBuffer(m_logicalDevice, slot.buffer, nullptr);
+	VulkanMemoryTracker::free(m_logicalDevice, slot.memory);
+	slot.buffer = VK_NULL_HANDLE;
+	slot.memory = VK_NULL_HANDLE;
+	slot.mappedData = nullptr;
+	slot.size = 0;
+}
+
+VkCommandBuffer VulkanFrameCapture::recordCapture(uint32_t slotIndex, VkImage image, VkFormat imageFormat, VkExtent2D extent, VkImageLayout imageLayout)
+{
+	if (!m_screenshotRequested && !m_sequenceActive)
+	{
+		return VK_NULL_HANDLE;
+	}
+	TIME_POINT startTime = std::chrono::high_resolution_clock::now();
+
+	std::string path;
+	CAPTURE_FORMAT format;
+	if (m_screenshotRequested)
+	{
+		m_screenshotRequested = false;
+		path = m_screenshotPath;
+		format = m_screenshotFormat;
+	}
+	else
+	{
+		char frameNumber[16];
+		snprintf(frameNumber, sizeof(frameNumber), "_%05u", m_sequenceFrame++);
+		path = m_sequencePrefix + frameNumber + ((m_sequenceFormat == CAPTURE_FORMAT::PNG) ? ".png" : ".rgba");
+		format = m_sequenceFormat;
+	}
+
+	if (image == VK_NULL_HANDLE || !(isBGRA(imageFormat) || isRGBA(imageFormat)))
+	{
+#ifndef NDEBUG
+		std::cout << "Can't capture " << path << ", the image can't be copied from or isn't 8 bits per channel" << std::endl;
+#endif
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stats.numFailed++;
+		return VK_NULL_HANDLE;
+	}
+
+	Slot& slot = getSlot(slotIndex);
+	resizeReadbackBuffer(slot, static_cast<VkDeviceSize>(extent.width) * extent.height * 4);
+	if (slot.cmdBuffer == VK_NULL_HANDLE)
+	{
+		VulkanCommandUtil::allocateCommandBuffers(m_logicalDevice, m_cmdPool, 1, &slot.cmdBuffer);
+	}
+	slot.pending = true;
+	slot.path = path;
+	slot.format = format;
+	slot.imageFormat = imageFormat;
+	slot.extent = extent;
+
+	// The slot's last copy was collected before its image was handed out again, so the command buffer is free to reset
+	vkResetCommandBuffer(slot.cmdBuffer, 0);
+	VulkanCommandUtil::beginCommandBuffer(slot.cmdBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+	// The frame's color writes have to land before the copy, presentable images move to transfer source and back around it
+	VkImageSubresourceRange subresourceRange = {};
+	subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	subresourceRange.levelCount = 1;
+	subresourceRange.layerCount = 1;
+	VkImageMemoryBarrier imageBarrier = {};
+	imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.image = image;
+	imageBarrier.subresourceRange = subresourceRange;
+	imageBarrier.oldLayout = imageLayout;
+	imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	imageBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	VulkanCommandUtil::pipelineBarrier(slot.cmdBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+		0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+	VkBufferImageCopy region = {};
+	region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	region.imageExtent = { extent.width, extent.height, 1 };
+	vkCmdCopyImageToBuffer(slot.cmdBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer, 1, &region);
+
+	if (imageLayout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
+	{
+		imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		imageBarrier.newLayout = imageLayout;
+		imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		imageBarrier.dstAccessMask = 0;
+		VulkanCommandUtil::pipelineBarrier(slot.cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+			0, nullptr, 0, nullptr, 1, &imageBarrier);
+	}
+	VkBufferMemoryBarrier bufferBarrier = BufferUtil::createBufferMemoryBarrier(slot.buffer, 0, slot.size, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT);
+	VulkanCommandUtil::pipelineBarrier(slot.cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+		0, nullptr, 1, &bufferBarrier, 0, nullptr);
+	VulkanCommandUtil::endCommandBuffer(slot.cmdBuffer);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stats.numCaptured++;
+	m_totalOverheadMs += TimerUtil::getTimeElapsedSinceStart(startTime);
+	return slot.cmdBuffer;
+}
+
+void VulkanFrameCapture::collect(uint32_t slotIndex)
+{
+	if (slotIndex >= m_slots.size() || !m_slots[slotIndex].pending)
+	{
+		return;
+	}
+	TIME_POINT startTime = std::chrono::high_resolution_clock::now();
+	Slot& slot = m_slots[slotIndex];
+	slot.pending = false;
+
+	if (!slot.coherent)
+	{
+		VkMappedMemoryRange range = {};
+		range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		range.memory = slot.memory;
+		range.offset = 0;
+		range.size = VK_WHOLE_SIZE;
+		vkInvalidateMappedMemoryRanges(m_logicalDevice, 1, &range);
+	}
+
+	// Copy out so the readback buffer is free for the slot's next frame, the encoders can take as long as they need
+	std::vector<unsigned char> pixels;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (m_stats.numPending >= m_maxPending)
+		{
+			TIME_POINT stallStartTime = std::chrono::high_resolution_clock::now();
+			m_encoded.wait(lock, [this]() { return m_stats.numPending < m_maxPending; });
+			m_stats.totalStallMs += TimerUtil::getTimeElapsedSinceStart(stallStartTime);
+		}
+		if (!m_freePixelBuffers.empty())
+		{
+			pixels = std::move(m_freePixelBuffers.back());
+			m_freePixelBuffers.pop_back();
+		}
+		m_stats.numPending++;
+	}
+	pixels.resize(static_cast<size_t>(slot.size));
+	memcpy(pixels.data(), slot.mappedData, pixels.size());
+
+	// The lambda owns the pixels and a copy of the capture's description, the slot moves on to the next capture
+	Slot capture = slot;
+	m_encoders->submit([this, pixels = std::move(pixels), capture]() mutable { encode(pixels, capture); });
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_totalOverheadMs += TimerUtil::getTimeElapsedSinceStart(startTime);
+}
+
+void VulkanFrameCapture::collectAll()
+{
+	for (uint32_t i = 0; i < m_slots.size(); i++)
+	{
+		collect(i);
+	}
+}
+
+void VulkanFrameCapture::encode(std::vector<unsigned char>& pixels, const Slot& capture)
+{
+	TIME_POINT startTime = std::chrono::high_resolution_clock::now();
+	if (isBGRA(capture.imageFormat))
+	{
+		for (size_t i = 0; i < pixels.size(); i += 4)
+		{
+			std::swap(pixels[i], pixels[i + 2]);
+		}
+	}
+
+	bool written = false;
+	const int width = static_cast<int>(capture.extent.width);
+	const int height = static_cast<int>(capture.extent.height);
+	if (capture.format == CAPTURE_FORMAT::PNG)
+	{
+		written = (stbi_write_png(capture.path.c_str(), width, height, 4, pixels.data(), width * 4) != 0);
+	}
+	else
+	{
+		std::ofstream file(capture.path, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+		written = file.good();
+	}
+	const float encodeTime = TimerUtil::getTimeElapsedSinceStart(startTime);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		written ? m_stats.numWritten++ : m_stats.numFailed++;
+		m_stats.numPending--;
+		m_totalEncodeMs += encodeTime;
+		m_freePixelBuffers.push_back(std::move(pixels));
+	}
+	m_encoded.notify_all();
+}
+
+void VulkanFrameCapture::waitForEncoders()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_encoded.wait(lock, [this]() { return m_stats.numPending == 0; });
+}
+
+VulkanFrameCapture::Stats VulkanFrameCapture::getStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Stats stats = m_stats;
+	if (stats.numCaptured > 0)
+	{
+		stats.averageOverheadMs = static_cast<float>(m_totalOverheadMs / stats.numCaptured);
+	}
+	const uint64_t numEncoded = stats.numWritten + stats.numFailed;
+	if (numEncoded > 0)
+	{
+		stats.averageEncodeMs = static_cast<float>(m_totalEncodeMs / numEncoded);
+	}
+	return stats;
+}
+void VulkanFrameCapture::resetStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const uint32_t numPending = m_stats.numPending;
+	m_stats = Stats();
+	m_stats.numPending = numPending;
+	m_totalOverheadMs = 0.0;
+	m_totalEncodeMs = 0.0;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <global.h>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+
+class ThreadPool;
+
+enum class CAPTURE_FORMAT { PNG, RAW }; // Raw is the tightly packed RGBA8 pixels without a header
+
+// Writes the final image of frames to disk without stalling the frame loop.
+// A captured frame copies its finished image into a host visible readback buffer as the last work of its submission. There is one buffer
+// per swapchain image, like the rest of the per image resources, and a copy is picked up once the frame that made it has finished,
+// i.e. when its image comes around again, so nothing waits on the queue. The pixels are then encoded and written by background threads.
+// If the encoders fall too far behind, picking up waits for them, so capturing every frame runs at the encode rate at worst.
+class VulkanFrameCapture
+{
+public:
+	struct Stats
+	{
+		uint64_t numCaptured = 0; // Copies recorded
+		uint64_t numWritten = 0;
+		uint64_t numFailed = 0; // Unsupported image formats and failed writes
+		uint32_t numPending = 0; // Copied but not written yet
+		float averageOverheadMs = 0.0f; // Render thread time per captured frame: recording the copy and picking it up, stalls included
+		float totalStallMs = 0.0f; // Time picking up waited on the encoders
+		float averageEncodeMs = 0.0f; // Encoding and writing one frame on a background thread
+	};
+
+	VulkanFrameCapture() = delete;
+	VulkanFrameCapture(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, uint32_t graphicsFamily);
+	// Writes out whatever was captured, the device has to be idle
+	~VulkanFrameCapture();
+
+	VulkanFrameCapture(const VulkanFrameCapture&) = delete;
+	VulkanFrameCapture& operator=(const VulkanFrameCapture&) = delete;
+
+	// The next frame that is submitted
+	void requestScreenshot(const std::string& path, CAPTURE_FORMAT format = CAPTURE_FORMAT::PNG);
+	// Every frame until stopped, written to <pathPrefix>_00000.png (or .rgba) onwards
+	void startSequence(const std::string& pathPrefix, CAPTURE_FORMAT format = CAPTURE_FORMAT::PNG);
+	void stopSequence();
+	bool isCapturingSequence() const { return m_sequenceActive; }
+
+	// Records the copy of the slot's finished image and returns the command buffer to submit after the rest of the frame,
+	// VK_NULL_HANDLE if the frame isn't captured. The image is expected in imageLayout and left in it.
+	// A null image drops the capture, for swapchains that can't be copied from.
+	VkCommandBuffer recordCapture(uint32_t slot, VkImage image, VkFormat imageFormat, VkExtent2D extent, VkImageLayout imageLayout);
+	// The slot's last frame has finished: hands its copy to the encoders without waiting on the GPU
+	void collect(uint32_t slot);
+	// Every frame has finished, e.g. after waiting for the device before recreating the swapchain
+	void collectAll();
+	// Blocks until everything that was collected is written
+	void waitForEncoders();
+
+	Stats getStats() const;
+	void resetStats();
+
+private:
+	struct Slot
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize size = 0;
+		void* mappedData = nullptr;
+		bool coherent = true;
+		VkCommandBuffer cmdBuffer = VK_NULL_HANDLE;
+
+		// The capture the copy belongs to, until it is collected
+		bool pending = false;
+		std::string path;
+		CAPTURE_FORMAT format = CAPTURE_FORMAT::PNG;
+		VkFormat imageFormat = VK_FORMAT_UNDEFINED;
+		VkExtent2D extent = {};
+	};
+
+	Slot& getSlot(uint32_t slot);
+	void resizeReadbackBuffer(Slot& slot, VkDeviceSize size);
+	void destroyReadbackBuffer(Slot& slot);
+	void encode(std::vector<unsigned char>& pixels, const Slot& capture);
+
+private:
+	VkDevice m_logicalDevice;
+	VkPhysicalDevice m_physicalDevice;
+	VkCommandPool m_cmdPool = VK_NULL_HANDLE;
+	std::vector<Slot> m_slots;
+
+	// Requests, render thread only
+	bool m_screenshotRequested = false;
+	std::string m_screenshotPath;
+	CAPTURE_FORMAT m_screenshotFormat = CAPTURE_FORMAT::PNG;
+	bool m_sequenceActive = false;
+	std::string m_sequencePrefix;
+	CAPTURE_FORMAT m_sequenceFormat = CAPTURE_FORMAT::PNG;
+	uint32_t m_sequenceFrame = 0;
+
+	// Encoders -- the pixel buffers they are done with are reused for later captures
+	std::unique_ptr<ThreadPool> m_encoders;
+	uint32_t m_maxPending;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_encoded;
+	std::vector<std::vector<unsigned char>> m_freePixelBuffers;
+	Stats m_stats;
+	double m_totalOverheadMs = 0.0;
+	double m_totalEncodeMs = 0.0;
+};
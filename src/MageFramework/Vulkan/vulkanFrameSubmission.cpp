@@ -0,0 +1,167 @@
+#include "vulkanFrameSubmission.h"
+#include <algorithm>
+
+void VulkanFrameSubmission::begin(bool useTimelineSemaphores)
+{
+	m_useTimelineSemaphores = useTimelineSemaphores;
+	m_batches.clear();
+	m_fences.clear();
+}
+
+VulkanFrameSubmission::Batch* VulkanFrameSubmission::findLastBatch(VkQueue queue)
+{
+	for (auto batch = m_batches.rbegin(); batch != m_batches.rend(); ++batch)
+	{
+		if (batch->queue == queue)
+		{
+			return &(*batch);
+		}
+	}
+	return nullptr;
+}
+VulkanFrameSubmission::Batch& VulkanFrameSubmission::startBatch(VkQueue queue)
+{
+	m_batches.emplace_back();
+	m_batches.back().queue = queue;
+	return m_batches.back();
+}
+
+void VulkanFrameSubmission::addCommandBuffer(VkQueue queue, VkCommandBuffer cmdBuffer)
+{
+	// Signals happen at the end of a batch, work added after one needs a batch of its own
+	Batch* batch = findLastBatch(queue);
+	if (!batch || !batch->signalSemaphores.empty())
+	{
+		batch = &startBatch(queue);
+	}
+	batch->cmdBuffers.push_back(cmdBuffer);
+}
+void VulkanFrameSubmission::addWait(VkQueue queue, VkSemaphore semaphore, VkPipelineStageFlags waitStage, uint64_t value)
+{
+	// Waits happen at the start of a batch, work that was already added to the queue must not wait
+	Batch* batch = findLastBatch(queue);
+	if (!batch || !batch->cmdBuffers.empty() || !batch->signalSemaphores.empty())
+	{
+		batch = &startBatch(queue);
+	}
+	batch->waitSemaphores.push_back(semaphore);
+	batch->waitValues.push_back(value);
+	batch->waitStages.push_back(waitStage);
+}
+void VulkanFrameSubmission::addSignal(VkQueue queue, VkSemaphore semaphore, uint64_t value)
+{
+	Batch* batch = findLastBatch(queue);
+	if (!batch)
+	{
+		batch = &startBatch(queue);
+	}
+	batch->signalSemaphores.push_back(semaphore);
+	batch->signalValues.push_back(value);
+}
+void VulkanFrameSubmission::setFence(VkQueue queue, VkFence fence)
+{
+	m_fences.push_back({ queue, fence });
+}
+
+void VulkanFrameSubmission::submit()
+{
+	m_numSubmitCalls = 0;
+	m_numSubmitInfos = 0;
+	m_submitTime = 0.0f;
+
+	// Group the batches into vkQueueSubmit calls
+	std::vector<std::pair<VkQueue, std::vector<const Batch*>>> submits;
+	for (const Batch& batch : m_batches)
+	{
+		auto sameQueue = [&batch](const std::pair<VkQueue, std::vector<const Batch*>>& submit) { return submit.first == batch.queue; };
+
+		if (m_useTimelineSemaphores)
+		{
+			// Waits may be submitted before their signals, so each queue only needs one call
+			auto submit = std::find_if(submits.begin(), submits.end(), sameQueue);
+			if (submit != submits.end())
+			{
+				submit->second.push_back(&batch);
+				continue;
+			}
+		}
+		else if (!submits.empty() && sameQueue(submits.back()))
+		{
+			submits.back().second.push_back(&batch);
+			continue;
+		}
+		submits.push_back({ batch.queue, { &batch } });
+	}
+
+	for (size_t i = 0; i < submits.size(); i++)
+	{
+		const VkQueue queue = submits[i].first;
+
+		// The fence goes on the last call of its queue
+		VkFence fence = VK_NULL_HANDLE;
+		const bool isLastSubmitOnQueue = std::none_of(submits.begin() + i + 1, submits.end(),
+			[queue](const std::pair<VkQueue, std::vector<const Batch*>>& submit) { return submit.first == queue; });
+		if (isLastSubmitOnQueue)
+		{
+			for (const std::pair<VkQueue, VkFence>& queueFence : m_fences)
+			{
+				if (queueFence.first == queue)
+				{
+					fence = queueFence.second;
+				}
+			}
+		}
+
+		submitBatches(queue, submits[i].second, fence);
+	}
+
+	// A fence on a queue that got no work still has to signal
+	for (const std::pair<VkQueue, VkFence>& queueFence : m_fences)
+	{
+		auto sameQueue = [&queueFence](const std::pair<VkQueue, std::vector<const Batch*>>& submit) { return submit.first == queueFence.first; };
+		if (std::none_of(submits.begin(), submits.end(), sameQueue))
+		{
+			submitBatches(queueFence.first, {}, queueFence.second);
+		}
+	}
+}
+
+void VulkanFrameSubmission::submitBatches(VkQueue queue, const std::vector<const Batch*>& batches, VkFence fence)
+{
+	std::vector<VkSubmitInfo> submitInfos(batches.size());
+	std::vector<VkTimelineSemaphoreSubmitInfoKHR> timelineInfos(batches.size());
+	for (size_t i = 0; i < batches.size(); i++)
+	{
+		const Batch& batch = *batches[i];
+
+		VkSubmitInfo& submitInfo = submitInfos[i];
+		submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.waitSemaphoreCount = static_cast<uint32_t>(batch.waitSemaphores.size());
+		submitInfo.pWaitSemaphores = batch.waitSemaphores.data();
+		submitInfo.pWaitDstStageMask = batch.waitStages.data();
+		submitInfo.commandBufferCount = static_cast<uint32_t>(batch.cmdBuffers.size());
+		submitInfo.pCommandBuffers = batch.cmdBuffers.data();
+		submitInfo.signalSemaphoreCount = static_cast<uint32_t>(batch.signalSemaphores.size());
+		submitInfo.pSignalSemaphores = batch.signalSemaphores.data();
+
+		if (m_useTimelineSemaphores)
+		{
+			VkTimelineSemaphoreSubmitInfoKHR& timelineInfo = timelineInfos[i];
+			timelineInfo = {};
+			timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+			timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(batch.waitValues.size());
+			timelineInfo.pWaitSemaphoreValues = batch.waitValues.data();
+			timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(batch.signalValues.size());
+			timelineInfo.pSignalSemaphoreValues = batch.signalValues.data();
+			submitInfo.pNext = &timelineInfo;
+		}
+	}
+
+	const TIME_POINT submitStart = std::chrono::high_resolution_clock::now();
+	VK_CHECK_RESULT(vkQueueSubmit(queue, static_cast<uint32_t>(submitInfos.size()), submitInfos.data(), fence));
+	m_submitTime += TimerUtil::getTimeElapsedSinceStart(submitStart);
+
+	m_numSubmitCalls++;
+	m_numSubmitInfos += static_cast<uint32_t>(submitInfos.size());
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <global.h>
+
+// Collects all the command buffers of a frame and submits them with as few vkQueueSubmit calls as the dependencies allow.
+// Work added to the same queue runs in the order it was added, those edges are left to pipeline barriers and render pass dependencies.
+// Semaphores are only added where work on one queue waits on another queue, or on the swapchain.
+// Every run of work on a queue becomes one VkSubmitInfo, a new one starts when the queue has to wait on something after it already has work.
+//
+// Binary semaphores have to be signaled before anything waiting on them is submitted, so queues are submitted in the order their work was added,
+// consecutive work on the same queue sharing a vkQueueSubmit. With timeline semaphores waits can be submitted before their signals,
+// so every queue gets exactly one vkQueueSubmit.
+class VulkanFrameSubmission
+{
+public:
+	// Clears everything added for the previous frame, the submit statistics of the previous frame stay until submit()
+	// useTimelineSemaphores chains the wait and signal values onto the submits, requires VK_KHR_timeline_semaphore
+	void begin(bool useTimelineSemaphores);
+
+	void addCommandBuffer(VkQueue queue, VkCommandBuffer cmdBuffer);
+	// Everything added to the queue after this waits on the semaphore, the value is ignored for binary semaphores
+	void addWait(VkQueue queue, VkSemaphore semaphore, VkPipelineStageFlags waitStage, uint64_t value = 0);
+	// Signaled once everything added to the queue so far has finished, the value is ignored for binary semaphores
+	void addSignal(VkQueue queue, VkSemaphore semaphore, uint64_t value = 0);
+	// Signaled by the last vkQueueSubmit of the queue
+	void setFence(VkQueue queue, VkFence fence);
+
+	void submit();
+
+	// Stats of the last submit()
+	uint32_t getNumSubmitCalls() const { return m_numSubmitCalls; }
+	uint32_t getNumSubmitInfos() const { return m_numSubmitInfos; }
+	float getSubmitTime() const { return m_submitTime; } // CPU time spent inside vkQueueSubmit, ms
+
+private:
+	struct Batch
+	{
+		VkQueue queue;
+		std::vector<VkSemaphore> waitSemaphores;
+		std::vector<uint64_t> waitValues;
+		std::vector<VkPipelineStageFlags> waitStages;
+		std::vector<VkCommandBuffer> cmdBuffers;
+		std::vector<VkSemaphore> signalSemaphores;
+		std::vector<uint64_t> signalValues;
+	};
+
+	Batch* findLastBatch(VkQueue queue);
+	Batch& startBatch(VkQueue queue);
+	void submitBatches(VkQueue queue, const std::vector<const Batch*>& batches, VkFence fence);
+
+private:
+	bool m_useTimelineSemaphores = false;
+	std::vector<Batch> m_batches; // In the order they were started
+	std::vector<std::pair<VkQueue, VkFence>> m_fences;
+
+	uint32_t m_numSubmitCalls = 0;
+	uint32_t m_numSubmitInfos = 0;
+	float m_submitTime = 0.0f;
+};
@@ -0,0 +1,390 @@
+#include "vulkanGpuProfiler.h"
+#include <fstream>
+
+// Two queries per pass, every slot's query pool has room for this many passes
+static const uint32_t MAX_PROFILED_PASSES = 32;
+// Results come in the order of the flag bits, the fragment invocations bit is above the vertex invocations bit
+static const VkQueryPipelineStatisticFlags GRAPHICS_STATISTICS = VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+static const VkQueryPipelineStatisticFlags COMPUTE_STATISTICS = VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+
+VulkanGpuProfiler::VulkanGpuProfiler(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, uint32_t graphicsFamily, uint32_t computeFamily,
+	bool pipelineStatistics, bool inheritedQueries)
+	: m_logicalDevice(logicalDevice), m_statisticsEnabled(pipelineStatistics), m_inheritedQueries(inheritedQueries)
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	m_timestampPeriod = properties.limits.timestampPeriod;
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+	auto timestampMask = [&](uint32_t family) -> uint64_t
+	{
+		const uint32_t validBits = queueFamilies[family].timestampValidBits;
+		return (validBits >= 64) ? ~0ull : ((1ull << validBits) - 1);
+	};
+	m_timestampMasks[QueueFlags::Graphics] = timestampMask(graphicsFamily);
+	m_timestampMasks[QueueFlags::Compute] = timestampMask(computeFamily);
+	m_enabled = (m_timestampMasks[QueueFlags::Graphics] != 0);
+
+#ifndef NDEBUG
+	std::cout << "GPU pass timings " << (m_enabled ? "enabled" : "disabled, the graphics queue can't write timestamps")
+		<< ((m_enabled && m_timestampMasks[QueueFlags::Compute] == 0) ? " (compute passes aren't timed)" : "") << std::endl;
+	std::cout << "GPU pipeline statistics " << (m_statisticsEnabled ? "enabled" : "disabled, the device doesn't support the queries") << std::endl;
+#endif
+}
+VulkanGpuProfiler::~VulkanGpuProfiler()
+{
+	for (Slot& slot : m_slots)
+	{
+		for (VkQueryPool queryPool : { slot.queryPool, slot.graphicsStatisticsPool, slot.computeStatisticsPool })
+		{
+			if (queryPool != VK_NULL_HANDLE)
+			{
+				vkDestroyQueryPool(m_logicalDevice, queryPool, nullptr);
+			}
+		}
+	}
+}
+
+VkQueryPipelineStatisticFlags VulkanGpuProfiler::getGraphicsStatisticsFlags() const
+{
+	return (m_statisticsEnabled && m_inheritedQueries) ? GRAPHICS_STATISTICS : 0;
+}
+
+uint32_t VulkanGpuProfiler::registerPass(const std::string& name, QueueFlags queue, bool executesSecondaryCommandBuffers)
+{
+	// Secondary command buffers executed while the query is active have to inherit it
+	const bool queried = m_statisticsEnabled && (!executesSecondaryCommandBuffers || m_inheritedQueries);
+	for (uint32_t i = 0; i < m_passStats.size(); i++)
+	{
+		if (m_passStats[i].name == name)
+		{
+			m_passStats[i].queried = queried;
+			return i;
+		}
+	}
+	if (m_passStats.size() >= MAX_PROFILED_PASSES)
+	{
+		throw std::runtime_error("too many passes for the GPU profiler");
+	}
+
+	PassStats stats;
+	stats.name = name;
+	stats.queue = queue;
+	stats.timed = (m_timestampMasks[queue] != 0);
+	stats.queried = queried;
+	m_passStats.push_back(stats);
+	return static_cast<uint32_t>(m_passStats.size() - 1);
+}
+
+VulkanGpuProfiler::Slot& VulkanGpuProfiler::getSlot(uint32_t slot)
+{
+	if (slot >= m_slots.size())
+	{
+		m_slots.resize(slot + 1);
+	}
+	Slot& l_slot = m_slots[slot];
+	if (l_slot.recordedPasses.empty())
+	{
+		VkQueryPoolCreateInfo queryPoolInfo = {};
+		queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		if (m_enabled)
+		{
+			queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			queryPoolInfo.queryCount = 2 * MAX_PROFILED_PASSES;
+			VK_CHECK_RESULT(vkCreateQueryPool(m_logicalDevice, &queryPoolInfo, nullptr, &l_slot.queryPool));
+		}
+		if (m_statisticsEnabled)
+		{
+			// One query per pass in each, a pass only ever uses the pool of its queue
+			queryPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+			queryPoolInfo.queryCount = MAX_PROFILED_PASSES;
+			queryPoolInfo.pipelineStatistics = GRAPHICS_STATISTICS;
+			VK_CHECK_RESULT(vkCreateQueryPool(m_logicalDevice, &queryPoolInfo, nullptr, &l_slot.graphicsStatisticsPool));
+			queryPoolInfo.pipelineStatistics = COMPUTE_STATISTICS;
+			VK_CHECK_RESULT(vkCreateQueryPool(m_logicalDevice, &queryPoolInfo, nullptr, &l_slot.computeStatisticsPool));
+		}
+		l_slot.recordedPasses.assign(MAX_PROFILED_PASSES, false);
+		l_slot.passCounters.assign(MAX_PROFILED_PASSES, CommandCounters());
+	}
+	return l_slot;
+}
+VkQueryPool VulkanGpuProfiler::getStatisticsPool(const Slot& slot, uint32_t passId) const
+{
+	return (m_passStats[passId].queue == QueueFlags::Compute) ? slot.computeStatisticsPool : slot.graphicsStatisticsPool;
+}
+
+void VulkanGpuProfiler::beginPass(VkCommandBuffer cmdBuffer, uint32_t slot, uint32_t passId)
+{
+	if (passId >= m_passStats.size())
+	{
+		return;
+	}
+
+	Slot& l_slot = getSlot(slot);
+	if (isTimed(passId))
+	{
+		vkCmdResetQueryPool(cmdBuffer, l_slot.queryPool, 2 * passId, 2);
+		vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, l_slot.queryPool, 2 * passId);
+	}
+	if (isQueried(passId))
+	{
+		const VkQueryPool statisticsPool = getStatisticsPool(l_slot, passId);
+		vkCmdResetQueryPool(cmdBuffer, statisticsPool, passId, 1);
+		vkCmdBeginQuery(cmdBuffer, statisticsPool, passId, 0);
+	}
+	l_slot.recordedPasses[passId] = true;
+}
+void VulkanGpuProfiler::endPass(VkCommandBuffer cmdBuffer, uint32_t slot, uint32_t passId)
+{
+	if (passId >= m_passStats.size())
+	{
+		return;
+	}
+
+	const Slot& l_slot = getSlot(slot);
+	if (isQueried(passId))
+	{
+		vkCmdEndQuery(cmdBuffer, getStatisticsPool(l_slot, passId), passId);
+	}
+	if (isTimed(passId))
+	{
+		vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, l_slot.queryPool, 2 * passId + 1);
+	}
+}
+void VulkanGpuProfiler::clearSlot(uint32_t slot)
+{
+	if (slot < m_slots.size() && !m_slots[slot].recordedPasses.empty())
+	{
+		m_slots[slot].recordedPasses.assign(MAX_PROFILED_PASSES, false);
+		m_slots[slot].passCounters.assign(MAX_PROFILED_PASSES, CommandCounters());
+	}
+}
+void VulkanGpuProfiler::setPassCounters(uint32_t slot, uint32_t passId, const CommandCounters& counters)
+{
+	if (passId < m_passStats.size())
+	{
+		getSlot(slot).passCounters[passId] = counters;
+	}
+}
+
+void VulkanGpuProfiler::slotSubmitted(uint32_t slot, uint64_t frame)
+{
+	// Also without timestamps, the command counters are collected per slot
+	getSlot(slot).submitted = true;
+	getSlot(slot).frame = frame;
+}
+
+float VulkanGpuProfiler::toMilliseconds(uint64_t ticks) const
+{
+	return static_cast<float>(static_cast<double>(ticks) * m_timestampPeriod / 1e6);
+}
+
+bool VulkanGpuProfiler::collectStatistics(const Slot& slot, uint32_t passId)
+{
+	// The statistics in flag bit order followed by the availability, no VK_QUERY_RESULT_WAIT_BIT so this never blocks
+	const bool isCompute = (m_passStats[passId].queue == QueueFlags::Compute);
+	const uint32_t numValues = isCompute ? 1 : 3;
+	std::array<uint64_t, 4> results = {};
+	const VkResult result = vkGetQueryPoolResults(m_logicalDevice, getStatisticsPool(slot, passId), passId, 1,
+		sizeof(results), results.data(), sizeof(results), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+	if ((result != VK_SUCCESS && result != VK_NOT_READY) || results[numValues] == 0)
+	{
+		return false;
+	}
+
+	PipelineStatistics& statistics = m_passStats[passId].lastStatistics;
+	statistics = PipelineStatistics();
+	if (isCompute)
+	{
+		statistics.computeShaderInvocations = results[0];
+	}
+	else
+	{
+		statistics.inputAssemblyPrimitives = results[0];
+		statistics.vertexShaderInvocations = results[1];
+		statistics.fragmentShaderInvocations = results[2];
+	}
+	return true;
+}
+
+void VulkanGpuProfiler::collect(uint32_t slot)
+{
+	if (slot >= m_slots.size() || !m_slots[slot].submitted)
+	{
+		return;
+	}
+
+	const Slot& l_slot = m_slots[slot];
+	uint64_t computeBegin = UINT64_MAX;
+	uint64_t computeEnd = 0;
+	std::vector<std::pair<uint64_t, uint64_t>> graphicsIntervals;
+	bool available = true;
+	for (uint32_t passId = 0; passId < m_passStats.size(); passId++)
+	{
+		if (!l_slot.recordedPasses[passId])
+		{
+			m_passStats[passId].lastCounters = CommandCounters();
+			m_passStats[passId].lastStatistics = PipelineStatistics();
+			continue;
+		}
+
+		m_passStats[passId].lastCounters = l_slot.passCounters[passId];
+		if (isQueried(passId) && !collectStatistics(l_slot, passId))
+		{
+			available = false;
+		}
+		if (!isTimed(passId))
+		{
+			continue;
+		}
+
+		// Timestamp and availability of the begin and the end query, no VK_QUERY_RESULT_WAIT_BIT so this never blocks
+		std::array<uint64_t, 4> results = {};
+		const VkResult result = vkGetQueryPoolResults(m_logicalDevice, l_slot.queryPool, 2 * passId, 2,
+			sizeof(results), results.data(), 2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+		if ((result != VK_SUCCESS && result != VK_NOT_READY) || results[1] == 0 || results[3] == 0)
+		{
+			available = false;
+			continue;
+		}
+
+		PassStats& stats = m_passStats[passId];
+		const uint64_t mask = m_timestampMasks[stats.queue];
+		const uint64_t begin = results[0] & mask;
+		const uint64_t end = results[2] & mask;
+		const float passTime = toMilliseconds((end - begin) & mask);
+
+		stats.lastMs = passTime;
+		stats.minMs = (stats.numSamples == 0) ? passTime : std::min(stats.minMs, passTime);
+		stats.maxMs = (stats.numSamples == 0) ? passTime : std::max(stats.maxMs, passTime);
+		stats.numSamples++;
+		stats.averageMs += (passTime - stats.averageMs) / stats.numSamples;
+
+		if (stats.queue == QueueFlags::Compute)
+		{
+			computeBegin = std::min(computeBegin, begin);
+			computeEnd = std::max(computeEnd, end);
+		}
+		else
+		{
+			graphicsIntervals.push_back({ begin, end });
+		}
+	}
+	if (!available)
+	{
+		// Some of the frame's queries hadn't landed, it is neither the last collected frame nor a row in the log
+		return;
+	}
+	m_lastCollectedFrame = l_slot.frame;
+
+	// Graphics passes run one after the other, so their overlaps with the compute interval don't double count
+	uint64_t overlap = 0;
+	for (const std::pair<uint64_t, uint64_t>& interval : graphicsIntervals)
+	{
+		const uint64_t overlapBegin = std::max(interval.first, computeBegin);
+		const uint64_t overlapEnd = std::min(interval.second, computeEnd);
+		overlap += (overlapEnd > overlapBegin) ? (overlapEnd - overlapBegin) : 0;
+	}
+	m_lastComputeOverlap = toMilliseconds(overlap);
+
+	if (m_frameLog.is_open())
+	{
+		writeFrameLogLine(l_slot.frame);
+	}
+}
+
+CommandCounters VulkanGpuProfiler::getLastFrameCounters() const
+{
+	CommandCounters counters;
+	for (const PassStats& stats : m_passStats)
+	{
+		counters += stats.lastCounters;
+	}
+	return counters;
+}
+PipelineStatistics VulkanGpuProfiler::getLastFrameStatistics() const
+{
+	PipelineStatistics statistics;
+	for (const PassStats& stats : m_passStats)
+	{
+		statistics += stats.lastStatistics;
+	}
+	return statistics;
+}
+
+void VulkanGpuProfiler::resetStats()
+{
+	for (PassStats& stats : m_passStats)
+	{
+		stats.numSamples = 0;
+		stats.lastMs = stats.averageMs = stats.minMs = stats.maxMs = 0.0f;
+		stats.lastCounters = CommandCounters();
+		stats.lastStatistics = PipelineStatistics();
+	}
+	m_lastComputeOverlap = 0.0f;
+}
+
+bool VulkanGpuProfiler::exportCSV(const std::string& path) const
+{
+	std::ofstream file(path);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	file << "pass,queue,samples,last_ms,average_ms,min_ms,max_ms\n";
+	for (const PassStats& stats : m_passStats)
+	{
+		file << stats.name << "," << ((stats.queue == QueueFlags::Compute) ? "compute" : "graphics") << "," << stats.numSamples << ","
+			<< stats.lastMs << "," << stats.averageMs << "," << stats.minMs << "," << stats.maxMs << "\n";
+	}
+	return true;
+}
+
+bool VulkanGpuProfiler::startFrameLog(const std::string& path)
+{
+	stopFrameLog();
+	m_frameLog.open(path);
+	if (!m_frameLog.is_open())
+	{
+		return false;
+	}
+
+	m_numLoggedPasses = static_cast<uint32_t>(m_passStats.size());
+	m_frameLog << "frame";
+	for (uint32_t passId = 0; passId < m_numLoggedPasses; passId++)
+	{
+		const std::string& name = m_passStats[passId].name;
+		m_frameLog << "," << name << "_draws," << name << "_dispatches," << name << "_pipeline_binds," << name << "_descriptor_set_binds,"
+			<< name << "_push_constants," << name << "_barriers," << name << "_redundant_binds," << name << "_primitives,"
+			<< name << "_vertex_invocations," << name << "_fragment_invocations," << name << "_compute_invocations";
+	}
+	m_frameLog << "\n";
+	return m_frameLog.good();
+}
+void VulkanGpuProfiler::stopFrameLog()
+{
+	if (m_frameLog.is_open())
+	{
+		m_frameLog.close();
+	}
+}
+
+void VulkanGpuProfiler::writeFrameLogLine(uint64_t frame)
+{
+	m_frameLog << frame;
+	for (uint32_t passId = 0; passId < m_numLoggedPasses; passId++)
+	{
+		const CommandCounters& counters = m_passStats[passId].lastCounters;
+		const PipelineStatistics& statistics = m_passStats[passId].lastStatistics;
+		m_frameLog << "," << counters.draws << "," << counters.dispatches << "," << counters.pipelineBinds << "," << counters.descriptorSetBinds
+			<< "," << counters.pushConstants << "," << counters.barriers << "," << counters.redundantBinds << "," << statistics.inputAssemblyPrimitives
+			<< "," << statistics.vertexShaderInvocations << "," << statistics.fragmentShaderInvocations << "," << statistics.computeShaderInvocations;
+	}
+	m_frameLog << "\n";
+}
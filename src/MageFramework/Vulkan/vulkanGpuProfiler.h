@@ -0,0 +1,147 @@
+#pragma once
+#include <global.h>
+#include <Vulkan/vulkanCommandRecorder.h>
+#include <fstream>
+#include <string>
+
+// What a pass made the GPU do, from a pipeline statistics query around it
+struct PipelineStatistics
+{
+	uint64_t inputAssemblyPrimitives = 0;
+	uint64_t vertexShaderInvocations = 0;
+	uint64_t fragmentShaderInvocations = 0;
+	uint64_t computeShaderInvocations = 0;
+
+	PipelineStatistics& operator+=(const PipelineStatistics& other)
+	{
+		inputAssemblyPrimitives += other.inputAssemblyPrimitives;
+		vertexShaderInvocations += other.vertexShaderInvocations;
+		fragmentShaderInvocations += other.fragmentShaderInvocations;
+		computeShaderInvocations += other.computeShaderInvocations;
+		return *this;
+	}
+};
+
+// Times the passes of a frame on the GPU with timestamp queries.
+// Every pass writes a timestamp before and after its commands into the query pool of the slot its command buffer was recorded for.
+// The renderer uses one slot per frame in flight, like the rest of the per frame resources its command buffers bind.
+// The queries are reset right before they are written, so prerecorded command buffers can be replayed as they are.
+// A slot's timestamps are read back without waiting once the frame that last used it has finished, i.e. when its frame in flight comes around again.
+//
+// Passes on a queue family with timestampValidBits == 0 are skipped, without timestamps on the graphics queue the profiler is disabled.
+//
+// With the pipelineStatisticsQuery feature every pass also gets a pipeline statistics query: primitives, vertex and fragment invocations
+// for passes on the graphics queue, compute invocations for passes on the compute queue. They are collected along with the timestamps.
+// A pass that executes secondary command buffers only gets one with the inheritedQueries feature as well, the secondaries have to
+// inherit the query.
+// The command counters (see VulkanCommandRecorder) of what was recorded for a pass are handed in per slot and become the pass's
+// last counters when the slot is collected, so they line up with the frame the GPU numbers come from. Passes that aren't recorded
+// through a VulkanCommandRecorder, i.e. the UI, have none.
+class VulkanGpuProfiler
+{
+public:
+	struct PassStats
+	{
+		std::string name;
+		QueueFlags queue;
+		bool timed; // The pass's queue family supports timestamps
+		bool queried; // The pass gets a pipeline statistics query
+		uint32_t numSamples = 0;
+		float lastMs = 0.0f;
+		float averageMs = 0.0f;
+		float minMs = 0.0f;
+		float maxMs = 0.0f;
+		// Of the last collected frame, 0 if the pass wasn't recorded for it
+		CommandCounters lastCounters;
+		PipelineStatistics lastStatistics;
+	};
+
+	VulkanGpuProfiler() = delete;
+	// pipelineStatistics and inheritedQueries: the device features of the same name are enabled on the device
+	VulkanGpuProfiler(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, uint32_t graphicsFamily, uint32_t computeFamily,
+		bool pipelineStatistics, bool inheritedQueries);
+	~VulkanGpuProfiler();
+
+	VulkanGpuProfiler(const VulkanGpuProfiler&) = delete;
+	VulkanGpuProfiler& operator=(const VulkanGpuProfiler&) = delete;
+
+	bool isEnabled() const { return m_enabled; }
+	bool isPipelineStatisticsEnabled() const { return m_statisticsEnabled; }
+	// What secondary command buffers executed inside a graphics pass have to inherit, 0 without pipeline statistics or inherited queries
+	VkQueryPipelineStatisticFlags getGraphicsStatisticsFlags() const;
+
+	// Passes keep their id for the lifetime of the profiler, registering the same name again returns the same id
+	// and updates whether it executes secondary command buffers
+	uint32_t registerPass(const std::string& name, QueueFlags queue, bool executesSecondaryCommandBuffers = false);
+
+	// Recorded outside of render passes
+	void beginPass(VkCommandBuffer cmdBuffer, uint32_t slot, uint32_t passId);
+	void endPass(VkCommandBuffer cmdBuffer, uint32_t slot, uint32_t passId);
+	// Forgets which passes were recorded for the slot, call before re-recording its command buffers
+	void clearSlot(uint32_t slot);
+	// What was recorded for the pass into the slot's command buffers
+	void setPassCounters(uint32_t slot, uint32_t passId, const CommandCounters& counters);
+
+	// The slot's command buffers have been submitted for the given frame
+	void slotSubmitted(uint32_t slot, uint64_t frame);
+	// The slot's last frame has finished: reads its timestamps without waiting and adds them to the stats
+	void collect(uint32_t slot);
+	// The frame the passes' last times belong to, 0 before anything was collected. Frames are collected a frame in flight later than they are submitted.
+	uint64_t getLastCollectedFrame() const { return m_lastCollectedFrame; }
+
+	// Stats
+	const std::vector<PassStats>& getPassStats() const { return m_passStats; }
+	// How long the compute passes of the last collected frame ran alongside graphics passes, in ms.
+	// Only meaningful with async compute and on devices whose queues share one timestamp clock, which Vulkan doesn't guarantee.
+	float getLastComputeOverlap() const { return m_lastComputeOverlap; }
+	// Summed over the passes of the last collected frame
+	CommandCounters getLastFrameCounters() const;
+	PipelineStatistics getLastFrameStatistics() const;
+	void resetStats();
+	// One line per pass: name, queue, samples, last, average, min and max in ms
+	bool exportCSV(const std::string& path) const;
+
+	// Writes a line per collected frame: the frame, then every pass's command counters and pipeline statistics.
+	// The columns are the passes registered when the log starts.
+	bool startFrameLog(const std::string& path);
+	void stopFrameLog();
+	bool isLoggingFrames() const { return m_frameLog.is_open(); }
+
+private:
+	struct Slot
+	{
+		VkQueryPool queryPool = VK_NULL_HANDLE;
+		VkQueryPool graphicsStatisticsPool = VK_NULL_HANDLE;
+		VkQueryPool computeStatisticsPool = VK_NULL_HANDLE;
+		bool submitted = false;
+		uint64_t frame = 0;
+		std::vector<bool> recordedPasses;
+		std::vector<CommandCounters> passCounters;
+	};
+
+	Slot& getSlot(uint32_t slot);
+	// Compute passes can be on a queue family without graphics, their queries only count compute invocations
+	VkQueryPool getStatisticsPool(const Slot& slot, uint32_t passId) const;
+	// False if the pass's statistics weren't available yet
+	bool collectStatistics(const Slot& slot, uint32_t passId);
+	void writeFrameLogLine(uint64_t frame);
+	bool isTimed(uint32_t passId) const { return m_enabled && passId < m_passStats.size() && m_passStats[passId].timed; }
+	bool isQueried(uint32_t passId) const { return passId < m_passStats.size() && m_passStats[passId].queried; }
+	float toMilliseconds(uint64_t ticks) const;
+
+private:
+	VkDevice m_logicalDevice;
+	bool m_enabled = false;
+	bool m_statisticsEnabled = false;
+	bool m_inheritedQueries = false;
+	float m_timestampPeriod = 1.0f; // ns per tick
+	std::array<uint64_t, sizeof(QueueFlags)> m_timestampMasks = {}; // Valid bits per queue, 0 if the queue's family can't write timestamps
+
+	std::vector<Slot> m_slots;
+	std::vector<PassStats> m_passStats; // Indexed by pass id
+	float m_lastComputeOverlap = 0.0f;
+	uint64_t m_lastCollectedFrame = 0;
+
+	std::ofstream m_frameLog;
+	uint32_t m_numLoggedPasses = 0;
+};
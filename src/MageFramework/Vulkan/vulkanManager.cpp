@@ -1,72 +1,161 @@
 #include "vulkanManager.h"
 
-const static uint32_t maxFramesInFlight = 3;
-
-VulkanManager::VulkanManager(GLFWwindow* _window, const char* applicationName)
+VulkanManager::VulkanManager(GLFWwindow* _window, const char* applicationName, uint32_t framesInFlight, VkPresentModeKHR preferredPresentMode,
+	bool preferAsyncCompute, bool preferDedicatedTransfer)
+	: m_preferredPresentMode(preferredPresentMode), m_preferAsyncCompute(preferAsyncCompute), m_preferDedicatedTransfer(preferDedicatedTransfer),
+	m_numFramesInFlight(std::min(std::max(framesInFlight, 1u), MAX_FRAMES_IN_FLIGHT))
+{
+	initialize(_window, applicationName);
+}
+VulkanManager::VulkanManager(VkExtent2D offscreenExtent, const char* applicationName, uint32_t framesInFlight,
+	bool preferAsyncCompute, bool preferDedicatedTransfer)
+	: m_preferredPresentMode(VK_PRESENT_MODE_IMMEDIATE_KHR), m_preferAsyncCompute(preferAsyncCompute), m_preferDedicatedTransfer(preferDedicatedTransfer),
+	m_numFramesInFlight(std::min(std::max(framesInFlight, 1u), MAX_FRAMES_IN_FLIGHT)), m_headless(true), m_offscreenExtent(offscreenExtent)
 {
+	initialize(nullptr, applicationName);
+}
+void VulkanManager::initialize(GLFWwindow* window, const char* applicationName)
+{
+	// Vulkan Instance -- a window needs the extensions GLFW asks for to create its surface
 	unsigned int glfwExtensionCount = 0;
-	const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-	// Vulkan Instance
+	const char** glfwExtensions = m_headless ? nullptr : glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 	initVulkanInstance(applicationName, glfwExtensionCount, glfwExtensions);
 
-	// Create Drawing Surface, i.e. window where things are rendered to
-	if (glfwCreateWindowSurface(m_instance, _window, nullptr, &m_surface) != VK_SUCCESS)
+	// Create The physical and logical devices required by vulkan
+	// Dictate the type of queues that need to be supported 
+	QueueFlagBits requiredQueues = QueueFlagBit::GraphicsBit | QueueFlagBit::ComputeBit | QueueFlagBit::TransferBit;
+	std::vector<const char*> deviceExtensions;
+
+	if (!m_headless)
 	{
-		throw std::runtime_error("failed to create window surface!");
+		// Create Drawing Surface, i.e. window where things are rendered to
+		if (glfwCreateWindowSurface(m_instance, window, nullptr, &m_surface) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create window surface!");
+		}
+		requiredQueues |= QueueFlagBit::PresentBit;
+		deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 	}
 
-	// Create The physical and logical devices required by vulkan
-	// Dictate the type of queues that need to be supported 
-	QueueFlagBits requiredQueues = QueueFlagBit::GraphicsBit | QueueFlagBit::ComputeBit | QueueFlagBit::TransferBit | QueueFlagBit::PresentBit;
-
-	std::vector<const char*> deviceExtensions = {
-		VK_KHR_SWAPCHAIN_EXTENSION_NAME,
-		// Ray tracing 
-		VK_KHR_GET_MEMORY_REQUIREMENTS_2_EXTENSION_NAME,
-		VK_NV_RAY_TRACING_EXTENSION_NAME
-	};
-	// Setup Physical Devices --> Find a GPU that supports Vusurfacelkan
+	// Setup Physical Devices --> Find a GPU that supports Vulkan, ray tracing is optional (see queryOptionalDeviceFeatures)
 	pickPhysicalDevice(deviceExtensions, requiredQueues );
+	queryOptionalDeviceFeatures();
+#ifndef NDEBUG
+	std::cout << "Compute queue family " << m_queueFamilyIndices[QueueFlags::Compute] 
+		<< (usesAsyncCompute() ? " (async compute)" : " (shared with the graphics queue)") << std::endl;
+	std::cout << "Transfer queue family " << m_queueFamilyIndices[QueueFlags::Transfer]
+		<< (usesDedicatedTransferQueue() ? " (dedicated)" : " (shared with the graphics queue)") << std::endl;
+#endif
 	// Create a Logical Device
 	createLogicalDevice(requiredQueues);
+	m_resourceCache = std::make_shared<VulkanResourceCache>(m_logicalDevice, m_physicalDevice);
+	m_uploadQueue = std::make_shared<VulkanUploadQueue>(m_logicalDevice, m_physicalDevice,
+		m_queues[QueueFlags::Transfer], m_queueFamilyIndices[QueueFlags::Transfer],
+		m_queues[QueueFlags::Graphics], m_queueFamilyIndices[QueueFlags::Graphics]);
+	m_deletionQueue = std::make_shared<VulkanDeletionQueue>();
+	m_gpuProfiler = std::make_shared<VulkanGpuProfiler>(m_logicalDevice, m_physicalDevice,
+		m_queueFamilyIndices[QueueFlags::Graphics], m_queueFamilyIndices[QueueFlags::Compute],
+		m_pipelineStatisticsSupported, m_inheritedQueriesSupported);
+	m_frameCapture = std::make_shared<VulkanFrameCapture>(m_logicalDevice, m_physicalDevice, m_queueFamilyIndices[QueueFlags::Graphics]);
 
-	createPresentationObjects(_window);
+	createPresentationObjects(window);
 	createSyncObjects();
 }
 VulkanManager::~VulkanManager() 
 {
-	vkDeviceWaitIdle(getLogicalDevice());
+	// The swapchain or offscreen images go first, the renderers built on them are gone by now
+	cleanup();
 
-	for (size_t i = 0; i < maxFramesInFlight; i++)
+	for (size_t i = 0; i < m_numFramesInFlight; i++)
 	{
 		vkDestroySemaphore(m_logicalDevice, m_renderFinishedSemaphores[i], nullptr);
 		vkDestroySemaphore(m_logicalDevice, m_imageAvailableSemaphores[i], nullptr);
 		vkDestroyFence(m_logicalDevice, m_framesInFlight[i], nullptr);
 	}
+	for (VkSemaphore timelineSemaphore : m_timelineSemaphores)
+	{
+		if (timelineSemaphore != VK_NULL_HANDLE)
+		{
+			vkDestroySemaphore(m_logicalDevice, timelineSemaphore, nullptr);
+		}
+	}
 
 	if (ENABLE_VALIDATION)
 	{
 		destroyDebugUtilsMessengerEXT(m_instance, m_debugMessenger, nullptr);
 	}
 
+	// Writes out the frames that are still being captured
+	m_frameCapture.reset();
+	m_gpuProfiler.reset();
+	// Retired textures hand their samplers and views back to the resource cache
+	m_deletionQueue->flush();
+	m_deletionQueue.reset();
+	m_uploadQueue.reset();
+	m_resourceCache.reset();
 	vkDestroyDevice(m_logicalDevice, nullptr);
-	vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+	if (m_surface != VK_NULL_HANDLE)
+	{
+		vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+	}
 	vkDestroyInstance(m_instance, nullptr);
 }
 void VulkanManager::cleanup()
 {
 	vkDeviceWaitIdle(m_logicalDevice);
 
-	vkDestroySwapchainKHR(m_logicalDevice, m_swapChain, nullptr);
 	for (size_t i = 0; i < m_swapChainImageViews.size(); i++)
 	{
 		vkDestroyImageView(m_logicalDevice, m_swapChainImageViews[i], nullptr);
 	}
+	m_swapChainImageViews.clear();
+	if (m_headless)
+	{
+		for (size_t i = 0; i < m_swapChainImages.size(); i++)
+		{
+			vkDestroyImage(m_logicalDevice, m_swapChainImages[i], nullptr);
+			VulkanMemoryTracker::free(m_logicalDevice, m_offscreenImageMemory[i]);
+		}
+		m_offscreenImageMemory.clear();
+	}
+	else if (m_swapChain != VK_NULL_HANDLE)
+	{
+		vkDestroySwapchainKHR(m_logicalDevice, m_swapChain, nullptr);
+		m_swapChain = VK_NULL_HANDLE;
+	}
+	m_swapChainImages.clear();
 }
 void VulkanManager::recreate(GLFWwindow* window)
 {
+	// Frames in flight may still render into or present the old images, so they go through the deletion queue instead of waiting
+	// on the device. The old swapchain is handed to the new one as its oldSwapchain and destroyed once those frames have finished.
+	VkDevice logicalDevice = m_logicalDevice;
+	deferDestruction([logicalDevice, swapChainImageViews = m_swapChainImageViews, headless = m_headless,
+		offscreenImages = m_swapChainImages, offscreenImageMemory = m_offscreenImageMemory]()
+	{
+		for (VkImageView imageView : swapChainImageViews)
+		{
+			vkDestroyImageView(logicalDevice, imageView, nullptr);
+		}
+		if (headless)
+		{
+			for (size_t i = 0; i < offscreenImages.size(); i++)
+			{
+				vkDestroyImage(logicalDevice, offscreenImages[i], nullptr);
+				VulkanMemoryTracker::free(logicalDevice, offscreenImageMemory[i]);
+			}
+		}
+	});
+	m_swapChainImageViews.clear();
+	m_swapChainImages.clear();
+	m_offscreenImageMemory.clear();
+
+	const VkSwapchainKHR oldSwapChain = m_swapChain;
 	createPresentationObjects(window);
+	if (oldSwapChain != VK_NULL_HANDLE)
+	{
+		deferDestruction([logicalDevice, oldSwapChain]() { vkDestroySwapchainKHR(logicalDevice, oldSwapChain, nullptr); });
+	}
 }
 
 void VulkanManager::initVulkanInstance(const char* applicationName, unsigned int additionalExtensionCount, const char** additionalExtensions)
@@ -133,14 +222,20 @@ void VulkanManager::pickPhysicalDevice(std::vector<const char*> deviceExtensions
 	std::vector<VkPhysicalDevice> physicalDevices(physicalDeviceCount);
 	vkEnumeratePhysicalDevices(m_instance, &physicalDeviceCount, physicalDevices.data());
 
+	// Take the best ranked device that has everything the renderer can't do without, so a machine with a GPU never ends up on
+	// a CPU implementation while CI machines and machines without a GPU can still run on lavapipe
 	m_physicalDevice = VK_NULL_HANDLE;
+	int bestRank = -1;
 	for (const auto& device : physicalDevices)
 	{
 		if (isPhysicalDeviceSuitable(device, deviceExtensions, requiredQueues, m_surface))
 		{
-			m_physicalDevice = device;
-			m_msaaSamples = VulkanDevicesUtil::getMaxUsableSampleCount(m_physicalDevice);
-			break;
+			const int rank = rankPhysicalDevice(device);
+			if (rank > bestRank)
+			{
+				m_physicalDevice = device;
+				bestRank = rank;
+			}
 		}
 	}
 
@@ -151,7 +246,202 @@ void VulkanManager::pickPhysicalDevice(std::vector<const char*> deviceExtensions
 		throw std::runtime_error("failed to find a suitable GPU!");
 	}
 
+	// The suitability check fills in the queue families and swapchain support of the device it looked at, redo it for the chosen one
+	isPhysicalDeviceSuitable(m_physicalDevice, deviceExtensions, requiredQueues, m_surface);
+	m_msaaSamples = VulkanDevicesUtil::getMaxUsableSampleCount(m_physicalDevice);
+	vkGetPhysicalDeviceProperties(m_physicalDevice, &m_physicalDeviceProperties);
 	vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &deviceMemoryProperties);
+	VulkanMemoryTracker::setMemoryProperties(deviceMemoryProperties);
+#ifndef NDEBUG
+	std::cout << "Physical device: " << m_physicalDeviceProperties.deviceName << std::endl;
+#endif
+}
+void VulkanManager::queryOptionalDeviceFeatures()
+{
+	// Descriptor Indexing -- used for bindless material textures
+	// Reference: https://www.khronos.org/registry/vulkan/specs/1.1-extensions/man/html/VK_EXT_descriptor_indexing.html
+	{
+		m_descriptorIndexingSupported = false;
+		const std::vector<const char*> descriptorIndexingExtensions = {
+			VK_KHR_MAINTENANCE3_EXTENSION_NAME,
+			VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME
+		};
+
+		// We are on a Vulkan 1.0 instance so the '2' queries come from VK_KHR_get_physical_device_properties2
+		auto l_vkGetPhysicalDeviceFeatures2KHR = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(m_instance, "vkGetPhysicalDeviceFeatures2KHR");
+		auto l_vkGetPhysicalDeviceProperties2KHR = (PFN_vkGetPhysicalDeviceProperties2KHR)vkGetInstanceProcAddr(m_instance, "vkGetPhysicalDeviceProperties2KHR");
+
+		if (l_vkGetPhysicalDeviceFeatures2KHR && l_vkGetPhysicalDeviceProperties2KHR &&
+			VulkanDevicesUtil::checkDeviceExtensionSupport(m_physicalDevice, descriptorIndexingExtensions))
+		{
+			VkPhysicalDeviceDescriptorIndexingFeaturesEXT supportedFeatures = {};
+			supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+			VkPhysicalDeviceFeatures2KHR deviceFeatures2 = {};
+			deviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+			deviceFeatures2.pNext = &supportedFeatures;
+			l_vkGetPhysicalDeviceFeatures2KHR(m_physicalDevice, &deviceFeatures2);
+
+			VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties = {};
+			indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+			VkPhysicalDeviceProperties2KHR deviceProperties2 = {};
+			deviceProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+			deviceProperties2.pNext = &indexingProperties;
+			l_vkGetPhysicalDeviceProperties2KHR(m_physicalDevice, &deviceProperties2);
+
+			// Only the subset the bindless material path relies on
+			m_descriptorIndexingSupported =
+				deviceFeatures2.features.shaderSampledImageArrayDynamicIndexing &&
+				supportedFeatures.runtimeDescriptorArray &&
+				supportedFeatures.descriptorBindingPartiallyBound &&
+				supportedFeatures.descriptorBindingVariableDescriptorCount &&
+				supportedFeatures.descriptorBindingSampledImageUpdateAfterBind;
+
+			if (m_descriptorIndexingSupported)
+			{
+				m_maxBindlessSampledImages = std::min(indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+					indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages);
+
+				m_descriptorIndexingFeatures = {};
+				m_descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+				m_descriptorIndexingFeatures.runtimeDescriptorArray = VK_TRUE;
+				m_descriptorIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+				m_descriptorIndexingFeatures.descriptorBindingVariableDescriptorCount = VK_TRUE;
+				m_descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+				m_descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing = supportedFeatures.shaderSampledImageArrayNonUniformIndexing;
+
+				m_deviceExtensions.insert(m_deviceExtensions.end(), descriptorIndexingExtensions.begin(), descriptorIndexingExtensions.end());
+			}
+		}
+
+#ifndef NDEBUG
+		std::cout << "Descriptor indexing " << (m_descriptorIndexingSupported ? "supported" : "not supported") << std::endl;
+#endif
+	}
+
+	// Timeline Semaphores -- used for frame synchronization, falls back to binary semaphores and fences
+	// Reference: https://www.khronos.org/registry/vulkan/specs/1.1-extensions/man/html/VK_KHR_timeline_semaphore.html
+	{
+		m_timelineSemaphoreSupported = false;
+		const std::vector<const char*> timelineSemaphoreExtensions = { VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME };
+
+		auto l_vkGetPhysicalDeviceFeatures2KHR = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(m_instance, "vkGetPhysicalDeviceFeatures2KHR");
+
+		if (l_vkGetPhysicalDeviceFeatures2KHR &&
+			VulkanDevicesUtil::checkDeviceExtensionSupport(m_physicalDevice, timelineSemaphoreExtensions))
+		{
+			VkPhysicalDeviceTimelineSemaphoreFeaturesKHR supportedFeatures = {};
+			supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+			VkPhysicalDeviceFeatures2KHR deviceFeatures2 = {};
+			deviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+			deviceFeatures2.pNext = &supportedFeatures;
+			l_vkGetPhysicalDeviceFeatures2KHR(m_physicalDevice, &deviceFeatures2);
+
+			m_timelineSemaphoreSupported = (supportedFeatures.timelineSemaphore == VK_TRUE);
+			if (m_timelineSemaphoreSupported)
+			{
+				m_timelineSemaphoreFeatures = {};
+				m_timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+				m_timelineSemaphoreFeatures.timelineSemaphore = VK_TRUE;
+
+				m_deviceExtensions.insert(m_deviceExtensions.end(), timelineSemaphoreExtensions.begin(), timelineSemaphoreExtensions.end());
+			}
+		}
+
+#ifndef NDEBUG
+		std::cout << "Timeline semaphores " << (m_timelineSemaphoreSupported ? "supported" : "not supported") << std::endl;
+#endif
+	}
+
+	// NV Ray Tracing -- the ray traced render type falls back to rasterization without it
+	{
+		const std::vector<const char*> rayTracingExtensions = {
+			VK_KHR_GET_MEMORY_REQUIREMENTS_2_EXTENSION_NAME,
+			VK_NV_RAY_TRACING_EXTENSION_NAME
+		};
+		m_rayTracingSupported = VulkanDevicesUtil::checkDeviceExtensionSupport(m_physicalDevice, rayTracingExtensions);
+		if (m_rayTracingSupported)
+		{
+			m_deviceExtensions.insert(m_deviceExtensions.end(), rayTracingExtensions.begin(), rayTracingExtensions.end());
+		}
+
+#ifndef NDEBUG
+		std::cout << "Ray tracing " << (m_rayTracingSupported ? "supported" : "not supported") << std::endl;
+#endif
+	}
+
+	// Memory Budget -- per heap usage for benchmarks, nothing depends on it
+	// Reference: https://www.khronos.org/registry/vulkan/specs/1.1-extensions/man/html/VK_EXT_memory_budget.html
+	{
+		const std::vector<const char*> memoryBudgetExtensions = { VK_EXT_MEMORY_BUDGET_EXTENSION_NAME };
+		m_vkGetPhysicalDeviceMemoryProperties2KHR = (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(m_instance, "vkGetPhysicalDeviceMemoryProperties2KHR");
+		m_memoryBudgetSupported = m_vkGetPhysicalDeviceMemoryProperties2KHR &&
+			VulkanDevicesUtil::checkDeviceExtensionSupport(m_physicalDevice, memoryBudgetExtensions);
+		if (m_memoryBudgetSupported)
+		{
+			m_deviceExtensions.insert(m_deviceExtensions.end(), memoryBudgetExtensions.begin(), memoryBudgetExtensions.end());
+		}
+
+#ifndef NDEBUG
+		std::cout << "Memory budget " << (m_memoryBudgetSupported ? "supported" : "not supported") << std::endl;
+#endif
+	}
+}
+
+std::vector<VulkanMemoryTracker::HeapStats> VulkanManager::getMemoryHeapStats() const
+{
+	std::vector<VulkanMemoryTracker::HeapStats> heaps = VulkanMemoryTracker::getHeapStats();
+	if (!m_memoryBudgetSupported)
+	{
+		return heaps;
+	}
+
+	// The budget changes with what other processes allocate, so it's queried every time
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT memoryBudget = {};
+	memoryBudget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+	VkPhysicalDeviceMemoryProperties2KHR memoryProperties2 = {};
+	memoryProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR;
+	memoryProperties2.pNext = &memoryBudget;
+	m_vkGetPhysicalDeviceMemoryProperties2KHR(m_physicalDevice, &memoryProperties2);
+
+	for (uint32_t i = 0; i < heaps.size() && i < memoryProperties2.memoryProperties.memoryHeapCount; i++)
+	{
+		heaps[i].budget = memoryBudget.heapBudget[i];
+		heaps[i].usage = memoryBudget.heapUsage[i];
+	}
+	return heaps;
+}
+VkDeviceSize VulkanManager::getDeviceLocalMemoryUsage() const
+{
+	if (!m_memoryBudgetSupported)
+	{
+		return 0;
+	}
+
+	VkDeviceSize usage = 0;
+	for (const VulkanMemoryTracker::HeapStats& heap : getMemoryHeapStats())
+	{
+		if (heap.deviceLocal)
+		{
+			usage += heap.usage;
+		}
+	}
+	return usage;
+}
+VkDeviceSize VulkanManager::getDeviceLocalMemoryHeadroom() const
+{
+	VkDeviceSize headroom = 0;
+	for (const VulkanMemoryTracker::HeapStats& heap : getMemoryHeapStats())
+	{
+		if (!heap.deviceLocal)
+		{
+			continue;
+		}
+		// Without the extension only our own allocations are known, measured against the whole heap
+		const VkDeviceSize limit = m_memoryBudgetSupported ? heap.budget : heap.size;
+		const VkDeviceSize used = m_memoryBudgetSupported ? heap.usage : heap.allocated;
+		headroom += (used < limit) ? limit - used : 0;
+	}
+	return headroom;
 }
 void VulkanManager::createLogicalDevice(QueueFlagBits requiredQueues)
 {
@@ -183,16 +473,39 @@ void VulkanManager::createLogicalDevice(QueueFlagBits requiredQueues)
 		deviceQueueCreateInfos.push_back(deviceQueueCreateInfo);
 	}
 
-	// Specify the set of device features used
+	// Specify the set of device features used, the ones nothing depends on yet are only enabled where they exist
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(m_physicalDevice, &supportedFeatures);
 	VkPhysicalDeviceFeatures deviceFeatures = {};
-	deviceFeatures.geometryShader = VK_TRUE;
-	deviceFeatures.tessellationShader = VK_TRUE;
+	deviceFeatures.geometryShader = supportedFeatures.geometryShader;
+	deviceFeatures.tessellationShader = supportedFeatures.tessellationShader;
 	// enable anisotropic filtering -- HIGH Performance Cost
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
 	// enable sample shading feature for the device -- HIGH Performance Cost
-	deviceFeatures.sampleRateShading = VK_TRUE;
+	deviceFeatures.sampleRateShading = supportedFeatures.sampleRateShading;
 	// Needed otherwise compiler complains, possibly related to https://github.com/KhronosGroup/Vulkan-ValidationLayers/issues/327
 	deviceFeatures.fragmentStoresAndAtomics = VK_TRUE;
+	// Indexing into arrays of textures with a dynamically uniform index, i.e. bindless materials
+	deviceFeatures.shaderSampledImageArrayDynamicIndexing = m_descriptorIndexingSupported ? VK_TRUE : VK_FALSE;
+	// Per pass pipeline statistics in the GPU profiler
+	deviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+	m_pipelineStatisticsSupported = (supportedFeatures.pipelineStatisticsQuery == VK_TRUE);
+	// Lets secondary command buffers run inside a pass with an active statistics query, i.e. multithreaded draw recording
+	deviceFeatures.inheritedQueries = m_pipelineStatisticsSupported ? supportedFeatures.inheritedQueries : VK_FALSE;
+	m_inheritedQueriesSupported = (deviceFeatures.inheritedQueries == VK_TRUE);
+
+	// Extension feature structs get chained onto the device create info
+	void* deviceCreateInfoNext = nullptr;
+	if (m_timelineSemaphoreSupported)
+	{
+		m_timelineSemaphoreFeatures.pNext = deviceCreateInfoNext;
+		deviceCreateInfoNext = &m_timelineSemaphoreFeatures;
+	}
+	if (m_descriptorIndexingSupported)
+	{
+		m_descriptorIndexingFeatures.pNext = deviceCreateInfoNext;
+		deviceCreateInfoNext = &m_descriptorIndexingFeatures;
+	}
 
 
 	// Actually create logical device
@@ -201,14 +514,14 @@ void VulkanManager::createLogicalDevice(QueueFlagBits requiredQueues)
 		VulkanDevicesUtil::createLogicalDevice(m_physicalDevice, m_logicalDevice, &deviceFeatures,
 			static_cast<uint32_t>(deviceQueueCreateInfos.size()), deviceQueueCreateInfos.data(),
 			static_cast<uint32_t>(m_deviceExtensions.size()), m_deviceExtensions.data(),
-			static_cast<uint32_t>(validationLayers.size()), validationLayers.data());
+			static_cast<uint32_t>(validationLayers.size()), validationLayers.data(), deviceCreateInfoNext);
 	}
 	else
 	{
 		VulkanDevicesUtil::createLogicalDevice(m_physicalDevice, m_logicalDevice, &deviceFeatures,
 			static_cast<uint32_t>(deviceQueueCreateInfos.size()), deviceQueueCreateInfos.data(),
 			static_cast<uint32_t>(m_deviceExtensions.size()), m_deviceExtensions.data(),
-			0, nullptr);
+			0, nullptr, deviceCreateInfoNext);
 	}
 
 	//Get required queues
@@ -219,16 +532,43 @@ void VulkanManager::createLogicalDevice(QueueFlagBits requiredQueues)
 			vkGetDeviceQueue(m_logicalDevice, m_queueFamilyIndices[i], 0, &m_queues[i]);
 		}
 	}
+
+	if (m_timelineSemaphoreSupported)
+	{
+		m_vkWaitSemaphoresKHR = (PFN_vkWaitSemaphoresKHR)vkGetDeviceProcAddr(m_logicalDevice, "vkWaitSemaphoresKHR");
+		m_vkGetSemaphoreCounterValueKHR = (PFN_vkGetSemaphoreCounterValueKHR)vkGetDeviceProcAddr(m_logicalDevice, "vkGetSemaphoreCounterValueKHR");
+		m_timelineSemaphoreSupported = (m_vkWaitSemaphoresKHR != nullptr && m_vkGetSemaphoreCounterValueKHR != nullptr);
+	}
 }
 
 void VulkanManager::createPresentationObjects(GLFWwindow* window)
 {
-	createSwapChain(window);
+	if (m_headless)
+	{
+		createOffscreenImages();
+	}
+	else
+	{
+		createSwapChain(window);
+	}
 	createSwapChainImageViews();
+
+	// Images can come back in a different order or count after a recreate. The frames that used the old images are finished by then
+	// (see Renderer::recreate) and the new images haven't been used yet, so there is nothing to wait on for any of them.
+	m_imagesInFlight.assign(m_swapChainImages.size(), VK_NULL_HANDLE);
+	m_imageTimelineValues.assign(m_swapChainImages.size(), 0);
 }
 
 bool VulkanManager::acquireNextSwapChainImage()
 {
+	if (m_headless)
+	{
+		// Round robin, the image wait that follows makes sure the image's last frame is done with it.
+		// Nothing signals the image available semaphore, the frame doesn't wait on it when headless.
+		m_currentImage = static_cast<uint32_t>(m_submittedFrameCount % m_swapChainImages.size());
+		return true;
+	}
+
 	// It is possible to use a semaphore, fence, or both as the synchronization objects that are to be signaled 
 	// when the presentation engine is finished using the image
 	VkResult result = vkAcquireNextImageKHR(m_logicalDevice, m_swapChain, std::numeric_limits<uint64_t>::max(),
@@ -252,6 +592,12 @@ bool VulkanManager::acquireNextSwapChainImage()
 }
 bool VulkanManager::presentImageToSwapChain()
 {
+	if (m_headless)
+	{
+		// The frame is done once its submission finishes, it doesn't signal the render finished semaphore when headless
+		return true;
+	}
+
 	VkPresentInfoKHR presentInfo = {};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 	presentInfo.waitSemaphoreCount = 1;
@@ -276,27 +622,157 @@ bool VulkanManager::presentImageToSwapChain()
 
 void VulkanManager::advanceCurrentFrameIndex()
 {
-	m_currentFrame = (m_currentFrame + 1) % maxFramesInFlight;
+	if (m_useTimelineSemaphores)
+	{
+		// The last submission of the frame was on the graphics queue, once the timeline reaches its value the frame and its image are free
+		const uint64_t frameDoneValue = m_timelineValues[QueueFlags::Graphics];
+		m_frameTimelineValues[m_currentFrame] = frameDoneValue;
+		m_imageTimelineValues[m_currentImage] = frameDoneValue;
+	}
+
+	m_frameInputTimes[m_currentFrame] = m_inputSampleTime;
+	m_frameInputPending[m_currentFrame] = m_inputSamplePending;
+	m_inputSamplePending = false;
+
+	m_frameSerials[m_currentFrame] = ++m_submittedFrameCount;
+	m_currentFrame = (m_currentFrame + 1) % m_numFramesInFlight;
 }
 
 void VulkanManager::waitForFrameInFlightFence()
 {
-	// The VK_TRUE we pass in vkWaitForFences indicates that we want to wait for all fences.
-	vkWaitForFences(m_logicalDevice, 1, &m_framesInFlight[m_currentFrame], VK_TRUE, UINT64_MAX);
+	const TIME_POINT waitStart = std::chrono::high_resolution_clock::now();
+
+	if (m_useTimelineSemaphores)
+	{
+		waitForTimelineValue(QueueFlags::Graphics, m_frameTimelineValues[m_currentFrame]);
+	}
+	else
+	{
+		// The VK_TRUE we pass in vkWaitForFences indicates that we want to wait for all fences.
+		vkWaitForFences(m_logicalDevice, 1, &m_framesInFlight[m_currentFrame], VK_TRUE, UINT64_MAX);
+	}
+
+	measureInputToCompletionLatency(m_currentFrame);
+	frameCompleted(m_currentFrame);
+
+	// Starts the count for this frame, the image wait adds to it
+	m_lastFrameWaitTime = m_pendingWaitTime + TimerUtil::getTimeElapsedSinceStart(waitStart);
+	m_pendingWaitTime = 0.0f;
+}
+void VulkanManager::waitForPreviousFrame()
+{
+	const TIME_POINT waitStart = std::chrono::high_resolution_clock::now();
+	const uint32_t previousFrame = getPreviousFrameIndex();
+
+	if (m_useTimelineSemaphores)
+	{
+		waitForTimelineValue(QueueFlags::Graphics, m_timelineValues[QueueFlags::Graphics]);
+	}
+	else
+	{
+		// Each frame's fence is signaled by its last submission and frames on the graphics queue finish in order
+		vkWaitForFences(m_logicalDevice, 1, &m_framesInFlight[previousFrame], VK_TRUE, UINT64_MAX);
+	}
+	measureInputToCompletionLatency(previousFrame);
+	frameCompleted(previousFrame);
+
+	m_pendingWaitTime += TimerUtil::getTimeElapsedSinceStart(waitStart);
+}
+void VulkanManager::markInputSampled()
+{
+	m_inputSampleTime = std::chrono::high_resolution_clock::now();
+	m_inputSamplePending = true;
+}
+void VulkanManager::measureInputToCompletionLatency(uint32_t frameIndex)
+{
+	if (m_frameInputPending[frameIndex])
+	{
+		m_lastInputToCompletionLatency = TimerUtil::getTimeElapsedSinceStart(m_frameInputTimes[frameIndex]);
+		m_frameInputPending[frameIndex] = false;
+	}
+}
+void VulkanManager::frameCompleted(uint32_t frameIndex)
+{
+	// Frames finish in submission order, so everything up to this frame is done
+	m_completedFrameCount = std::max(m_completedFrameCount, m_frameSerials[frameIndex]);
+	m_deletionQueue->collect(m_completedFrameCount, m_uploadQueue->getCompletedTicket());
+}
+void VulkanManager::pollCompletedFrames()
+{
+	const uint64_t completedTimelineValue = m_useTimelineSemaphores ? getCompletedTimelineValue(QueueFlags::Graphics) : 0;
+	for (uint32_t i = 0; i < m_numFramesInFlight; i++)
+	{
+		if (m_frameSerials[i] <= m_completedFrameCount)
+		{
+			continue;
+		}
+		const bool finished = m_useTimelineSemaphores ? (m_frameTimelineValues[i] <= completedTimelineValue) :
+			(vkGetFenceStatus(m_logicalDevice, m_framesInFlight[i]) == VK_SUCCESS);
+		if (finished)
+		{
+			m_completedFrameCount = std::max(m_completedFrameCount, m_frameSerials[i]);
+		}
+	}
+	m_deletionQueue->collect(m_completedFrameCount, m_uploadQueue->getCompletedTicket());
+}
+void VulkanManager::deferDestruction(std::function<void()> destroy)
+{
+	m_deletionQueue->retire(m_submittedFrameCount + 1, m_uploadQueue->getLatestTicket(), std::move(destroy));
+}
+void VulkanManager::deferDestruction(std::shared_ptr<void> object)
+{
+	m_deletionQueue->retire(m_submittedFrameCount + 1, m_uploadQueue->getLatestTicket(), std::move(object));
 }
 void VulkanManager::resetFrameInFlightFence()
 {
-	vkResetFences(m_logicalDevice, 1, &m_framesInFlight[m_currentFrame]);
+	if (!m_useTimelineSemaphores)
+	{
+		vkResetFences(m_logicalDevice, 1, &m_framesInFlight[m_currentFrame]);
+	}
 }
 void VulkanManager::waitForImageInFlightFence()
 {
-	// Check if a previous frame is using this image (i.e. there is its fence to wait on)
-	// This is possible if vkAcquireNextImageKHR returns images out of order.
-	if (m_imagesInFlight[m_currentImage] != VK_NULL_HANDLE) {
-		vkWaitForFences(m_logicalDevice, 1, &m_imagesInFlight[m_currentImage], VK_TRUE, UINT64_MAX);
+	const TIME_POINT waitStart = std::chrono::high_resolution_clock::now();
+
+	if (m_useTimelineSemaphores)
+	{
+		// Timeline values only ever increase, so waiting on the value of the last frame that used the image is exact
+		waitForTimelineValue(QueueFlags::Graphics, m_imageTimelineValues[m_currentImage]);
 	}
-	// Mark the image as now being in use by this frame
-	m_imagesInFlight[m_currentImage] = m_framesInFlight[m_currentFrame];
+	else
+	{
+		// Check if a previous frame is using this image (i.e. there is its fence to wait on)
+		// This is possible if vkAcquireNextImageKHR returns images out of order.
+		if (m_imagesInFlight[m_currentImage] != VK_NULL_HANDLE) {
+			vkWaitForFences(m_logicalDevice, 1, &m_imagesInFlight[m_currentImage], VK_TRUE, UINT64_MAX);
+		}
+		// Mark the image as now being in use by this frame
+		m_imagesInFlight[m_currentImage] = m_framesInFlight[m_currentFrame];
+	}
+
+	m_lastFrameWaitTime += TimerUtil::getTimeElapsedSinceStart(waitStart);
+}
+
+uint64_t VulkanManager::getCompletedTimelineValue(QueueFlags flag) const
+{
+	uint64_t value = 0;
+	VK_CHECK_RESULT(m_vkGetSemaphoreCounterValueKHR(m_logicalDevice, m_timelineSemaphores[flag], &value));
+	return value;
+}
+void VulkanManager::waitForTimelineValue(QueueFlags flag, uint64_t value) const
+{
+	// Every timeline starts at 0, so there is nothing to wait on before the first submission
+	if (value == 0)
+	{
+		return;
+	}
+
+	VkSemaphoreWaitInfoKHR waitInfo = {};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &m_timelineSemaphores[flag];
+	waitInfo.pValues = &value;
+	VK_CHECK_RESULT(m_vkWaitSemaphoresKHR(m_logicalDevice, &waitInfo, UINT64_MAX));
 }
 
 
@@ -312,13 +788,63 @@ void VulkanManager::transitionSwapChainImageLayout_SingleTimeCommand(uint32_t in
 	VkQueue graphicsQueue = getQueue(QueueFlags::Graphics);
 	ImageUtil::transitionImageLayout_SingleTimeCommand(m_logicalDevice, graphicsQueue, graphicsCmdPool, m_swapChainImages[index], m_swapChainImageFormat, oldLayout, newLayout, mipLevels);
 }
+void VulkanManager::readBackSwapChainImage(uint32_t index, std::vector<unsigned char>& rgbaPixels, VkCommandPool& graphicsCmdPool)
+{
+	// Swapchain images aren't created with transfer source usage, offscreen images are
+	if (!m_headless)
+	{
+		throw std::runtime_error("only offscreen images can be read back");
+	}
 
+	const uint32_t width = m_swapChainExtent.width;
+	const uint32_t height = m_swapChainExtent.height;
+	const VkDeviceSize size = static_cast<VkDeviceSize>(width) * height * 4;
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+	BufferUtil::createBuffer(m_logicalDevice, m_physicalDevice, stagingBuffer, stagingBufferMemory, size,
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_SHARING_MODE_EXCLUSIVE, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
-void VulkanManager::copyImageToSwapChainImage(uint32_t index, VkImage& srcImage, VkCommandBuffer& graphicsCmdBuffer, VkCommandPool& graphicsCmdPool, VkExtent2D imgExtents)
-{
 	VkQueue graphicsQueue = getQueue(QueueFlags::Graphics);
-	ImageUtil::copyImageToImage(m_logicalDevice, graphicsQueue, graphicsCmdPool, graphicsCmdBuffer,
-		srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_swapChainImages[index], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, imgExtents.width, imgExtents.height, 1);
+	VkCommandBuffer cmdBuffer;
+	VulkanCommandUtil::beginSingleTimeCommand(m_logicalDevice, graphicsCmdPool, cmdBuffer);
+
+	// The frame left the image in transfer source layout, its color writes still have to be made visible to the copy
+	VkImageSubresourceRange subresourceRange = ImageUtil::createImageSubResourceRange(VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1);
+	VkImageMemoryBarrier imageBarrier = ImageUtil::createImageMemoryBarrier(m_swapChainImages[index], getPresentLayout(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, subresourceRange);
+	VulkanCommandUtil::pipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+		0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+	VkBufferImageCopy region = {};
+	region.bufferOffset = 0;
+	region.bufferRowLength = 0; // Tightly packed
+	region.bufferImageHeight = 0;
+	region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent = { width, height, 1 };
+	vkCmdCopyImageToBuffer(cmdBuffer, m_swapChainImages[index], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, stagingBuffer, 1, &region);
+
+	VkBufferMemoryBarrier bufferBarrier = BufferUtil::createBufferMemoryBarrier(stagingBuffer, 0, size, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT);
+	VulkanCommandUtil::pipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+		0, nullptr, 1, &bufferBarrier, 0, nullptr);
+	VulkanCommandUtil::endAndSubmitSingleTimeCommand(m_logicalDevice, graphicsQueue, graphicsCmdPool, cmdBuffer);
+
+	// Offscreen images are BGRA
+	rgbaPixels.resize(static_cast<size_t>(size));
+	void* mappedData;
+	vkMapMemory(m_logicalDevice, stagingBufferMemory, 0, size, 0, &mappedData);
+	const unsigned char* bgraPixels = static_cast<const unsigned char*>(mappedData);
+	for (size_t i = 0; i < rgbaPixels.size(); i += 4)
+	{
+		rgbaPixels[i + 0] = bgraPixels[i + 2];
+		rgbaPixels[i + 1] = bgraPixels[i + 1];
+		rgbaPixels[i + 2] = bgraPixels[i + 0];
+		rgbaPixels[i + 3] = bgraPixels[i + 3];
+	}
+	vkUnmapMemory(m_logicalDevice, stagingBufferMemory);
+
+	vkDestroyBuffer(m_logicalDevice, stagingBuffer, nullptr);
+	VulkanMemoryTracker::free(m_logicalDevice, stagingBufferMemory);
 }
 
 
@@ -331,26 +857,35 @@ void VulkanManager::createSwapChain(GLFWwindow* window)
 	m_swapChainSupport = querySwapChainSupport();
 
 	m_surfaceFormat = SwapChainUtil::chooseSwapSurfaceFormat(m_swapChainSupport.surfaceFormats);
-	m_presentMode = SwapChainUtil::chooseSwapPresentMode(m_swapChainSupport.presentModes);
+	m_presentMode = SwapChainUtil::chooseSwapPresentMode(m_swapChainSupport.presentModes, m_preferredPresentMode);
 	VkExtent2D extent = SwapChainUtil::chooseSwapExtent(m_swapChainSupport.surfaceCapabilities, window);
 
 	// Can do multiple buffering here!
 	// minImageCount is almost definitely 1 (or it doesnt support presentation)
 	// setting imageCount to 2 makes it possible to do double buffering
 	uint32_t imageCount = m_swapChainSupport.surfaceCapabilities.minImageCount + 1;
+	// Every frame in flight needs an image to render into, otherwise the extra frames just wait on acquiring one
+	imageCount = std::max(imageCount, m_numFramesInFlight);
 	// 0 is a special value for maxImageCount, that means that there is no maximum
 	if (m_swapChainSupport.surfaceCapabilities.maxImageCount > 0 && imageCount > m_swapChainSupport.surfaceCapabilities.maxImageCount)
 	{
 		imageCount = m_swapChainSupport.surfaceCapabilities.maxImageCount;
 	}
-	VkImageUsageFlags swapchainUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	// The last post process pass and the UI render straight into the swapchain images
+	VkImageUsageFlags swapchainUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	// Frame capture copies out of them, surfaces aren't required to allow that
+	m_swapChainCopyable = (m_swapChainSupport.surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) != 0;
+	if (m_swapChainCopyable)
+	{
+		swapchainUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	}
 	VkSwapchainCreateInfoKHR swapChainCreateInfo = SwapChainUtil::basicSwapChainCreateInfo(
 		m_surface, imageCount, m_surfaceFormat.format, m_surfaceFormat.colorSpace,
 		extent, 1, swapchainUsage,
 		m_swapChainSupport.surfaceCapabilities.currentTransform,
 		VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
 		m_presentMode,
-		VK_NULL_HANDLE);
+		m_swapChain); // The swapchain being replaced on a recreate, VK_NULL_HANDLE the first time
 
 	if (m_queueFamilyIndices[QueueFlags::Graphics] != m_queueFamilyIndices[QueueFlags::Present])
 	{
@@ -381,6 +916,27 @@ void VulkanManager::createSwapChain(GLFWwindow* window)
 	m_swapChainImageFormat = m_surfaceFormat.format;
 	m_swapChainExtent = extent;
 }
+void VulkanManager::createOffscreenImages()
+{
+	// As many images as a swapchain would typically get, so headless frames overlap the way they do with a window
+	const uint32_t imageCount = std::max(3u, m_numFramesInFlight);
+	m_surfaceFormat = { VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
+	m_presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR; // Nothing throttles headless frames
+	m_swapChainImageFormat = m_surfaceFormat.format;
+	m_swapChainExtent = m_offscreenExtent;
+	m_swapChainCopyable = true;
+
+	// The last post process pass and the UI render into them, copies read them back
+	const VkImageUsageFlags usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	m_swapChainImages.resize(imageCount);
+	m_offscreenImageMemory.resize(imageCount);
+	for (uint32_t i = 0; i < imageCount; i++)
+	{
+		ImageUtil::createImage(m_logicalDevice, m_physicalDevice, m_swapChainImages[i], m_offscreenImageMemory[i],
+			VK_IMAGE_TYPE_2D, m_swapChainImageFormat, { m_swapChainExtent.width, m_swapChainExtent.height, 1 },
+			usage, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_TILING_OPTIMAL, 1, 1, VK_IMAGE_LAYOUT_UNDEFINED, VK_SHARING_MODE_EXCLUSIVE);
+	}
+}
 void VulkanManager::createSwapChainImageViews()
 {
 	m_swapChainImageViews.resize(m_swapChainImages.size());
@@ -416,10 +972,11 @@ void VulkanManager::createSyncObjects()
 
 
 	// Create Semaphores
-	m_imageAvailableSemaphores.resize(maxFramesInFlight);
-	m_renderFinishedSemaphores.resize(maxFramesInFlight);
-	m_framesInFlight.resize(maxFramesInFlight);
-	m_imagesInFlight.resize(maxFramesInFlight, VK_NULL_HANDLE);
+	m_imageAvailableSemaphores.resize(m_numFramesInFlight);
+	m_renderFinishedSemaphores.resize(m_numFramesInFlight);
+	m_framesInFlight.resize(m_numFramesInFlight);
+	m_frameInputTimes.resize(m_numFramesInFlight);
+	m_frameInputPending.assign(m_numFramesInFlight, false);
 
 	VkSemaphoreCreateInfo semaphoreInfo = {};
 	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -428,7 +985,7 @@ void VulkanManager::createSyncObjects()
 	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
 	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-	for (size_t i = 0; i < maxFramesInFlight; i++)
+	for (size_t i = 0; i < m_numFramesInFlight; i++)
 	{
 		if (vkCreateSemaphore(m_logicalDevice, &semaphoreInfo, nullptr, &m_imageAvailableSemaphores[i]) != VK_SUCCESS ||
 			vkCreateSemaphore(m_logicalDevice, &semaphoreInfo, nullptr, &m_renderFinishedSemaphores[i]) != VK_SUCCESS ||
@@ -437,6 +994,29 @@ void VulkanManager::createSyncObjects()
 			throw std::runtime_error("Failed to create synchronization objects for a frame");
 		}
 	}
+
+	// Timeline Semaphores -- Created even if the renderer ends up using the fences, they're cheap and nothing signals them then
+	if (m_timelineSemaphoreSupported)
+	{
+		VkSemaphoreTypeCreateInfoKHR semaphoreTypeInfo = {};
+		semaphoreTypeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+		semaphoreTypeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+		semaphoreTypeInfo.initialValue = 0;
+
+		VkSemaphoreCreateInfo timelineSemaphoreInfo = {};
+		timelineSemaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		timelineSemaphoreInfo.pNext = &semaphoreTypeInfo;
+
+		// Present work is submitted through vkQueuePresentKHR which can't signal anything
+		const QueueFlags timelineQueues[] = { QueueFlags::Graphics, QueueFlags::Compute, QueueFlags::Transfer };
+		for (QueueFlags queue : timelineQueues)
+		{
+			VK_CHECK_RESULT(vkCreateSemaphore(m_logicalDevice, &timelineSemaphoreInfo, nullptr, &m_timelineSemaphores[queue]));
+		}
+	}
+	m_timelineValues.fill(0);
+	m_frameTimelineValues.assign(m_numFramesInFlight, 0);
+	m_frameSerials.assign(m_numFramesInFlight, 0);
 }
 
 
@@ -447,21 +1027,37 @@ void VulkanManager::createSyncObjects()
 bool VulkanManager::isPhysicalDeviceSuitable(VkPhysicalDevice pDevice, std::vector<const char*> deviceExtensions,
 	QueueFlagBits requiredQueues, VkSurfaceKHR vkSurface)
 {
-	VkPhysicalDeviceProperties deviceProperties;
 	VkPhysicalDeviceFeatures deviceFeatures;
-	vkGetPhysicalDeviceProperties(pDevice, &deviceProperties);
 	vkGetPhysicalDeviceFeatures(pDevice, &deviceFeatures);
 
-	//Add features you really need in the gpu
-	bool desiredFeaturesSupported = (deviceProperties.deviceType
-		== VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU &&
-		deviceFeatures.geometryShader &&
-		deviceFeatures.tessellationShader &&
-		deviceFeatures.samplerAnisotropy &&
+	// Only the features the renderer can't do without, the device type only decides the rank (see rankPhysicalDevice)
+	bool desiredFeaturesSupported = (deviceFeatures.samplerAnisotropy &&
 		deviceFeatures.fragmentStoresAndAtomics);
 
 	bool queueSupport = true;
 	m_queueFamilyIndices = VulkanDevicesUtil::checkDeviceQueueSupport(pDevice, requiredQueues, vkSurface);
+	if (requiredQueues[QueueFlags::Compute] && m_queueFamilyIndices[QueueFlags::Graphics] >= 0)
+	{
+		// Async compute needs a family without graphics, a queue from the graphics family would just be the graphics queue again (one queue per family).
+		// Without one compute shares the graphics queue, so compute and graphics work stays in submission order and needs no semaphores between them.
+		const int computeOnlyFamily = VulkanDevicesUtil::findQueueFamily(pDevice, VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT);
+		if (m_preferAsyncCompute && computeOnlyFamily >= 0)
+		{
+			m_queueFamilyIndices[QueueFlags::Compute] = computeOnlyFamily;
+		}
+		else if (VulkanDevicesUtil::getQueueFamilyFlags(pDevice, m_queueFamilyIndices[QueueFlags::Graphics]) & VK_QUEUE_COMPUTE_BIT)
+		{
+			m_queueFamilyIndices[QueueFlags::Compute] = m_queueFamilyIndices[QueueFlags::Graphics];
+		}
+	}
+	if (requiredQueues[QueueFlags::Transfer] && m_queueFamilyIndices[QueueFlags::Graphics] >= 0)
+	{
+		// Transfer only families are the copy engines, they run alongside graphics and compute.
+		// Graphics families always support transfers, so without one uploads go through the graphics queue.
+		const int transferOnlyFamily = VulkanDevicesUtil::findQueueFamily(pDevice, VK_QUEUE_TRANSFER_BIT, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
+		m_queueFamilyIndices[QueueFlags::Transfer] = (m_preferDedicatedTransfer && transferOnlyFamily >= 0) ? 
+			transferOnlyFamily : m_queueFamilyIndices[QueueFlags::Graphics];
+	}
 	for (unsigned int i = 0; i < requiredQueues.size(); i++)
 	{
 		if (requiredQueues[i])
@@ -470,6 +1066,7 @@ bool VulkanManager::isPhysicalDeviceSuitable(VkPhysicalDevice pDevice, std::vect
 		}
 	}
 
+	m_swapChainSupport = {};
 	if (requiredQueues[QueueFlags::Present])
 	{
 		// Get basic surface capabilities
@@ -502,14 +1099,33 @@ bool VulkanManager::isPhysicalDeviceSuitable(VkPhysicalDevice pDevice, std::vect
 	//		- For the Surface we have there is:
 	//			-- one supported image format 
 	//			-- one supported presentation mode 
-	//		- the surface has a maxImageCount of atleast 2 to support double buffering
+	//		- the surface has a maxImageCount of atleast 2 to support double buffering (0 means there is no maximum)
+	// Headless there is no surface to check
 	bool swapChainSupportAdequate = ( !requiredQueues[QueueFlags::Present] || 
-									( !m_swapChainSupport.surfaceFormats.empty() && !m_swapChainSupport.presentModes.empty()) );
-	swapChainSupportAdequate = ( swapChainSupportAdequate && 
-							   ( m_swapChainSupport.surfaceCapabilities.maxImageCount > 1) );
+									( !m_swapChainSupport.surfaceFormats.empty() && !m_swapChainSupport.presentModes.empty() &&
+									( m_swapChainSupport.surfaceCapabilities.maxImageCount == 0 || m_swapChainSupport.surfaceCapabilities.maxImageCount > 1) ) );
 
 	return queueSupport & swapChainSupportAdequate  & desiredFeaturesSupported & deviceExtensionsSupported;
 }
+int VulkanManager::rankPhysicalDevice(VkPhysicalDevice pDevice)
+{
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(pDevice, &deviceProperties);
+
+	int typeRank = 0;
+	switch (deviceProperties.deviceType)
+	{
+	case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:   typeRank = 4; break;
+	case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: typeRank = 3; break;
+	case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:    typeRank = 2; break;
+	case VK_PHYSICAL_DEVICE_TYPE_CPU:            typeRank = 1; break;
+	default:                                     typeRank = 0; break;
+	}
+
+	const bool rayTracing = VulkanDevicesUtil::checkDeviceExtensionSupport(pDevice,
+		{ VK_KHR_GET_MEMORY_REQUIREMENTS_2_EXTENSION_NAME, VK_NV_RAY_TRACING_EXTENSION_NAME });
+	return 2 * typeRank + (rayTracing ? 1 : 0);
+}
 
 SwapChainSupportDetails VulkanManager::querySwapChainSupport()
 {
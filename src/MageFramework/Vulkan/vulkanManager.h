@@ -3,6 +3,12 @@
 #include <Vulkan/Utilities/vSwapChainUtil.h>
 #include <Vulkan/Utilities/vImageUtil.h>
 #include <Vulkan/Utilities/vDeviceUtil.h>
+#include <Vulkan/vulkanResourceCache.h>
+#include <Vulkan/vulkanUploadQueue.h>
+#include <Vulkan/vulkanDeletionQueue.h>
+#include <Vulkan/vulkanGpuProfiler.h>
+#include <Vulkan/vulkanFrameCapture.h>
+#include <Vulkan/vulkanMemoryTracker.h>
 
 #ifdef DEBUG_MAGE_FRAMEWORK
 static const bool ENABLE_VALIDATION = true;
@@ -15,6 +21,8 @@ const std::vector<const char*> validationLayers =
 	"VK_LAYER_LUNARG_standard_validation"
 };
 
+static const uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+
 struct VulkanDevices
 {
 	VkDevice lDevice; // Logical Device
@@ -26,10 +34,20 @@ class VulkanManager
 {
 public:
 	VulkanManager() = delete;
-	VulkanManager(GLFWwindow* _window, const char* applicationName);
+	// framesInFlight is clamped to [1, MAX_FRAMES_IN_FLIGHT], the present mode falls back to FIFO if the surface doesn't support it
+	// preferAsyncCompute picks a compute only queue family if there is one, compute shares the graphics queue otherwise
+	// preferDedicatedTransfer does the same for uploads with a transfer only queue family
+	VulkanManager(GLFWwindow* _window, const char* applicationName,
+		uint32_t framesInFlight = 3, VkPresentModeKHR preferredPresentMode = VK_PRESENT_MODE_MAILBOX_KHR, bool preferAsyncCompute = true,
+		bool preferDedicatedTransfer = true);
+	// Headless -- no window, surface or swapchain. Frames render into a chain of offscreen images of the given size that stand in for
+	// the swapchain images: acquiring hands them out round robin and presenting only ends the frame, nothing waits on the display.
+	VulkanManager(VkExtent2D offscreenExtent, const char* applicationName,
+		uint32_t framesInFlight = 3, bool preferAsyncCompute = true, bool preferDedicatedTransfer = true);
 	~VulkanManager();
-	void cleanup();
+	void cleanup(); // Waits for the device, only for shutdown
 	
+	// Replaces the swapchain or offscreen images without waiting on the device, the old ones go through the deletion queue
 	void recreate(GLFWwindow* window);
 	void createPresentationObjects(GLFWwindow* window);
 
@@ -39,19 +57,57 @@ public:
 	bool presentImageToSwapChain();
 	void advanceCurrentFrameIndex();
 
-	// Fences
+	// Fences -- with timeline semaphores these wait on the graphics timeline instead and the reset is a no-op
 	void waitForFrameInFlightFence();
 	void waitForImageInFlightFence();
 	void resetFrameInFlightFence();
+	// Waits until the GPU has finished the most recently submitted frame, i.e. nothing is left in flight
+	void waitForPreviousFrame();
+
+	// Input to frame completion latency -- the input time is attached to the next frame that gets submitted and the latency
+	// is taken when the CPU sees that frame finish, at the latest when its frame in flight slot is waited on again.
+	// This stops at GPU completion, not at the present: when the image reaches the display isn't observable without
+	// VK_KHR_present_wait, and the present queue and vertical blank add to it in FIFO and MAILBOX.
+	void markInputSampled();
+	float getLastInputToCompletionLatency() const { return m_lastInputToCompletionLatency; } // ms
+
+	// Timeline Semaphores -- one per queue, every submission to a queue signals the next value on that queue's timeline.
+	// A value that has been reached means everything submitted up to it has finished executing, 
+	// which is what frame waits and anything retiring resources check against.
+	bool usesTimelineSemaphores() const { return m_useTimelineSemaphores; }
+	void setUseTimelineSemaphores(bool useTimelineSemaphores) { m_useTimelineSemaphores = useTimelineSemaphores && m_timelineSemaphoreSupported; }
+	VkSemaphore getTimelineSemaphore(QueueFlags flag) const { return m_timelineSemaphores[flag]; }
+	uint64_t getNextTimelineValue(QueueFlags flag) { return ++m_timelineValues[flag]; } // Value the next submission on the queue should signal
+	uint64_t getLastTimelineValue(QueueFlags flag) const { return m_timelineValues[flag]; } // Value signaled by the last submission on the queue
+	uint64_t getCompletedTimelineValue(QueueFlags flag) const;
+	void waitForTimelineValue(QueueFlags flag, uint64_t value) const;
+
+	// Deferred destruction -- the object is destroyed once the frame that is being prepared and the uploads recorded so far have finished,
+	// nothing waits on the device. Finished objects are collected whenever a frame wait returns.
+	void deferDestruction(std::function<void()> destroy);
+	void deferDestruction(std::shared_ptr<void> object);
+	// Frames are counted from 1, a frame is submitted once advanceCurrentFrameIndex() has moved past it
+	uint64_t getSubmittedFrameCount() const { return m_submittedFrameCount; }
+	uint64_t getCompletedFrameCount() const { return m_completedFrameCount; }
+	// Checks which frames have finished without waiting, frame waits do this for the frame they waited on
+	void pollCompletedFrames();
+
+	// Time the CPU spent blocked on the GPU at the start of the current frame, in milliseconds
+	float getLastFrameWaitTime() const { return m_lastFrameWaitTime; }
+
+	bool isHeadless() const { return m_headless; }
+	// Layout a frame leaves its swapchain image in, offscreen images are left ready to be copied out of
+	VkImageLayout getPresentLayout() const { return m_headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; }
+	// Offscreen images always can be, swapchain images only where the surface allows transfer source usage
+	bool canCopyFromSwapChainImages() const { return m_swapChainCopyable; }
 
 	// Image Transitions
 	void transitionSwapChainImageLayout(uint32_t index, VkImageLayout oldLayout, VkImageLayout newLayout, VkCommandBuffer& graphicsCmdBuffer, VkCommandPool& graphicsCmdPool);
 	void transitionSwapChainImageLayout_SingleTimeCommand(uint32_t index, VkImageLayout oldLayout, VkImageLayout newLayout, VkCommandPool& graphicsCmdPool);
 
-	// Copy srcImage to swapchain image
-	// The source image has to be inVK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
-	// The swapchain image has to be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-	void copyImageToSwapChainImage(uint32_t index, VkImage& srcImage, VkCommandBuffer& graphicsCmdBuffer, VkCommandPool& graphicsCmdPool, VkExtent2D imgExtents);
+	// Headless only -- copies a finished offscreen image through a staging buffer into tightly packed RGBA8 pixels.
+	// Blocks until the copy is done, the frame that rendered the image has to have finished already.
+	void readBackSwapChainImage(uint32_t index, std::vector<unsigned char>& rgbaPixels, VkCommandPool& graphicsCmdPool);
 
 	//---------
 	// Getters
@@ -62,16 +118,29 @@ public:
 	const VkDevice getLogicalDevice() const { return m_logicalDevice; }
 	const VkPhysicalDevice getPhysicalDevice() const { return m_physicalDevice; }
 	const VulkanDevices getVulkanDevices() const { return { m_logicalDevice, m_physicalDevice }; }
+	const VkPhysicalDeviceProperties& getPhysicalDeviceProperties() const { return m_physicalDeviceProperties; }
+	std::shared_ptr<VulkanResourceCache> getResourceCache() const { return m_resourceCache; }
+	std::shared_ptr<VulkanUploadQueue> getUploadQueue() const { return m_uploadQueue; }
+	std::shared_ptr<VulkanDeletionQueue> getDeletionQueue() const { return m_deletionQueue; }
+	std::shared_ptr<VulkanGpuProfiler> getGpuProfiler() const { return m_gpuProfiler; }
+	std::shared_ptr<VulkanFrameCapture> getFrameCapture() const { return m_frameCapture; }
 
 	VkQueue getQueue(QueueFlags flag) const { return m_queues[flag]; }
 	uint32_t getQueueIndex(QueueFlags flag) const { return m_queueFamilyIndices[flag]; }
+	// Compute runs on its own queue family, resources written by one and read by the other need queue family ownership transfers
+	bool usesAsyncCompute() const { return m_queueFamilyIndices[QueueFlags::Compute] != m_queueFamilyIndices[QueueFlags::Graphics]; }
+	// Uploads run on their own queue family, see VulkanUploadQueue
+	bool usesDedicatedTransferQueue() const { return m_queueFamilyIndices[QueueFlags::Transfer] != m_queueFamilyIndices[QueueFlags::Graphics]; }
 	
+	VkImage getSwapChainImage(uint32_t index) const { return m_swapChainImages[index]; }
 	VkImageView getSwapChainImageView(uint32_t index) const { return m_swapChainImageViews[index]; }
 	const VkFormat getSwapChainImageFormat() const { return m_swapChainImageFormat; }
 	const uint32_t getSwapChainImageCount() const { return static_cast<uint32_t>(m_swapChainImages.size()); }
 	const VkExtent2D getSwapChainVkExtent() const { return m_swapChainExtent; }
 	const uint32_t getFrameIndex() const { return m_currentFrame; }
+	const uint32_t getPreviousFrameIndex() const { return (m_currentFrame + m_numFramesInFlight - 1) % m_numFramesInFlight; } // The last frame presented
 	const uint32_t getImageIndex() const { return m_currentImage; }
+	const uint32_t getNumFramesInFlight() const { return m_numFramesInFlight; }
 
 	VkSemaphore getImageAvailableVkSemaphore() const { return m_imageAvailableSemaphores[m_currentFrame]; }
 	VkSemaphore getRenderFinishedVkSemaphore() const { return m_renderFinishedSemaphores[m_currentFrame]; }
@@ -79,10 +148,28 @@ public:
 
 	const VkSurfaceFormatKHR getSurfaceFormat() const { return m_surfaceFormat; }
 	const VkPresentModeKHR getPresentMode() const { return m_presentMode; }
+	const VkPresentModeKHR getPreferredPresentMode() const { return m_preferredPresentMode; }
+
+	// Optional device features
+	bool isDescriptorIndexingSupported() const { return m_descriptorIndexingSupported; }
+	uint32_t getMaxBindlessSampledImages() const { return m_maxBindlessSampledImages; }
+	bool isTimelineSemaphoreSupported() const { return m_timelineSemaphoreSupported; }
+	bool isRayTracingSupported() const { return m_rayTracingSupported; }
+	bool isMemoryBudgetSupported() const { return m_memoryBudgetSupported; }
+	bool isPipelineStatisticsSupported() const { return m_pipelineStatisticsSupported; }
+	// What the device-local heaps have allocated, by this and any other process, 0 without VK_EXT_memory_budget
+	VkDeviceSize getDeviceLocalMemoryUsage() const;
+	// Every heap with what the memory tracker has allocated in it, plus the driver's budget and usage with VK_EXT_memory_budget
+	std::vector<VulkanMemoryTracker::HeapStats> getMemoryHeapStats() const;
+	// What can still be allocated in the device-local heaps before going over budget (or over the heap size without VK_EXT_memory_budget),
+	// streaming should hold back and evict before this runs out
+	VkDeviceSize getDeviceLocalMemoryHeadroom() const;
 
 private:
+	void initialize(GLFWwindow* window, const char* applicationName);
 	void initVulkanInstance(const char* applicationName, unsigned int additionalExtensionCount = 0, const char** additionalExtensions = nullptr);
 	void pickPhysicalDevice(std::vector<const char*> deviceExtensions, QueueFlagBits& requiredQueues);
+	void queryOptionalDeviceFeatures();
 	void createLogicalDevice(QueueFlagBits requiredQueues);
 
 	//-----------------------------------------
@@ -90,14 +177,20 @@ private:
 	//-----------------------------------------
 	// Creates SwapChain and store a handle to the images that make up the swapchain
 	void createSwapChain(GLFWwindow* window);
+	// Headless stand in for the swapchain images
+	void createOffscreenImages();
 	void createSwapChainImageViews();
 	void createSyncObjects();
+	void measureInputToCompletionLatency(uint32_t frameIndex);
+	void frameCompleted(uint32_t frameIndex);
 
 	//------------------------------------
 	// Helper Functions -- Vulkan Devices
 	//------------------------------------
 	bool isPhysicalDeviceSuitable(VkPhysicalDevice device, std::vector<const char*> deviceExtensions,
 		QueueFlagBits requiredQueues, VkSurfaceKHR vkSurface = VK_NULL_HANDLE);
+	// Higher is better: discrete GPUs first, then integrated, virtual and CPU implementations (e.g. lavapipe), ray tracing breaks ties
+	int rankPhysicalDevice(VkPhysicalDevice device);
 	SwapChainSupportDetails querySwapChainSupport();
 
 	//-------------------------------------
@@ -127,13 +220,25 @@ private:
 	//-----------------------
 	// Vulkan Device related
 	//-----------------------
-	VkSurfaceKHR m_surface;
+	VkSurfaceKHR m_surface = VK_NULL_HANDLE; // Stays null when headless
 
 	// The physical device is the GPU and the logical device interfaces with the physical device.
 	// Reference: https://vulkan-tutorial.com/Drawing_a_triangle/Presentation
 	VkDevice m_logicalDevice;
 	VkPhysicalDevice m_physicalDevice;
 	VkPhysicalDeviceMemoryProperties deviceMemoryProperties;
+	VkPhysicalDeviceProperties m_physicalDeviceProperties;
+
+	// Shared samplers and image views, outlives every texture and is destroyed right before the logical device
+	std::shared_ptr<VulkanResourceCache> m_resourceCache;
+	// Staging uploads for buffers and textures, same lifetime as the resource cache
+	std::shared_ptr<VulkanUploadQueue> m_uploadQueue;
+	// Resources retired while frames are in flight, emptied right before the upload queue goes
+	std::shared_ptr<VulkanDeletionQueue> m_deletionQueue;
+	// Per pass GPU timings
+	std::shared_ptr<VulkanGpuProfiler> m_gpuProfiler;
+	// Screenshots and frame sequences, copied out per swapchain image and written by background threads
+	std::shared_ptr<VulkanFrameCapture> m_frameCapture;
 
 	// Queues are required to submit commands
 	Queues m_queues;
@@ -143,28 +248,73 @@ private:
 	std::vector<const char*> m_deviceExtensions;
 	std::vector<const char*> m_instanceExtensions;
 
+	// Optional Features -- enabled when the physical device supports them, the renderer falls back otherwise
+	bool m_descriptorIndexingSupported = false;
+	uint32_t m_maxBindlessSampledImages = 0;
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT m_descriptorIndexingFeatures = {};
+	bool m_timelineSemaphoreSupported = false;
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR m_timelineSemaphoreFeatures = {};
+	PFN_vkWaitSemaphoresKHR m_vkWaitSemaphoresKHR = nullptr;
+	PFN_vkGetSemaphoreCounterValueKHR m_vkGetSemaphoreCounterValueKHR = nullptr;
+	bool m_rayTracingSupported = false;
+	bool m_memoryBudgetSupported = false;
+	bool m_pipelineStatisticsSupported = false;
+	bool m_inheritedQueriesSupported = false;
+	PFN_vkGetPhysicalDeviceMemoryProperties2KHR m_vkGetPhysicalDeviceMemoryProperties2KHR = nullptr;
+
 	SwapChainSupportDetails m_swapChainSupport;
 	VkSurfaceFormatKHR m_surfaceFormat;
 	VkPresentModeKHR m_presentMode;
+	VkPresentModeKHR m_preferredPresentMode;
+	bool m_preferAsyncCompute;
+	bool m_preferDedicatedTransfer;
 
 	//-----------------------------
 	// Vulkan Presentation related
 	//-----------------------------
 
-	VkSwapchainKHR m_swapChain;
+	bool m_headless = false;
+	VkExtent2D m_offscreenExtent = {};
+	std::vector<VkDeviceMemory> m_offscreenImageMemory; // Headless only, backs the images below
+
+	VkSwapchainKHR m_swapChain = VK_NULL_HANDLE;
 	std::vector<VkImage> m_swapChainImages;
 	std::vector<VkImageView> m_swapChainImageViews;
+	bool m_swapChainCopyable = false;
 
 	VkFormat m_swapChainImageFormat;
 	VkExtent2D m_swapChainExtent;
 	uint32_t m_currentFrame = 0;
 	uint32_t m_currentImage;
 
+	// Per frame in flight -- everything the CPU touches while preparing a frame: sync objects here, transient command pools in the backend.
+	// Per swapchain image -- everything bound to the image a frame renders into: image views and framebuffers, and the uniform buffers and
+	// descriptor sets the prerecorded per image command buffers bind. Those are safe to update as soon as the image's last frame is done.
+	uint32_t m_numFramesInFlight;
 	std::vector<VkSemaphore> m_imageAvailableSemaphores;
 	std::vector<VkSemaphore> m_renderFinishedSemaphores;
 	std::vector<VkFence> m_framesInFlight;
 	std::vector<VkFence> m_imagesInFlight;
 
+	// Timeline semaphores replace the fences above when they are in use, the binary semaphores stay 
+	// because acquiring and presenting swapchain images can't wait on or signal a timeline semaphore
+	bool m_useTimelineSemaphores = false;
+	std::array<VkSemaphore, sizeof(QueueFlags)> m_timelineSemaphores = {};
+	std::array<uint64_t, sizeof(QueueFlags)> m_timelineValues = {};
+	std::vector<uint64_t> m_frameTimelineValues; // Graphics timeline value that signals the frame is done, per frame in flight
+	std::vector<uint64_t> m_imageTimelineValues; // Graphics timeline value of the last frame that rendered to the image, per swapchain image
+	uint64_t m_submittedFrameCount = 0;
+	uint64_t m_completedFrameCount = 0;
+	std::vector<uint64_t> m_frameSerials; // Number of the last frame submitted from each frame in flight slot
+	float m_lastFrameWaitTime = 0.0f;
+	float m_pendingWaitTime = 0.0f; // Waits that happened before the frame started, added to the frame's wait time
+
+	TIME_POINT m_inputSampleTime;
+	bool m_inputSamplePending = false;
+	std::vector<TIME_POINT> m_frameInputTimes; // Per frame in flight
+	std::vector<bool> m_frameInputPending;
+	float m_lastInputToCompletionLatency = 0.0f;
+
 	//----------
 	// Settings
 	//----------
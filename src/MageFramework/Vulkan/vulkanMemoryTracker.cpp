@@ -0,0 +1,183 @@
+#include "vulkanMemoryTracker.h"
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+	struct Allocation
+	{
+		VkDeviceSize size;
+		uint32_t heapIndex;
+		MEMORY_CATEGORY category;
+	};
+
+	const char* const s_categoryNames[] = {
+		"vertex", "index", "uniform", "texture", "render target", "accel structure", "scratch", "staging", "other" };
+	static_assert(sizeof(s_categoryNames) / sizeof(s_categoryNames[0]) == static_cast<size_t>(MEMORY_CATEGORY::COUNT),
+		"every memory category needs a name");
+
+	// Allocations come from loading threads as well as the render thread
+	std::mutex s_mutex;
+	VkPhysicalDeviceMemoryProperties s_memoryProperties = {};
+	std::unordered_map<VkDeviceMemory, Allocation> s_allocations;
+	std::array<VulkanMemoryTracker::CategoryStats, static_cast<size_t>(MEMORY_CATEGORY::COUNT)> s_categories;
+
+	double toMB(VkDeviceSize bytes)
+	{
+		return static_cast<double>(bytes) / (1024.0 * 1024.0);
+	}
+}
+
+void VulkanMemoryTracker::setMemoryProperties(const VkPhysicalDeviceMemoryProperties& memoryProperties)
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	s_memoryProperties = memoryProperties;
+}
+
+VkResult VulkanMemoryTracker::allocate(VkDevice logicalDevice, const VkMemoryAllocateInfo& allocateInfo, VkDeviceMemory& memory, MEMORY_CATEGORY category)
+{
+	const VkResult result = vkAllocateMemory(logicalDevice, &allocateInfo, nullptr, &memory);
+	if (result != VK_SUCCESS)
+	{
+		return result;
+	}
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+	const uint32_t heapIndex = (allocateInfo.memoryTypeIndex < s_memoryProperties.memoryTypeCount) ?
+		s_memoryProperties.memoryTypes[allocateInfo.memoryTypeIndex].heapIndex : 0;
+	s_allocations[memory] = { allocateInfo.allocationSize, heapIndex, category };
+
+	CategoryStats& stats = s_categories[static_cast<size_t>(category)];
+	stats.allocated += allocateInfo.allocationSize;
+	stats.peakAllocated = std::max(stats.peakAllocated, stats.allocated);
+	stats.numAllocations++;
+	stats.allocatedPerHeap[heapIndex] += allocateInfo.allocationSize;
+	return result;
+}
+
+void VulkanMemoryTracker::free(VkDevice logicalDevice, VkDeviceMemory memory)
+{
+	if (memory == VK_NULL_HANDLE)
+	{
+		return;
+	}
+	vkFreeMemory(logicalDevice, memory, nullptr);
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+	auto allocation = s_allocations.find(memory);
+	if (allocation == s_allocations.end())
+	{
+		return;
+	}
+	CategoryStats& stats = s_categories[static_cast<size_t>(allocation->second.category)];
+	stats.allocated -= allocation->second.size;
+	stats.numAllocations--;
+	stats.allocatedPerHeap[allocation->second.heapIndex] -= allocation->second.size;
+	s_allocations.erase(allocation);
+}
+
+MEMORY_CATEGORY VulkanMemoryTracker::categorizeBuffer(VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
+{
+	if (usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT) { return MEMORY_CATEGORY::VERTEX; }
+	if (usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT) { return MEMORY_CATEGORY::INDEX; }
+	if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) { return MEMORY_CATEGORY::UNIFORM; }
+	// The scratch space of acceleration structure builds is the only ray tracing buffer the host never writes,
+	// instance data and shader binding tables are mapped
+	if ((usage & VK_BUFFER_USAGE_RAY_TRACING_BIT_NV) && !(properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) { return MEMORY_CATEGORY::SCRATCH; }
+	// Host visible buffers that are only copied from or into, i.e. uploads and readbacks
+	const VkBufferUsageFlags transferUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	if ((usage & ~transferUsage) == 0 && (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) { return MEMORY_CATEGORY::STAGING; }
+	return MEMORY_CATEGORY::OTHER;
+}
+
+MEMORY_CATEGORY VulkanMemoryTracker::categorizeImage(VkImageUsageFlags usage)
+{
+	// Anything the GPU renders or writes into, including the storage images of compute and ray tracing passes
+	const VkImageUsageFlags renderTargetUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+		VK_IMAGE_USAGE_STORAGE_BIT;
+	return (usage & renderTargetUsage) ? MEMORY_CATEGORY::RENDER_TARGET : MEMORY_CATEGORY::TEXTURE;
+}
+
+const char* VulkanMemoryTracker::getCategoryName(MEMORY_CATEGORY category)
+{
+	return s_categoryNames[static_cast<size_t>(category)];
+}
+
+std::array<VulkanMemoryTracker::CategoryStats, static_cast<size_t>(MEMORY_CATEGORY::COUNT)> VulkanMemoryTracker::getCategoryStats()
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	return s_categories;
+}
+
+std::vector<VulkanMemoryTracker::HeapStats> VulkanMemoryTracker::getHeapStats()
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	std::vector<HeapStats> heaps(s_memoryProperties.memoryHeapCount);
+	for (uint32_t i = 0; i < s_memoryProperties.memoryHeapCount; i++)
+	{
+		heaps[i].size = s_memoryProperties.memoryHeaps[i].size;
+		heaps[i].deviceLocal = (s_memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+	}
+	for (const auto& allocation : s_allocations)
+	{
+		if (allocation.second.heapIndex < heaps.size())
+		{
+			heaps[allocation.second.heapIndex].allocated += allocation.second.size;
+			heaps[allocation.second.heapIndex].numAllocations++;
+		}
+	}
+	return heaps;
+}
+
+uint32_t VulkanMemoryTracker::getNumLiveAllocations()
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	return static_cast<uint32_t>(s_allocations.size());
+}
+
+void VulkanMemoryTracker::printAllocationTable(std::ostream& out, const std::vector<HeapStats>& heaps)
+{
+	const auto categories = getCategoryStats();
+	const std::ios_base::fmtflags flags = out.flags();
+	const std::streamsize precision = out.precision();
+	out << std::fixed << std::setprecision(1);
+
+	out << std::left << std::setw(18) << "category" << std::right << std::setw(8) << "count" << std::setw(12) << "peak MB";
+	for (size_t heap = 0; heap < heaps.size(); heap++)
+	{
+		out << std::setw(12) << ("heap " + std::to_string(heap) + " MB");
+	}
+	out << "\n";
+	for (size_t i = 0; i < categories.size(); i++)
+	{
+		const CategoryStats& stats = categories[i];
+		if (stats.peakAllocated == 0)
+		{
+			continue;
+		}
+		out << std::left << std::setw(18) << s_categoryNames[i] << std::right << std::setw(8) << stats.numAllocations
+			<< std::setw(12) << toMB(stats.peakAllocated);
+		for (size_t heap = 0; heap < heaps.size(); heap++)
+		{
+			out << std::setw(12) << toMB(stats.allocatedPerHeap[heap]);
+		}
+		out << "\n";
+	}
+
+	for (size_t heap = 0; heap < heaps.size(); heap++)
+	{
+		const HeapStats& stats = heaps[heap];
+		out << "heap " << heap << (stats.deviceLocal ? " (device local)" : " (host)") << ": " << toMB(stats.allocated) << " MB in "
+			<< stats.numAllocations << " allocations of " << toMB(stats.size) << " MB";
+		if (stats.budget > 0)
+		{
+			out << ", driver reports " << toMB(stats.usage) << " MB used of a " << toMB(stats.budget) << " MB budget";
+		}
+		out << "\n";
+	}
+
+	out.flags(flags);
+	out.precision(precision);
+}
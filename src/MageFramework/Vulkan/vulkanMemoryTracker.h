@@ -0,0 +1,57 @@
+#pragma once
+#include <global.h>
+#include <array>
+#include <ostream>
+
+enum class MEMORY_CATEGORY
+{
+	VERTEX, INDEX, UNIFORM, TEXTURE, RENDER_TARGET, ACCELERATION_STRUCTURE, SCRATCH, STAGING, OTHER,
+	COUNT
+};
+
+// Accounting of every VkDeviceMemory allocation, by category and by memory heap.
+// Every allocation and free goes through VulkanMemoryTracker::allocate and VulkanMemoryTracker::free instead of vkAllocateMemory
+// and vkFreeMemory. The buffer and image helpers pick the category from the usage flags, see categorizeBuffer and categorizeImage.
+// The state is global, like the CPU profiler's, because the helpers that allocate don't know about the VulkanManager.
+// The VulkanManager hands over its physical device's memory layout and adds the driver's view of the heaps (VK_EXT_memory_budget),
+// see VulkanManager::getMemoryHeapStats.
+namespace VulkanMemoryTracker
+{
+	struct HeapStats
+	{
+		VkDeviceSize size = 0;
+		bool deviceLocal = false;
+		VkDeviceSize allocated = 0; // By this process, through the tracker
+		uint32_t numAllocations = 0;
+		// What the driver reports with VK_EXT_memory_budget, by every process; 0 without it
+		VkDeviceSize budget = 0;
+		VkDeviceSize usage = 0;
+	};
+
+	struct CategoryStats
+	{
+		VkDeviceSize allocated = 0;
+		VkDeviceSize peakAllocated = 0;
+		uint32_t numAllocations = 0;
+		std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> allocatedPerHeap = {};
+	};
+
+	// Called by the VulkanManager once it has picked the physical device, before anything is allocated
+	void setMemoryProperties(const VkPhysicalDeviceMemoryProperties& memoryProperties);
+
+	VkResult allocate(VkDevice logicalDevice, const VkMemoryAllocateInfo& allocateInfo, VkDeviceMemory& memory, MEMORY_CATEGORY category);
+	// Ignores VK_NULL_HANDLE
+	void free(VkDevice logicalDevice, VkDeviceMemory memory);
+
+	MEMORY_CATEGORY categorizeBuffer(VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+	MEMORY_CATEGORY categorizeImage(VkImageUsageFlags usage);
+	const char* getCategoryName(MEMORY_CATEGORY category);
+
+	std::array<CategoryStats, static_cast<size_t>(MEMORY_CATEGORY::COUNT)> getCategoryStats();
+	// Without the budget and usage, see VulkanManager::getMemoryHeapStats
+	std::vector<HeapStats> getHeapStats();
+	uint32_t getNumLiveAllocations();
+
+	// The table of categories by heap followed by the heaps, sizes in MB
+	void printAllocationTable(std::ostream& out, const std::vector<HeapStats>& heaps);
+}
@@ -0,0 +1,217 @@
+#include "vulkanResourceCache.h"
+#include <cstring>
+
+namespace
+{
+	template<typename T>
+	inline void hashCombine(size_t& seed, const T& value)
+	{
+		seed ^= std::hash<T>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+	}
+
+	inline uint32_t floatBits(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+}
+
+//--------------------
+// Key Hashing
+//--------------------
+bool VulkanResourceCache::SamplerKey::operator==(const SamplerKey& other) const
+{
+	const VkSamplerCreateInfo& a = info;
+	const VkSamplerCreateInfo& b = other.info;
+	return a.flags == b.flags && a.magFilter == b.magFilter && a.minFilter == b.minFilter && a.mipmapMode == b.mipmapMode &&
+		a.addressModeU == b.addressModeU && a.addressModeV == b.addressModeV && a.addressModeW == b.addressModeW &&
+		a.mipLodBias == b.mipLodBias && a.anisotropyEnable == b.anisotropyEnable && a.maxAnisotropy == b.maxAnisotropy &&
+		a.compareEnable == b.compareEnable && a.compareOp == b.compareOp && a.minLod == b.minLod && a.maxLod == b.maxLod &&
+		a.borderColor == b.borderColor && a.unnormalizedCoordinates == b.unnormalizedCoordinates;
+}
+size_t VulkanResourceCache::SamplerKeyHash::operator()(const SamplerKey& key) const
+{
+	const VkSamplerCreateInfo& i = key.info;
+	size_t seed = 0;
+	hashCombine(seed, i.flags);
+	hashCombine(seed, static_cast<uint32_t>(i.magFilter));
+	hashCombine(seed, static_cast<uint32_t>(i.minFilter));
+	hashCombine(seed, static_cast<uint32_t>(i.mipmapMode));
+	hashCombine(seed, static_cast<uint32_t>(i.addressModeU));
+	hashCombine(seed, static_cast<uint32_t>(i.addressModeV));
+	hashCombine(seed, static_cast<uint32_t>(i.addressModeW));
+	hashCombine(seed, floatBits(i.mipLodBias));
+	hashCombine(seed, i.anisotropyEnable);
+	hashCombine(seed, floatBits(i.maxAnisotropy));
+	hashCombine(seed, i.compareEnable);
+	hashCombine(seed, static_cast<uint32_t>(i.compareOp));
+	hashCombine(seed, floatBits(i.minLod));
+	hashCombine(seed, floatBits(i.maxLod));
+	hashCombine(seed, static_cast<uint32_t>(i.borderColor));
+	hashCombine(seed, i.unnormalizedCoordinates);
+	return seed;
+}
+
+bool VulkanResourceCache::ImageViewKey::operator==(const ImageViewKey& other) const
+{
+	const VkImageViewCreateInfo& a = info;
+	const VkImageViewCreateInfo& b = other.info;
+	return a.flags == b.flags && a.image == b.image && a.viewType == b.viewType && a.format == b.format &&
+		a.components.r == b.components.r && a.components.g == b.components.g &&
+		a.components.b == b.components.b && a.components.a == b.components.a &&
+		a.subresourceRange.aspectMask == b.subresourceRange.aspectMask &&
+		a.subresourceRange.baseMipLevel == b.subresourceRange.baseMipLevel &&
+		a.subresourceRange.levelCount == b.subresourceRange.levelCount &&
+		a.subresourceRange.baseArrayLayer == b.subresourceRange.baseArrayLayer &&
+		a.subresourceRange.layerCount == b.subresourceRange.layerCount;
+}
+size_t VulkanResourceCache::ImageViewKeyHash::operator()(const ImageViewKey& key) const
+{
+	const VkImageViewCreateInfo& i = key.info;
+	size_t seed = 0;
+	hashCombine(seed, i.flags);
+	hashCombine(seed, i.image);
+	hashCombine(seed, static_cast<uint32_t>(i.viewType));
+	hashCombine(seed, static_cast<uint32_t>(i.format));
+	hashCombine(seed, static_cast<uint32_t>(i.components.r));
+	hashCombine(seed, static_cast<uint32_t>(i.components.g));
+	hashCombine(seed, static_cast<uint32_t>(i.components.b));
+	hashCombine(seed, static_cast<uint32_t>(i.components.a));
+	hashCombine(seed, i.subresourceRange.aspectMask);
+	hashCombine(seed, i.subresourceRange.baseMipLevel);
+	hashCombine(seed, i.subresourceRange.levelCount);
+	hashCombine(seed, i.subresourceRange.baseArrayLayer);
+	hashCombine(seed, i.subresourceRange.layerCount);
+	return seed;
+}
+
+//--------------------
+// Cache
+//--------------------
+VulkanResourceCache::VulkanResourceCache(VkDevice logicalDevice, VkPhysicalDevice physicalDevice)
+	: m_logicalDevice(logicalDevice)
+{
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+	m_deviceMaxAnisotropy = deviceProperties.limits.maxSamplerAnisotropy;
+	m_maxSamplerAllocationCount = deviceProperties.limits.maxSamplerAllocationCount;
+	m_maxAnisotropy = m_deviceMaxAnisotropy;
+}
+VulkanResourceCache::~VulkanResourceCache()
+{
+	for (auto& sampler : m_samplers)
+	{
+		vkDestroySampler(m_logicalDevice, sampler.second, nullptr);
+	}
+	m_samplers.clear();
+
+	// Views still alive here belong to images that were never released, destroy them so the device can be destroyed cleanly
+	for (auto& imageView : m_imageViews)
+	{
+		vkDestroyImageView(m_logicalDevice, imageView.second.view, nullptr);
+	}
+	m_imageViews.clear();
+	m_imageViewKeys.clear();
+}
+
+void VulkanResourceCache::setMaxAnisotropy(float maxAnisotropy)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_maxAnisotropy = std::max(1.0f, std::min(maxAnisotropy, m_deviceMaxAnisotropy));
+}
+
+VkSampler VulkanResourceCache::getSampler(const VkSamplerCreateInfo& createInfo)
+{
+	if (createInfo.pNext != nullptr)
+	{
+		throw std::runtime_error("sampler create infos with a pNext chain can't be cached");
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_numSamplerRequests++;
+
+	// Apply the anisotropy setting before hashing so samplers that end up identical are shared
+	SamplerKey key = { createInfo };
+	if (key.info.anisotropyEnable)
+	{
+		key.info.maxAnisotropy = std::min(key.info.maxAnisotropy, m_maxAnisotropy);
+	}
+	if (!key.info.anisotropyEnable || key.info.maxAnisotropy <= 1.0f)
+	{
+		key.info.anisotropyEnable = VK_FALSE;
+		key.info.maxAnisotropy = 1.0f;
+	}
+
+	auto found = m_samplers.find(key);
+	if (found != m_samplers.end())
+	{
+		return found->second;
+	}
+
+	if (m_samplers.size() >= m_maxSamplerAllocationCount)
+	{
+		throw std::runtime_error("exceeded maxSamplerAllocationCount, too many unique sampler states");
+	}
+
+	VkSampler sampler;
+	if (vkCreateSampler(m_logicalDevice, &key.info, nullptr, &sampler) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create texture sampler!");
+	}
+	m_samplers.insert({ key, sampler });
+	return sampler;
+}
+
+VkImageView VulkanResourceCache::getImageView(const VkImageViewCreateInfo& createInfo)
+{
+	if (createInfo.pNext != nullptr)
+	{
+		throw std::runtime_error("image view create infos with a pNext chain can't be cached");
+	}
+
+	ImageViewKey key = { createInfo };
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_numImageViewRequests++;
+
+	auto found = m_imageViews.find(key);
+	if (found != m_imageViews.end())
+	{
+		found->second.refCount++;
+		return found->second.view;
+	}
+
+	VkImageView imageView;
+	if (vkCreateImageView(m_logicalDevice, &key.info, nullptr, &imageView) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create image views!");
+	}
+	m_imageViews.insert({ key, { imageView, 1 } });
+	m_imageViewKeys.insert({ imageView, key });
+	return imageView;
+}
+
+void VulkanResourceCache::releaseImageView(VkImageView imageView)
+{
+	if (imageView == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto foundKey = m_imageViewKeys.find(imageView);
+	if (foundKey == m_imageViewKeys.end())
+	{
+		throw std::runtime_error("tried to release an image view that did not come from the resource cache");
+	}
+
+	auto found = m_imageViews.find(foundKey->second);
+	found->second.refCount--;
+	if (found->second.refCount == 0)
+	{
+		vkDestroyImageView(m_logicalDevice, imageView, nullptr);
+		m_imageViews.erase(found);
+		m_imageViewKeys.erase(foundKey);
+	}
+}
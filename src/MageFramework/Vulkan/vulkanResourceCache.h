@@ -0,0 +1,73 @@
+#pragma once
+#include <global.h>
+#include <mutex>
+#include <unordered_map>
+
+// Device level cache for immutable Vulkan objects that are commonly requested many times with identical create infos.
+// Samplers: A scene only ever uses a handful of sampler states, but every texture used to own its own VkSampler.
+//	Samplers live until the cache is destroyed, they are tiny and the device caps how many can exist (maxSamplerAllocationCount).
+// Image Views: Identical view requests on the same image share one VkImageView, views are reference counted because they die with their image.
+// pNext chains are not part of the key, so create infos with a pNext chain can't be cached.
+class VulkanResourceCache
+{
+public:
+	VulkanResourceCache() = delete;
+	VulkanResourceCache(VkDevice logicalDevice, VkPhysicalDevice physicalDevice);
+	~VulkanResourceCache();
+
+	// Anisotropy requested by samplers is clamped to this, i.e. RendererOptions::anisotropy drives every cached sampler.
+	// Only affects samplers created after the call.
+	void setMaxAnisotropy(float maxAnisotropy);
+	float getMaxAnisotropy() const { return m_maxAnisotropy; }
+
+	VkSampler getSampler(const VkSamplerCreateInfo& createInfo);
+	VkImageView getImageView(const VkImageViewCreateInfo& createInfo);
+	void releaseImageView(VkImageView imageView);
+
+	// Stats
+	uint32_t getNumSamplers() const { return static_cast<uint32_t>(m_samplers.size()); }
+	uint32_t getNumSamplerRequests() const { return m_numSamplerRequests; }
+	uint32_t getNumImageViews() const { return static_cast<uint32_t>(m_imageViews.size()); }
+	uint32_t getNumImageViewRequests() const { return m_numImageViewRequests; }
+
+private:
+	struct SamplerKey
+	{
+		VkSamplerCreateInfo info;
+		bool operator==(const SamplerKey& other) const;
+	};
+	struct SamplerKeyHash
+	{
+		size_t operator()(const SamplerKey& key) const;
+	};
+
+	struct ImageViewKey
+	{
+		VkImageViewCreateInfo info;
+		bool operator==(const ImageViewKey& other) const;
+	};
+	struct ImageViewKeyHash
+	{
+		size_t operator()(const ImageViewKey& key) const;
+	};
+
+	struct CachedImageView
+	{
+		VkImageView view;
+		uint32_t refCount;
+	};
+
+private:
+	VkDevice m_logicalDevice;
+	float m_deviceMaxAnisotropy;
+	float m_maxAnisotropy;
+	uint32_t m_maxSamplerAllocationCount;
+
+	std::mutex m_mutex;
+	std::unordered_map<SamplerKey, VkSampler, SamplerKeyHash> m_samplers;
+	std::unordered_map<ImageViewKey, CachedImageView, ImageViewKeyHash> m_imageViews;
+	std::unordered_map<VkImageView, ImageViewKey> m_imageViewKeys; // Reverse lookup for releaseImageView
+
+	uint32_t m_numSamplerRequests = 0;
+	uint32_t m_numImageViewRequests = 0;
+};
@@ -0,0 +1,289 @@
+#include "vulkanUploadQueue.h"
+#include <Vulkan/Utilities/vCommandUtil.h>
+#include <Vulkan/Utilities/vBufferUtil.h>
+#include <Vulkan/Utilities/vImageUtil.h>
+
+VulkanUploadQueue::VulkanUploadQueue(VkDevice logicalDevice, VkPhysicalDevice physicalDevice,
+	VkQueue transferQueue, uint32_t transferFamily, VkQueue graphicsQueue, uint32_t graphicsFamily)
+	: m_logicalDevice(logicalDevice), m_physicalDevice(physicalDevice),
+	m_transferQueue(transferQueue), m_graphicsQueue(graphicsQueue), m_transferFamily(transferFamily), m_graphicsFamily(graphicsFamily)
+{
+	// Every command buffer is recorded once and freed when its batch retires
+	VulkanCommandUtil::createCommandPool(m_logicalDevice, m_transferCmdPool, m_transferFamily, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+	if (usesDedicatedTransferQueue())
+	{
+		VulkanCommandUtil::createCommandPool(m_logicalDevice, m_graphicsCmdPool, m_graphicsFamily, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+	}
+}
+VulkanUploadQueue::~VulkanUploadQueue()
+{
+	flush();
+
+	vkDestroyCommandPool(m_logicalDevice, m_transferCmdPool, nullptr);
+	if (m_graphicsCmdPool != VK_NULL_HANDLE)
+	{
+		vkDestroyCommandPool(m_logicalDevice, m_graphicsCmdPool, nullptr);
+	}
+}
+
+VulkanUploadQueue::Batch& VulkanUploadQueue::getRecordingBatch()
+{
+	if (!m_batches.empty() && m_batches.back().state == BatchState::RECORDING)
+	{
+		return m_batches.back();
+	}
+
+	m_batches.emplace_back();
+	Batch& batch = m_batches.back();
+	batch.ticket = m_nextTicket++;
+
+	VulkanCommandUtil::beginSingleTimeCommand(m_logicalDevice, m_transferCmdPool, batch.transferCmdBuffer);
+	if (usesDedicatedTransferQueue())
+	{
+		VulkanCommandUtil::beginSingleTimeCommand(m_logicalDevice, m_graphicsCmdPool, batch.graphicsCmdBuffer);
+
+		VkSemaphoreCreateInfo semaphoreInfo = {};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		VK_CHECK_RESULT(vkCreateSemaphore(m_logicalDevice, &semaphoreInfo, nullptr, &batch.transferFinished));
+	}
+
+	VkFenceCreateInfo fenceInfo = {};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	VK_CHECK_RESULT(vkCreateFence(m_logicalDevice, &fenceInfo, nullptr, &batch.fence));
+
+	return batch;
+}
+
+void VulkanUploadQueue::uploadBuffer(VkBuffer stagingBuffer, VkDeviceMemory stagingMemory, VkBuffer dstBuffer, VkDeviceSize size)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Batch& batch = getRecordingBatch();
+
+	VulkanCommandUtil::copyCommandBuffer(m_logicalDevice, batch.transferCmdBuffer, stagingBuffer, dstBuffer, 0, 0, size);
+
+	// Uploaded buffers are read by anything from vertex input to acceleration structure builds
+	if (usesDedicatedTransferQueue())
+	{
+		// The release and the acquire have to describe the same transfer, their other access masks are ignored
+		VkBufferMemoryBarrier release = BufferUtil::createBufferMemoryBarrier(dstBuffer, 0, size,
+			VK_ACCESS_TRANSFER_WRITE_BIT, 0, m_transferFamily, m_graphicsFamily);
+		VulkanCommandUtil::pipelineBarrier(batch.transferCmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0, 0, nullptr, 1, &release, 0, nullptr);
+
+		VkBufferMemoryBarrier acquire = BufferUtil::createBufferMemoryBarrier(dstBuffer, 0, size,
+			0, VK_ACCESS_MEMORY_READ_BIT, m_transferFamily, m_graphicsFamily);
+		VulkanCommandUtil::pipelineBarrier(batch.graphicsCmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			0, 0, nullptr, 1, &acquire, 0, nullptr);
+	}
+	else
+	{
+		VkBufferMemoryBarrier barrier = BufferUtil::createBufferMemoryBarrier(dstBuffer, 0, size,
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT);
+		VulkanCommandUtil::pipelineBarrier(batch.transferCmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			0, 0, nullptr, 1, &barrier, 0, nullptr);
+	}
+
+	batch.stagingBuffers.push_back({ stagingBuffer, stagingMemory });
+	m_uploadedBytes += size;
+}
+
+void VulkanUploadQueue::uploadImage(VkBuffer stagingBuffer, VkDeviceMemory stagingMemory, VkImage dstImage, VkFormat format,
+	uint32_t width, uint32_t height, uint32_t mipLevels, bool generateMipMaps)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Batch& batch = getRecordingBatch();
+
+	VkImageSubresourceRange range = ImageUtil::createImageSubResourceRange(VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1);
+	VkImageMemoryBarrier toTransferDst = ImageUtil::createImageMemoryBarrier(dstImage,
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT, range);
+	VulkanCommandUtil::pipelineBarrier(batch.transferCmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &toTransferDst);
+
+	// Copying the whole of mip level 0 is always allowed, whatever the transfer queue's image transfer granularity is
+	VkBufferImageCopy region = {};
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = 1;
+	region.imageExtent = { width, height, 1 };
+	vkCmdCopyBufferToImage(batch.transferCmdBuffer, stagingBuffer, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+	// The mip chain is generated from TRANSFER_DST_OPTIMAL, that transition is left to it
+	const VkImageLayout copiedLayout = generateMipMaps ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	const VkAccessFlags dstAccess = generateMipMaps ? (VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT) : VK_ACCESS_SHADER_READ_BIT;
+	const VkPipelineStageFlags dstStage = generateMipMaps ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+	VkCommandBuffer finishCmdBuffer = batch.transferCmdBuffer;
+	if (usesDedicatedTransferQueue())
+	{
+		// Blits need a graphics queue, so mip generation happens after the acquire
+		VkImageMemoryBarrier release = ImageUtil::createImageMemoryBarrier(dstImage,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, copiedLayout, VK_ACCESS_TRANSFER_WRITE_BIT, 0, range, m_transferFamily, m_graphicsFamily);
+		VulkanCommandUtil::pipelineBarrier(batch.transferCmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &release);
+
+		VkImageMemoryBarrier acquire = ImageUtil::createImageMemoryBarrier(dstImage,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, copiedLayout, 0, dstAccess, range, m_transferFamily, m_graphicsFamily);
+		VulkanCommandUtil::pipelineBarrier(batch.graphicsCmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStage,
+			0, 0, nullptr, 0, nullptr, 1, &acquire);
+
+		finishCmdBuffer = batch.graphicsCmdBuffer;
+	}
+	else if (!generateMipMaps)
+	{
+		VkImageMemoryBarrier toShaderRead = ImageUtil::createImageMemoryBarrier(dstImage,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, copiedLayout, VK_ACCESS_TRANSFER_WRITE_BIT, dstAccess, range);
+		VulkanCommandUtil::pipelineBarrier(batch.transferCmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage,
+			0, 0, nullptr, 0, nullptr, 1, &toShaderRead);
+	}
+
+	if (generateMipMaps)
+	{
+		ImageUtil::recordGenerateMipMaps(finishCmdBuffer, m_physicalDevice, dstImage, format,
+			static_cast<int32_t>(width), static_cast<int32_t>(height), 1, mipLevels);
+	}
+
+	batch.stagingBuffers.push_back({ stagingBuffer, stagingMemory });
+	m_uploadedBytes += static_cast<uint64_t>(FormatUtil::getImageSizeInBytes(format, width, height));
+}
+
+uint64_t VulkanUploadQueue::submit()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return submitRecordingBatch();
+}
+uint64_t VulkanUploadQueue::submitRecordingBatch()
+{
+	if (m_batches.empty() || m_batches.back().state != BatchState::RECORDING)
+	{
+		return m_nextTicket - 1;
+	}
+
+	Batch& batch = m_batches.back();
+	VulkanCommandUtil::endCommandBuffer(batch.transferCmdBuffer);
+	if (usesDedicatedTransferQueue())
+	{
+		// Nothing else submits to the transfer queue, the lock is all the synchronization it needs
+		VulkanCommandUtil::endCommandBuffer(batch.graphicsCmdBuffer);
+		VulkanCommandUtil::submitToQueueSynced(m_transferQueue, 1, &batch.transferCmdBuffer,
+			0, nullptr, nullptr, 1, &batch.transferFinished, batch.fence);
+		batch.state = BatchState::TRANSFERRING;
+	}
+	else
+	{
+		// Goes to the graphics queue with the next update() or flush()
+		batch.state = BatchState::SUBMITTED;
+	}
+	return batch.ticket;
+}
+
+bool VulkanUploadQueue::isComplete(uint64_t ticket)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return ticket <= m_lastRetiredTicket;
+}
+
+void VulkanUploadQueue::flush()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	submitRecordingBatch();
+	advanceBatches(true);
+}
+void VulkanUploadQueue::update()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	advanceBatches(false);
+}
+
+void VulkanUploadQueue::submitToGraphicsQueue(Batch& batch, VkCommandBuffer cmdBuffer, VkSemaphore waitSemaphore)
+{
+	// The copies are known to be done by now, the wait only carries the ownership transfer's dependency and doesn't stall the queue
+	const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+	const uint32_t waitCount = (waitSemaphore != VK_NULL_HANDLE) ? 1 : 0;
+	VulkanCommandUtil::submitToQueueSynced(m_graphicsQueue, 1, &cmdBuffer, waitCount, &waitSemaphore, &waitStage, 0, nullptr, batch.fence);
+	batch.state = BatchState::FINISHING;
+}
+
+void VulkanUploadQueue::advanceBatches(bool wait)
+{
+	for (Batch& batch : m_batches)
+	{
+		if (batch.state == BatchState::SUBMITTED)
+		{
+			submitToGraphicsQueue(batch, batch.transferCmdBuffer, VK_NULL_HANDLE);
+		}
+		else if (batch.state == BatchState::TRANSFERRING)
+		{
+			if (wait)
+			{
+				vkWaitForFences(m_logicalDevice, 1, &batch.fence, VK_TRUE, DEFAULT_FENCE_TIMEOUT);
+			}
+			if (vkGetFenceStatus(m_logicalDevice, batch.fence) == VK_SUCCESS)
+			{
+				// The fence is reused to track the graphics side
+				vkResetFences(m_logicalDevice, 1, &batch.fence);
+				submitToGraphicsQueue(batch, batch.graphicsCmdBuffer, batch.transferFinished);
+			}
+		}
+	}
+
+	// Batches retire in order so a single ticket describes everything that has finished
+	while (!m_batches.empty() && m_batches.front().state == BatchState::FINISHING)
+	{
+		Batch& batch = m_batches.front();
+		if (wait)
+		{
+			vkWaitForFences(m_logicalDevice, 1, &batch.fence, VK_TRUE, DEFAULT_FENCE_TIMEOUT);
+		}
+		if (vkGetFenceStatus(m_logicalDevice, batch.fence) != VK_SUCCESS)
+		{
+			break;
+		}
+		retireBatch(batch);
+		m_batches.pop_front();
+	}
+}
+
+void VulkanUploadQueue::retireBatch(Batch& batch)
+{
+	vkFreeCommandBuffers(m_logicalDevice, m_transferCmdPool, 1, &batch.transferCmdBuffer);
+	if (batch.graphicsCmdBuffer != VK_NULL_HANDLE)
+	{
+		vkFreeCommandBuffers(m_logicalDevice, m_graphicsCmdPool, 1, &batch.graphicsCmdBuffer);
+	}
+	if (batch.transferFinished != VK_NULL_HANDLE)
+	{
+		vkDestroySemaphore(m_logicalDevice, batch.transferFinished, nullptr);
+	}
+	vkDestroyFence(m_logicalDevice, batch.fence, nullptr);
+
+	for (auto& staging : batch.stagingBuffers)
+	{
+		vkDestroyBuffer(m_logicalDevice, staging.first, nullptr);
+		VulkanMemoryTracker::free(m_logicalDevice, staging.second);
+	}
+
+	m_lastRetiredTicket = batch.ticket;
+}
+
+uint64_t VulkanUploadQueue::getLatestTicket()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_nextTicket - 1;
+}
+uint64_t VulkanUploadQueue::getCompletedTicket()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_lastRetiredTicket;
+}
+
+uint32_t VulkanUploadQueue::getNumBatchesInFlight()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	uint32_t numBatches = 0;
+	for (const Batch& batch : m_batches)
+	{
+		numBatches += (batch.state != BatchState::RECORDING) ? 1 : 0;
+	}
+	return numBatches;
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <global.h>
+#include <mutex>
+#include <deque>
+
+// Copies staging buffers into device local buffers and images without stalling the queues the renderer submits frames to.
+// Uploads are recorded into the open batch and submitted together, every batch is one command buffer per queue and one fence.
+//
+// With a dedicated transfer queue family the copies run on the transfer queue alongside rendering. The transfer queue releases
+// the destination resources, and once the copies are done update() submits the matching acquire on the graphics queue
+// (queue family ownership transfer) together with the work a transfer queue can't do, i.e. generating mip maps.
+// Without one the whole batch runs on the graphics queue, it still doesn't block the CPU.
+//
+// Recording and submitting batches is thread safe so loaders can run on worker threads. Anything that submits to the graphics queue
+// (update and flush) has to be called from the thread that submits the frames, submits to the same queue must be externally synchronized.
+class VulkanUploadQueue
+{
+public:
+	VulkanUploadQueue() = delete;
+	VulkanUploadQueue(VkDevice logicalDevice, VkPhysicalDevice physicalDevice,
+		VkQueue transferQueue, uint32_t transferFamily, VkQueue graphicsQueue, uint32_t graphicsFamily);
+	~VulkanUploadQueue();
+
+	VulkanUploadQueue(const VulkanUploadQueue&) = delete;
+	VulkanUploadQueue& operator=(const VulkanUploadQueue&) = delete;
+
+	bool usesDedicatedTransferQueue() const { return m_transferFamily != m_graphicsFamily; }
+
+	// The staging buffer belongs to the upload queue from here on, it is destroyed once the batch has finished
+	void uploadBuffer(VkBuffer stagingBuffer, VkDeviceMemory stagingMemory, VkBuffer dstBuffer, VkDeviceSize size);
+	// Fills mip level 0 of a single layer 2D image from tightly packed texels, the image ends up in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+	// With generateMipMaps the rest of the mip chain is blitted from level 0, otherwise the image is expected to have a single mip level.
+	void uploadImage(VkBuffer stagingBuffer, VkDeviceMemory stagingMemory, VkImage dstImage, VkFormat format,
+		uint32_t width, uint32_t height, uint32_t mipLevels, bool generateMipMaps);
+
+	// Submits everything recorded since the last submit, returns the ticket of that batch or of the last batch if nothing was recorded
+	uint64_t submit();
+	// The batch and every batch before it have finished, the resources they uploaded can be used by anything submitted from now on
+	bool isComplete(uint64_t ticket);
+	// Submits the open batch and blocks until every batch has finished, for uploads that have to be done before rendering starts
+	void flush();
+
+	// Moves batches along without blocking: submits the graphics side of batches whose copies have finished
+	// and retires the batches that are done. Call once per frame.
+	void update();
+
+	// Ticket of the newest batch, including the one that is still recording, i.e. the last batch that can touch a resource that exists now
+	uint64_t getLatestTicket();
+	uint64_t getCompletedTicket();
+
+	// Stats
+	uint32_t getNumBatchesInFlight();
+	uint64_t getUploadedBytes() const { return m_uploadedBytes; }
+
+private:
+	enum class BatchState { RECORDING, SUBMITTED, TRANSFERRING, FINISHING };
+
+	struct Batch
+	{
+		uint64_t ticket;
+		BatchState state = BatchState::RECORDING;
+		// The transfer side records the copies, the graphics side the acquires and the mip generation.
+		// Without a dedicated transfer queue there is only the transfer side and it is allocated from the graphics family.
+		VkCommandBuffer transferCmdBuffer = VK_NULL_HANDLE;
+		VkCommandBuffer graphicsCmdBuffer = VK_NULL_HANDLE;
+		VkSemaphore transferFinished = VK_NULL_HANDLE;
+		VkFence fence = VK_NULL_HANDLE;
+		std::vector<std::pair<VkBuffer, VkDeviceMemory>> stagingBuffers;
+	};
+
+	Batch& getRecordingBatch();
+	uint64_t submitRecordingBatch();
+	void submitToGraphicsQueue(Batch& batch, VkCommandBuffer cmdBuffer, VkSemaphore waitSemaphore);
+	void advanceBatches(bool wait);
+	void retireBatch(Batch& batch);
+
+private:
+	VkDevice m_logicalDevice;
+	VkPhysicalDevice m_physicalDevice;
+	VkQueue m_transferQueue;
+	VkQueue m_graphicsQueue;
+	uint32_t m_transferFamily;
+	uint32_t m_graphicsFamily;
+
+	VkCommandPool m_transferCmdPool;
+	VkCommandPool m_graphicsCmdPool = VK_NULL_HANDLE; // Only with a dedicated transfer queue
+
+	std::mutex m_mutex;
+	std::deque<Batch> m_batches; // Oldest first, the last one may still be recording
+	uint64_t m_nextTicket = 1;
+	uint64_t m_lastRetiredTicket = 0;
+	uint64_t m_uploadedBytes = 0;
+};
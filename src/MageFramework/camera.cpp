@@ -1,17 +1,17 @@
 #include "camera.h"
 
 Camera::Camera(std::shared_ptr<VulkanManager> vulkanManager, glm::vec3 eyePos, glm::vec3 lookAtPoint, int width, int height,
-	float foV_vertical, float aspectRatio, float nearClip, float farClip, int numSwapChainImages, CameraMode mode, RENDER_TYPE renderType)
+	float foV_vertical, float aspectRatio, float nearClip, float farClip, int numFramesInFlight, CameraMode mode, RENDER_TYPE renderType)
 	: m_vulkanManager(vulkanManager), m_logicalDevice(m_vulkanManager->getLogicalDevice()), m_physicalDevice(m_vulkanManager->getPhysicalDevice()),
-	m_numSwapChainImages(numSwapChainImages), m_mode(mode), m_renderType(renderType),
+	m_numFramesInFlight(numFramesInFlight), m_mode(mode), m_renderType(renderType),
 	m_eyePos(eyePos), m_ref(lookAtPoint), m_width(width), m_height(height),
 	m_fovy(foV_vertical), m_aspect(aspectRatio), m_near_clip(nearClip), m_far_clip(farClip)
 {
 	m_worldUp = glm::vec3(0, 1, 0);
 	recomputeAttributes();
 
-	m_cameraUniforms.resize(m_numSwapChainImages);
-	for (int i = 0; i < numSwapChainImages; i++)
+	m_cameraUniforms.resize(m_numFramesInFlight);
+	for (int i = 0; i < numFramesInFlight; i++)
 	{
 		BufferUtil::createMageBuffer(m_logicalDevice, m_physicalDevice,	m_cameraUniforms[i].cameraUB, 
 			sizeof(CameraUniformBlock),	nullptr, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
@@ -21,21 +21,24 @@ Camera::Camera(std::shared_ptr<VulkanManager> vulkanManager, glm::vec3 eyePos, g
 	}
 }
 
-Camera::Camera(std::shared_ptr<VulkanManager> vulkanManager, JSONItem::Camera& jsonCam, int numSwapChainImages, CameraMode mode, RENDER_TYPE renderType)
+Camera::Camera(std::shared_ptr<VulkanManager> vulkanManager, JSONItem::Camera& jsonCam, int numFramesInFlight, CameraMode mode, RENDER_TYPE renderType)
 	: Camera( vulkanManager, jsonCam.eyePos, jsonCam.lookAtPoint, jsonCam.width, jsonCam.height,
-		jsonCam.foV_vertical, jsonCam.aspectRatio, jsonCam.nearClip, jsonCam.farClip, numSwapChainImages, mode, renderType)
+		jsonCam.foV_vertical, jsonCam.aspectRatio, jsonCam.nearClip, jsonCam.farClip, numFramesInFlight, mode, renderType)
 {};
 
 Camera::~Camera()
 {
-	vkDeviceWaitIdle(m_logicalDevice);
-
-	vkDestroyDescriptorSetLayout(m_logicalDevice, m_DSL_camera, nullptr);
-	for (unsigned int i = 0; i < m_numSwapChainImages; i++)
+	// Frames in flight may still read the uniform buffers, they go once those frames have finished
+	VkDevice logicalDevice = m_logicalDevice;
+	m_vulkanManager->deferDestruction([logicalDevice, DSL_camera = m_DSL_camera, cameraUniforms = m_cameraUniforms]() mutable
 	{
-		m_cameraUniforms[i].cameraUB.unmap(m_logicalDevice);
-		m_cameraUniforms[i].cameraUB.destroy(m_logicalDevice);
-	}
+		vkDestroyDescriptorSetLayout(logicalDevice, DSL_camera, nullptr);
+		for (CameraUniform& cameraUniform : cameraUniforms)
+		{
+			cameraUniform.cameraUB.unmap(logicalDevice);
+			cameraUniform.cameraUB.destroy(logicalDevice);
+		}
+	});
 }
 
 void Camera::updateUniformBuffer(unsigned int bufferIndex)
@@ -71,6 +74,33 @@ void Camera::copyToGPUMemory(unsigned int bufferIndex)
 	m_cameraUniforms[bufferIndex].cameraUB.copyDataToMappedBuffer(&m_cameraUniforms[bufferIndex].uniformBlock);
 }
 
+uint64_t Camera::addInput(const CameraInput& input)
+{
+	std::lock_guard<std::mutex> lock(m_inputMutex);
+	m_pendingInput.translateLook += input.translateLook;
+	m_pendingInput.translateRight += input.translateRight;
+	m_pendingInput.translateUp += input.translateUp;
+	m_pendingInput.rotateUp += input.rotateUp;
+	m_pendingInput.rotateRight += input.rotateRight;
+	return ++m_pendingInputSerial;
+}
+void Camera::applyPendingInput()
+{
+	CameraInput l_input;
+	{
+		std::lock_guard<std::mutex> lock(m_inputMutex);
+		l_input = m_pendingInput;
+		m_pendingInput = {};
+		m_latchedInputSerial = m_pendingInputSerial;
+	}
+
+	if (l_input.translateLook != 0.0f) { translateAlongLook(l_input.translateLook); }
+	if (l_input.translateRight != 0.0f) { translateAlongRight(l_input.translateRight); }
+	if (l_input.translateUp != 0.0f) { translateAlongUp(l_input.translateUp); }
+	if (l_input.rotateUp != 0.0f) { rotateAboutUp(l_input.rotateUp); }
+	if (l_input.rotateRight != 0.0f) { rotateAboutRight(l_input.rotateRight); }
+}
+
 void Camera::switchCameraMode()
 {
 	if (m_mode == CameraMode::FLY)
@@ -97,6 +127,13 @@ glm::mat4 Camera::getProj() const
 {
 	return glm::perspective(glm::radians(m_fovy), m_width / (float)m_height, m_near_clip, m_far_clip);
 }
+void Camera::setPose(const glm::vec3& eyePos, const glm::vec3& lookAtPoint)
+{
+	m_eyePos = eyePos;
+	m_ref = lookAtPoint;
+	recomputeAttributes();
+}
+
 void Camera::recomputeAttributes()
 {
 	m_forward = glm::normalize(m_ref - m_eyePos);
@@ -203,7 +240,7 @@ void Camera::translateAlongUp(float amt)
 
 void Camera::expandDescriptorPool(std::vector<VkDescriptorPoolSize>& poolSizes)
 {
-	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, m_numSwapChainImages });	// Current Camera State
+	poolSizes.push_back({ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, m_numFramesInFlight });	// Current Camera State
 }
 void Camera::createDescriptors(VkDescriptorPool descriptorPool)
 {
@@ -217,14 +254,14 @@ void Camera::createDescriptors(VkDescriptorPool descriptorPool)
 	}
 
 	// Descriptor Sets
-	for (uint32_t i = 0; i < m_numSwapChainImages; i++)
+	for (uint32_t i = 0; i < m_numFramesInFlight; i++)
 	{
 		DescriptorUtil::createDescriptorSets(m_logicalDevice, descriptorPool, 1, &m_DSL_camera, &m_cameraUniforms[i].DS_camera);
 	}
 }
 void Camera::writeToAndUpdateDescriptorSets()
 {
-	for (uint32_t i = 0; i < m_numSwapChainImages; i++)
+	for (uint32_t i = 0; i < m_numFramesInFlight; i++)
 	{
 		VkWriteDescriptorSet writecameraSetInfo = DescriptorUtil::writeDescriptorSet(
 				m_cameraUniforms[i].DS_camera, 0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &m_cameraUniforms[i].cameraUB.descriptorInfo);
@@ -9,6 +9,7 @@
 #include <Vulkan/Utilities/vRenderUtil.h>
 #include <Vulkan/Utilities/vDescriptorUtil.h>
 #include <Utilities/loadingUtility.h>
+#include <mutex>
 
 struct CameraUniformBlock 
 {
@@ -30,14 +31,24 @@ struct CameraUniform
 
 enum class CameraMode { FLY, ORBIT };
 
+// Camera motion accumulated by input handling until the frame samples it
+struct CameraInput
+{
+	float translateLook = 0.0f;
+	float translateRight = 0.0f;
+	float translateUp = 0.0f;
+	float rotateUp = 0.0f; // degrees
+	float rotateRight = 0.0f; // degrees
+};
+
 class Camera
 {
 public:
 	Camera() = delete;	// https://stackoverflow.com/questions/5513881/meaning-of-delete-after-function-declaration
 	Camera(std::shared_ptr<VulkanManager> vulkanManager, glm::vec3 eyePos, glm::vec3 lookAtPoint, int width, int height,
-		float foV_vertical, float aspectRatio, float nearClip, float farClip, int numSwapChainImages, CameraMode mode = CameraMode::FLY,
+		float foV_vertical, float aspectRatio, float nearClip, float farClip, int numFramesInFlight, CameraMode mode = CameraMode::FLY,
 		RENDER_TYPE renderType = RENDER_TYPE::RASTERIZATION);
-	Camera(std::shared_ptr<VulkanManager> vulkanManager, JSONItem::Camera& jsonCam, int numSwapChainImages, CameraMode mode = CameraMode::FLY,
+	Camera(std::shared_ptr<VulkanManager> vulkanManager, JSONItem::Camera& jsonCam, int numFramesInFlight, CameraMode mode = CameraMode::FLY,
 		RENDER_TYPE renderType = RENDER_TYPE::RASTERIZATION);
 	~Camera();
 
@@ -46,10 +57,21 @@ public:
 	void updateUniformBuffer(Camera* cam, unsigned int dstCamBufferIndex, unsigned int srcCamBufferIndex);
 	void copyToGPUMemory(unsigned int bufferIndex);
 
+	// Input -- handlers only accumulate motion, the renderer applies it in one go when the frame samples its input (see Renderer::renderLoop).
+	// addInput is thread safe and returns a serial that getLatchedInputSerial() reaches once a frame has applied the input.
+	uint64_t addInput(const CameraInput& input);
+	void applyPendingInput();
+	uint64_t getLatchedInputSerial() const { return m_latchedInputSerial; }
+
 	inline CameraMode getCameraMode() { return m_mode; };
 	inline void setCameraMode(CameraMode mode) { m_mode = mode; };
 	void switchCameraMode();
 
+	// Camera paths drive the camera through its pose, this bypasses the accumulated input
+	glm::vec3 getEyePos() const { return m_eyePos; }
+	glm::vec3 getLookAtPoint() const { return m_ref; }
+	void setPose(const glm::vec3& eyePos, const glm::vec3& lookAtPoint);
+
 	glm::mat4 getView() const;
 	glm::mat4 getProj() const;
 	glm::mat4 getViewProj() const;
@@ -76,14 +98,19 @@ private:
 	std::shared_ptr<VulkanManager> m_vulkanManager; //member variable because it is needed for the destructor
 	VkDevice m_logicalDevice;
 	VkPhysicalDevice m_physicalDevice;
-	unsigned int m_numSwapChainImages;
+	unsigned int m_numFramesInFlight;
 	CameraMode m_mode;
 	RENDER_TYPE m_renderType;
 
-	// Maintains a camera UBO for every image in the swap chain. So assuming you do atleast double buffering, which is basically guaranteed
-	// but still important enough to be called out, you have access to the previous camera state
+	// Maintains a camera UBO for every frame in flight. So with at least two frames in flight
+	// you have access to the previous camera state
 	std::vector<CameraUniform> m_cameraUniforms;
 
+	std::mutex m_inputMutex;
+	CameraInput m_pendingInput;
+	uint64_t m_pendingInputSerial = 0;
+	uint64_t m_latchedInputSerial = 0;
+
 	glm::vec3 m_eyePos;
 	glm::vec3 m_ref;      //The point in world space towards which the camera is pointing
 
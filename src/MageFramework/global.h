@@ -19,6 +19,8 @@
 #include <glm/gtc/matrix_access.hpp>
 
 #include <Utilities/timerUtility.h>
+#include <Utilities/cpuProfiler.h>
+#include <Utilities/heapTracker.h>
 #include <ForwardDeclaration/vulkanForward.h>
 #include <ForwardDeclaration/renderforward.h>
 #include <ForwardDeclaration/rayTracingForward.h>
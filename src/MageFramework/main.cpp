@@ -1,245 +1,210 @@
 #pragma once
-#include <global.h>
-#include <Vulkan/vulkanManager.h>
+#include "playgroundApplication.h"
+#include <Utilities/cloudNoiseUtility.h>
 
-#include "UIManager.h"
-#include "camera.h"
-#include "renderer.h"
+int main(int argc, char** argv)
+{
+	CpuProfiler::setThreadName("Main");
 
-std::shared_ptr<VulkanManager> vulkanManager;
-std::shared_ptr<Renderer> renderer;
-std::shared_ptr<Camera> camera;
+	// --cpu-profiler-bench prints what a CPU profiler zone costs switched off and on, and fails if a switched off zone costs more than 1 ns
+	// (meant for release builds, debug builds don't inline the check)
+	if (argc > 1 && std::string(argv[1]) == "--cpu-profiler-bench")
+	{
+		return CpuProfiler::benchmarkOverhead(100000000, 1.0) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
 
-namespace InputUtil
-{
-	void resizeCallback(GLFWwindow* window, int width, int height)
+	// --noise-benchmark bakes the cloud noise volumes across thread counts and checks that every bake is byte identical
+	if (argc > 1 && std::string(argv[1]) == "--noise-benchmark")
+	{
+		const bool lowFrequencyMatches = CloudNoiseUtil::benchmarkAndVerifyDeterminism(CloudNoiseUtil::lowFrequencyDefaults());
+		const bool highFrequencyMatches = CloudNoiseUtil::benchmarkAndVerifyDeterminism(CloudNoiseUtil::highFrequencyDefaults());
+		return (lowFrequencyMatches && highFrequencyMatches) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	// --texture-array-test packs synthetic images with the TextureArrayBuilder and checks their slots, layers and texture coordinates
+	if (argc > 1 && std::string(argv[1]) == "--texture-array-test")
 	{
-		renderer->m_windowResized = true;
-		//renderer->recreate();
+		return TextureArrayBuilder::verifyPacking() ? EXIT_SUCCESS : EXIT_FAILURE;
 	}
 
-	static bool leftMouseDown = false;
-	static bool changeCameraMode = false;
-	static double previousX = 0.0f;
-	static double previousY = 0.0f;
-	static float deltaForRotation = 0.4f;
-	static float deltaForMovement = 0.015f;
+	GraphicsPlaygroundApplication app;
+	// --record-benchmark records a synthetic 10k model scene into secondary command buffers on 1, 2, 4 and 8 threads
+	const bool recordBenchmark = (argc > 1 && std::string(argv[1]) == "--record-benchmark");
+	// --record-budget renders Sponza re-recording every frame and fails if recording takes more than 1 ms on average
+	const bool recordBudget = (argc > 1 && std::string(argv[1]) == "--record-budget");
+	// --frame-wait renders Sponza and prints how long the CPU waited on the GPU per frame and what the frame's submission cost,
+	// add "fences" to compare against the fallback
+	const bool frameWaitReport = (argc > 1 && std::string(argv[1]) == "--frame-wait");
+	// --latency-sweep renders Sponza with every present mode and frames in flight count and prints throughput and input to GPU completion latency
+	const bool latencySweep = (argc > 1 && std::string(argv[1]) == "--latency-sweep");
+	// --stream-model loads a model while Sponza renders, once on the render thread and once streamed from a worker thread,
+	// and prints the frame time spikes of both
+	const bool streamingReport = (argc > 1 && std::string(argv[1]) == "--stream-model");
+	// --resource-churn creates and drops a texture and a buffer every frame for 1000 frames while Sponza renders,
+	// and fails if dropping them ever stalls or anything is left behind
+	const bool resourceChurn = (argc > 1 && std::string(argv[1]) == "--resource-churn");
+	// --input-replay feeds synthetic camera input from another thread and prints the motion to photon latency
+	// with the camera latched before acquire and late latched
+	const bool inputReplay = (argc > 1 && std::string(argv[1]) == "--input-replay");
+	// --gpu-profile renders Sponza, prints the GPU time of every pass and writes them to a CSV file, gpu_pass_timings.csv unless one is given
+	const bool gpuProfile = (argc > 1 && std::string(argv[1]) == "--gpu-profile");
+	// --cpu-trace loads and renders Sponza with the CPU profiler capturing and writes a Chrome trace, cpu_trace.json unless one is given
+	const bool cpuTrace = (argc > 1 && std::string(argv[1]) == "--cpu-trace");
+	// --headless [scene.json] [frames] [config] renders the scene (Sponza and 300 frames unless given) without a window and prints frame time stats,
+	// runs on any Vulkan device including CPU implementations like lavapipe, falling back to rasterization without ray tracing
+	const bool headless = (argc > 1 && std::string(argv[1]) == "--headless");
+	// --sweep [config] renders every combination of the config's sweep values headless in one process, reusing the loaded assets,
+	// and prints a table comparing their frame times (Sponza and 300 frames per run unless given)
+	const bool sweep = (argc > 1 && std::string(argv[1]) == "--sweep");
+	// Without any of these the scene opens in a window. Any run takes the config arguments described in Utilities/rendererConfig.h,
+	// e.g. --config myConfig.json --scene gltfTestSponza.json --resolution 1280x720 renderType=RASTERIZATION FXAA=true
+	// --record-camera-path [scene.json] [path.json] opens the scene with the camera path recording, closing the window saves it
+	// (camera_path.json unless given). P starts and stops recording in any interactive run.
+	const bool recordCameraPath = (argc > 1 && std::string(argv[1]) == "--record-camera-path");
+	// --camera-path-bench [path.json] [scene.json] [out.csv] flies the camera along the path at a fixed 60 Hz step without a window
+	// and writes per frame CPU time, GPU pass times, draws and device memory to a CSV file, camera_path_bench.csv unless given.
+	// Defaults to the Sponza flythrough.
+	const bool cameraPathBench = (argc > 1 && std::string(argv[1]) == "--camera-path-bench");
+	// --regression [suite.json] [update] renders the suite's scenes and camera poses headless, compares the final images against golden PNGs
+	// (PSNR and SSIM) and the frame times against a baseline, and fails on either regressing. "update" writes new goldens and a new baseline.
+	// Defaults to src/Assets/Regression/regressionSuite.json, meant to run on lavapipe so it needs no GPU.
+	// A case without a golden image or baseline timings is skipped rather than failed, the run then exits with REGRESSION_SKIPPED_EXIT_CODE.
+	const bool regression = (argc > 1 && std::string(argv[1]) == "--regression");
+	// --capture-bench [frames] renders Sponza at 1280x720 headless without capturing, capturing every frame as PNG and as raw RGBA,
+	// and prints the frame rate and what capturing costs the frame loop per frame (60 frames per run unless given)
+	const bool captureBench = (argc > 1 && std::string(argv[1]) == "--capture-bench");
+	// --heap-report [frames] loads and renders Sponza headless with the heap tracker on and prints the live and peak CPU memory per subsystem,
+	// the allocations per frame once the frame loop has settled and the render thread's allocations in those frames (300 frames unless given).
+	// Needs a build configured with -DMAGE_HEAP_TRACKER=ON.
+	const bool heapReport = (argc > 1 && std::string(argv[1]) == "--heap-report");
+	// --pass-stats [out.csv] [frames] renders Sponza headless and writes every frame's command counters and pipeline statistics per pass
+	// to a CSV file (gpu_pass_statistics.csv and 300 frames unless given), then prints the last frame's
+	const bool passStatistics = (argc > 1 && std::string(argv[1]) == "--pass-stats");
+	// --noise-upload [cacheFolder] bakes both cloud noise volumes with mips into 3D textures, once with an empty cache and once from the cache,
+	// prints both times and fails if the cache wasn't used (noise_cache/ unless given)
+	const bool noiseUpload = (argc > 1 && std::string(argv[1]) == "--noise-upload");
+	// --volume-load loads the cloud noise slices in Assets/Textures/CloudTextures into 3D textures and prints the decode + upload time
+	// next to a serial stb decode of the same slices
+	const bool volumeLoad = (argc > 1 && std::string(argv[1]) == "--volume-load");
 
-	void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+	try
 	{
-		if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
+		if (recordBenchmark)
 		{
-			glfwSetWindowShouldClose(window, true);
+			app.runDrawRecordingBenchmark(10000);
+			return EXIT_SUCCESS;
 		}
-
-		if (key == GLFW_KEY_M && action == GLFW_PRESS)
+		if (recordBudget)
 		{
-			changeCameraMode = true;
-			camera->switchCameraMode();
+			return app.runRecordBudgetTest(300, 1.0f) ? EXIT_SUCCESS : EXIT_FAILURE;
 		}
-	}
-
-	void keyboardInputs(GLFWwindow* window)
-	{
-		if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
-			camera->translateAlongLook(deltaForMovement);
-		}
-		if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
-			camera->translateAlongLook(-deltaForMovement);
+		if (frameWaitReport)
+		{
+			const bool useTimelineSemaphores = !(argc > 2 && std::string(argv[2]) == "fences");
+			app.runFrameWaitReport(300, useTimelineSemaphores);
+			return EXIT_SUCCESS;
 		}
-
-		if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
-			camera->translateAlongRight(-deltaForMovement);
+		if (latencySweep)
+		{
+			app.runLatencySweep(300);
+			return EXIT_SUCCESS;
 		}
-		if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
-			camera->translateAlongRight(deltaForMovement);
+		if (streamingReport)
+		{
+			app.runStreamingReport(600);
+			return EXIT_SUCCESS;
 		}
-
-		if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) {
-			camera->translateAlongUp(deltaForMovement);
+		if (resourceChurn)
+		{
+			return app.runResourceChurnTest(1000) ? EXIT_SUCCESS : EXIT_FAILURE;
 		}
-		if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) {
-			camera->translateAlongUp(-deltaForMovement);
+		if (inputReplay)
+		{
+			app.runInputReplay(600);
+			return EXIT_SUCCESS;
 		}
-
-		if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS) {
-			camera->rotateAboutRight(deltaForRotation);
+		if (gpuProfile)
+		{
+			const std::string csvPath = (argc > 2) ? argv[2] : "gpu_pass_timings.csv";
+			return app.runGpuProfile(300, csvPath) ? EXIT_SUCCESS : EXIT_FAILURE;
 		}
-		if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS) {
-			camera->rotateAboutRight(-deltaForRotation);
+		if (cpuTrace)
+		{
+			const std::string tracePath = (argc > 2) ? argv[2] : "cpu_trace.json";
+			return app.runCpuTrace(300, tracePath) ? EXIT_SUCCESS : EXIT_FAILURE;
 		}
-		if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS) {
-			camera->rotateAboutUp(deltaForRotation);
+		if (recordCameraPath)
+		{
+			const std::string sceneFile = (argc > 2) ? argv[2] : "gltfTestSponza.json";
+			const std::string pathFile = (argc > 3) ? argv[3] : "camera_path.json";
+			app.runCameraPathRecording(sceneFile, pathFile);
+			return EXIT_SUCCESS;
 		}
-		if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) {
-			camera->rotateAboutUp(-deltaForRotation);
+		if (cameraPathBench)
+		{
+			const std::string pathFile = (argc > 2) ? argv[2] : "../../src/Assets/CameraPaths/sponzaFlythrough.json";
+			const std::string sceneFile = (argc > 3) ? argv[3] : "gltfTestSponza.json";
+			const std::string csvPath = (argc > 4) ? argv[4] : "camera_path_bench.csv";
+			return app.runCameraPathBenchmark(pathFile, sceneFile, csvPath) ? EXIT_SUCCESS : EXIT_FAILURE;
 		}
-
-		camera->updateUniformBuffer(vulkanManager->getFrameIndex());
-		camera->copyToGPUMemory(vulkanManager->getFrameIndex());
-	}
-
-	void mouseDownCallback(GLFWwindow* window, int button, int action, int mods)
-	{
-		if (button == GLFW_MOUSE_BUTTON_LEFT) {
-			if (action == GLFW_PRESS) {
-				leftMouseDown = true;
-				glfwGetCursorPos(window, &previousX, &previousY);
-			}
-			else if (action == GLFW_RELEASE) {
-				leftMouseDown = false;
+		if (regression)
+		{
+			std::string suitePath = "../../src/Assets/Regression/regressionSuite.json";
+			bool updateBaseline = false;
+			for (int i = 2; i < argc; i++)
+			{
+				if (std::string(argv[i]) == "update") { updateBaseline = true; }
+				else { suitePath = argv[i]; }
 			}
+			const RegressionResult result = app.runRegressionTest(suitePath, updateBaseline);
+			return (result == RegressionResult::PASSED) ? EXIT_SUCCESS : 
+				((result == RegressionResult::SKIPPED) ? REGRESSION_SKIPPED_EXIT_CODE : EXIT_FAILURE);
 		}
-	}
-
-	void mouseMoveCallback(GLFWwindow* window, double xPosition, double yPosition)
-	{
-		if (leftMouseDown)
+		if (captureBench)
 		{
-			double sensitivity = 0.1;
-			float deltaX = static_cast<float>((previousX - xPosition) * sensitivity);
-			float deltaY = static_cast<float>((previousY - yPosition) * sensitivity);
-			previousX = xPosition;
-			previousY = yPosition;
-
-			camera->rotateAboutUp(deltaX);
-			camera->rotateAboutRight(deltaY);
+			const uint32_t numFrames = (argc > 2) ? static_cast<uint32_t>(std::max(1, std::atoi(argv[2]))) : 60;
+			return app.runCaptureBenchmark(numFrames, "capture_bench") ? EXIT_SUCCESS : EXIT_FAILURE;
 		}
-	}
-
-	void scrollCallback(GLFWwindow* window, double xoffset, double yoffset)
-	{
-		if ((glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS) ||
-			(glfwGetKey(window, GLFW_KEY_RIGHT_CONTROL) == GLFW_PRESS))
+		if (heapReport)
 		{
-			deltaForMovement += static_cast<float>(yoffset) * 0.001f;
-			deltaForMovement = glm::clamp(deltaForMovement, 0.0f, 10.0f);
+			const uint32_t numFrames = (argc > 2) ? static_cast<uint32_t>(std::max(1, std::atoi(argv[2]))) : 300;
+			return app.runHeapReport(numFrames) ? EXIT_SUCCESS : EXIT_FAILURE;
 		}
-		else
+		if (passStatistics)
 		{
-			camera->translateAlongLook(static_cast<float>(yoffset) * 0.05f);
+			const std::string csvPath = (argc > 2) ? argv[2] : "gpu_pass_statistics.csv";
+			const uint32_t numFrames = (argc > 3) ? static_cast<uint32_t>(std::max(1, std::atoi(argv[3]))) : 300;
+			return app.runPassStatistics(numFrames, csvPath) ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+		if (noiseUpload)
+		{
+			const std::string cacheFolder = (argc > 2) ? argv[2] : "noise_cache/";
+			return app.runNoiseVolumeUpload(cacheFolder) ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+		if (volumeLoad)
+		{
+			app.runVolumeLoadReport();
+			return EXIT_SUCCESS;
 		}
-	}
-}
-
-class GraphicsPlaygroundApplication
-{
-public:
-	void run();
-
-private:
-	GLFWwindow* window;
-
-	void initialize();
-	void initWindow(int width, int height, const char* name);
-
-	void mainLoop();
-	void cleanup();
-};
-
-void GraphicsPlaygroundApplication::initWindow(int width, int height, const char* name)
-{
-	if (!glfwInit())
-	{
-		fprintf(stderr, "Failed to initialize GLFW\n");
-		exit(EXIT_FAILURE);
-	}
-
-	if (!glfwVulkanSupported())
-	{
-		fprintf(stderr, "Vulkan not supported\n");
-		exit(EXIT_FAILURE);
-	}
-
-	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-	glfwWindowHint(GLFW_RESIZABLE, GL_TRUE);
-	window = glfwCreateWindow(width, height, name, nullptr, nullptr);
-
-	if (!window)
-	{
-		fprintf(stderr, "Failed to initialize GLFW window\n");
-		glfwTerminate();
-		exit(EXIT_FAILURE);
-	}
-}
-
-void GraphicsPlaygroundApplication::initialize()
-{
-	static constexpr char* applicationName = "Mage Framework";
-	// Loads in the main camera and the scene
-	// JSONContents jsonContent = loadingUtil::loadJSON("gltfTest_box.json");
-	// JSONContents jsonContent = loadingUtil::loadJSON("emptyScene.json");
-	// JSONContents jsonContent = loadingUtil::loadJSON("objTestChalet.json");
-	JSONContents jsonContent = loadingUtil::loadJSON("gltfTest_gltf_and_obj.json");
-	const int window_width = jsonContent.mainCamera.width;
-	const int window_height = jsonContent.mainCamera.height;
-
-	RendererOptions rendererOptions =
-	{
-		RENDER_API::VULKAN, // API
-		RENDER_TYPE::RAYTRACE, // RAYTRACE   RASTERIZATION
-		false, false, false, // Anti-Aliasing 
-		false, 1.0f, // Sample Rate Shading
-		true, 16.0f // Anisotropy
-	};
-
-	initWindow(window_width, window_height, applicationName);
-	vulkanManager = std::make_shared<VulkanManager>(window, applicationName);
-
-	TimerUtil::initTimer();
-	camera = std::make_shared<Camera>(vulkanManager, jsonContent.mainCamera, vulkanManager->getSwapChainImageCount(), CameraMode::FLY, rendererOptions.renderType);
-	renderer = std::make_shared<Renderer>(window, vulkanManager, camera, jsonContent.scene, rendererOptions, window_width, window_height);
-
-	glfwSetWindowSizeCallback(window, InputUtil::resizeCallback);
-	glfwSetFramebufferSizeCallback(window, InputUtil::resizeCallback);
-
-	glfwSetKeyCallback(window, InputUtil::key_callback);
-	glfwSetScrollCallback(window, InputUtil::scrollCallback);
-	glfwSetMouseButtonCallback(window, InputUtil::mouseDownCallback);
-	glfwSetCursorPosCallback(window, InputUtil::mouseMoveCallback);
-}
-
-void GraphicsPlaygroundApplication::mainLoop()
-{
-	TIME_POINT frameStartTime;
-	float prevFrameTime = 0.0f;
-
-	// Reference: https://vulkan-tutorial.com/Drawing_a_triangle/Drawing/Rendering_and_presentation
-	while (!glfwWindowShouldClose(window))
-	{
-		frameStartTime = std::chrono::high_resolution_clock::now();
-		//Mouse inputs, window resize callbacks, and certain key press events
-		glfwPollEvents();
-		InputUtil::keyboardInputs(window);
-
-		renderer->renderLoop(prevFrameTime);
-
-		prevFrameTime = TimerUtil::getTimeElapsedSinceStart(frameStartTime);
-	}
-}
-
-void GraphicsPlaygroundApplication::cleanup()
-{
-	// Wait for the device to finish executing before cleanup
-	vkDeviceWaitIdle(vulkanManager->getLogicalDevice());
-	glfwDestroyWindow(window);
-	glfwTerminate();
-}
-
-void GraphicsPlaygroundApplication::run()
-{
-	initialize();
-	mainLoop();
-	cleanup();
-}
-
-int main()
-{
-	GraphicsPlaygroundApplication app;
 
-	try
-	{
-		app.run();
+		RendererConfig config;
+		config.options = defaultRendererOptions();
+		if (headless || sweep)
+		{
+			config.sceneFile = "gltfTestSponza.json";
+		}
+		RendererConfigUtil::parseCommandLine(argc, argv, sweep ? 2 : 1, config);
+		if (sweep)
+		{
+			app.runSweep(config);
+			return EXIT_SUCCESS;
+		}
+		if (config.headless)
+		{
+			app.runHeadless(config);
+			return EXIT_SUCCESS;
+		}
+		app.run(config);
 	}
 	catch (const std::exception& e)
 	{
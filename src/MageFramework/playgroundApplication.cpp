@@ -0,0 +1,462 @@
+#include "playgroundApplication.h"
+
+std::shared_ptr<VulkanManager> vulkanManager;
+std::shared_ptr<Renderer> renderer;
+std::shared_ptr<Camera> camera;
+
+namespace InputUtil
+{
+	void resizeCallback(GLFWwindow* window, int width, int height)
+	{
+		renderer->m_windowResized = true;
+		//renderer->recreate();
+	}
+
+	static bool leftMouseDown = false;
+	static bool changeCameraMode = false;
+	static bool toggleCameraPathRecording = false;
+	static bool takeScreenshot = false;
+	static bool toggleFrameSequence = false;
+	static double previousX = 0.0f;
+	static double previousY = 0.0f;
+	static float deltaForRotation = 0.4f;
+	static float deltaForMovement = 0.015f;
+
+	void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+	{
+		if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
+		{
+			glfwSetWindowShouldClose(window, true);
+		}
+
+		if (key == GLFW_KEY_M && action == GLFW_PRESS)
+		{
+			changeCameraMode = true;
+			camera->switchCameraMode();
+		}
+
+		// Starts recording the camera into a path and on the next press stops and saves it, see mainLoop
+		if (key == GLFW_KEY_P && action == GLFW_PRESS)
+		{
+			toggleCameraPathRecording = true;
+		}
+
+		// F12 saves the next frame, F11 starts and stops saving every frame, see mainLoop
+		if (key == GLFW_KEY_F12 && action == GLFW_PRESS)
+		{
+			takeScreenshot = true;
+		}
+		if (key == GLFW_KEY_F11 && action == GLFW_PRESS)
+		{
+			toggleFrameSequence = true;
+		}
+	}
+
+	// The camera only accumulates the motion, the renderer applies it and writes the camera uniforms when the frame samples its input
+	void keyboardInputs(GLFWwindow* window)
+	{
+		CameraInput input;
+		if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
+			input.translateLook += deltaForMovement;
+		}
+		if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
+			input.translateLook -= deltaForMovement;
+		}
+
+		if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
+			input.translateRight -= deltaForMovement;
+		}
+		if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
+			input.translateRight += deltaForMovement;
+		}
+
+		if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) {
+			input.translateUp += deltaForMovement;
+		}
+		if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) {
+			input.translateUp -= deltaForMovement;
+		}
+
+		if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS) {
+			input.rotateRight += deltaForRotation;
+		}
+		if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS) {
+			input.rotateRight -= deltaForRotation;
+		}
+		if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS) {
+			input.rotateUp += deltaForRotation;
+		}
+		if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) {
+			input.rotateUp -= deltaForRotation;
+		}
+
+		camera->addInput(input);
+	}
+
+	void mouseDownCallback(GLFWwindow* window, int button, int action, int mods)
+	{
+		if (button == GLFW_MOUSE_BUTTON_LEFT) {
+			if (action == GLFW_PRESS) {
+				leftMouseDown = true;
+				glfwGetCursorPos(window, &previousX, &previousY);
+			}
+			else if (action == GLFW_RELEASE) {
+				leftMouseDown = false;
+			}
+		}
+	}
+
+	void mouseMoveCallback(GLFWwindow* window, double xPosition, double yPosition)
+	{
+		if (leftMouseDown)
+		{
+			double sensitivity = 0.1;
+			float deltaX = static_cast<float>((previousX - xPosition) * sensitivity);
+			float deltaY = static_cast<float>((previousY - yPosition) * sensitivity);
+			previousX = xPosition;
+			previousY = yPosition;
+
+			CameraInput input;
+			input.rotateUp = deltaX;
+			input.rotateRight = deltaY;
+			camera->addInput(input);
+		}
+	}
+
+	void scrollCallback(GLFWwindow* window, double xoffset, double yoffset)
+	{
+		if ((glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS) ||
+			(glfwGetKey(window, GLFW_KEY_RIGHT_CONTROL) == GLFW_PRESS))
+		{
+			deltaForMovement += static_cast<float>(yoffset) * 0.001f;
+			deltaForMovement = glm::clamp(deltaForMovement, 0.0f, 10.0f);
+		}
+		else
+		{
+			CameraInput input;
+			input.translateLook = static_cast<float>(yoffset) * 0.05f;
+			camera->addInput(input);
+		}
+	}
+}
+
+RendererOptions defaultRendererOptions()
+{
+	RendererOptions rendererOptions =
+	{
+		RENDER_API::VULKAN, // API
+		RENDER_TYPE::RAYTRACE, // RAYTRACE   RASTERIZATION
+		false, false, false, // Anti-Aliasing 
+		false, 1.0f, // Sample Rate Shading
+		true, 16.0f, // Anisotropy
+		false, // Batch textures into texture arrays
+		false, // Bindless textures
+		false, // Record every frame
+		0,     // Draw recording threads (0 = picked from the scene's size, at most 4)
+		true,  // Timeline semaphores
+		3,     // Frames in flight
+		VK_PRESENT_MODE_MAILBOX_KHR, // Present mode
+		false, // Low latency
+		true,  // Async compute
+		true,  // Dedicated transfer queue
+		true   // Late latch camera
+	};
+	return rendererOptions;
+}
+
+FrameTimeStats computeFrameTimeStats(std::vector<float> frameTimes)
+{
+	FrameTimeStats stats;
+	if (frameTimes.empty())
+	{
+		return stats;
+	}
+
+	std::sort(frameTimes.begin(), frameTimes.end());
+	auto percentile = [&frameTimes](float p)
+	{
+		return frameTimes[std::min(frameTimes.size() - 1, static_cast<size_t>(p * frameTimes.size()))];
+	};
+	for (float frameTime : frameTimes)
+	{
+		stats.average += frameTime / frameTimes.size();
+	}
+	stats.min = frameTimes.front();
+	stats.median = percentile(0.5f);
+	stats.p95 = percentile(0.95f);
+	stats.p99 = percentile(0.99f);
+	stats.max = frameTimes.back();
+	return stats;
+}
+
+void printFrameTimeStats(const char* label, const FrameTimeStats& stats)
+{
+	std::cout << "  " << label << ": average " << stats.average << " ms, min " << stats.min << " ms, median " << stats.median
+		<< " ms, 95th " << stats.p95 << " ms, 99th " << stats.p99 << " ms, max " << stats.max << " ms" << std::endl;
+}
+
+void GraphicsPlaygroundApplication::initWindow(int width, int height, const char* name)
+{
+	if (!glfwInit())
+	{
+		fprintf(stderr, "Failed to initialize GLFW\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (!glfwVulkanSupported())
+	{
+		fprintf(stderr, "Vulkan not supported\n");
+		exit(EXIT_FAILURE);
+	}
+
+	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+	glfwWindowHint(GLFW_RESIZABLE, GL_TRUE);
+	window = glfwCreateWindow(width, height, name, nullptr, nullptr);
+
+	if (!window)
+	{
+		fprintf(stderr, "Failed to initialize GLFW window\n");
+		glfwTerminate();
+		exit(EXIT_FAILURE);
+	}
+}
+
+void GraphicsPlaygroundApplication::initialize(const std::string sceneFile, RendererOptions rendererOptions, bool headless, VkExtent2D resolution)
+{
+	// Loads in the main camera and the scene
+	// JSONContents jsonContent = loadingUtil::loadJSON("gltfTest_box.json");
+	// JSONContents jsonContent = loadingUtil::loadJSON("emptyScene.json");
+	// JSONContents jsonContent = loadingUtil::loadJSON("objTestChalet.json");
+	// JSONContents jsonContent = loadingUtil::loadJSON("gltfTest_gltf_and_obj.json");
+	JSONContents jsonContent = loadScene(sceneFile, resolution);
+	createVulkanManager(jsonContent.mainCamera, rendererOptions, headless);
+	createRenderer(jsonContent, rendererOptions);
+
+	if (headless)
+	{
+		// No window to take input from
+		return;
+	}
+
+	glfwSetWindowSizeCallback(window, InputUtil::resizeCallback);
+	glfwSetFramebufferSizeCallback(window, InputUtil::resizeCallback);
+
+	glfwSetKeyCallback(window, InputUtil::key_callback);
+	glfwSetScrollCallback(window, InputUtil::scrollCallback);
+	glfwSetMouseButtonCallback(window, InputUtil::mouseDownCallback);
+	glfwSetCursorPosCallback(window, InputUtil::mouseMoveCallback);
+
+	// Runs when the frame samples its input, with late latching that's well after the poll at the start of the frame
+	renderer->setInputSampler([this]()
+	{
+		glfwPollEvents();
+		InputUtil::keyboardInputs(window);
+	});
+}
+
+JSONContents GraphicsPlaygroundApplication::loadScene(const std::string& sceneFile, VkExtent2D resolution)
+{
+	JSONContents jsonContent = loadingUtil::loadJSON(sceneFile);
+	if (resolution.width > 0 && resolution.height > 0)
+	{
+		jsonContent.mainCamera.width = static_cast<int>(resolution.width);
+		jsonContent.mainCamera.height = static_cast<int>(resolution.height);
+		jsonContent.mainCamera.aspectRatio = static_cast<float>(resolution.width) / static_cast<float>(resolution.height);
+	}
+	return jsonContent;
+}
+
+void GraphicsPlaygroundApplication::createVulkanManager(const JSONItem::Camera& sceneCamera, const RendererOptions& rendererOptions, bool headless)
+{
+	static constexpr char* applicationName = "Mage Framework";
+	const int window_width = sceneCamera.width;
+	const int window_height = sceneCamera.height;
+
+	if (headless)
+	{
+		window = nullptr;
+		const VkExtent2D offscreenExtent = { static_cast<uint32_t>(window_width), static_cast<uint32_t>(window_height) };
+		vulkanManager = std::make_shared<VulkanManager>(offscreenExtent, applicationName,
+			rendererOptions.framesInFlight, rendererOptions.asyncCompute, rendererOptions.dedicatedTransfer);
+	}
+	else
+	{
+		initWindow(window_width, window_height, applicationName);
+		vulkanManager = std::make_shared<VulkanManager>(window, applicationName,
+			rendererOptions.framesInFlight, rendererOptions.presentMode, rendererOptions.asyncCompute, rendererOptions.dedicatedTransfer);
+	}
+}
+
+void GraphicsPlaygroundApplication::createRenderer(JSONContents& jsonContent, RendererOptions rendererOptions)
+{
+	TimerUtil::initTimer();
+	camera = std::make_shared<Camera>(vulkanManager, jsonContent.mainCamera, vulkanManager->getNumFramesInFlight(), CameraMode::FLY, rendererOptions.renderType);
+	renderer = std::make_shared<Renderer>(window, vulkanManager, camera, jsonContent.scene, rendererOptions,
+		jsonContent.mainCamera.width, jsonContent.mainCamera.height);
+}
+
+void GraphicsPlaygroundApplication::mainLoop()
+{
+	TIME_POINT frameStartTime;
+	float prevFrameTime = 0.0f;
+
+	// Reference: https://vulkan-tutorial.com/Drawing_a_triangle/Drawing/Rendering_and_presentation
+	while (!glfwWindowShouldClose(window))
+	{
+		frameStartTime = std::chrono::high_resolution_clock::now();
+		//Mouse inputs, window resize callbacks, and certain key press events
+		renderer->prepareInputSampling();
+		glfwPollEvents();
+
+		renderer->renderLoop(prevFrameTime);
+
+		if (InputUtil::toggleCameraPathRecording)
+		{
+			InputUtil::toggleCameraPathRecording = false;
+			recordingCameraPath ? stopCameraPathRecording() : startCameraPathRecording();
+		}
+		if (recordingCameraPath)
+		{
+			recordCameraPathKeyframe(false);
+		}
+		updateFrameCapture();
+
+		prevFrameTime = TimerUtil::getTimeElapsedSinceStart(frameStartTime);
+	}
+
+	if (recordingCameraPath)
+	{
+		stopCameraPathRecording();
+	}
+}
+
+FrameRun GraphicsPlaygroundApplication::runFrames(uint32_t numFrames, const std::function<void(uint32_t frame, float frameTime)>& afterFrame,
+	uint32_t numWarmUpFrames, const std::function<void(uint32_t frame)>& beforeFrame)
+{
+	FrameRun run;
+	run.frameTimes.reserve(numFrames);
+	float prevFrameTime = 0.0f;
+	TIME_POINT runStartTime = std::chrono::high_resolution_clock::now();
+	for (uint32_t frame = 0; frame < numWarmUpFrames + numFrames && !(window && glfwWindowShouldClose(window)); frame++)
+	{
+		const bool measured = (frame >= numWarmUpFrames);
+		if (frame == numWarmUpFrames)
+		{
+			runStartTime = std::chrono::high_resolution_clock::now();
+			vulkanManager->getGpuProfiler()->resetStats();
+		}
+
+		TIME_POINT frameStartTime = std::chrono::high_resolution_clock::now();
+		if (measured && beforeFrame)
+		{
+			beforeFrame(frame - numWarmUpFrames);
+		}
+		renderer->prepareInputSampling();
+		if (window)
+		{
+			glfwPollEvents();
+		}
+		renderer->renderLoop(prevFrameTime);
+		prevFrameTime = TimerUtil::getTimeElapsedSinceStart(frameStartTime);
+
+		if (measured)
+		{
+			run.frameTimes.push_back(prevFrameTime);
+			if (afterFrame)
+			{
+				afterFrame(frame - numWarmUpFrames, prevFrameTime);
+			}
+		}
+	}
+	// The frames still in flight are part of the run
+	vulkanManager->waitForPreviousFrame();
+	run.runTime = TimerUtil::getTimeElapsedSinceStart(runStartTime);
+	run.numFrames = static_cast<uint32_t>(run.frameTimes.size());
+	run.frameTimeStats = computeFrameTimeStats(run.frameTimes);
+	return run;
+}
+
+void GraphicsPlaygroundApplication::updateFrameCapture()
+{
+	std::shared_ptr<VulkanFrameCapture> frameCapture = vulkanManager->getFrameCapture();
+	if (InputUtil::takeScreenshot)
+	{
+		InputUtil::takeScreenshot = false;
+		const std::string path = "screenshot_" + std::to_string(numScreenshots++) + ".png";
+		frameCapture->requestScreenshot(path);
+		std::cout << "Saving the next frame to " << path << std::endl;
+	}
+	if (InputUtil::toggleFrameSequence)
+	{
+		InputUtil::toggleFrameSequence = false;
+		if (frameCapture->isCapturingSequence())
+		{
+			frameCapture->stopSequence();
+			const VulkanFrameCapture::Stats stats = frameCapture->getStats();
+			std::cout << "Stopped capturing, " << stats.numCaptured << " frames at " << stats.averageOverheadMs << " ms/frame on the render thread" << std::endl;
+		}
+		else
+		{
+			frameCapture->resetStats();
+			frameCapture->startSequence(frameSequencePrefix);
+			std::cout << "Capturing every frame to " << frameSequencePrefix << "_*.png, press F11 again to stop" << std::endl;
+		}
+	}
+}
+
+void GraphicsPlaygroundApplication::startCameraPathRecording()
+{
+	recordedCameraPath.clear();
+	recordingCameraPath = true;
+	cameraPathRecordStart = std::chrono::high_resolution_clock::now();
+	recordCameraPathKeyframe(true);
+	std::cout << "Recording the camera path, press P again to save it to " << cameraPathFile << std::endl;
+}
+void GraphicsPlaygroundApplication::recordCameraPathKeyframe(bool force)
+{
+	// The splines smooth over the gaps, a keyframe every 100 ms keeps the file small without losing the motion
+	const float keyframeInterval = 0.1f;
+	const float time = TimerUtil::getTimeElapsedSinceStart(cameraPathRecordStart) / 1000.0f;
+	const float lastTime = recordedCameraPath.empty() ? 0.0f : recordedCameraPath.getDuration();
+	if (force || recordedCameraPath.empty() || time - lastTime >= keyframeInterval)
+	{
+		recordedCameraPath.addKeyframe(time, camera->getEyePos(), camera->getLookAtPoint());
+	}
+}
+void GraphicsPlaygroundApplication::stopCameraPathRecording()
+{
+	recordCameraPathKeyframe(true);
+	recordingCameraPath = false;
+	if (recordedCameraPath.save(cameraPathFile))
+	{
+		std::cout << "Saved " << recordedCameraPath.getNumKeyframes() << " keyframes (" << recordedCameraPath.getDuration() << " s) to " << cameraPathFile << std::endl;
+	}
+	else
+	{
+		std::cout << "Failed to write " << cameraPathFile << std::endl;
+	}
+}
+
+void GraphicsPlaygroundApplication::cleanup()
+{
+	// Wait for the device to finish executing before cleanup
+	vkDeviceWaitIdle(vulkanManager->getLogicalDevice());
+
+	// Everything vulkan has to go before the window and its surface, the benchmarks initialize again afterwards
+	renderer.reset();
+	camera.reset();
+	vulkanManager.reset();
+	if (window)
+	{
+		glfwDestroyWindow(window);
+		glfwTerminate();
+		window = nullptr;
+	}
+}
+
+void GraphicsPlaygroundApplication::run(const RendererConfig& config)
+{
+	initialize(config.sceneFile, config.options, false, config.resolution);
+	mainLoop();
+	cleanup();
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <global.h>
+#include <Vulkan/vulkanManager.h>
+
+#include "UIManager.h"
+#include "camera.h"
+#include "renderer.h"
+#include <Utilities/cameraPath.h>
+#include <Utilities/rendererConfig.h>
+
+// Shared by the interactive app and the test and benchmark runs in Tools/, the GLFW callbacks reach them through these
+extern std::shared_ptr<VulkanManager> vulkanManager;
+extern std::shared_ptr<Renderer> renderer;
+extern std::shared_ptr<Camera> camera;
+
+RendererOptions defaultRendererOptions();
+
+struct FrameTimeStats
+{
+	float average = 0.0f;
+	float min = 0.0f;
+	float median = 0.0f;
+	float p95 = 0.0f;
+	float p99 = 0.0f;
+	float max = 0.0f;
+};
+
+FrameTimeStats computeFrameTimeStats(std::vector<float> frameTimes);
+void printFrameTimeStats(const char* label, const FrameTimeStats& stats);
+
+// What GraphicsPlaygroundApplication::runFrames measured, fewer frames than asked for if the window was closed
+struct FrameRun
+{
+	uint32_t numFrames = 0;
+	std::vector<float> frameTimes; // ms, CPU time of every measured frame
+	FrameTimeStats frameTimeStats;
+	float runTime = 0.0f; // ms, from the first measured frame until the GPU finished the last one
+};
+
+// SKIPPED means nothing regressed but a golden image or baseline timings were missing, so some checks couldn't run
+enum class RegressionResult { PASSED, FAILED, SKIPPED };
+// What --regression exits with when it is skipped, CTest reports the test as skipped on it (SKIP_RETURN_CODE in src/CMakeLists.txt)
+const int REGRESSION_SKIPPED_EXIT_CODE = 77;
+
+class GraphicsPlaygroundApplication
+{
+public:
+	void run(const RendererConfig& config);
+
+	// Test and benchmark runs, main() picks one from the command line. Each lives in Tools/ with the runs it belongs with.
+	void runDrawRecordingBenchmark(uint32_t numSyntheticModels);
+	bool runRecordBudgetTest(uint32_t numFrames, float budgetMs);
+	void runFrameWaitReport(uint32_t numFrames, bool useTimelineSemaphores);
+	void runLatencySweep(uint32_t numFrames);
+	void runStreamingReport(uint32_t numFrames);
+	bool runResourceChurnTest(uint32_t numFrames);
+	void runInputReplay(uint32_t numFrames);
+	bool runGpuProfile(uint32_t numFrames, const std::string& csvPath);
+	bool runCpuTrace(uint32_t numFrames, const std::string& tracePath);
+	void runHeadless(const RendererConfig& config);
+	void runSweep(const RendererConfig& config);
+	void runCameraPathRecording(const std::string& sceneFile, const std::string& pathFile);
+	bool runCameraPathBenchmark(const std::string& pathFile, const std::string& sceneFile, const std::string& csvPath);
+	RegressionResult runRegressionTest(const std::string& suitePath, bool updateBaseline);
+	bool runCaptureBenchmark(uint32_t numFrames, const std::string& outputDirectory);
+	bool runHeapReport(uint32_t numFrames);
+	bool runPassStatistics(uint32_t numFrames, const std::string& csvPath);
+	bool runNoiseVolumeUpload(std::string cacheFolder);
+	void runVolumeLoadReport();
+
+private:
+	GLFWwindow* window = nullptr;
+
+	// Camera path recording, toggled with P
+	CameraPath recordedCameraPath;
+	bool recordingCameraPath = false;
+	TIME_POINT cameraPathRecordStart;
+	std::string cameraPathFile = "camera_path.json";
+	void startCameraPathRecording();
+	void recordCameraPathKeyframe(bool force);
+	void stopCameraPathRecording();
+
+	// Frame capture, F12 takes a screenshot and F11 toggles capturing every frame
+	uint32_t numScreenshots = 0;
+	std::string frameSequencePrefix = "capture/frame";
+	void updateFrameCapture();
+
+	// Headless skips the window, the frames render offscreen at the scene camera's resolution unless another one is given
+	void initialize(const std::string sceneFile = "gltfTest_gltf_and_obj.json", RendererOptions rendererOptions = defaultRendererOptions(),
+		bool headless = false, VkExtent2D resolution = { 0, 0 });
+	void initWindow(int width, int height, const char* name);
+	JSONContents loadScene(const std::string& sceneFile, VkExtent2D resolution);
+	void createVulkanManager(const JSONItem::Camera& sceneCamera, const RendererOptions& rendererOptions, bool headless);
+	void createRenderer(JSONContents& jsonContent, RendererOptions rendererOptions);
+
+	void mainLoop();
+	// The frame loop of the test and benchmark runs. Renders numWarmUpFrames that aren't measured, resets the GPU profiler's stats,
+	// then renders and times numFrames. beforeFrame runs at the start of a measured frame, inside its time, and afterFrame at the end
+	// with the frame's CPU time, both get the index of the measured frame. Polls the window unless headless.
+	FrameRun runFrames(uint32_t numFrames, const std::function<void(uint32_t frame, float frameTime)>& afterFrame = nullptr,
+		uint32_t numWarmUpFrames = 10, const std::function<void(uint32_t frame)>& beforeFrame = nullptr);
+	void cleanup();
+};